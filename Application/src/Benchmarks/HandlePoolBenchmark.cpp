@@ -0,0 +1,60 @@
+#include "HandlePoolBenchmark.h"
+#include "ArcaneEngine/Core/HandlePool.h"
+#include "ArcaneEngine/Core/Timer.h"
+#include "ArcaneEngine/Core/Log.h"
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	struct BenchmarkObject
+	{
+		Arc::Handle<BenchmarkObject> Handle;
+	};
+
+	// Releases in a strided order so removals do not always hit the back of the dense array
+	uint32_t StridedIndex(uint32_t i, uint32_t count)
+	{
+		return static_cast<uint32_t>((uint64_t(i) * 7919) % count);
+	}
+}
+
+void RunHandlePoolBenchmark(uint32_t count, uint32_t iterations)
+{
+	// 7919 is prime, so the stride visits every index as long as count is not a multiple of it
+	if (count % 7919 == 0)
+		count++;
+
+	std::vector<BenchmarkObject> objects(count);
+	Arc::HandlePool<BenchmarkObject> pool;
+	std::unordered_map<void*, uint32_t> map;
+	uint64_t checksum = 0;
+
+	Arc::Timer timer;
+	for (uint32_t iteration = 0; iteration < iterations; iteration++)
+	{
+		for (BenchmarkObject& object : objects)
+			object.Handle = pool.Allocate(&object);
+		for (BenchmarkObject& object : objects)
+			checksum += pool.IsValid(object.Handle);
+		for (uint32_t i = 0; i < count; i++)
+			pool.Release(objects[StridedIndex(i, count)].Handle);
+	}
+	double poolTime = timer.elapsed_mili();
+
+	timer.reset_time();
+	for (uint32_t iteration = 0; iteration < iterations; iteration++)
+	{
+		for (BenchmarkObject& object : objects)
+			map[&object] = 0;
+		for (BenchmarkObject& object : objects)
+			checksum += map.contains(&object);
+		for (uint32_t i = 0; i < count; i++)
+			map.erase(&objects[StridedIndex(i, count)]);
+	}
+	double mapTime = timer.elapsed_mili();
+
+	ARC_LOG("Handle benchmark, {} handles x {} iterations (checksum {})", count, iterations, checksum);
+	ARC_LOG("HandlePool: {:.2f} ms, {:.1f} ns per create/validate/destroy", poolTime, poolTime * 1e6 / (double(count) * iterations));
+	ARC_LOG("unordered_map: {:.2f} ms, {:.1f} ns per create/validate/destroy", mapTime, mapTime * 1e6 / (double(count) * iterations));
+}
\ No newline at end of file
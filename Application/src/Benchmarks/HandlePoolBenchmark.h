@@ -0,0 +1,5 @@
+#pragma once
+#include <cstdint>
+
+// Creates, validates and destroys count handles in a HandlePool and in the unordered_map the ResourceCache used before, logging the timings
+void RunHandlePoolBenchmark(uint32_t count = 100000, uint32_t iterations = 10);
\ No newline at end of file
@@ -12,6 +12,10 @@ FluidDynamics::FluidDynamics(Arc::Window* window, Arc::Device* device, Arc::Pres
 	m_PresentQueue = presentQueue;
 	m_ResourceCache = m_Device->GetResourceCache();
 	m_RenderGraph = m_Device->GetRenderGraph();
+	m_RenderGraph->SetPassReordering(true);
+	// The pressure solve adds a hundred passes, their execute functions only read members
+	m_RenderGraph->SetMultithreadedRecording(true);
+	m_RenderGraph->SetPassTimings(true);
 
 	CreatePipelines();
 	CreateSamplers();
@@ -32,29 +36,40 @@ void FluidDynamics::CreatePipelines()
 	m_PresentVertShader = std::make_unique<Arc::Shader>();
 	m_PresentFragShader = std::make_unique<Arc::Shader>();
 
-	Arc::ShaderDesc shaderDesc;
-	if (Arc::ShaderCompiler::Compile("res/Shaders/FluidDynamics/addForces.comp", shaderDesc))
-		m_ResourceCache->CreateShader(m_AddForcesShader.get(), shaderDesc);
-	if (Arc::ShaderCompiler::Compile("res/Shaders/FluidDynamics/paintOverlay.comp", shaderDesc))
-		m_ResourceCache->CreateShader(m_PaintOverlayShader.get(), shaderDesc);
-	if (Arc::ShaderCompiler::Compile("res/Shaders/FluidDynamics/boundary.comp", shaderDesc))
-		m_ResourceCache->CreateShader(m_BoundaryShader.get(), shaderDesc);
-	if (Arc::ShaderCompiler::Compile("res/Shaders/FluidDynamics/fluidDiffusion.comp", shaderDesc))
-		m_ResourceCache->CreateShader(m_DiffusionShader.get(), shaderDesc);
-	if (Arc::ShaderCompiler::Compile("res/Shaders/FluidDynamics/fluidAdvection.comp", shaderDesc))
-		m_ResourceCache->CreateShader(m_FluidAdvectionShader.get(), shaderDesc);
-	if (Arc::ShaderCompiler::Compile("res/Shaders/FluidDynamics/velocityAdvection.comp", shaderDesc))
-		m_ResourceCache->CreateShader(m_VelocityAdvectionShader.get(), shaderDesc);
-	if (Arc::ShaderCompiler::Compile("res/Shaders/FluidDynamics/divergence.comp", shaderDesc))
-		m_ResourceCache->CreateShader(m_DivergenceShader.get(), shaderDesc);
-	if (Arc::ShaderCompiler::Compile("res/Shaders/FluidDynamics/jacobiIteration.comp", shaderDesc))
-		m_ResourceCache->CreateShader(m_PressureSolverShader.get(), shaderDesc);
-	if (Arc::ShaderCompiler::Compile("res/Shaders/FluidDynamics/projection.comp", shaderDesc))
-		m_ResourceCache->CreateShader(m_ProjectionShader.get(), shaderDesc);
-	if (Arc::ShaderCompiler::Compile("res/Shaders/FluidDynamics/shader.vert", shaderDesc))
-		m_ResourceCache->CreateShader(m_PresentVertShader.get(), shaderDesc);
-	if (Arc::ShaderCompiler::Compile("res/Shaders/FluidDynamics/shader.frag", shaderDesc))
-		m_ResourceCache->CreateShader(m_PresentFragShader.get(), shaderDesc);
+	std::vector<std::string> shaderPaths = {
+		"res/Shaders/FluidDynamics/addForces.comp",
+		"res/Shaders/FluidDynamics/paintOverlay.comp",
+		"res/Shaders/FluidDynamics/boundary.comp",
+		"res/Shaders/FluidDynamics/fluidDiffusion.comp",
+		"res/Shaders/FluidDynamics/fluidAdvection.comp",
+		"res/Shaders/FluidDynamics/velocityAdvection.comp",
+		"res/Shaders/FluidDynamics/divergence.comp",
+		"res/Shaders/FluidDynamics/jacobiIteration.comp",
+		"res/Shaders/FluidDynamics/projection.comp",
+		"res/Shaders/FluidDynamics/shader.vert",
+		"res/Shaders/FluidDynamics/shader.frag"
+	};
+	std::vector<Arc::Shader*> shaders = {
+		m_AddForcesShader.get(),
+		m_PaintOverlayShader.get(),
+		m_BoundaryShader.get(),
+		m_DiffusionShader.get(),
+		m_FluidAdvectionShader.get(),
+		m_VelocityAdvectionShader.get(),
+		m_DivergenceShader.get(),
+		m_PressureSolverShader.get(),
+		m_ProjectionShader.get(),
+		m_PresentVertShader.get(),
+		m_PresentFragShader.get()
+	};
+
+	std::vector<Arc::ShaderDesc> shaderDescs;
+	Arc::ShaderCompiler::Compile(shaderPaths, shaderDescs, *m_ResourceCache->GetThreadPool());
+	for (size_t i = 0; i < shaders.size(); i++)
+	{
+		if (!shaderDescs[i].SpirV.empty())
+			m_ResourceCache->CreateShader(shaders[i], shaderDescs[i]);
+	}
 
 	m_PresentPipeline = std::make_unique<Arc::Pipeline>();;
 	m_ResourceCache->CreatePipeline(m_PresentPipeline.get(), Arc::PipelineDesc{
@@ -65,57 +80,35 @@ void FluidDynamics::CreatePipelines()
 	});
 
 	m_AddForcesPipeline = std::make_unique<Arc::ComputePipeline>();
-	m_ResourceCache->CreateComputePipeline(m_AddForcesPipeline.get(), Arc::ComputePipelineDesc{
-		.Shader = m_AddForcesShader.get(),
-		.UsePushDescriptors = true
-	});
-
 	m_PaintOverlayPipeline = std::make_unique<Arc::ComputePipeline>();
-	m_ResourceCache->CreateComputePipeline(m_PaintOverlayPipeline.get(), Arc::ComputePipelineDesc{
-		.Shader = m_PaintOverlayShader.get(),
-		.UsePushDescriptors = true
-	});
-
 	m_BoundaryPipeline = std::make_unique<Arc::ComputePipeline>();
-	m_ResourceCache->CreateComputePipeline(m_BoundaryPipeline.get(), Arc::ComputePipelineDesc{
-		.Shader = m_BoundaryShader.get(),
-		.UsePushDescriptors = true
-	});
-
 	m_DiffusionPipeline = std::make_unique<Arc::ComputePipeline>();
-	m_ResourceCache->CreateComputePipeline(m_DiffusionPipeline.get(), Arc::ComputePipelineDesc{
-		.Shader = m_DiffusionShader.get(),
-		.UsePushDescriptors = true
-	});
-	
 	m_FluidAdvectionPipeline = std::make_unique<Arc::ComputePipeline>();
-	m_ResourceCache->CreateComputePipeline(m_FluidAdvectionPipeline.get(), Arc::ComputePipelineDesc{
-		.Shader = m_FluidAdvectionShader.get(),
-		.UsePushDescriptors = true
-	});
-
 	m_VelocityAdvectionPipeline = std::make_unique<Arc::ComputePipeline>();
-	m_ResourceCache->CreateComputePipeline(m_VelocityAdvectionPipeline.get(), Arc::ComputePipelineDesc{
-		.Shader = m_VelocityAdvectionShader.get(),
-		.UsePushDescriptors = true
-	});
-	
 	m_DivergencePipeline = std::make_unique<Arc::ComputePipeline>();
-	m_ResourceCache->CreateComputePipeline(m_DivergencePipeline.get(), Arc::ComputePipelineDesc{
-		.Shader = m_DivergenceShader.get(),
-		.UsePushDescriptors = true
-	});
-	
 	m_PressureSolverPipeline = std::make_unique<Arc::ComputePipeline>();
-	m_ResourceCache->CreateComputePipeline(m_PressureSolverPipeline.get(), Arc::ComputePipelineDesc{
-		.Shader = m_PressureSolverShader.get(),
-		.UsePushDescriptors = true
-	});
-	
 	m_ProjectionPipeline = std::make_unique<Arc::ComputePipeline>();
-	m_ResourceCache->CreateComputePipeline(m_ProjectionPipeline.get(), Arc::ComputePipelineDesc{
-		.Shader = m_ProjectionShader.get(),
-		.UsePushDescriptors = true
+
+	m_ResourceCache->CreateComputePipelines({
+		m_AddForcesPipeline.get(),
+		m_PaintOverlayPipeline.get(),
+		m_BoundaryPipeline.get(),
+		m_DiffusionPipeline.get(),
+		m_FluidAdvectionPipeline.get(),
+		m_VelocityAdvectionPipeline.get(),
+		m_DivergencePipeline.get(),
+		m_PressureSolverPipeline.get(),
+		m_ProjectionPipeline.get()
+	}, {
+		Arc::ComputePipelineDesc{ .Shader = m_AddForcesShader.get(), .UsePushDescriptors = true },
+		Arc::ComputePipelineDesc{ .Shader = m_PaintOverlayShader.get(), .UsePushDescriptors = true },
+		Arc::ComputePipelineDesc{ .Shader = m_BoundaryShader.get(), .UsePushDescriptors = true },
+		Arc::ComputePipelineDesc{ .Shader = m_DiffusionShader.get(), .UsePushDescriptors = true },
+		Arc::ComputePipelineDesc{ .Shader = m_FluidAdvectionShader.get(), .UsePushDescriptors = true },
+		Arc::ComputePipelineDesc{ .Shader = m_VelocityAdvectionShader.get(), .UsePushDescriptors = true },
+		Arc::ComputePipelineDesc{ .Shader = m_DivergenceShader.get(), .UsePushDescriptors = true },
+		Arc::ComputePipelineDesc{ .Shader = m_PressureSolverShader.get(), .UsePushDescriptors = true },
+		Arc::ComputePipelineDesc{ .Shader = m_ProjectionShader.get(), .UsePushDescriptors = true }
 	});
 }
 
@@ -147,27 +140,17 @@ void FluidDynamics::CreateImages()
 	m_OverlayDispatchSize = glm::ceil(glm::vec2(unscaledW, unscaledH) / 32.0f);
 	float clearColor[4] = { 0, 0, 0, 0 };
 
-	m_Device->WaitIdle();
-
-	if (m_Dye1.get())
-		m_ResourceCache->ReleaseResource(m_Dye1.get());
-	if (m_Dye2.get())
-		m_ResourceCache->ReleaseResource(m_Dye2.get());
+	if (m_Dye)
+		m_RenderGraph->ReleaseHistoryImage(m_Dye);
 
-	m_Dye1 = std::make_unique<Arc::GpuImage>();
-	m_Dye2 = std::make_unique<Arc::GpuImage>();
 	auto dyeDesc = Arc::GpuImageDesc{
 		.Extent = { w, h, 1 },
 		.Format = Arc::Format::R16G16B16A16_Sfloat,
 		.UsageFlags = Arc::ImageUsage::TransferSrc | Arc::ImageUsage::TransferDst | Arc::ImageUsage::Storage | Arc::ImageUsage::Sampled,
 		.AspectFlags = Arc::ImageAspect::Color,
+		.Movable = true,
 	};
-	m_ResourceCache->CreateGpuImage(m_Dye1.get(), dyeDesc);
-	m_ResourceCache->CreateGpuImage(m_Dye2.get(), dyeDesc);
-	m_Device->TransitionImageLayout(m_Dye1.get(), Arc::ImageLayout::General);
-	m_Device->TransitionImageLayout(m_Dye2.get(), Arc::ImageLayout::General);
-	m_Device->ClearColorImage(m_Dye1.get(), clearColor, Arc::ImageLayout::General);
-	m_Device->ClearColorImage(m_Dye2.get(), clearColor, Arc::ImageLayout::General);
+	m_Dye = m_RenderGraph->CreateHistoryImage(dyeDesc);
 
 	if (m_Overlay.get())
 		m_ResourceCache->ReleaseResource(m_Overlay.get());
@@ -178,6 +161,7 @@ void FluidDynamics::CreateImages()
 		.Format = Arc::Format::R8G8B8A8_Unorm,
 		.UsageFlags = Arc::ImageUsage::TransferSrc | Arc::ImageUsage::TransferDst | Arc::ImageUsage::Storage | Arc::ImageUsage::Sampled,
 		.AspectFlags = Arc::ImageAspect::Color,
+		.Movable = true,
 	};
 	m_ResourceCache->CreateGpuImage(m_Overlay.get(), overlayDesc);
 	m_Device->TransitionImageLayout(m_Overlay.get(), Arc::ImageLayout::General);
@@ -192,6 +176,7 @@ void FluidDynamics::CreateImages()
 		.Format = Arc::Format::R8_Uint,
 		.UsageFlags = Arc::ImageUsage::TransferSrc | Arc::ImageUsage::TransferDst | Arc::ImageUsage::Storage | Arc::ImageUsage::Sampled,
 		.AspectFlags = Arc::ImageAspect::Color,
+		.Movable = true,
 	};
 	m_ResourceCache->CreateGpuImage(m_Boundary.get(), boundaryDesc);
 	m_Device->TransitionImageLayout(m_Boundary.get(), Arc::ImageLayout::General);
@@ -206,6 +191,7 @@ void FluidDynamics::CreateImages()
 		.Format = Arc::Format::R8_Uint,
 		.UsageFlags = Arc::ImageUsage::TransferSrc | Arc::ImageUsage::TransferDst | Arc::ImageUsage::Storage | Arc::ImageUsage::Sampled,
 		.AspectFlags = Arc::ImageAspect::Color,
+		.Movable = true,
 	};
 	m_ResourceCache->CreateGpuImage(m_Wall.get(), wallDesc);
 	m_Device->TransitionImageLayout(m_Wall.get(), Arc::ImageLayout::General);
@@ -213,40 +199,17 @@ void FluidDynamics::CreateImages()
 
 
 
-	if (m_Velocity1.get())
-		m_ResourceCache->ReleaseResource(m_Velocity1.get());
-	if (m_Velocity2.get())
-		m_ResourceCache->ReleaseResource(m_Velocity2.get());
+	if (m_Velocity)
+		m_RenderGraph->ReleaseHistoryImage(m_Velocity);
 
-	m_Velocity1 = std::make_unique<Arc::GpuImage>();
-	m_Velocity2 = std::make_unique<Arc::GpuImage>();
 	auto velocityDesc = Arc::GpuImageDesc{
 		.Extent = { w + 1, h + 1, 1 },
 		.Format = Arc::Format::R32G32_Sfloat,
 		.UsageFlags = Arc::ImageUsage::TransferSrc | Arc::ImageUsage::TransferDst | Arc::ImageUsage::Storage | Arc::ImageUsage::Sampled,
 		.AspectFlags = Arc::ImageAspect::Color,
+		.Movable = true,
 	};
-	m_ResourceCache->CreateGpuImage(m_Velocity1.get(), velocityDesc);
-	m_ResourceCache->CreateGpuImage(m_Velocity2.get(), velocityDesc);
-	m_Device->TransitionImageLayout(m_Velocity1.get(), Arc::ImageLayout::General);
-	m_Device->TransitionImageLayout(m_Velocity2.get(), Arc::ImageLayout::General);
-	m_Device->ClearColorImage(m_Velocity1.get(), clearColor, Arc::ImageLayout::General);
-	m_Device->ClearColorImage(m_Velocity2.get(), clearColor, Arc::ImageLayout::General);
-
-	if (m_Divergence.get())
-		m_ResourceCache->ReleaseResource(m_Divergence.get());
-
-	m_Divergence = std::make_unique<Arc::GpuImage>();
-	auto divergenceDesc = Arc::GpuImageDesc{
-		.Extent = { w, h, 1 },
-		.Format = Arc::Format::R32_Sfloat,
-		.UsageFlags = Arc::ImageUsage::TransferSrc | Arc::ImageUsage::TransferDst | Arc::ImageUsage::Storage | Arc::ImageUsage::Sampled,
-		.AspectFlags = Arc::ImageAspect::Color,
-	};
-	m_ResourceCache->CreateGpuImage(m_Divergence.get(), divergenceDesc);
-	m_Device->TransitionImageLayout(m_Divergence.get(), Arc::ImageLayout::General);
-	m_Device->ClearColorImage(m_Divergence.get(), clearColor, Arc::ImageLayout::General);
-
+	m_Velocity = m_RenderGraph->CreateHistoryImage(velocityDesc);
 
 	if (m_Pressure1.get())
 		m_ResourceCache->ReleaseResource(m_Pressure1.get());
@@ -260,6 +223,7 @@ void FluidDynamics::CreateImages()
 		.Format = Arc::Format::R32_Sfloat,
 		.UsageFlags = Arc::ImageUsage::TransferSrc | Arc::ImageUsage::TransferDst | Arc::ImageUsage::Storage | Arc::ImageUsage::Sampled,
 		.AspectFlags = Arc::ImageAspect::Color,
+		.Movable = true,
 	};
 	m_ResourceCache->CreateGpuImage(m_Pressure1.get(), pressureDesc);
 	m_ResourceCache->CreateGpuImage(m_Pressure2.get(), pressureDesc);
@@ -267,6 +231,22 @@ void FluidDynamics::CreateImages()
 	m_Device->TransitionImageLayout(m_Pressure2.get(), Arc::ImageLayout::General);
 	m_Device->ClearColorImage(m_Pressure1.get(), clearColor, Arc::ImageLayout::General);
 	m_Device->ClearColorImage(m_Pressure2.get(), clearColor, Arc::ImageLayout::General);
+
+	// Simulation state is carried into the next frame, so passes writing it must not be culled.
+	// History images are retained by the graph.
+	for (Arc::HistoryImage* historyImage : { m_Dye, m_Velocity })
+	{
+		for (uint32_t i = 0; i < historyImage->GetVersionCount(); i++)
+		{
+			m_Device->TransitionImageLayout(historyImage->GetVersion(i), Arc::ImageLayout::General);
+			m_Device->ClearColorImage(historyImage->GetVersion(i), clearColor, Arc::ImageLayout::General);
+		}
+	}
+	// The pressure solve starts from the result of the previous frame
+	for (Arc::GpuImage* image : { m_Wall.get(), m_Boundary.get(), m_Pressure1.get(), m_Pressure2.get() })
+	{
+		m_RenderGraph->RetainResource(image->GetHandle());
+	}
 	m_ClearFrame = true;
 }
 
@@ -303,98 +283,213 @@ void FluidDynamics::RenderFrame(float elapsedTime)
 
 	if (Arc::Input::IsKeyPressed(Arc::KeyCode::G))
 	{
-		std::vector<uint8_t> imageData = m_Device->GetImageData(m_Dye1.get(), Arc::ImageLayout::General);
+		std::vector<uint8_t> imageData = m_Device->GetImageData(m_Dye->GetPrevious(), Arc::ImageLayout::General);
 		std::string path = "img.png";
 		stbi_write_png(path.c_str(), m_Size.x, m_Size.y, 4, imageData.data(), m_Size.x * 4);
 	}
+	// Graph of the previous frame, pass timings lag behind by the frames in flight
+	if (Arc::Input::IsKeyPressed(Arc::KeyCode::D))
+	{
+		m_RenderGraph->DumpGraph("render_graph.dot");
+		m_RenderGraph->DumpGraph("render_graph.json");
+	}
 
 	m_RenderGraph->AddPass(Arc::RenderPass{
-	.ExecuteFunction = [&](Arc::CommandBuffer* cmd, uint32_t frameIndex) {
-		cmd->PushConstants(Arc::ShaderStage::Compute, m_AddForcesPipeline->GetLayout(), &fluidData, sizeof(fluidData));
-		
-		cmd->BindComputePipeline(m_AddForcesPipeline->GetHandle());
-		cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_AddForcesPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
-			.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, m_Dye1->GetImageView(), Arc::ImageLayout::General, nullptr))
-			.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, m_Velocity1->GetImageView(), Arc::ImageLayout::General, nullptr))
-			.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::StorageImage, m_Wall->GetImageView(), Arc::ImageLayout::General, nullptr)));
-		cmd->Dispatch(m_ThreadDispatchSize.x, m_ThreadDispatchSize.y, 1);
-
-		if (m_ClearFrame || lc || rc)
-		{
-			m_ClearFrame = false;
-			cmd->BindComputePipeline(m_PaintOverlayPipeline->GetHandle());
-			cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_PaintOverlayPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
-				.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, m_Overlay->GetImageView(), Arc::ImageLayout::General, nullptr)));
-			cmd->Dispatch(m_OverlayDispatchSize.x, m_OverlayDispatchSize.y, 1);
-
-			cmd->BindComputePipeline(m_BoundaryPipeline->GetHandle());
-			cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_BoundaryPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
-				.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, m_Wall->GetImageView(), Arc::ImageLayout::General, nullptr))
-				.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, m_Boundary->GetImageView(), Arc::ImageLayout::General, nullptr)));
+		.Name = "AddForces",
+		.ExecuteFunction = [&, dye = m_Dye->GetPrevious(), velocity = m_Velocity->GetPrevious()](Arc::CommandBuffer* cmd, uint32_t frameIndex) {
+			cmd->PushConstants(Arc::ShaderStage::Compute, m_AddForcesPipeline->GetLayout(), &fluidData, sizeof(fluidData));
+			cmd->BindComputePipeline(m_AddForcesPipeline->GetHandle());
+			cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_AddForcesPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
+				.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, dye->GetImageView(), Arc::ImageLayout::General, nullptr))
+				.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, velocity->GetImageView(), Arc::ImageLayout::General, nullptr))
+				.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::StorageImage, m_Wall->GetImageView(), Arc::ImageLayout::General, nullptr)));
 			cmd->Dispatch(m_ThreadDispatchSize.x, m_ThreadDispatchSize.y, 1);
+		},
+		.Outputs = {
+			{ .Image = m_Dye->GetPrevious()->GetHandle(), .Access = Arc::ResourceAccess::StorageReadWrite },
+			{ .Image = m_Velocity->GetPrevious()->GetHandle(), .Access = Arc::ResourceAccess::StorageReadWrite },
+			{ .Image = m_Wall->GetHandle(), .Access = Arc::ResourceAccess::StorageReadWrite },
 		}
+	});
 
-		cmd->BindComputePipeline(m_FluidAdvectionPipeline->GetHandle());
-		cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_FluidAdvectionPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
-			.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, m_Velocity1->GetImageView(), Arc::ImageLayout::General, nullptr))
-			.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, m_Dye1->GetImageView(), Arc::ImageLayout::General, m_LinearSampler->GetHandle()))
-			.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::CombinedImageSampler, m_Dye1->GetImageView(), Arc::ImageLayout::General, m_LinearSampler->GetHandle()))
-			.AddWrite(Arc::PushImageWrite(3, Arc::DescriptorType::StorageImage, m_Boundary->GetImageView(), Arc::ImageLayout::General, nullptr)));
-		cmd->Dispatch(m_ThreadDispatchSize.x, m_ThreadDispatchSize.y, 1);
-		
-		cmd->BindComputePipeline(m_VelocityAdvectionPipeline->GetHandle());
-		cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_VelocityAdvectionPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
-			.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, m_Velocity1->GetImageView(), Arc::ImageLayout::General, nullptr))
-			.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, m_Velocity2->GetImageView(), Arc::ImageLayout::General, nullptr)));
-		cmd->Dispatch(m_VelocityThreadDispatchSize.x, m_VelocityThreadDispatchSize.y, 1);
-		std::swap(m_Velocity1, m_Velocity2);
-
-
-		cmd->BindComputePipeline(m_DivergencePipeline->GetHandle());
-		cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_DivergencePipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
-			.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, m_Velocity1->GetImageView(), Arc::ImageLayout::General, nullptr))
-			.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, m_Divergence->GetImageView(), Arc::ImageLayout::General, nullptr))
-			.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::StorageImage, m_Boundary->GetImageView(), Arc::ImageLayout::General, nullptr)));
-		cmd->Dispatch(m_ThreadDispatchSize.x, m_ThreadDispatchSize.y, 1);
-
-		cmd->BindComputePipeline(m_PressureSolverPipeline->GetHandle());
-		for (size_t i = 0; i < 100; i++)
-		{
-			cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_PressureSolverPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
-				.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, m_Divergence->GetImageView(), Arc::ImageLayout::General, nullptr))
-				.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, m_Pressure1->GetImageView(), Arc::ImageLayout::General, nullptr))
-				.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::StorageImage, m_Pressure2->GetImageView(), Arc::ImageLayout::General, nullptr))
+	if (m_ClearFrame || lc || rc)
+	{
+		m_ClearFrame = false;
+		m_RenderGraph->AddPass(Arc::RenderPass{
+			.Name = "PaintOverlay",
+			.ExecuteFunction = [&](Arc::CommandBuffer* cmd, uint32_t frameIndex) {
+				cmd->PushConstants(Arc::ShaderStage::Compute, m_PaintOverlayPipeline->GetLayout(), &fluidData, sizeof(fluidData));
+				cmd->BindComputePipeline(m_PaintOverlayPipeline->GetHandle());
+				cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_PaintOverlayPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
+					.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, m_Overlay->GetImageView(), Arc::ImageLayout::General, nullptr)));
+				cmd->Dispatch(m_OverlayDispatchSize.x, m_OverlayDispatchSize.y, 1);
+			},
+			.Outputs = {
+				{ .Image = m_Overlay->GetHandle(), .Access = Arc::ResourceAccess::StorageReadWrite },
+			}
+		});
+
+		m_RenderGraph->AddPass(Arc::RenderPass{
+			.Name = "Boundary",
+			.ExecuteFunction = [&](Arc::CommandBuffer* cmd, uint32_t frameIndex) {
+				cmd->BindComputePipeline(m_BoundaryPipeline->GetHandle());
+				cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_BoundaryPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
+					.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, m_Wall->GetImageView(), Arc::ImageLayout::General, nullptr))
+					.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, m_Boundary->GetImageView(), Arc::ImageLayout::General, nullptr)));
+				cmd->Dispatch(m_ThreadDispatchSize.x, m_ThreadDispatchSize.y, 1);
+			},
+			.Inputs = {
+				{ .Image = m_Wall->GetHandle(), .Access = Arc::ResourceAccess::StorageRead },
+			},
+			.Outputs = {
+				{ .Image = m_Boundary->GetHandle(), .Access = Arc::ResourceAccess::StorageWrite },
+			}
+		});
+	}
+
+	m_RenderGraph->AddPass(Arc::RenderPass{
+		.Name = "FluidAdvection",
+		.ExecuteFunction = [&, dye = m_Dye->GetPrevious(), velocity = m_Velocity->GetPrevious()](Arc::CommandBuffer* cmd, uint32_t frameIndex) {
+			cmd->BindComputePipeline(m_FluidAdvectionPipeline->GetHandle());
+			cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_FluidAdvectionPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
+				.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, velocity->GetImageView(), Arc::ImageLayout::General, nullptr))
+				.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, dye->GetImageView(), Arc::ImageLayout::General, m_LinearSampler->GetHandle()))
+				.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::CombinedImageSampler, dye->GetImageView(), Arc::ImageLayout::General, m_LinearSampler->GetHandle()))
 				.AddWrite(Arc::PushImageWrite(3, Arc::DescriptorType::StorageImage, m_Boundary->GetImageView(), Arc::ImageLayout::General, nullptr)));
 			cmd->Dispatch(m_ThreadDispatchSize.x, m_ThreadDispatchSize.y, 1);
-			std::swap(m_Pressure1, m_Pressure2);
+		},
+		.Inputs = {
+			{ .Image = m_Velocity->GetPrevious()->GetHandle(), .Access = Arc::ResourceAccess::StorageRead },
+			{ .Image = m_Dye->GetPrevious()->GetHandle(), .Access = Arc::ResourceAccess::SampledRead, .Layout = Arc::ImageLayout::General },
+			{ .Image = m_Boundary->GetHandle(), .Access = Arc::ResourceAccess::StorageRead },
+		},
+		.Outputs = {
+			{ .Image = m_Dye->GetPrevious()->GetHandle(), .Access = Arc::ResourceAccess::StorageWrite },
+		}
+	});
+
+	m_RenderGraph->AddPass(Arc::RenderPass{
+		.Name = "VelocityAdvection",
+		.ExecuteFunction = [&, velocityIn = m_Velocity->GetPrevious(), velocityOut = m_Velocity->GetCurrent()](Arc::CommandBuffer* cmd, uint32_t frameIndex) {
+			cmd->BindComputePipeline(m_VelocityAdvectionPipeline->GetHandle());
+			cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_VelocityAdvectionPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
+				.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, velocityIn->GetImageView(), Arc::ImageLayout::General, nullptr))
+				.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, velocityOut->GetImageView(), Arc::ImageLayout::General, nullptr)));
+			cmd->Dispatch(m_VelocityThreadDispatchSize.x, m_VelocityThreadDispatchSize.y, 1);
+		},
+		.Inputs = {
+			{ .Image = m_Velocity->GetPrevious()->GetHandle(), .Access = Arc::ResourceAccess::StorageRead },
+		},
+		.Outputs = {
+			{ .Image = m_Velocity->GetCurrent()->GetHandle(), .Access = Arc::ResourceAccess::StorageWrite },
 		}
-			
-		cmd->BindComputePipeline(m_ProjectionPipeline->GetHandle());
-		cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_ProjectionPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
-			.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, m_Velocity1->GetImageView(), Arc::ImageLayout::General, nullptr))
-			.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, m_Pressure1->GetImageView(), Arc::ImageLayout::General, nullptr))
-			.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::StorageImage, m_Boundary->GetImageView(), Arc::ImageLayout::General, nullptr)));
-		cmd->Dispatch(m_VelocityThreadDispatchSize.x, m_VelocityThreadDispatchSize.y, 1);
-
-		cmd->BindComputePipeline(m_DiffusionPipeline->GetHandle());
-		cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_DiffusionPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
-			.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, m_Dye1->GetImageView(), Arc::ImageLayout::General, nullptr))
-			.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, m_Dye2->GetImageView(), Arc::ImageLayout::General, nullptr))
-			.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::StorageImage, m_Boundary->GetImageView(), Arc::ImageLayout::General, nullptr)));
-		cmd->Dispatch(m_ThreadDispatchSize.x, m_ThreadDispatchSize.y, 1);
-		std::swap(m_Dye1, m_Dye2);
-	} });
+	});
+
+	// Divergence only lives until the pressure solve, so its memory is shared through the graph
+	Arc::GpuImage* divergence = m_RenderGraph->CreateTransientImage(Arc::GpuImageDesc{
+		.Extent = { (uint32_t)m_Size.x, (uint32_t)m_Size.y, 1 },
+		.Format = Arc::Format::R32_Sfloat,
+		.UsageFlags = Arc::ImageUsage::Storage,
+		.AspectFlags = Arc::ImageAspect::Color,
+	});
+
+	m_RenderGraph->AddPass(Arc::RenderPass{
+		.Name = "Divergence",
+		.ExecuteFunction = [&, velocity = m_Velocity->GetCurrent(), divergence](Arc::CommandBuffer* cmd, uint32_t frameIndex) {
+			cmd->BindComputePipeline(m_DivergencePipeline->GetHandle());
+			cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_DivergencePipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
+				.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, velocity->GetImageView(), Arc::ImageLayout::General, nullptr))
+				.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, divergence->GetImageView(), Arc::ImageLayout::General, nullptr))
+				.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::StorageImage, m_Boundary->GetImageView(), Arc::ImageLayout::General, nullptr)));
+			cmd->Dispatch(m_ThreadDispatchSize.x, m_ThreadDispatchSize.y, 1);
+		},
+		.Inputs = {
+			{ .Image = m_Velocity->GetCurrent()->GetHandle(), .Access = Arc::ResourceAccess::StorageRead },
+			{ .Image = m_Boundary->GetHandle(), .Access = Arc::ResourceAccess::StorageRead },
+		},
+		.Outputs = {
+			{ .Image = divergence->GetHandle(), .Access = Arc::ResourceAccess::StorageWrite },
+		}
+	});
+
+	for (size_t i = 0; i < 100; i++)
+	{
+		m_RenderGraph->AddPass(Arc::RenderPass{
+			.Name = "PressureSolver",
+			.ExecuteFunction = [&, divergence, pressureIn = m_Pressure1.get(), pressureOut = m_Pressure2.get()](Arc::CommandBuffer* cmd, uint32_t frameIndex) {
+				cmd->BindComputePipeline(m_PressureSolverPipeline->GetHandle());
+				cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_PressureSolverPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
+					.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, divergence->GetImageView(), Arc::ImageLayout::General, nullptr))
+					.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, pressureIn->GetImageView(), Arc::ImageLayout::General, nullptr))
+					.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::StorageImage, pressureOut->GetImageView(), Arc::ImageLayout::General, nullptr))
+					.AddWrite(Arc::PushImageWrite(3, Arc::DescriptorType::StorageImage, m_Boundary->GetImageView(), Arc::ImageLayout::General, nullptr)));
+				cmd->Dispatch(m_ThreadDispatchSize.x, m_ThreadDispatchSize.y, 1);
+			},
+			.Inputs = {
+				{ .Image = divergence->GetHandle(), .Access = Arc::ResourceAccess::StorageRead },
+				{ .Image = m_Pressure1->GetHandle(), .Access = Arc::ResourceAccess::StorageRead },
+				{ .Image = m_Boundary->GetHandle(), .Access = Arc::ResourceAccess::StorageRead },
+			},
+			.Outputs = {
+				{ .Image = m_Pressure2->GetHandle(), .Access = Arc::ResourceAccess::StorageWrite },
+			}
+		});
+		std::swap(m_Pressure1, m_Pressure2);
+	}
+
+	m_RenderGraph->AddPass(Arc::RenderPass{
+		.Name = "Projection",
+		.ExecuteFunction = [&, velocity = m_Velocity->GetCurrent(), pressure = m_Pressure1.get()](Arc::CommandBuffer* cmd, uint32_t frameIndex) {
+			cmd->BindComputePipeline(m_ProjectionPipeline->GetHandle());
+			cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_ProjectionPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
+				.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, velocity->GetImageView(), Arc::ImageLayout::General, nullptr))
+				.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, pressure->GetImageView(), Arc::ImageLayout::General, nullptr))
+				.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::StorageImage, m_Boundary->GetImageView(), Arc::ImageLayout::General, nullptr)));
+			cmd->Dispatch(m_VelocityThreadDispatchSize.x, m_VelocityThreadDispatchSize.y, 1);
+		},
+		.Inputs = {
+			{ .Image = m_Pressure1->GetHandle(), .Access = Arc::ResourceAccess::StorageRead },
+			{ .Image = m_Boundary->GetHandle(), .Access = Arc::ResourceAccess::StorageRead },
+		},
+		.Outputs = {
+			{ .Image = m_Velocity->GetCurrent()->GetHandle(), .Access = Arc::ResourceAccess::StorageReadWrite },
+		}
+	});
+
+	m_RenderGraph->AddPass(Arc::RenderPass{
+		.Name = "Diffusion",
+		.ExecuteFunction = [&, dyeIn = m_Dye->GetPrevious(), dyeOut = m_Dye->GetCurrent()](Arc::CommandBuffer* cmd, uint32_t frameIndex) {
+			cmd->BindComputePipeline(m_DiffusionPipeline->GetHandle());
+			cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_DiffusionPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
+				.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, dyeIn->GetImageView(), Arc::ImageLayout::General, nullptr))
+				.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, dyeOut->GetImageView(), Arc::ImageLayout::General, nullptr))
+				.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::StorageImage, m_Boundary->GetImageView(), Arc::ImageLayout::General, nullptr)));
+			cmd->Dispatch(m_ThreadDispatchSize.x, m_ThreadDispatchSize.y, 1);
+		},
+		.Inputs = {
+			{ .Image = m_Dye->GetPrevious()->GetHandle(), .Access = Arc::ResourceAccess::StorageRead },
+			{ .Image = m_Boundary->GetHandle(), .Access = Arc::ResourceAccess::StorageRead },
+		},
+		.Outputs = {
+			{ .Image = m_Dye->GetCurrent()->GetHandle(), .Access = Arc::ResourceAccess::StorageWrite },
+		}
+	});
 
 	m_RenderGraph->SetPresentPass(Arc::PresentPass{
-	.LoadOp = Arc::AttachmentLoadOp::Clear,
-	.ClearColor = {0.1, 0.6, 0.6, 1.0},
-	.ExecuteFunction = [&](Arc::CommandBuffer* cmd, uint32_t frameIndex) {
-		cmd->BindPipeline(m_PresentPipeline->GetHandle());
-		cmd->PushDescriptorSets(Arc::PipelineBindPoint::Graphics, m_PresentPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
-			.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::CombinedImageSampler, m_Dye1->GetImageView(), Arc::ImageLayout::General, m_LinearSampler->GetHandle()))
-			.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::CombinedImageSampler, m_Overlay->GetImageView(), Arc::ImageLayout::General, m_LinearSampler->GetHandle())));
-		cmd->Draw(6, 1, 0, 0);
-	} });
+		.LoadOp = Arc::AttachmentLoadOp::Clear,
+		.ClearColor = {0.1, 0.6, 0.6, 1.0},
+		.ExecuteFunction = [&, dye = m_Dye->GetCurrent()](Arc::CommandBuffer* cmd, uint32_t frameIndex) {
+			cmd->BindPipeline(m_PresentPipeline->GetHandle());
+			cmd->PushDescriptorSets(Arc::PipelineBindPoint::Graphics, m_PresentPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
+				.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::CombinedImageSampler, dye->GetImageView(), Arc::ImageLayout::General, m_LinearSampler->GetHandle()))
+				.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::CombinedImageSampler, m_Overlay->GetImageView(), Arc::ImageLayout::General, m_LinearSampler->GetHandle())));
+			cmd->Draw(6, 1, 0, 0);
+		},
+		.Inputs = {
+			{ .Image = m_Dye->GetCurrent()->GetHandle(), .Access = Arc::ResourceAccess::SampledRead, .Stage = Arc::ShaderStage::Fragment, .Layout = Arc::ImageLayout::General },
+			{ .Image = m_Overlay->GetHandle(), .Access = Arc::ResourceAccess::SampledRead, .Stage = Arc::ShaderStage::Fragment, .Layout = Arc::ImageLayout::General },
+		}
+	});
 
 	m_RenderGraph->BuildGraph();
 	m_RenderGraph->Execute(frameData, m_PresentQueue->GetExtent());
@@ -405,6 +500,8 @@ void FluidDynamics::SwapchainResized(void* presentQueue)
 {
 	m_PresentQueue = static_cast<Arc::PresentQueue*>(presentQueue);
 	CreateImages();
+	// Every resize leaves holes of the old simulation images behind, compact them over the next frames
+	m_ResourceCache->BeginDefragmentation();
 }
 
 void FluidDynamics::RecompileShaders()
@@ -52,13 +52,10 @@ private:
 	glm::ivec2 m_ThreadDispatchSize;
 	glm::ivec2 m_VelocityThreadDispatchSize;
 	glm::ivec2 m_OverlayDispatchSize;
-	std::unique_ptr<Arc::GpuImage> m_Dye1;
-	std::unique_ptr<Arc::GpuImage> m_Dye2;
+	Arc::HistoryImage* m_Dye = nullptr;
 	std::unique_ptr<Arc::GpuImage> m_Wall;
 	std::unique_ptr<Arc::GpuImage> m_Boundary;
-	std::unique_ptr<Arc::GpuImage> m_Velocity1;
-	std::unique_ptr<Arc::GpuImage> m_Velocity2;
-	std::unique_ptr<Arc::GpuImage> m_Divergence;
+	Arc::HistoryImage* m_Velocity = nullptr;
 	std::unique_ptr<Arc::GpuImage> m_Pressure1;
 	std::unique_ptr<Arc::GpuImage> m_Pressure2;
 	std::unique_ptr<Arc::GpuImage> m_Overlay;
@@ -22,16 +22,10 @@ PathTracer::PathTracer(Arc::Window* window, Arc::Device* device, Arc::PresentQue
 	m_Camera->MovementSpeed = 1.0f;
 
 	CreateSamplers();
+	CreateTextures();
 	CreateAccelerationStructure();
 	CreatePipelines();
 	CreateImages();
-
-	m_GlobalDataBuffer = std::make_unique<Arc::GpuBufferArray>();
-	m_ResourceCache->CreateGpuBufferArray(m_GlobalDataBuffer.get(), Arc::GpuBufferDesc{
-		.Size = sizeof(GlobalFrameData),
-		.UsageFlags = Arc::BufferUsage::UniformBuffer,
-		.MemoryProperty = Arc::MemoryProperty::HostVisible,
-		});
 }
 
 bool PathTracer::LoadObjModel(std::string filePath, std::vector<Vertex>& outVertices, std::vector<uint32_t>& outIndices)
@@ -120,30 +114,27 @@ void PathTracer::LoadModel(std::string filepath, Model* model)
 		return;
 	}
 
-	m_ResourceCache->CreateGpuBuffer(&model->VertexBuffer, Arc::GpuBufferDesc{
-		.Size = (uint32_t)(vertices.size() * sizeof(Vertex)),
-		.UsageFlags = Arc::BufferUsage::StorageBuffer | Arc::BufferUsage::ShaderDeviceAddress | Arc::BufferUsage::AccelerationStructureBuildInputReadOnly | Arc::BufferUsage::TransferDst,
-		.MemoryProperty = Arc::MemoryProperty::DeviceLocal,
-	});
-	m_ResourceCache->CreateGpuBuffer(&model->IndexBuffer, Arc::GpuBufferDesc{
-		.Size = (uint32_t)(indices.size() * sizeof(uint32_t)),
-		.UsageFlags = Arc::BufferUsage::StorageBuffer | Arc::BufferUsage::ShaderDeviceAddress | Arc::BufferUsage::AccelerationStructureBuildInputReadOnly | Arc::BufferUsage::TransferDst,
-		.MemoryProperty = Arc::MemoryProperty::DeviceLocal,
-	});
-
-	m_Device->SetDeviceLocalBufferData(&model->VertexBuffer, vertices.data(), vertices.size() * sizeof(Vertex));
-	m_Device->SetDeviceLocalBufferData(&model->IndexBuffer, indices.data(), indices.size() * sizeof(uint32_t));
+	// Meshes share the large buffers of the geometry allocator instead of owning two buffers each
+	Arc::GeometryAllocator* geometryAllocator = m_Device->GetGeometryAllocator();
+	uint64_t vertexSize = vertices.size() * sizeof(Vertex);
+	uint64_t indexSize = indices.size() * sizeof(uint32_t);
+	model->VertexBuffer = geometryAllocator->Allocate(vertexSize);
+	model->IndexBuffer = geometryAllocator->Allocate(indexSize);
+	geometryAllocator->Upload(model->VertexBuffer, vertices.data(), vertexSize);
+	geometryAllocator->Upload(model->IndexBuffer, indices.data(), indexSize);
 
 	m_ResourceCache->CreateBottomLevelAS(&model->BottomLevelAS, Arc::BottomLevelASDesc{
-		.VertexBuffer = model->VertexBuffer.GetHandle(),
-		.IndexBuffer = model->IndexBuffer.GetHandle(),
+		.VertexBuffer = model->VertexBuffer.Buffer,
+		.IndexBuffer = model->IndexBuffer.Buffer,
+		.VertexBufferOffset = model->VertexBuffer.Offset,
+		.IndexBufferOffset = model->IndexBuffer.Offset,
 		.VertexStride = sizeof(Vertex),
 		.NumTriangles = (uint32_t)indices.size() / 3,
 		.VertexFormat = Arc::Format::R32G32B32_Sfloat
 		});
 
-	model->VertexBufferDeviceAddress = m_Device->GetBufferDeviceAddress(&model->VertexBuffer);
-	model->IndexBufferDeviceAddress = m_Device->GetBufferDeviceAddress(&model->IndexBuffer);
+	model->VertexBufferDeviceAddress = model->VertexBuffer.DeviceAddress;
+	model->IndexBufferDeviceAddress = model->IndexBuffer.DeviceAddress;
 }
 
 void PathTracer::AddInstance(std::vector<MeshPrimitive>& meshInfos, std::vector<Material>& materials, Model* model, glm::mat4 transform, const Material& material)
@@ -181,6 +172,33 @@ void PathTracer::AddInstance(std::vector<MeshPrimitive>& meshInfos, std::vector<
 	meshInfos.push_back(meshInfo);
 }
 
+void PathTracer::CreateTextures()
+{
+	m_WhiteTexture = std::make_unique<Arc::GpuImage>();
+	m_ResourceCache->CreateGpuImage(m_WhiteTexture.get(), Arc::GpuImageDesc{
+		.Extent = { 1, 1, 1},
+		.Format = Arc::Format::R8G8B8A8_Unorm,
+		.UsageFlags = Arc::ImageUsage::TransferDst | Arc::ImageUsage::Sampled,
+		.AspectFlags = Arc::ImageAspect::Color,
+		});
+	uint32_t whitePixel = 0xFFFFFFFF;
+	m_Device->SetImageData(m_WhiteTexture.get(), &whitePixel, sizeof(uint32_t), Arc::ImageLayout::ShaderReadOnlyOptimal);
+
+	int imgWidth, imgHeight, imgChannels;
+	const char* file = "res/Images/Granite.jpg";
+	stbi_info(file, &imgWidth, &imgHeight, &imgChannels);
+	m_Texture = std::make_unique<Arc::GpuImage>();
+	m_ResourceCache->CreateGpuImage(m_Texture.get(), Arc::GpuImageDesc{
+		.Extent = { (uint32_t)imgWidth, (uint32_t)imgHeight, 1},
+		.Format = Arc::Format::R8G8B8A8_Unorm,
+		.UsageFlags = Arc::ImageUsage::TransferDst | Arc::ImageUsage::Sampled,
+		.AspectFlags = Arc::ImageAspect::Color,
+		});
+	stbi_uc* data = stbi_load(file, &imgWidth, &imgHeight, &imgChannels, 4);
+	m_Device->SetImageData(m_Texture.get(), data, imgWidth * imgHeight * 4 * sizeof(uint8_t), Arc::ImageLayout::ShaderReadOnlyOptimal);
+	stbi_image_free(data);
+}
+
 void PathTracer::CreateAccelerationStructure()
 {
 	m_Plane = std::make_unique<Model>();
@@ -194,21 +212,24 @@ void PathTracer::CreateAccelerationStructure()
 
 	std::vector<MeshPrimitive> meshInfos;
 	std::vector<Material> materials;
-	Material glass{};
+	// Texture indices point into the bindless heap
+	Material untextured{};
+	untextured.TextureIndex = m_WhiteTexture->GetSampledIndex();
+	Material glass = untextured;
 	glass.Color = glm::vec4(0.95, 0.7, 0.7, 1);
 	glass.Roughness = 0.1f;
 	glass.Transmission = 1.0f;
-	Material redWall{};
+	Material redWall = untextured;
 	redWall.Color = vec4(1.0, 0.2, 0.3, 1);
-	redWall.TextureIndex = 1;
-	Material greenWall{};
+	redWall.TextureIndex = m_Texture->GetSampledIndex();
+	Material greenWall = untextured;
 	greenWall.Color = vec4(0.25, 1.0, 0.35, 1);
 	greenWall.Metallic = 1.0f;
-	Material blueWall{};
+	Material blueWall = untextured;
 	blueWall.Color = vec4(0.25, 0.55, 1.0, 1);
-	Material whiteWall{};
+	Material whiteWall = untextured;
 	whiteWall.Color = vec4(0.8, 0.8, 0.8, 1);
-	Material light{};
+	Material light = untextured;
 	light.Color = vec4(1);
 	light.Emission = vec4(15.0, 15.0, 15.0, 1);
 
@@ -285,29 +306,6 @@ void PathTracer::CreateAccelerationStructure()
 	m_ResourceCache->UnmapMemory(m_MaterialBuffer.get());
 
 
-	m_WhiteTexture = std::make_unique<Arc::GpuImage>();
-	m_ResourceCache->CreateGpuImage(m_WhiteTexture.get(), Arc::GpuImageDesc{
-		.Extent = { 1, 1, 1},
-		.Format = Arc::Format::R8G8B8A8_Unorm,
-		.UsageFlags = Arc::ImageUsage::TransferDst | Arc::ImageUsage::Sampled,
-		.AspectFlags = Arc::ImageAspect::Color,
-		});
-	uint32_t whitePixel = 0xFFFFFFFF;
-	m_Device->SetImageData(m_WhiteTexture.get(), &whitePixel, sizeof(uint32_t), Arc::ImageLayout::ShaderReadOnlyOptimal);
-
-	int imgWidth, imgHeight, imgChannels;
-	const char* file = "res/Images/Granite.jpg";
-	stbi_info(file, &imgWidth, &imgHeight, &imgChannels);
-	m_Texture = std::make_unique<Arc::GpuImage>();
-	m_ResourceCache->CreateGpuImage(m_Texture.get(), Arc::GpuImageDesc{
-		.Extent = { (uint32_t)imgWidth, (uint32_t)imgHeight, 1},
-		.Format = Arc::Format::R8G8B8A8_Unorm,
-		.UsageFlags = Arc::ImageUsage::TransferDst | Arc::ImageUsage::Sampled,
-		.AspectFlags = Arc::ImageAspect::Color,
-		});
-	data = stbi_load(file, &imgWidth, &imgHeight, &imgChannels, 4);
-	m_Device->SetImageData(m_Texture.get(), data, imgWidth * imgHeight * 4 * sizeof(uint8_t), Arc::ImageLayout::ShaderReadOnlyOptimal);
-	stbi_image_free(data);
 
 
 	m_SceneDescriptorSet = std::make_unique<Arc::DescriptorSet>();
@@ -315,14 +313,11 @@ void PathTracer::CreateAccelerationStructure()
 		.Bindings = {
 			{ Arc::DescriptorType::StorageBuffer, Arc::ShaderStage::RayClosestHit },
 			{ Arc::DescriptorType::StorageBuffer, Arc::ShaderStage::RayClosestHit },
-			{ Arc::DescriptorType::CombinedImageSampler, Arc::ShaderStage::RayClosestHit, Arc::DescriptorFlag::Bindless },
 		}
 	});
 	m_Device->UpdateDescriptorSet(m_SceneDescriptorSet.get(), Arc::DescriptorWrite()
 		.AddWrite(Arc::BufferWrite(0, m_MeshInfoBuffer.get()))
 		.AddWrite(Arc::BufferWrite(1, m_MaterialBuffer.get()))
-		.AddWrite(Arc::ImageWrite(2, 0, m_WhiteTexture.get(), Arc::ImageLayout::ShaderReadOnlyOptimal, m_LinearSampler.get()))
-		.AddWrite(Arc::ImageWrite(2, 1, m_Texture.get(), Arc::ImageLayout::ShaderReadOnlyOptimal, m_LinearSampler.get()))
 	);
 }
 
@@ -382,8 +377,6 @@ void PathTracer::CreateImages()
 	uint32_t w = m_PresentQueue->GetExtent()[0];
 	uint32_t h = m_PresentQueue->GetExtent()[1];
 
-	m_Device->WaitIdle();
-
 	if (m_OutputImage.get())
 		m_ResourceCache->ReleaseResource(m_OutputImage.get());
 
@@ -396,12 +389,8 @@ void PathTracer::CreateImages()
 	};
 	m_ResourceCache->CreateGpuImage(m_OutputImage.get(), imageDesc);
 
-	if (m_AccumulationImage1.get())
-		m_ResourceCache->ReleaseResource(m_AccumulationImage1.get());
-	if (m_AccumulationImage2.get())
-		m_ResourceCache->ReleaseResource(m_AccumulationImage2.get());
-	m_AccumulationImage1 = std::make_unique<Arc::GpuImage>();
-	m_AccumulationImage2 = std::make_unique<Arc::GpuImage>();
+	if (m_Accumulation)
+		m_RenderGraph->ReleaseHistoryImage(m_Accumulation);
 	{
 		Arc::GpuImageDesc desc = Arc::GpuImageDesc{
 		.Extent = { w, h, 1},
@@ -410,25 +399,27 @@ void PathTracer::CreateImages()
 		.AspectFlags = Arc::ImageAspect::Color,
 		.MipLevels = 1,
 		};
-		m_ResourceCache->CreateGpuImage(m_AccumulationImage1.get(), desc);
-		m_ResourceCache->CreateGpuImage(m_AccumulationImage2.get(), desc);
-		const float clearColor[4] = {0.0, 0.0, 0.0, 0.0};
-		m_Device->ImmediateSubmit([&](Arc::CommandBufferHandle cmdHandle) {
-			Arc::CommandBuffer cmd(cmdHandle);
-			cmd.TransitionImage(m_AccumulationImage1->GetHandle(), Arc::ImageLayout::Undefined, Arc::ImageLayout::General);
-			cmd.TransitionImage(m_AccumulationImage2->GetHandle(), Arc::ImageLayout::Undefined, Arc::ImageLayout::General);
-			cmd.ClearColorImage(m_AccumulationImage1->GetHandle(), clearColor, Arc::ImageLayout::General);
-			cmd.ClearColorImage(m_AccumulationImage2->GetHandle(), clearColor, Arc::ImageLayout::General);
-		});
+		m_Accumulation = m_RenderGraph->CreateHistoryImage(desc);
+		float clearColor[4] = {0.0, 0.0, 0.0, 0.0};
+		for (uint32_t i = 0; i < m_Accumulation->GetVersionCount(); i++)
+		{
+			m_Device->TransitionImageLayout(m_Accumulation->GetVersion(i), Arc::ImageLayout::General);
+			m_Device->ClearColorImage(m_Accumulation->GetVersion(i), clearColor, Arc::ImageLayout::General);
+		}
 	}
-	m_Device->WaitIdle();
 
 	m_Camera->AspectRatio = w / (float)h;
 }
 
 PathTracer::~PathTracer()
 {
-
+	// The ranges live in the engine owned blocks of the geometry allocator, FreeResources does not return them
+	Arc::GeometryAllocator* geometryAllocator = m_Device->GetGeometryAllocator();
+	for (Model* model : { m_Plane.get(), m_Dragon.get(), m_Sphere.get() })
+	{
+		geometryAllocator->Free(model->VertexBuffer);
+		geometryAllocator->Free(model->IndexBuffer);
+	}
 }
 
 void PathTracer::RenderFrame(float elapsedTime)
@@ -436,7 +427,6 @@ void PathTracer::RenderFrame(float elapsedTime)
 	static float lastTime = 0.0f;
 	float dt = elapsedTime - lastTime;
 	lastTime = elapsedTime;
-	m_IsEvenFrame = !m_IsEvenFrame;
 
 	if (Arc::Input::IsKeyPressed(Arc::KeyCode::G))
 	{
@@ -466,39 +456,33 @@ void PathTracer::RenderFrame(float elapsedTime)
 	if (m_Camera->HasMoved || Arc::Input::IsKeyDown(Arc::KeyCode::C))
 	{
 		globalFrameData.FrameIndex = 1;
+		m_RenderGraph->InvalidateHistory(m_Accumulation);
 	}
 
-	{
-		void* data = m_ResourceCache->MapMemory(m_GlobalDataBuffer.get(), frameData.FrameIndex);
-		memcpy(data, &globalFrameData, sizeof(GlobalFrameData));
-		m_ResourceCache->UnmapMemory(m_GlobalDataBuffer.get(), frameData.FrameIndex);
-	}
+	Arc::UniformAllocation globalData = m_Device->GetUniformAllocator()->Upload(frameData.FrameIndex, globalFrameData);
 
 	m_RenderGraph->AddPass(Arc::RenderPass{
-		.ExecuteFunction = [&](Arc::CommandBuffer* cmd, uint32_t frameIndex) {
-			cmd->MemoryBarrier({
-			Arc::CommandBuffer::ImageBarrier{
-				.Handle = m_OutputImage->GetHandle(),
-				.OldLayout = Arc::ImageLayout::Undefined,
-				.NewLayout = Arc::ImageLayout::General,
-			} });
-
+		.Name = "PathTracing",
+		.ExecuteFunction = [&, globalData, accumulationIn = m_Accumulation->GetPrevious(), accumulationOut = m_Accumulation->GetCurrent()](Arc::CommandBuffer* cmd, uint32_t frameIndex) {
 			cmd->BindDescriptorSets(Arc::PipelineBindPoint::RayTracing, m_RayTracingPipeline->GetLayout(), 0, { m_SceneDescriptorSet->GetHandle() });
+			cmd->BindDescriptorSets(Arc::PipelineBindPoint::RayTracing, m_RayTracingPipeline->GetLayout(), Arc::BindlessSetIndex, { m_ResourceCache->GetBindlessDescriptorSet() });
+			uint32_t samplerIndex = m_LinearSampler->GetBindlessIndex();
+			cmd->PushConstants(Arc::ShaderStage::RayGen | Arc::ShaderStage::RayClosestHit | Arc::ShaderStage::RayMiss, m_RayTracingPipeline->GetLayout(), &samplerIndex, sizeof(uint32_t));
 			cmd->PushDescriptorSets(Arc::PipelineBindPoint::RayTracing, m_RayTracingPipeline->GetLayout(), 1, Arc::PushDescriptorWrite()
 				.AddWrite(Arc::PushAccelerationStructureWrite(0, Arc::DescriptorType::AccelerationStructure, m_Scene->GetHandle()))
-				.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, m_IsEvenFrame ? m_AccumulationImage1->GetImageView() : m_AccumulationImage2->GetImageView(), Arc::ImageLayout::General, nullptr))
-				.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::StorageImage, m_IsEvenFrame ? m_AccumulationImage2->GetImageView() : m_AccumulationImage1->GetImageView(), Arc::ImageLayout::General, nullptr))
+				.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, accumulationIn->GetImageView(), Arc::ImageLayout::General, nullptr))
+				.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::StorageImage, accumulationOut->GetImageView(), Arc::ImageLayout::General, nullptr))
 				.AddWrite(Arc::PushImageWrite(3, Arc::DescriptorType::StorageImage, m_OutputImage->GetImageView(), Arc::ImageLayout::General, nullptr))
-				.AddWrite(Arc::PushBufferWrite(4, Arc::DescriptorType::UniformBuffer, m_GlobalDataBuffer->GetHandle(frameIndex), m_GlobalDataBuffer->GetSize())));
+				.AddWrite(Arc::PushBufferWrite(4, Arc::DescriptorType::UniformBuffer, globalData.Buffer, globalData.Size, globalData.Offset)));
 			cmd->BindRayTracingPipeline(m_RayTracingPipeline->GetHandle());
 			cmd->TraceRays(m_RayTracingPipeline.get(), m_OutputImage->GetExtent()[0], m_OutputImage->GetExtent()[1], 1);
-		
-			cmd->MemoryBarrier({
-			Arc::CommandBuffer::ImageBarrier{
-				.Handle = m_OutputImage->GetHandle(),
-				.OldLayout = Arc::ImageLayout::General,
-				.NewLayout = Arc::ImageLayout::ShaderReadOnlyOptimal
-			} });
+		},
+		.Inputs = {
+			{ .Image = m_Accumulation->GetPrevious()->GetHandle(), .Access = Arc::ResourceAccess::StorageRead, .Stage = Arc::ShaderStage::RayGen },
+		},
+		.Outputs = {
+			{ .Image = m_Accumulation->GetCurrent()->GetHandle(), .Access = Arc::ResourceAccess::StorageWrite, .Stage = Arc::ShaderStage::RayGen },
+			{ .Image = m_OutputImage->GetHandle(), .Access = Arc::ResourceAccess::StorageWrite, .Stage = Arc::ShaderStage::RayGen },
 		}
 	});
 
@@ -510,6 +494,9 @@ void PathTracer::RenderFrame(float elapsedTime)
 			cmd->PushDescriptorSets(Arc::PipelineBindPoint::Graphics, m_CompositePipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
 				.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::CombinedImageSampler, m_OutputImage->GetImageView(), Arc::ImageLayout::ShaderReadOnlyOptimal, m_NearestSampler->GetHandle())));
 			cmd->Draw(6, 1, 0, 0);
+		},
+		.Inputs = {
+			{ .Image = m_OutputImage->GetHandle(), .Access = Arc::ResourceAccess::SampledRead, .Stage = Arc::ShaderStage::Fragment },
 		}
 	});
 
@@ -23,6 +23,7 @@ public:
 
 private:
 
+	void CreateTextures();
 	void CreateAccelerationStructure();
 	void CreatePipelines();
 	void CreateSamplers();
@@ -50,8 +51,8 @@ private:
 
 	struct Model
 	{
-		Arc::GpuBuffer VertexBuffer;
-		Arc::GpuBuffer IndexBuffer;
+		Arc::GeometryAllocation VertexBuffer;
+		Arc::GeometryAllocation IndexBuffer;
 		Arc::BottomLevelAS BottomLevelAS;
 		uint64_t VertexBufferDeviceAddress;
 		uint64_t IndexBufferDeviceAddress;
@@ -109,16 +110,13 @@ private:
 	std::unique_ptr<Arc::GpuBuffer> m_MeshInfoBuffer;
 	std::unique_ptr<Arc::GpuBuffer> m_MaterialBuffer;
 	std::unique_ptr<Arc::DescriptorSet> m_SceneDescriptorSet;
-	std::unique_ptr<Arc::GpuBufferArray> m_GlobalDataBuffer;
 	std::unique_ptr<CameraFP> m_Camera;
-	bool m_IsEvenFrame = false;
 
 	std::unique_ptr<Arc::Shader> m_RayGenShader;
 	std::unique_ptr<Arc::Shader> m_RayMissShader;
 	std::unique_ptr<Arc::Shader> m_RayClosestHitShader;
 	std::unique_ptr<Arc::RayTracingPipeline> m_RayTracingPipeline;
-	std::unique_ptr<Arc::GpuImage> m_AccumulationImage1;
-	std::unique_ptr<Arc::GpuImage> m_AccumulationImage2;
+	Arc::HistoryImage* m_Accumulation = nullptr;
 	std::unique_ptr<Arc::GpuImage> m_OutputImage;
 
 	std::unique_ptr<Model> m_Plane;
@@ -13,6 +13,7 @@ RadianceCascades::RadianceCascades(Arc::Window* window, Arc::Device* device, Arc
 	m_PresentQueue = presentQueue;
 	m_ResourceCache = m_Device->GetResourceCache();
 	m_RenderGraph = m_Device->GetRenderGraph();
+	m_RenderGraph->SetPassReordering(true);
 
 	CreatePipelines();
 	CreateSamplers();
@@ -27,27 +28,33 @@ void RadianceCascades::CreatePipelines()
 	m_CompositeVertShader = std::make_unique<Arc::Shader>();
 	m_CompositeFragShader = std::make_unique<Arc::Shader>();
 
-	Arc::ShaderDesc shaderDesc;
-	if (Arc::ShaderCompiler::Compile("res/Shaders/RadianceCascades/radianceCascades.comp", shaderDesc))
-		m_ResourceCache->CreateShader(m_RadianceCascadesShader.get(), shaderDesc);
-	if (Arc::ShaderCompiler::Compile("res/Shaders/RadianceCascades/jumpFloodAlgorithm.comp", shaderDesc))
-		m_ResourceCache->CreateShader(m_JFAShader.get(), shaderDesc);
-	if (Arc::ShaderCompiler::Compile("res/Shaders/RadianceCascades/shader.vert", shaderDesc))
-		m_ResourceCache->CreateShader(m_CompositeVertShader.get(), shaderDesc);
-	if (Arc::ShaderCompiler::Compile("res/Shaders/RadianceCascades/shader.frag", shaderDesc))
-		m_ResourceCache->CreateShader(m_CompositeFragShader.get(), shaderDesc);
+	std::vector<std::string> shaderPaths = {
+		"res/Shaders/RadianceCascades/radianceCascades.comp",
+		"res/Shaders/RadianceCascades/jumpFloodAlgorithm.comp",
+		"res/Shaders/RadianceCascades/shader.vert",
+		"res/Shaders/RadianceCascades/shader.frag"
+	};
+	std::vector<Arc::Shader*> shaders = {
+		m_RadianceCascadesShader.get(),
+		m_JFAShader.get(),
+		m_CompositeVertShader.get(),
+		m_CompositeFragShader.get()
+	};
 
-	m_RadianceCascadesPipeline = std::make_unique<Arc::ComputePipeline>();
-	m_ResourceCache->CreateComputePipeline(m_RadianceCascadesPipeline.get(), Arc::ComputePipelineDesc{
-		.Shader = m_RadianceCascadesShader.get(),
-		.UsePushDescriptors = true
-		});
+	std::vector<Arc::ShaderDesc> shaderDescs;
+	Arc::ShaderCompiler::Compile(shaderPaths, shaderDescs, *m_ResourceCache->GetThreadPool());
+	for (size_t i = 0; i < shaders.size(); i++)
+	{
+		if (!shaderDescs[i].SpirV.empty())
+			m_ResourceCache->CreateShader(shaders[i], shaderDescs[i]);
+	}
 
+	m_RadianceCascadesPipeline = std::make_unique<Arc::ComputePipeline>();
 	m_JFAPipeline = std::make_unique<Arc::ComputePipeline>();
-	m_ResourceCache->CreateComputePipeline(m_JFAPipeline.get(), Arc::ComputePipelineDesc{
-		.Shader = m_JFAShader.get(),
-		.UsePushDescriptors = true
-		});
+	m_ResourceCache->CreateComputePipelines({ m_RadianceCascadesPipeline.get(), m_JFAPipeline.get() }, {
+		Arc::ComputePipelineDesc{ .Shader = m_RadianceCascadesShader.get(), .UsePushDescriptors = true },
+		Arc::ComputePipelineDesc{ .Shader = m_JFAShader.get(), .UsePushDescriptors = true }
+	});
 
 	m_CompositePipeline = std::make_unique<Arc::Pipeline>();;
 	m_ResourceCache->CreatePipeline(m_CompositePipeline.get(), Arc::PipelineDesc{
@@ -80,7 +87,6 @@ void RadianceCascades::CreateImages()
 	uint32_t h = m_PresentQueue->GetExtent()[1];
 	float clearColor[4] = { 0, 0, 0, 0 };
 
-	m_Device->WaitIdle();
 	if (m_SeedImage.get())
 		m_ResourceCache->ReleaseResource(m_SeedImage.get());
 
@@ -106,70 +112,42 @@ void RadianceCascades::CreateImages()
 		m_Device->ClearColorImage(m_SeedImage.get(), clearColor, Arc::ImageLayout::General);
 	}
 
-	if (m_JFAImage1.get())
-		m_ResourceCache->ReleaseResource(m_JFAImage1.get());
-	if (m_JFAImage2.get())
-		m_ResourceCache->ReleaseResource(m_JFAImage2.get());
-
-	m_JFAImage1 = std::make_unique<Arc::GpuImage>();
-	m_JFAImage2 = std::make_unique<Arc::GpuImage>();
-	auto jfaImageDesc = Arc::GpuImageDesc{
+	m_JFAImageDesc = Arc::GpuImageDesc{
 		.Extent = { w, h, 1},
 		.Format = Arc::Format::R16G16_Sfloat,
-		.UsageFlags = Arc::ImageUsage::TransferSrc | Arc::ImageUsage::Storage | Arc::ImageUsage::Sampled,
+		.UsageFlags = Arc::ImageUsage::Storage,
 		.AspectFlags = Arc::ImageAspect::Color,
 	};
-	m_ResourceCache->CreateGpuImage(m_JFAImage1.get(), jfaImageDesc);
-	m_ResourceCache->CreateGpuImage(m_JFAImage2.get(), jfaImageDesc);
-	m_Device->TransitionImageLayout(m_JFAImage1.get(), Arc::ImageLayout::General);
-	m_Device->TransitionImageLayout(m_JFAImage2.get(), Arc::ImageLayout::General);
-
-	if (m_SDFImage.get())
-		m_ResourceCache->ReleaseResource(m_SDFImage.get());
-
-	m_SDFImage = std::make_unique<Arc::GpuImage>();
-	m_ResourceCache->CreateGpuImage(m_SDFImage.get(), Arc::GpuImageDesc{
+	m_SDFImageDesc = Arc::GpuImageDesc{
 		.Extent = { w, h, 1},
 		.Format = Arc::Format::R16_Sfloat,
-		.UsageFlags = Arc::ImageUsage::TransferSrc | Arc::ImageUsage::Storage | Arc::ImageUsage::Sampled,
+		.UsageFlags = Arc::ImageUsage::Storage | Arc::ImageUsage::Sampled,
 		.AspectFlags = Arc::ImageAspect::Color,
-		});
-	m_Device->TransitionImageLayout(m_SDFImage.get(), Arc::ImageLayout::General);
-
-	if (m_NearestColorImage.get())
-		m_ResourceCache->ReleaseResource(m_NearestColorImage.get());
-
-	m_NearestColorImage = std::make_unique<Arc::GpuImage>();
-	m_ResourceCache->CreateGpuImage(m_NearestColorImage.get(), Arc::GpuImageDesc{
+	};
+	m_NearestColorImageDesc = Arc::GpuImageDesc{
 		.Extent = { w, h, 1},
 		.Format = Arc::Format::R8G8B8A8_Unorm,
-		.UsageFlags = Arc::ImageUsage::TransferSrc | Arc::ImageUsage::Storage | Arc::ImageUsage::Sampled,
+		.UsageFlags = Arc::ImageUsage::Storage | Arc::ImageUsage::Sampled,
 		.AspectFlags = Arc::ImageAspect::Color,
-		});
-	m_Device->TransitionImageLayout(m_NearestColorImage.get(), Arc::ImageLayout::General);
-
-	for (auto& cascade : m_Cascades)
-	{
-		if (&cascade)
-			m_ResourceCache->ReleaseResource(&cascade);
-	}
+	};
 
 	// Gets size that is equal or less that (w, h) and is divisible by 2^(cascadeCount - 1)
 	// 2^(cascadeCount - 1) is how many probe groups are on one side of the cascade
-	uint32_t cascadeCount = 6;
-	uint32_t div = 1 << (cascadeCount - 1);
+	uint32_t div = 1 << (m_CascadeCount - 1);
 	glm::uvec2 cascadeExtent = { w - (w % div), h - (h % div)};
-	m_Cascades.resize(cascadeCount);
-	for (auto& cascade : m_Cascades)
-	{
-		m_ResourceCache->CreateGpuImage(&cascade, Arc::GpuImageDesc{
-			.Extent = { cascadeExtent.x, cascadeExtent.y, 1},
-			.Format = Arc::Format::R8G8B8A8_Unorm,
-			.UsageFlags = Arc::ImageUsage::TransferSrc | Arc::ImageUsage::Storage | Arc::ImageUsage::Sampled,
-			.AspectFlags = Arc::ImageAspect::Color,
-			});
-		m_Device->TransitionImageLayout(&cascade, Arc::ImageLayout::General);
-	}
+	m_CascadeImageDesc = Arc::GpuImageDesc{
+		.Extent = { cascadeExtent.x, cascadeExtent.y, 1},
+		.Format = Arc::Format::R8G8B8A8_Unorm,
+		.UsageFlags = Arc::ImageUsage::TransferSrc | Arc::ImageUsage::Storage | Arc::ImageUsage::Sampled,
+		.AspectFlags = Arc::ImageAspect::Color,
+	};
+
+	if (m_RadianceImage.get())
+		m_ResourceCache->ReleaseResource(m_RadianceImage.get());
+
+	m_RadianceImage = std::make_unique<Arc::GpuImage>();
+	m_ResourceCache->CreateGpuImage(m_RadianceImage.get(), m_CascadeImageDesc);
+	m_Device->TransitionImageLayout(m_RadianceImage.get(), Arc::ImageLayout::General);
 
 	m_MaxJFAIterations = std::ceil(std::log2(std::max(w, h)));
 	m_ClearFrame = true;
@@ -200,9 +178,9 @@ void RadianceCascades::RenderFrame(float elapsedTime)
 
 	if (Arc::Input::IsKeyPressed(Arc::KeyCode::G))
 	{
-		std::vector<uint8_t> imageData = m_Device->GetImageData(&m_Cascades[0], Arc::ImageLayout::General);
+		std::vector<uint8_t> imageData = m_Device->GetImageData(m_RadianceImage.get(), Arc::ImageLayout::General);
 		std::string path = "img.png";
-		stbi_write_png(path.c_str(), m_Cascades[0].GetExtent()[0], m_Cascades[0].GetExtent()[1], 4, imageData.data(), m_Cascades[0].GetExtent()[0] * 4);
+		stbi_write_png(path.c_str(), m_RadianceImage->GetExtent()[0], m_RadianceImage->GetExtent()[1], 4, imageData.data(), m_RadianceImage->GetExtent()[0] * 4);
 		ARC_LOG("Screenshot saved to disk");
 	}
 
@@ -211,65 +189,93 @@ void RadianceCascades::RenderFrame(float elapsedTime)
 		m_ClearFrame)
 	{
 		m_ClearFrame = false;
-		m_RenderGraph->AddPass(Arc::RenderPass{
-			.ExecuteFunction = [&](Arc::CommandBuffer* cmd, uint32_t frameIndex) {
-				cmd->BindComputePipeline(m_JFAPipeline->GetHandle());
-				cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_JFAPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
-					.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, m_SeedImage->GetImageView(), Arc::ImageLayout::General, nullptr))
-					.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, m_JFAImage1->GetImageView(), Arc::ImageLayout::General, nullptr))
-					.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::StorageImage, m_JFAImage2->GetImageView(), Arc::ImageLayout::General, nullptr))
-					.AddWrite(Arc::PushImageWrite(3, Arc::DescriptorType::StorageImage, m_SDFImage->GetImageView(), Arc::ImageLayout::General, nullptr))
-					.AddWrite(Arc::PushImageWrite(4, Arc::DescriptorType::StorageImage, m_NearestColorImage->GetImageView(), Arc::ImageLayout::General, nullptr)));
-				
-				jfaData.phase = 0;
-				cmd->PushConstants(Arc::ShaderStage::Compute, m_JFAPipeline->GetLayout(), &jfaData, sizeof(jfaData));
-				cmd->Dispatch(std::ceil(m_SeedImage->GetExtent()[0] / 32.0f), std::ceil(m_SeedImage->GetExtent()[1] / 32.0f), 1);
-
-				for (int i = 0; i < m_MaxJFAIterations; i++)
-				{
-					jfaData.phase = 1;
-					jfaData.jump = 1 << (m_MaxJFAIterations - i - 1);
+		Arc::GpuImage* jfaImage1 = m_RenderGraph->CreateTransientImage(m_JFAImageDesc);
+		Arc::GpuImage* jfaImage2 = m_RenderGraph->CreateTransientImage(m_JFAImageDesc);
+		Arc::GpuImage* sdfImage = m_RenderGraph->CreateTransientImage(m_SDFImageDesc);
+		Arc::GpuImage* nearestColorImage = m_RenderGraph->CreateTransientImage(m_NearestColorImageDesc);
+		std::vector<Arc::GpuImage*> cascades(m_CascadeCount);
+		cascades[0] = m_RadianceImage.get();
+		for (uint32_t i = 1; i < m_CascadeCount; i++)
+		{
+			cascades[i] = m_RenderGraph->CreateTransientImage(m_CascadeImageDesc);
+		}
 
+		auto addJumpFloodPass = [&](int phase, int jump, Arc::ArrayView<Arc::Resource> inputs, Arc::ArrayView<Arc::Resource> outputs) {
+			m_RenderGraph->AddPass(Arc::RenderPass{
+				.Name = "JumpFlood",
+				.ExecuteFunction = [&, phase, jump, jfaIn = jfaImage1, jfaOut = jfaImage2, sdfImage, nearestColorImage](Arc::CommandBuffer* cmd, uint32_t frameIndex) {
+					// Passes can be recorded concurrently, so the shared push constants are copied
+					JfaData data = jfaData;
+					data.phase = phase;
+					data.jump = jump;
+					cmd->BindComputePipeline(m_JFAPipeline->GetHandle());
 					cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_JFAPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
 						.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, m_SeedImage->GetImageView(), Arc::ImageLayout::General, nullptr))
-						.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, m_JFAImage1->GetImageView(), Arc::ImageLayout::General, nullptr))
-						.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::StorageImage, m_JFAImage2->GetImageView(), Arc::ImageLayout::General, nullptr))
-						.AddWrite(Arc::PushImageWrite(3, Arc::DescriptorType::StorageImage, m_SDFImage->GetImageView(), Arc::ImageLayout::General, nullptr))
-						.AddWrite(Arc::PushImageWrite(4, Arc::DescriptorType::StorageImage, m_NearestColorImage->GetImageView(), Arc::ImageLayout::General, nullptr)));
-
-					cmd->PushConstants(Arc::ShaderStage::Compute, m_JFAPipeline->GetLayout(), &jfaData, sizeof(jfaData));
-					cmd->Dispatch(std::ceil(m_SeedImage->GetExtent()[0] / 32.0f), std::ceil(m_SeedImage->GetExtent()[1] / 32.0f), 1);			
-					std::swap(m_JFAImage1, m_JFAImage2);
-				}
+						.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, jfaIn->GetImageView(), Arc::ImageLayout::General, nullptr))
+						.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::StorageImage, jfaOut->GetImageView(), Arc::ImageLayout::General, nullptr))
+						.AddWrite(Arc::PushImageWrite(3, Arc::DescriptorType::StorageImage, sdfImage->GetImageView(), Arc::ImageLayout::General, nullptr))
+						.AddWrite(Arc::PushImageWrite(4, Arc::DescriptorType::StorageImage, nearestColorImage->GetImageView(), Arc::ImageLayout::General, nullptr)));
+					cmd->PushConstants(Arc::ShaderStage::Compute, m_JFAPipeline->GetLayout(), &data, sizeof(data));
+					cmd->Dispatch(std::ceil(m_SeedImage->GetExtent()[0] / 32.0f), std::ceil(m_SeedImage->GetExtent()[1] / 32.0f), 1);
+				},
+				.Inputs = inputs,
+				.Outputs = outputs
+			});
+		};
+
+		addJumpFloodPass(0, 0, {}, {
+			{ .Image = m_SeedImage->GetHandle(), .Access = Arc::ResourceAccess::StorageReadWrite },
+			{ .Image = jfaImage1->GetHandle(), .Access = Arc::ResourceAccess::StorageWrite },
+		});
+
+		for (int i = 0; i < m_MaxJFAIterations; i++)
+		{
+			addJumpFloodPass(1, 1 << (m_MaxJFAIterations - i - 1), {
+				{ .Image = jfaImage1->GetHandle(), .Access = Arc::ResourceAccess::StorageRead },
+			}, {
+				{ .Image = jfaImage2->GetHandle(), .Access = Arc::ResourceAccess::StorageWrite },
+			});
+			std::swap(jfaImage1, jfaImage2);
+		}
+
+		addJumpFloodPass(2, 0, {
+			{ .Image = m_SeedImage->GetHandle(), .Access = Arc::ResourceAccess::StorageRead },
+			{ .Image = jfaImage1->GetHandle(), .Access = Arc::ResourceAccess::StorageRead },
+		}, {
+			{ .Image = sdfImage->GetHandle(), .Access = Arc::ResourceAccess::StorageWrite },
+			{ .Image = nearestColorImage->GetHandle(), .Access = Arc::ResourceAccess::StorageWrite },
+		});
 
-				jfaData.phase = 2;
-				cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_JFAPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
-					.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::StorageImage, m_SeedImage->GetImageView(), Arc::ImageLayout::General, nullptr))
-					.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::StorageImage, m_JFAImage1->GetImageView(), Arc::ImageLayout::General, nullptr))
-					.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::StorageImage, m_JFAImage2->GetImageView(), Arc::ImageLayout::General, nullptr))
-					.AddWrite(Arc::PushImageWrite(3, Arc::DescriptorType::StorageImage, m_SDFImage->GetImageView(), Arc::ImageLayout::General, nullptr))
-					.AddWrite(Arc::PushImageWrite(4, Arc::DescriptorType::StorageImage, m_NearestColorImage->GetImageView(), Arc::ImageLayout::General, nullptr)));
-
-				cmd->PushConstants(Arc::ShaderStage::Compute, m_JFAPipeline->GetLayout(), &jfaData, sizeof(jfaData));
-				cmd->Dispatch(std::ceil(m_SeedImage->GetExtent()[0] / 32.0f), std::ceil(m_SeedImage->GetExtent()[1] / 32.0f), 1);
-
-				cmd->BindComputePipeline(m_RadianceCascadesPipeline->GetHandle());
-				for (int i = m_Cascades.size() - 1; i >= 0; i--)
-				{
-					cascadeData.Index = i;
-					cascadeData.Interval = 2.0f;
-					cascadeData.Count = m_Cascades.size();
-					float cascadeIndex = i;
+		for (int i = m_CascadeCount - 1; i >= 0; i--)
+		{
+			Arc::GpuImage* cascade = cascades[i];
+			Arc::GpuImage* upperCascade = cascades[std::min(i + 1, (int)m_CascadeCount - 1)];
+			m_RenderGraph->AddPass(Arc::RenderPass{
+				.Name = "Cascade",
+				.ExecuteFunction = [&, i, cascade, upperCascade, sdfImage, nearestColorImage](Arc::CommandBuffer* cmd, uint32_t frameIndex) {
+					CascadeData data = cascadeData;
+					data.Index = i;
+					data.Interval = 2.0f;
+					data.Count = m_CascadeCount;
+					cmd->BindComputePipeline(m_RadianceCascadesPipeline->GetHandle());
 					cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_RadianceCascadesPipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
-						.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::CombinedImageSampler, m_SDFImage->GetImageView(), Arc::ImageLayout::General, m_LinearSampler->GetHandle()))
-						.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::CombinedImageSampler, m_NearestColorImage->GetImageView(), Arc::ImageLayout::General, m_LinearSampler->GetHandle()))
-						.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::StorageImage, m_Cascades[i].GetImageView(), Arc::ImageLayout::General, nullptr))
-						.AddWrite(Arc::PushImageWrite(3, Arc::DescriptorType::CombinedImageSampler, m_Cascades[std::min(i + 1, (int)m_Cascades.size() - 1)].GetImageView(), Arc::ImageLayout::General, m_LinearSampler->GetHandle())));
-					cmd->PushConstants(Arc::ShaderStage::Compute, m_RadianceCascadesPipeline->GetLayout(), &cascadeData, sizeof(cascadeData));
-					cmd->Dispatch(m_Cascades[0].GetExtent()[0] / 32.0f, m_Cascades[0].GetExtent()[1] / 32.0f, 1);
+						.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::CombinedImageSampler, sdfImage->GetImageView(), Arc::ImageLayout::General, m_LinearSampler->GetHandle()))
+						.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::CombinedImageSampler, nearestColorImage->GetImageView(), Arc::ImageLayout::General, m_LinearSampler->GetHandle()))
+						.AddWrite(Arc::PushImageWrite(2, Arc::DescriptorType::StorageImage, cascade->GetImageView(), Arc::ImageLayout::General, nullptr))
+						.AddWrite(Arc::PushImageWrite(3, Arc::DescriptorType::CombinedImageSampler, upperCascade->GetImageView(), Arc::ImageLayout::General, m_LinearSampler->GetHandle())));
+					cmd->PushConstants(Arc::ShaderStage::Compute, m_RadianceCascadesPipeline->GetLayout(), &data, sizeof(data));
+					cmd->Dispatch(cascade->GetExtent()[0] / 32.0f, cascade->GetExtent()[1] / 32.0f, 1);
+				},
+				.Inputs = {
+					{ .Image = sdfImage->GetHandle(), .Access = Arc::ResourceAccess::SampledRead, .Layout = Arc::ImageLayout::General },
+					{ .Image = nearestColorImage->GetHandle(), .Access = Arc::ResourceAccess::SampledRead, .Layout = Arc::ImageLayout::General },
+					{ .Image = upperCascade->GetHandle(), .Access = Arc::ResourceAccess::SampledRead, .Layout = Arc::ImageLayout::General },
+				},
+				.Outputs = {
+					{ .Image = cascade->GetHandle(), .Access = Arc::ResourceAccess::StorageWrite },
 				}
-			}
-		});
+			});
+		}
 	}
 	m_RenderGraph->SetPresentPass(Arc::PresentPass{
 		.LoadOp = Arc::AttachmentLoadOp::Clear,
@@ -278,8 +284,12 @@ void RadianceCascades::RenderFrame(float elapsedTime)
 			cmd->BindPipeline(m_CompositePipeline->GetHandle());
 			cmd->PushDescriptorSets(Arc::PipelineBindPoint::Graphics, m_CompositePipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
 				.AddWrite(Arc::PushImageWrite(0, Arc::DescriptorType::CombinedImageSampler, m_SeedImage->GetImageView(), Arc::ImageLayout::General, m_NearestSampler->GetHandle()))
-				.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::CombinedImageSampler, m_Cascades[0].GetImageView(), Arc::ImageLayout::General, m_NearestSampler->GetHandle())));
+				.AddWrite(Arc::PushImageWrite(1, Arc::DescriptorType::CombinedImageSampler, m_RadianceImage->GetImageView(), Arc::ImageLayout::General, m_NearestSampler->GetHandle())));
 			cmd->Draw(6, 1, 0, 0);
+		},
+		.Inputs = {
+			{ .Image = m_SeedImage->GetHandle(), .Access = Arc::ResourceAccess::SampledRead, .Stage = Arc::ShaderStage::Fragment, .Layout = Arc::ImageLayout::General },
+			{ .Image = m_RadianceImage->GetHandle(), .Access = Arc::ResourceAccess::SampledRead, .Stage = Arc::ShaderStage::Fragment, .Layout = Arc::ImageLayout::General },
 		}
 	});
 	m_RenderGraph->BuildGraph();
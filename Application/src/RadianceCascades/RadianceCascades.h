@@ -51,11 +51,13 @@ private:
 	std::unique_ptr<Arc::Sampler> m_LinearSampler;
 
 	std::unique_ptr<Arc::GpuImage> m_SeedImage;
-	std::unique_ptr<Arc::GpuImage> m_JFAImage1;
-	std::unique_ptr<Arc::GpuImage> m_JFAImage2;
-	std::unique_ptr<Arc::GpuImage> m_SDFImage;
-	std::unique_ptr<Arc::GpuImage> m_NearestColorImage;
-	std::vector<Arc::GpuImage> m_Cascades;
+	// Only cascade 0 is kept between frames, the rest are transient images of the render graph
+	std::unique_ptr<Arc::GpuImage> m_RadianceImage;
+	Arc::GpuImageDesc m_JFAImageDesc;
+	Arc::GpuImageDesc m_SDFImageDesc;
+	Arc::GpuImageDesc m_NearestColorImageDesc;
+	Arc::GpuImageDesc m_CascadeImageDesc;
+	uint32_t m_CascadeCount = 6;
 	uint32_t m_MaxJFAIterations = 0;
 	bool m_ClearFrame = true;
 
@@ -1,5 +1,6 @@
 #include "TransferFunctionEditor.h"
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 
 TransferFunctionEditor::TransferFunctionEditor()
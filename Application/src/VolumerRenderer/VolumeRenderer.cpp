@@ -50,6 +50,7 @@ VolumeRenderer::VolumeRenderer(Arc::Window* window, Arc::Device* device, Arc::Pr
 		.UsageFlags = Arc::ImageUsage::Storage | Arc::ImageUsage::Sampled | Arc::ImageUsage::TransferDst,
 		.AspectFlags = Arc::ImageAspect::Color,
 		.MipLevels = 1,
+		.Movable = true,
 	});
 
 	m_TransferFunctionImage = std::make_unique<Arc::GpuImage>();
@@ -60,6 +61,7 @@ VolumeRenderer::VolumeRenderer(Arc::Window* window, Arc::Device* device, Arc::Pr
 		.UsageFlags = Arc::ImageUsage::Sampled | Arc::ImageUsage::TransferDst,
 		.AspectFlags = Arc::ImageAspect::Color,
 		.MipLevels = 1,
+		.Movable = true,
 	});
 
 	m_Files = DatasetLoader::GetDirectoryFiles(m_DatasetDirectory);
@@ -72,30 +74,13 @@ VolumeRenderer::VolumeRenderer(Arc::Window* window, Arc::Device* device, Arc::Pr
 
 	UpdateTransferAndExtinctionImages();
 
-	m_GlobalDataBuffer = std::make_unique<Arc::GpuBufferArray>();
-	m_ResourceCache->CreateGpuBufferArray(m_GlobalDataBuffer.get(), Arc::GpuBufferDesc{
-		.Size = sizeof(GlobalFrameData),
-		.UsageFlags = Arc::BufferUsage::UniformBuffer,
-		.MemoryProperty = Arc::MemoryProperty::HostVisible,
-	});
-
-	m_GlobalDataDescSet = std::make_unique<Arc::DescriptorSetArray>();
-	m_ResourceCache->AllocateDescriptorSetArray(m_GlobalDataDescSet.get(), Arc::DescriptorSetDesc{
-		.Bindings = {
-			{ Arc::DescriptorType::UniformBuffer, Arc::ShaderStage::Compute }
-		}
-	});
-	m_Device->UpdateDescriptorSet(m_GlobalDataDescSet.get(), Arc::DescriptorWrite()
-		.AddWrite(Arc::BufferArrayWrite(0, m_GlobalDataBuffer.get()))
-	);
-
+	// The frame data is uploaded through the UniformAllocator and pushed, the images stay in bound sets
 	m_VolumePipeline = std::make_unique<Arc::ComputePipeline>();
 	m_ResourceCache->CreateComputePipeline(m_VolumePipeline.get(), Arc::ComputePipelineDesc{
-		.Shader = m_VolumeShader.get()
+		.Shader = m_VolumeShader.get(),
+		.PushDescriptorSets = { 0 }
 	});
 
-	m_VolumeImageDescriptor1 = std::make_unique<Arc::DescriptorSet>();
-	m_VolumeImageDescriptor2 = std::make_unique<Arc::DescriptorSet>();
 	{
 		Arc::DescriptorSetDesc desc = Arc::DescriptorSetDesc{
 		.Bindings = {
@@ -107,8 +92,15 @@ VolumeRenderer::VolumeRenderer(Arc::Window* window, Arc::Device* device, Arc::Pr
 			{ Arc::DescriptorType::CombinedImageSampler, Arc::ShaderStage::Compute },
 			{ Arc::DescriptorType::StorageImage, Arc::ShaderStage::Compute }
 		}};
-		m_ResourceCache->AllocateDescriptorSet(m_VolumeImageDescriptor1.get(), desc);
-		m_ResourceCache->AllocateDescriptorSet(m_VolumeImageDescriptor2.get(), desc);
+		m_VolumeImageDescriptors.resize(m_Device->GetFramesInFlightCount());
+		for (auto& frameDescriptorSets : m_VolumeImageDescriptors)
+		{
+			for (auto& descriptorSet : frameDescriptorSets)
+			{
+				descriptorSet = std::make_unique<Arc::DescriptorSet>();
+				m_ResourceCache->AllocateDescriptorSet(descriptorSet.get(), desc);
+			}
+		}
 	}
 
 
@@ -119,12 +111,8 @@ VolumeRenderer::VolumeRenderer(Arc::Window* window, Arc::Device* device, Arc::Pr
 		.ColorAttachmentFormats = { m_PresentQueue->GetSurfaceFormat() },
 	});
 
-	m_PresentDescriptor = std::make_unique<Arc::DescriptorSet>();
-	m_ResourceCache->AllocateDescriptorSet(m_PresentDescriptor.get(), Arc::DescriptorSetDesc{
-		.Bindings = {
-			{ Arc::DescriptorType::CombinedImageSampler, Arc::ShaderStage::Fragment }
-		}
-	});
+	m_PresentDescriptorSet = std::make_unique<Arc::DescriptorSet>();
+	m_OutdatedDescriptors.resize(m_Device->GetFramesInFlightCount(), false);
 
 	m_Camera = std::make_unique<CameraFP>(m_Window);
 	m_Camera->Position = glm::vec3(0.5, 0.5, -0.5f);
@@ -150,7 +138,6 @@ void VolumeRenderer::RenderFrame(float elapsedTime)
 	static float lastTime = 0.0f;
 	float dt = elapsedTime - lastTime;
 	lastTime = elapsedTime;
-	m_IsEvenFrame = !m_IsEvenFrame;
 
 	Arc::FrameData frameData = m_PresentQueue->BeginFrame();
 	Arc::CommandBuffer* cmd = frameData.CommandBuffer;
@@ -252,6 +239,7 @@ void VolumeRenderer::RenderFrame(float elapsedTime)
 			{
 				UpdateDescriptorSets();
 				globalFrameData.frameIndex = 1;
+				m_RenderGraph->InvalidateHistory(m_Accumulation);
 			}
 			});
 		m_UserInterface->RenderCanvas(m_ImGuiDisplayImage, [&](float width, float height)
@@ -277,45 +265,51 @@ void VolumeRenderer::RenderFrame(float elapsedTime)
 		m_UserInterface->EndDockspace();
 	}
 
+	UpdateFrameDescriptorSets(frameData.FrameIndex);
+
 	if (guiChanged || m_Camera->HasMoved || m_TransferFunctionEditor->HasDataChanged())
 	{
 		globalFrameData.frameIndex = 1;
+		m_RenderGraph->InvalidateHistory(m_Accumulation);
 	}
+	Arc::UniformAllocation globalData = m_Device->GetUniformAllocator()->Upload(frameData.FrameIndex, globalFrameData);
+	if (m_TransferFunctionEditor->HasDataChanged())
 	{
-		void* data = m_ResourceCache->MapMemory(m_GlobalDataBuffer.get(), frameData.FrameIndex);
-		memcpy(data, &globalFrameData, sizeof(GlobalFrameData));
-		m_ResourceCache->UnmapMemory(m_GlobalDataBuffer.get(), frameData.FrameIndex);
-	
-		if (m_TransferFunctionEditor->HasDataChanged())
-		{
-			UpdateTransferAndExtinctionImages();
-		}
+		UpdateTransferAndExtinctionImages();
 	}
 
 	m_RenderGraph->AddPass(Arc::RenderPass{
-		.ExecuteFunction = [&](Arc::CommandBuffer* cmd, uint32_t frameIndex) {
-			cmd->MemoryBarrier({
-			Arc::CommandBuffer::ImageBarrier{
-				.Handle = m_OutputImage->GetHandle(),
-				.OldLayout = Arc::ImageLayout::Undefined,
-				.NewLayout = Arc::ImageLayout::General,
-			} });
-
-			{
-				//auto gpuTimer = m_Device->GetTimestampQuery()->AddScopedTimer("Compute", cmd);
-				cmd->BindDescriptorSets(Arc::PipelineBindPoint::Compute, m_VolumePipeline->GetLayout(), 0, { m_GlobalDataDescSet->GetHandle(frameIndex), m_IsEvenFrame ? m_VolumeImageDescriptor1->GetHandle() : m_VolumeImageDescriptor2->GetHandle() });
-				cmd->BindComputePipeline(m_VolumePipeline->GetHandle());
-				cmd->Dispatch(std::ceil(m_ImGuiCanvasSize.x / 32.0f), std::ceil(m_ImGuiCanvasSize.y / 32.0f), 1);
-			}
-
-			cmd->MemoryBarrier({
-			Arc::CommandBuffer::ImageBarrier{
-				.Handle = m_OutputImage->GetHandle(),
-				.OldLayout = Arc::ImageLayout::General,
-				.NewLayout = Arc::ImageLayout::ShaderReadOnlyOptimal
-			} });
+		.Name = "VolumeRendering",
+		.ExecuteFunction = [&, globalData, previousVersion = m_Accumulation->GetVersionIndex(1)](Arc::CommandBuffer* cmd, uint32_t frameIndex) {
+			//auto gpuTimer = m_Device->GetTimestampQuery()->AddScopedTimer("Compute", cmd);
+			cmd->PushDescriptorSets(Arc::PipelineBindPoint::Compute, m_VolumePipeline->GetLayout(), 0, Arc::PushDescriptorWrite()
+				.AddWrite(Arc::PushBufferWrite(0, Arc::DescriptorType::UniformBuffer, globalData.Buffer, globalData.Size, globalData.Offset)));
+			cmd->BindDescriptorSets(Arc::PipelineBindPoint::Compute, m_VolumePipeline->GetLayout(), 1, { m_VolumeImageDescriptors[frameIndex][previousVersion]->GetHandle() });
+			cmd->BindComputePipeline(m_VolumePipeline->GetHandle());
+			cmd->Dispatch(std::ceil(m_ImGuiCanvasSize.x / 32.0f), std::ceil(m_ImGuiCanvasSize.y / 32.0f), 1);
+		},
+		.Inputs = {
+			{ .Image = m_DatasetImage->GetHandle(), .Access = Arc::ResourceAccess::SampledRead },
+			{ .Image = m_TransferFunctionImage->GetHandle(), .Access = Arc::ResourceAccess::SampledRead },
+			{ .Image = m_Accumulation->GetPrevious()->GetHandle(), .Access = Arc::ResourceAccess::StorageRead },
+		},
+		.Outputs = {
+			{ .Image = m_Accumulation->GetCurrent()->GetHandle(), .Access = Arc::ResourceAccess::StorageWrite },
+			{ .Image = m_MaxExtinctionImage->GetHandle(), .Access = Arc::ResourceAccess::StorageReadWrite },
+			{ .Image = m_OutputImage->GetHandle(), .Access = Arc::ResourceAccess::StorageWrite },
 		}
 	});
+	if (!m_RenderWithGUI)
+	{
+		m_ResourceCache->AllocateTransientDescriptorSet(m_PresentDescriptorSet.get(), frameData.FrameIndex, Arc::DescriptorSetDesc{
+			.Bindings = {
+				{ Arc::DescriptorType::CombinedImageSampler, Arc::ShaderStage::Fragment }
+			}
+		});
+		m_Device->UpdateDescriptorSet(m_PresentDescriptorSet.get(), Arc::DescriptorWrite()
+			.AddWrite(Arc::ImageWrite(0, m_OutputImage.get(), Arc::ImageLayout::ShaderReadOnlyOptimal, m_NearestSampler.get()))
+		);
+	}
 	m_RenderGraph->SetPresentPass(Arc::PresentPass{
 		.LoadOp = Arc::AttachmentLoadOp::Clear,
 		.ClearColor = {1, 0.5, 1, 1},
@@ -326,10 +320,13 @@ void VolumeRenderer::RenderFrame(float elapsedTime)
 			}
 			else
 			{
-				cmd->BindDescriptorSets(Arc::PipelineBindPoint::Graphics, m_PresentPipeline->GetLayout(), 0, { m_PresentDescriptor->GetHandle() });
+				cmd->BindDescriptorSets(Arc::PipelineBindPoint::Graphics, m_PresentPipeline->GetLayout(), 0, { m_PresentDescriptorSet->GetHandle() });
 				cmd->BindPipeline(m_PresentPipeline->GetHandle());
 				cmd->Draw(6, 1, 0, 0);
 			}
+		},
+		.Inputs = {
+			{ .Image = m_OutputImage->GetHandle(), .Access = Arc::ResourceAccess::SampledRead, .Stage = Arc::ShaderStage::Fragment },
 		}
 	});
 	m_RenderGraph->BuildGraph();
@@ -358,31 +355,42 @@ bool VolumeRenderer::LoadDataset(std::string fileName)
 	}
 
 	m_SelectedDataset = fileName;
-	if (m_DataSetSize.x != size.x || m_DataSetSize.y != size.y || m_DataSetSize.z != size.z)
-	{
-		m_Device->WaitIdle();
-		if (m_DatasetImage.get())
-			m_ResourceCache->ReleaseResource(m_DatasetImage.get());
-		m_DatasetImage = std::make_unique<Arc::GpuImage>();
-		m_ResourceCache->CreateGpuImage(m_DatasetImage.get(), Arc::GpuImageDesc{
-			.Extent = { (uint32_t)size.x, (uint32_t)size.y, (uint32_t)size.z },
-			.Format = Arc::Format::R8_Unorm,
-			.UsageFlags = Arc::ImageUsage::Sampled | Arc::ImageUsage::TransferDst,
-			.AspectFlags = Arc::ImageAspect::Color,
-			.MipLevels = 1,
-		});
-
-		m_DataSetSize = size;
-	}
+	// Frames in flight keep reading the previous image, so every dataset gets a new one
+	if (m_DatasetImage.get())
+		m_ResourceCache->ReleaseResource(m_DatasetImage.get());
+	m_DatasetImage = std::make_unique<Arc::GpuImage>();
+	m_ResourceCache->CreateGpuImage(m_DatasetImage.get(), Arc::GpuImageDesc{
+		.Extent = { (uint32_t)size.x, (uint32_t)size.y, (uint32_t)size.z },
+		.Format = Arc::Format::R8_Unorm,
+		.UsageFlags = Arc::ImageUsage::Sampled | Arc::ImageUsage::TransferDst,
+		.AspectFlags = Arc::ImageAspect::Color,
+		.MipLevels = 1,
+		.Movable = true,
+	});
 	std::vector<uint8_t> dataSet = DatasetLoader::LoadFromFile("res/Datasets/" + fileName);
 	m_Device->SetImageData(m_DatasetImage.get(), dataSet.data(), dataSet.size(), Arc::ImageLayout::ShaderReadOnlyOptimal);
-	
+
+	// Datasets differ in size, compact the memory they leave behind over the next frames
+	m_ResourceCache->BeginDefragmentation(Arc::DefragmentationDesc{
+		.ImageMoved = [this](Arc::GpuImage* image) {
+			if (image == m_OutputImage.get())
+			{
+				m_ImGuiRenderer->RemoveImageId(m_ImGuiDisplayImage);
+				m_ImGuiDisplayImage = m_ImGuiRenderer->CreateImageId(m_OutputImage->GetImageView(), m_LinearSampler->GetHandle());
+			}
+			else if (image == m_TransferFunctionImage.get())
+			{
+				m_ImGuiRenderer->RemoveImageId(m_ImGuiTransferImage);
+				m_ImGuiTransferImage = m_ImGuiRenderer->CreateImageId(m_TransferFunctionImage->GetImageView(), m_LinearSampler->GetHandle());
+			}
+		},
+	});
+
 	return true;
 }
 
 void VolumeRenderer::ResizeCanvas(uint32_t width, uint32_t height)
 {
-	m_Device->WaitIdle();
 	if(m_OutputImage.get())
 		m_ResourceCache->ReleaseResource(m_OutputImage.get());
 	m_OutputImage = std::make_unique<Arc::GpuImage>();
@@ -392,13 +400,10 @@ void VolumeRenderer::ResizeCanvas(uint32_t width, uint32_t height)
 		.UsageFlags = Arc::ImageUsage::TransferSrc | Arc::ImageUsage::Storage | Arc::ImageUsage::Sampled,
 		.AspectFlags = Arc::ImageAspect::Color,
 		.MipLevels = 1,
+		.Movable = true,
 	});
-	if (m_AccumulationImage1.get())
-		m_ResourceCache->ReleaseResource(m_AccumulationImage1.get());
-	if (m_AccumulationImage2.get())
-		m_ResourceCache->ReleaseResource(m_AccumulationImage2.get());
-	m_AccumulationImage1 = std::make_unique<Arc::GpuImage>();
-	m_AccumulationImage2 = std::make_unique<Arc::GpuImage>();
+	if (m_Accumulation)
+		m_RenderGraph->ReleaseHistoryImage(m_Accumulation);
 	{
 		Arc::GpuImageDesc desc = Arc::GpuImageDesc{
 		.Extent = { width, height, 1},
@@ -407,41 +412,43 @@ void VolumeRenderer::ResizeCanvas(uint32_t width, uint32_t height)
 		.AspectFlags = Arc::ImageAspect::Color,
 		.MipLevels = 1,
 		};
-		m_ResourceCache->CreateGpuImage(m_AccumulationImage1.get(), desc);
-		m_ResourceCache->CreateGpuImage(m_AccumulationImage2.get(), desc);
-		m_Device->TransitionImageLayout(m_AccumulationImage1.get(), Arc::ImageLayout::General);
-		m_Device->TransitionImageLayout(m_AccumulationImage2.get(), Arc::ImageLayout::General);
+		m_Accumulation = m_RenderGraph->CreateHistoryImage(desc, AccumulationVersionCount);
+		for (uint32_t i = 0; i < m_Accumulation->GetVersionCount(); i++)
+		{
+			m_Device->TransitionImageLayout(m_Accumulation->GetVersionImage(i), Arc::ImageLayout::General);
+		}
 	}
 
 	UpdateDescriptorSets();
 
-	m_Device->UpdateDescriptorSet(m_PresentDescriptor.get(), Arc::DescriptorWrite()
-		.AddWrite(Arc::ImageWrite(0, m_OutputImage.get(), Arc::ImageLayout::ShaderReadOnlyOptimal, m_NearestSampler.get()))
-	);
-
+	m_ImGuiRenderer->RemoveImageId(m_ImGuiDisplayImage);
 	m_ImGuiDisplayImage = m_ImGuiRenderer->CreateImageId(m_OutputImage->GetImageView(), m_LinearSampler->GetHandle());
 }
 
 void VolumeRenderer::UpdateDescriptorSets()
 {
-	m_Device->UpdateDescriptorSet(m_VolumeImageDescriptor1.get(), Arc::DescriptorWrite()
-		.AddWrite(Arc::ImageWrite(0, m_AccumulationImage1.get(), Arc::ImageLayout::General, nullptr))
-		.AddWrite(Arc::ImageWrite(1, m_AccumulationImage2.get(), Arc::ImageLayout::General, nullptr))
-		.AddWrite(Arc::ImageWrite(2, m_OutputImage.get(), Arc::ImageLayout::General, nullptr))
-		.AddWrite(Arc::ImageWrite(3, m_DatasetImage.get(), Arc::ImageLayout::ShaderReadOnlyOptimal, m_LinearSampler.get()))
-		.AddWrite(Arc::ImageWrite(4, m_TransferFunctionImage.get(), Arc::ImageLayout::ShaderReadOnlyOptimal, m_LinearSampler.get()))
-		.AddWrite(Arc::ImageWrite(5, m_MaxExtinctionImage.get(), Arc::ImageLayout::General, m_NearestSampler.get()))
-		.AddWrite(Arc::ImageWrite(6, m_MaxExtinctionImage.get(), Arc::ImageLayout::General, nullptr))
-	);
-	m_Device->UpdateDescriptorSet(m_VolumeImageDescriptor2.get(), Arc::DescriptorWrite()
-		.AddWrite(Arc::ImageWrite(0, m_AccumulationImage2.get(), Arc::ImageLayout::General, nullptr))
-		.AddWrite(Arc::ImageWrite(1, m_AccumulationImage1.get(), Arc::ImageLayout::General, nullptr))
-		.AddWrite(Arc::ImageWrite(2, m_OutputImage.get(), Arc::ImageLayout::General, nullptr))
-		.AddWrite(Arc::ImageWrite(3, m_DatasetImage.get(), Arc::ImageLayout::ShaderReadOnlyOptimal, m_LinearSampler.get()))
-		.AddWrite(Arc::ImageWrite(4, m_TransferFunctionImage.get(), Arc::ImageLayout::ShaderReadOnlyOptimal, m_LinearSampler.get()))
-		.AddWrite(Arc::ImageWrite(5, m_MaxExtinctionImage.get(), Arc::ImageLayout::General, m_NearestSampler.get()))
-		.AddWrite(Arc::ImageWrite(6, m_MaxExtinctionImage.get(), Arc::ImageLayout::General, nullptr))
-	);
+	std::fill(m_OutdatedDescriptors.begin(), m_OutdatedDescriptors.end(), true);
+}
+
+void VolumeRenderer::UpdateFrameDescriptorSets(uint32_t frameIndex)
+{
+	if (!m_OutdatedDescriptors[frameIndex])
+		return;
+	m_OutdatedDescriptors[frameIndex] = false;
+
+	auto& frameDescriptorSets = m_VolumeImageDescriptors[frameIndex];
+	for (uint32_t i = 0; i < AccumulationVersionCount; i++)
+	{
+		m_Device->UpdateDescriptorSet(frameDescriptorSets[i].get(), Arc::DescriptorWrite()
+			.AddWrite(Arc::ImageWrite(0, m_Accumulation->GetVersionImage(i), Arc::ImageLayout::General, nullptr))
+			.AddWrite(Arc::ImageWrite(1, m_Accumulation->GetVersionImage((i + 1) % AccumulationVersionCount), Arc::ImageLayout::General, nullptr))
+			.AddWrite(Arc::ImageWrite(2, m_OutputImage.get(), Arc::ImageLayout::General, nullptr))
+			.AddWrite(Arc::ImageWrite(3, m_DatasetImage.get(), Arc::ImageLayout::ShaderReadOnlyOptimal, m_LinearSampler.get()))
+			.AddWrite(Arc::ImageWrite(4, m_TransferFunctionImage.get(), Arc::ImageLayout::ShaderReadOnlyOptimal, m_LinearSampler.get()))
+			.AddWrite(Arc::ImageWrite(5, m_MaxExtinctionImage.get(), Arc::ImageLayout::General, m_NearestSampler.get()))
+			.AddWrite(Arc::ImageWrite(6, m_MaxExtinctionImage.get(), Arc::ImageLayout::General, nullptr))
+		);
+	}
 }
 
 void VolumeRenderer::UpdateTransferAndExtinctionImages()
@@ -461,7 +468,6 @@ void VolumeRenderer::SwapchainResized(void* presentQueue)
 
 void VolumeRenderer::RecompileShaders()
 {
-	m_Device->WaitIdle();
 	Arc::Timer timer;
 	Arc::ShaderDesc shaderDesc;
 	if (Arc::ShaderCompiler::Compile("res/Shaders/compute.comp", shaderDesc))
@@ -475,7 +481,8 @@ void VolumeRenderer::RecompileShaders()
 			m_ResourceCache->ReleaseResource(m_VolumePipeline.get());
 		m_VolumePipeline = std::make_unique<Arc::ComputePipeline>();
 		m_ResourceCache->CreateComputePipeline(m_VolumePipeline.get(), Arc::ComputePipelineDesc{
-			.Shader = m_VolumeShader.get()
+			.Shader = m_VolumeShader.get(),
+			.PushDescriptorSets = { 0 }
 			});
 		globalFrameData.frameIndex = 0;
 	}
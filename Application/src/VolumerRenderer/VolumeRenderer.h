@@ -27,6 +27,7 @@ private:
 	bool LoadDataset(std::string fileName);
 	void ResizeCanvas(uint32_t width, uint32_t height);
 	void UpdateDescriptorSets();
+	void UpdateFrameDescriptorSets(uint32_t frameIndex);
 	void UpdateTransferAndExtinctionImages();
 
 	Arc::Window* m_Window;
@@ -37,12 +38,11 @@ private:
 	std::unique_ptr<Arc::ImGuiRenderer> m_ImGuiRenderer;
 	std::unique_ptr<TransferFunctionEditor> m_TransferFunctionEditor;
 	std::unique_ptr<UserInterface> m_UserInterface;
-	ImTextureID m_ImGuiDisplayImage;
-	ImTextureID m_ImGuiTransferImage;
+	ImTextureID m_ImGuiDisplayImage = {};
+	ImTextureID m_ImGuiTransferImage = {};
 	ImVec2 m_ImGuiCanvasSize;
 
 	std::unique_ptr<CameraFP> m_Camera;
-	bool m_IsEvenFrame = false;
 	bool m_RenderWithGUI = true;
 	bool m_AccumulateFrames = true;
 	struct GlobalFrameData
@@ -62,21 +62,16 @@ private:
 		alignas(16) glm::ivec4 debugDraw = { 0, 1, 1, 1 };
 	} globalFrameData;
 
-	std::unique_ptr<Arc::GpuBufferArray> m_GlobalDataBuffer;
-	std::unique_ptr<Arc::DescriptorSetArray> m_GlobalDataDescSet;
-
 	std::string m_DatasetDirectory = "res/Datasets/";
 	std::vector<std::string> m_Files;
 	std::string m_SelectedDataset = "";
-	glm::ivec3 m_DataSetSize = {0, 0, 0};
 	uint32_t m_ExtinctionGridSize = 64;
 
 	// Resources
 	std::unique_ptr<Arc::Sampler> m_NearestSampler;
 	std::unique_ptr<Arc::Sampler> m_LinearSampler;
 	std::unique_ptr<Arc::GpuImage> m_OutputImage;
-	std::unique_ptr<Arc::GpuImage> m_AccumulationImage1;
-	std::unique_ptr<Arc::GpuImage> m_AccumulationImage2;
+	Arc::HistoryImage* m_Accumulation = nullptr;
 	std::unique_ptr<Arc::GpuImage> m_DatasetImage;
 	std::unique_ptr<Arc::GpuImage> m_TransferFunctionImage;
 	std::unique_ptr<Arc::GpuImage> m_MaxExtinctionImage;
@@ -84,11 +79,15 @@ private:
 	// Compute Pass
 	std::unique_ptr<Arc::Shader> m_VolumeShader;
 	std::unique_ptr<Arc::ComputePipeline> m_VolumePipeline;
-	std::unique_ptr<Arc::DescriptorSet> m_VolumeImageDescriptor1;
-	std::unique_ptr<Arc::DescriptorSet> m_VolumeImageDescriptor2;
+	// One per frame in flight and version of the accumulation image that is read as the previous frame
+	static constexpr uint32_t AccumulationVersionCount = 2;
+	std::vector<std::array<std::unique_ptr<Arc::DescriptorSet>, AccumulationVersionCount>> m_VolumeImageDescriptors;
 	// Present Pass
 	std::unique_ptr<Arc::Shader> m_VertShader;
 	std::unique_ptr<Arc::Shader> m_FragShader;
 	std::unique_ptr<Arc::Pipeline> m_PresentPipeline;
-	std::unique_ptr<Arc::DescriptorSet> m_PresentDescriptor;
+	// Allocated from the transient pools of the frame and written again every frame without the GUI
+	std::unique_ptr<Arc::DescriptorSet> m_PresentDescriptorSet;
+	// Sets of other frames can still be in use, so each frame rewrites its own sets before recording
+	std::vector<bool> m_OutdatedDescriptors;
 };
\ No newline at end of file
@@ -10,6 +10,11 @@
 #include "RadianceCascades/RadianceCascades.h"
 #include "FluidDynamics/FluidDynamics.h"
 #include "PathTracer/PathTracer.h"
+#include "Benchmarks/HandlePoolBenchmark.h"
+#include "ArcaneEngine/Core/Log.h"
+#include "ArcaneEngine/Core/AllocationCounter.h"
+#include <algorithm>
+#include <string_view>
 
 int currentRendererId = -1;
 void GetRenderer(int rendererId, std::unique_ptr<RendererBase>& renderer, 
@@ -19,6 +24,7 @@ void GetRenderer(int rendererId, std::unique_ptr<RendererBase>& renderer,
 		return;
 
 	device->WaitIdle();
+	device->GetRenderGraph()->Reset();
 	device->GetResourceCache()->FreeResources();
 	renderer.reset();
 	switch (rendererId)
@@ -39,8 +45,56 @@ void GetRenderer(int rendererId, std::unique_ptr<RendererBase>& renderer,
 	currentRendererId = rendererId;
 }
 
-int main()
+// Creates, renders and destroys every renderer twice. Engine owned buffers may grow during the first round,
+// after that every round has to leave the same resources alive
+int RunLeakTest(Arc::Window* window, Arc::Device* device, Arc::PresentQueue* presentQueue, uint32_t frameCount = 10)
 {
+	auto sameReport = [](const std::vector<Arc::ResourceReportEntry>& a, const std::vector<Arc::ResourceReportEntry>& b) {
+		return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const Arc::ResourceReportEntry& x, const Arc::ResourceReportEntry& y) {
+			return x.Tag == y.Tag && std::string_view(x.Type) == y.Type && x.Count == y.Count && x.Bytes == y.Bytes;
+		});
+	};
+
+	std::unique_ptr<RendererBase> renderer;
+	std::vector<Arc::ResourceReportEntry> baseline;
+	Arc::Timer timer;
+	for (uint32_t round = 0; round < 2; round++)
+	{
+		for (int rendererId = 1; rendererId <= 4; rendererId++)
+		{
+			GetRenderer(rendererId, renderer, window, device, presentQueue);
+			for (uint32_t frame = 0; frame < frameCount && !presentQueue->OutOfDate(); frame++)
+			{
+				window->PollEvents();
+				renderer->RenderFrame(timer.elapsed_sec());
+			}
+			GetRenderer(0, renderer, window, device, presentQueue);
+
+			std::vector<Arc::ResourceReportEntry> report = device->GetResourceCache()->GetResourceReport();
+			if (round == 0)
+			{
+				baseline = std::move(report);
+			}
+			else if (!sameReport(report, baseline))
+			{
+				ARC_LOG_ERROR("Leak test failed, renderer {} changed the live resources:", rendererId);
+				device->GetResourceCache()->PrintResourceReport();
+				return 1;
+			}
+		}
+	}
+	ARC_LOG("Leak test passed, {} resources stay alive between renderers", baseline.size());
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1 && std::string_view(argv[1]) == "--benchmark-handles")
+	{
+		RunHandlePoolBenchmark();
+		return 0;
+	}
+
 	Arc::WindowDescription windowDesc;
 	windowDesc.Title = "Arcane Vulkan renderer";
 	windowDesc.Width = 1280;
@@ -54,9 +108,17 @@ int main()
 	auto device = std::make_unique<Arc::Device>(window->GetHandle(), window->GetInstanceExtensions(), inFlightFrameCount);
 	auto presentQueue = std::make_unique<Arc::PresentQueue>(device.get(), presentMode);
 
+	if (argc > 1 && std::string_view(argv[1]) == "--leak-test")
+		return RunLeakTest(window.get(), device.get(), presentQueue.get());
+
 	std::unique_ptr<RendererBase> renderer;
 	GetRenderer(3, renderer, window.get(), device.get(), presentQueue.get());
 	
+#ifdef ARC_COUNT_ALLOCATIONS
+	int checkedRendererId = -1;
+	uint32_t rendererFrameCount = 0;
+	bool allocationReported = false;
+#endif
 	Arc::Timer timer;
 	while (!window->IsClosed())
 	{
@@ -82,10 +144,32 @@ int main()
 			presentQueue.reset();
 			presentQueue = std::make_unique<Arc::PresentQueue>(device.get(), presentMode);
 			renderer->SwapchainResized(presentQueue.get());
+#ifdef ARC_COUNT_ALLOCATIONS
+			// The renderer rebuilds its graph for the new extent
+			checkedRendererId = -1;
+#endif
 		}
 
 		renderer->RenderFrame(timer.elapsed_sec());
+
+#ifdef ARC_COUNT_ALLOCATIONS
+		// The first frames of a renderer build and compile its graph, frames after that should not allocate
+		if (checkedRendererId != currentRendererId)
+		{
+			checkedRendererId = currentRendererId;
+			rendererFrameCount = 0;
+			allocationReported = false;
+		}
+		uint32_t allocationCount = presentQueue->GetFrameAllocationCount();
+		if (++rendererFrameCount > 2 * inFlightFrameCount && allocationCount > 0 && !allocationReported)
+		{
+			ARC_LOG_WARNING("Renderer {} made {} allocations in frame {}", currentRendererId, allocationCount, rendererFrameCount);
+			allocationReported = true;
+		}
+#endif
 	}
 	device->WaitIdle();
+	device->GetRenderGraph()->Reset();
+	device->GetResourceCache()->PrintResourceReport();
 	device->GetResourceCache()->FreeResources();
 }
\ No newline at end of file
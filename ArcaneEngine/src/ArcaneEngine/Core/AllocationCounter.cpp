@@ -0,0 +1,72 @@
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace Arc
+{
+	namespace
+	{
+		std::atomic<uint64_t> s_AllocationCount = 0;
+	}
+
+	uint64_t GetAllocationCount()
+	{
+		return s_AllocationCount.load(std::memory_order_relaxed);
+	}
+}
+
+#ifdef ARC_COUNT_ALLOCATIONS
+// Array and nothrow forms forward to these
+void* operator new(std::size_t size)
+{
+	Arc::s_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+	void* memory = std::malloc(size ? size : 1);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	Arc::s_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+	size_t align = (size_t)alignment;
+	size = size ? size : 1;
+#ifdef _WIN32
+	void* memory = _aligned_malloc(size, align);
+#else
+	// aligned_alloc requires the size to be a multiple of the alignment
+	void* memory = std::aligned_alloc(align, (size + align - 1) / align * align);
+#endif
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+#ifdef _WIN32
+	_aligned_free(memory);
+#else
+	std::free(memory);
+#endif
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(memory, alignment);
+}
+#endif // ARC_COUNT_ALLOCATIONS
\ No newline at end of file
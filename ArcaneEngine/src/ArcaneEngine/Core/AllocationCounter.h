@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+
+// Replaces the global operator new and delete to count allocations, define it for profiling builds as well
+#if defined(DEBUG)
+	#define ARC_COUNT_ALLOCATIONS
+#endif // DEBUG
+
+namespace Arc
+{
+	/* Number of operator new calls since startup from every thread, used to check that steady state frames do not allocate.
+	   Always 0 unless ARC_COUNT_ALLOCATIONS is defined */
+	uint64_t GetAllocationCount();
+}
\ No newline at end of file
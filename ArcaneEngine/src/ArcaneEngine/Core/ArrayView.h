@@ -0,0 +1,32 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <vector>
+
+namespace Arc
+{
+	/* Non-owning view of contiguous elements. Views of braced lists are only valid until the end of the full expression */
+	template<typename T>
+	class ArrayView
+	{
+	public:
+		ArrayView() = default;
+		ArrayView(const T* data, size_t size) : m_Data(data), m_Size(size) {}
+		ArrayView(std::initializer_list<T> list) : m_Data(list.begin()), m_Size(list.size()) {}
+		ArrayView(const std::vector<T>& vector) : m_Data(vector.data()), m_Size(vector.size()) {}
+		template<size_t N>
+		ArrayView(const std::array<T, N>& array) : m_Data(array.data()), m_Size(N) {}
+
+		const T* begin() const { return m_Data; }
+		const T* end() const { return m_Data + m_Size; }
+		const T* data() const { return m_Data; }
+		size_t size() const { return m_Size; }
+		bool empty() const { return m_Size == 0; }
+		const T& operator[](size_t index) const { return m_Data[index]; }
+
+	private:
+		const T* m_Data = nullptr;
+		size_t m_Size = 0;
+	};
+}
\ No newline at end of file
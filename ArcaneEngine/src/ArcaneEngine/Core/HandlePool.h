@@ -0,0 +1,139 @@
+#pragma once
+#include "ArcaneEngine/Core/Log.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Arc
+{
+	/* 32-bit generational handle, the low IndexBits select a slot and the remaining bits hold the slot generation it was issued with */
+	template<typename Tag>
+	struct Handle
+	{
+		static constexpr uint32_t IndexBits = 20;
+		static constexpr uint32_t IndexMask = (1u << IndexBits) - 1;
+		static constexpr uint32_t MaxGeneration = (1u << (32 - IndexBits)) - 1;
+
+		uint32_t Value = 0;
+
+		uint32_t GetIndex() const { return Value & IndexMask; }
+		uint32_t GetGeneration() const { return Value >> IndexBits; }
+		bool IsNull() const { return Value == 0; }
+		bool operator==(const Handle&) const = default;
+	};
+
+	/*
+		Values are kept densely packed in insertion order with swap-and-pop removal, handles go through a slot
+		array that maps them to the dense index. Releasing a slot bumps its generation so stale handles fail IsValid.
+		Generations start at 1, so a zero handle is never valid. They wrap back to 1 after MaxGeneration releases of a slot,
+		which is logged since the handles of generation 1 pass IsValid again.
+	*/
+	template<typename Tag, typename T = Tag*>
+	class HandlePool
+	{
+	public:
+		using HandleType = Handle<Tag>;
+
+		HandleType Allocate(const T& value)
+		{
+			uint32_t slotIndex;
+			if (!m_FreeSlots.empty())
+			{
+				slotIndex = m_FreeSlots.back();
+				m_FreeSlots.pop_back();
+			}
+			else
+			{
+				if (m_Slots.size() > HandleType::IndexMask)
+				{
+					ARC_LOG_FATAL("HandlePool is out of slots!");
+					return {};
+				}
+				slotIndex = static_cast<uint32_t>(m_Slots.size());
+				m_Slots.push_back({ .Generation = 1, .DenseIndex = 0 });
+			}
+			Slot& slot = m_Slots[slotIndex];
+			slot.DenseIndex = static_cast<uint32_t>(m_Values.size());
+			m_Values.push_back(value);
+			m_DenseSlots.push_back(slotIndex);
+			return { (slot.Generation << HandleType::IndexBits) | slotIndex };
+		}
+
+		bool IsValid(HandleType handle) const
+		{
+			uint32_t slotIndex = handle.GetIndex();
+			return !handle.IsNull() && slotIndex < m_Slots.size() && m_Slots[slotIndex].Generation == handle.GetGeneration();
+		}
+
+		T* Get(HandleType handle)
+		{
+			return IsValid(handle) ? &m_Values[m_Slots[handle.GetIndex()].DenseIndex] : nullptr;
+		}
+
+		const T* Get(HandleType handle) const
+		{
+			return IsValid(handle) ? &m_Values[m_Slots[handle.GetIndex()].DenseIndex] : nullptr;
+		}
+
+		bool Release(HandleType handle)
+		{
+			if (!IsValid(handle))
+				return false;
+			uint32_t slotIndex = handle.GetIndex();
+			Slot& slot = m_Slots[slotIndex];
+			uint32_t last = static_cast<uint32_t>(m_Values.size() - 1);
+			if (slot.DenseIndex != last)
+			{
+				m_Values[slot.DenseIndex] = std::move(m_Values[last]);
+				m_DenseSlots[slot.DenseIndex] = m_DenseSlots[last];
+				m_Slots[m_DenseSlots[last]].DenseIndex = slot.DenseIndex;
+			}
+			m_Values.pop_back();
+			m_DenseSlots.pop_back();
+			if (slot.Generation == HandleType::MaxGeneration)
+			{
+				// A handle kept since generation 1 of the slot becomes valid again
+				ARC_LOG_WARNING("HandlePool slot {} wrapped its generation after {} releases, stale handles to it can pass IsValid!", slotIndex, HandleType::MaxGeneration);
+				slot.Generation = 1;
+			}
+			else
+			{
+				slot.Generation++;
+			}
+			m_FreeSlots.push_back(slotIndex);
+			return true;
+		}
+
+		/* Handle of the value at a dense index, used to release values while iterating from the back */
+		HandleType GetHandle(uint32_t denseIndex) const
+		{
+			uint32_t slotIndex = m_DenseSlots[denseIndex];
+			return { (m_Slots[slotIndex].Generation << HandleType::IndexBits) | slotIndex };
+		}
+
+		void Clear()
+		{
+			while (!m_Values.empty())
+				Release(GetHandle(static_cast<uint32_t>(m_Values.size() - 1)));
+		}
+
+		T* begin() { return m_Values.data(); }
+		T* end() { return m_Values.data() + m_Values.size(); }
+		const T* begin() const { return m_Values.data(); }
+		const T* end() const { return m_Values.data() + m_Values.size(); }
+		uint32_t GetSize() const { return static_cast<uint32_t>(m_Values.size()); }
+		bool IsEmpty() const { return m_Values.empty(); }
+		T& Back() { return m_Values.back(); }
+
+	private:
+		struct Slot
+		{
+			uint32_t Generation;
+			uint32_t DenseIndex;
+		};
+		std::vector<T> m_Values;
+		std::vector<uint32_t> m_DenseSlots;
+		std::vector<Slot> m_Slots;
+		std::vector<uint32_t> m_FreeSlots;
+	};
+}
\ No newline at end of file
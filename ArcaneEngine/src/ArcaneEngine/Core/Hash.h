@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace Arc
+{
+	/* 64 bit FNV-1a hash of a byte range, stable across runs so it can be stored in files */
+	inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		uint64_t hash = seed;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+		return hash;
+	}
+}
\ No newline at end of file
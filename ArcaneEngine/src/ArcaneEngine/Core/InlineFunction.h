@@ -0,0 +1,126 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Arc
+{
+	template<typename Signature, size_t Capacity = 64>
+	class InlineFunction;
+
+	/* Callable stored inside the object instead of on the heap like std::function, callables that do not fit fail to compile */
+	template<typename R, typename... Args, size_t Capacity>
+	class InlineFunction<R(Args...), Capacity>
+	{
+	public:
+		InlineFunction() = default;
+		InlineFunction(std::nullptr_t) {}
+
+		template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InlineFunction> && std::is_invocable_r_v<R, std::decay_t<F>&, Args...>>>
+		InlineFunction(F&& function)
+		{
+			using Functor = std::decay_t<F>;
+			static_assert(sizeof(Functor) <= Capacity, "Callable is too large to be stored inline, capture less or capture a pointer to the data");
+			static_assert(alignof(Functor) <= alignof(std::max_align_t), "Callable is over-aligned");
+			static_assert(std::is_copy_constructible_v<Functor>, "Callable has to be copyable");
+
+			new (m_Storage) Functor(std::forward<F>(function));
+			m_Invoke = [](void* storage, Args... args) -> R {
+				return (*static_cast<Functor*>(storage))(std::forward<Args>(args)...);
+			};
+			m_Manage = [](Operation operation, void* destination, void* source) {
+				switch (operation)
+				{
+				case Operation::Copy:
+					new (destination) Functor(*static_cast<const Functor*>(source));
+					break;
+				case Operation::Move:
+					new (destination) Functor(std::move(*static_cast<Functor*>(source)));
+					static_cast<Functor*>(source)->~Functor();
+					break;
+				case Operation::Destroy:
+					static_cast<Functor*>(destination)->~Functor();
+					break;
+				}
+			};
+		}
+
+		InlineFunction(const InlineFunction& other)
+		{
+			if (other.m_Manage)
+				other.m_Manage(Operation::Copy, m_Storage, (void*)other.m_Storage);
+			m_Invoke = other.m_Invoke;
+			m_Manage = other.m_Manage;
+		}
+
+		InlineFunction(InlineFunction&& other) noexcept
+		{
+			if (other.m_Manage)
+				other.m_Manage(Operation::Move, m_Storage, other.m_Storage);
+			m_Invoke = other.m_Invoke;
+			m_Manage = other.m_Manage;
+			other.m_Invoke = nullptr;
+			other.m_Manage = nullptr;
+		}
+
+		~InlineFunction()
+		{
+			Reset();
+		}
+
+		InlineFunction& operator=(const InlineFunction& other)
+		{
+			if (this != &other)
+			{
+				Reset();
+				new (this) InlineFunction(other);
+			}
+			return *this;
+		}
+
+		InlineFunction& operator=(InlineFunction&& other) noexcept
+		{
+			if (this != &other)
+			{
+				Reset();
+				new (this) InlineFunction(std::move(other));
+			}
+			return *this;
+		}
+
+		InlineFunction& operator=(std::nullptr_t)
+		{
+			Reset();
+			return *this;
+		}
+
+		R operator()(Args... args) const
+		{
+			return m_Invoke((void*)m_Storage, std::forward<Args>(args)...);
+		}
+
+		explicit operator bool() const { return m_Invoke != nullptr; }
+		bool operator==(std::nullptr_t) const { return m_Invoke == nullptr; }
+
+	private:
+		enum class Operation
+		{
+			Copy,
+			Move,
+			Destroy,
+		};
+
+		void Reset()
+		{
+			if (m_Manage)
+				m_Manage(Operation::Destroy, m_Storage, nullptr);
+			m_Invoke = nullptr;
+			m_Manage = nullptr;
+		}
+
+		alignas(std::max_align_t) std::byte m_Storage[Capacity];
+		R(*m_Invoke)(void*, Args...) = nullptr;
+		void(*m_Manage)(Operation, void*, void*) = nullptr;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "LinearAllocator.h"
+#include <algorithm>
+
+namespace Arc
+{
+	LinearAllocator::LinearAllocator(size_t blockSize)
+	{
+		m_BlockSize = blockSize;
+	}
+
+	void* LinearAllocator::Allocate(size_t size, size_t alignment)
+	{
+		if (!m_Blocks.empty())
+		{
+			Block& block = m_Blocks.back();
+			uintptr_t address = (uintptr_t)block.Memory.get() + m_CurrentOffset;
+			size_t padding = (alignment - address % alignment) % alignment;
+			if (m_CurrentOffset + padding + size <= block.Size)
+			{
+				m_CurrentOffset += padding + size;
+				m_UsedSize += padding + size;
+				return (void*)(address + padding);
+			}
+		}
+
+		// Blocks are allocated with new, which is aligned for every fundamental type
+		size_t blockSize = std::max(m_BlockSize, size + alignment);
+		m_Blocks.push_back({ std::make_unique<uint8_t[]>(blockSize), blockSize });
+		m_CurrentOffset = 0;
+		return Allocate(size, alignment);
+	}
+
+	void LinearAllocator::Reset()
+	{
+		if (m_Blocks.size() > 1)
+		{
+			m_BlockSize = std::max(m_BlockSize, GetCapacity());
+			m_Blocks.clear();
+			m_Blocks.push_back({ std::make_unique<uint8_t[]>(m_BlockSize), m_BlockSize });
+		}
+		m_CurrentOffset = 0;
+		m_UsedSize = 0;
+	}
+
+	size_t LinearAllocator::GetCapacity() const
+	{
+		size_t capacity = 0;
+		for (auto& block : m_Blocks)
+		{
+			capacity += block.Size;
+		}
+		return capacity;
+	}
+}
\ No newline at end of file
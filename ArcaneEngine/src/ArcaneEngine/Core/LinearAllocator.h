@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace Arc
+{
+	/* Bump allocator for data that lives until the next Reset, destructors are never called */
+	class LinearAllocator
+	{
+	public:
+		LinearAllocator(size_t blockSize = 64 * 1024);
+
+		void* Allocate(size_t size, size_t alignment);
+		/* Memory of previous allocations is reused, blocks that overflowed are merged into a single block large enough for all of them */
+		void Reset();
+
+		template<typename T>
+		T* Copy(const T* data, size_t count)
+		{
+			static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>, "Only trivial types can be stored in a linear allocator");
+			if (count == 0)
+				return nullptr;
+			T* copy = static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+			std::memcpy(copy, data, sizeof(T) * count);
+			return copy;
+		}
+
+		size_t GetUsedSize() const { return m_UsedSize; }
+		size_t GetCapacity() const;
+
+	private:
+		struct Block
+		{
+			std::unique_ptr<uint8_t[]> Memory;
+			size_t Size = 0;
+		};
+		std::vector<Block> m_Blocks;
+		size_t m_BlockSize;
+		size_t m_CurrentOffset = 0;
+		size_t m_UsedSize = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace Arc
+{
+	ThreadPool::ThreadPool(uint32_t threadCount)
+	{
+		if (threadCount == 0)
+			threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+		m_Threads.reserve(threadCount);
+		for (uint32_t i = 0; i < threadCount; i++)
+		{
+			m_Threads.emplace_back(&ThreadPool::WorkerLoop, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stop = true;
+		}
+		m_TaskAvailable.notify_all();
+		for (auto& thread : m_Threads)
+		{
+			thread.join();
+		}
+	}
+
+	void ThreadPool::Submit(Task&& task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Tasks.push_back(std::move(task));
+			m_ActiveTasks++;
+		}
+		m_TaskAvailable.notify_one();
+	}
+
+	void ThreadPool::Wait()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_TasksFinished.wait(lock, [this]() { return m_ActiveTasks == 0; });
+	}
+
+	void ThreadPool::WorkerLoop()
+	{
+		while (true)
+		{
+			Task task;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_TaskAvailable.wait(lock, [this]() { return m_Stop || m_NextTask < m_Tasks.size(); });
+				if (m_Stop && m_NextTask == m_Tasks.size())
+					return;
+
+				task = std::move(m_Tasks[m_NextTask++]);
+				if (m_NextTask == m_Tasks.size())
+				{
+					m_Tasks.clear();
+					m_NextTask = 0;
+				}
+			}
+
+			task();
+
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_ActiveTasks--;
+				if (m_ActiveTasks == 0)
+					m_TasksFinished.notify_all();
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+#include "InlineFunction.h"
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace Arc
+{
+	class ThreadPool
+	{
+	public:
+		/* Thread count of 0 uses one thread per hardware thread, minus the calling thread */
+		ThreadPool(uint32_t threadCount = 0);
+		~ThreadPool();
+
+		using Task = InlineFunction<void(), 64>;
+		void Submit(Task&& task);
+		/* Blocks until every submitted task has finished */
+		void Wait();
+
+		uint32_t GetThreadCount() { return (uint32_t)m_Threads.size(); }
+
+	private:
+		void WorkerLoop();
+
+		std::vector<std::thread> m_Threads;
+		// Cleared once every task was taken, so submitting does not allocate once the capacity was reached
+		std::vector<Task> m_Tasks;
+		size_t m_NextTask = 0;
+		std::mutex m_Mutex;
+		std::condition_variable m_TaskAvailable;
+		std::condition_variable m_TasksFinished;
+		uint32_t m_ActiveTasks = 0;
+		bool m_Stop = false;
+	};
+}
\ No newline at end of file
@@ -1,17 +1,26 @@
 #include "CommandBuffer.h"
 #include "VulkanCore/VulkanHandleCreation.h"
 #include "VulkanCore/VulkanLocal.h"
+#include "ArcaneEngine/Core/Log.h"
 #include <vulkan/vulkan_core.h>
+#include <algorithm>
 
 namespace Arc
 {
 	extern PFN_vkCmdTraceRaysKHR vkCmdTraceRaysKHR;
 
-	CommandBuffer::CommandBuffer(DeviceHandle logicalDevice, CommandPoolHandle commandPool)
+	namespace
+	{
+		// Barriers converted per vkCmdPipelineBarrier2 call, sized so the conversion fits on the stack
+		constexpr size_t MaxBarrierBatch = 32;
+	}
+
+	CommandBuffer::CommandBuffer(DeviceHandle logicalDevice, CommandPoolHandle commandPool, bool secondary)
 	{
 		CommandBufferCreateInfo commandBufferCreateInfo = {
 			.logicalDevice = logicalDevice,
-			.commandPool = commandPool
+			.commandPool = commandPool,
+			.secondary = secondary
 		};
 
 		m_CommandBuffer = CreateCommandBufferHandle(commandBufferCreateInfo);
@@ -35,11 +44,29 @@ namespace Arc
 		VK_CHECK(vkBeginCommandBuffer((VkCommandBuffer)m_CommandBuffer, &beginInfo));
 	}
 
+	void CommandBuffer::BeginSecondary()
+	{
+		VkCommandBufferInheritanceInfo inheritanceInfo = {};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+		VK_CHECK(vkBeginCommandBuffer((VkCommandBuffer)m_CommandBuffer, &beginInfo));
+	}
+
 	void CommandBuffer::End()
 	{
 		VK_CHECK(vkEndCommandBuffer((VkCommandBuffer)m_CommandBuffer));
 	}
 
+	void CommandBuffer::ExecuteCommands(const std::vector<CommandBufferHandle>& commandBuffers)
+	{
+		vkCmdExecuteCommands((VkCommandBuffer)m_CommandBuffer, (uint32_t)commandBuffers.size(), (VkCommandBuffer*)commandBuffers.data());
+	}
+
 	void CommandBuffer::SetViewport(const uint32_t area[2])
 	{
 		VkViewport viewport = {};
@@ -60,10 +87,14 @@ namespace Arc
 		vkCmdSetScissor((VkCommandBuffer)m_CommandBuffer, 0, 1, &scissor);
 	}
 
-	void CommandBuffer::BeginRendering(const std::vector<ColorAttachment>& colorAttachments, std::optional<DepthAttachment> depthAttachment, const uint32_t renderArea[2])
+	void CommandBuffer::BeginRendering(ArrayView<ColorAttachment> colorAttachments, std::optional<DepthAttachment> depthAttachment, const uint32_t renderArea[2])
 	{
-		std::vector<VkRenderingAttachmentInfo> colorInfo(colorAttachments.size());
-		for (size_t i = 0; i < colorInfo.size(); i++)
+		if (colorAttachments.size() > MaxColorAttachments)
+			ARC_LOG_FATAL("Rendering supports at most {} color attachments!", MaxColorAttachments);
+
+		VkRenderingAttachmentInfo colorInfo[MaxColorAttachments];
+		uint32_t colorCount = (uint32_t)std::min<size_t>(colorAttachments.size(), MaxColorAttachments);
+		for (size_t i = 0; i < colorCount; i++)
 		{
 			auto& info = colorInfo[i];
 			auto& colorAttachment = colorAttachments[i];
@@ -80,8 +111,8 @@ namespace Arc
 		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
 		renderingInfo.renderArea = VkRect2D{ {0, 0}, { renderArea[0], renderArea[1] } };
 		renderingInfo.layerCount = 1;
-		renderingInfo.colorAttachmentCount = (uint32_t)colorInfo.size();
-		renderingInfo.pColorAttachments = colorInfo.data();
+		renderingInfo.colorAttachmentCount = colorCount;
+		renderingInfo.pColorAttachments = colorInfo;
 		if (depthAttachment.has_value())
 		{
 			auto& da = depthAttachment.value();
@@ -103,90 +134,85 @@ namespace Arc
 		vkCmdEndRendering((VkCommandBuffer)m_CommandBuffer);
 	}
 
-	void CommandBuffer::BindDescriptorSets(PipelineBindPoint bindPoint, PipelineLayoutHandle layout, uint32_t firstSet, const std::vector<DescriptorSetHandle>& descriptorSets)
+	void CommandBuffer::BindDescriptorSets(PipelineBindPoint bindPoint, PipelineLayoutHandle layout, uint32_t firstSet, ArrayView<DescriptorSetHandle> descriptorSets)
 	{
-		std::vector<VkDescriptorSet> sets(descriptorSets.size());
-		for (size_t i = 0; i < descriptorSets.size(); i++)
-		{
-			sets[i] = (VkDescriptorSet)descriptorSets[i];
-		}
-
-		vkCmdBindDescriptorSets((VkCommandBuffer)m_CommandBuffer, static_cast<VkPipelineBindPoint>(bindPoint), (VkPipelineLayout)layout, firstSet, (uint32_t)sets.size(), sets.data(), 0, nullptr);
+		// Handles are opaque pointers with the same layout as the Vulkan handles
+		vkCmdBindDescriptorSets((VkCommandBuffer)m_CommandBuffer, static_cast<VkPipelineBindPoint>(bindPoint), (VkPipelineLayout)layout, firstSet, (uint32_t)descriptorSets.size(), (const VkDescriptorSet*)descriptorSets.data(), 0, nullptr);
 	}
 
 	void CommandBuffer::PushDescriptorSets(PipelineBindPoint bindPoint, PipelineLayoutHandle layout, uint32_t set, const PushDescriptorWrite& descriptorWrite)
 	{
-		std::vector<VkWriteDescriptorSet> writes;
-		writes.reserve(descriptorWrite.m_BufferWrites.size() + descriptorWrite.m_ImageWrites.size());
+		constexpr uint32_t MaxWrites = PushDescriptorWrite::MaxWrites;
+		VkWriteDescriptorSet writes[MaxWrites * 3];
+		uint32_t writeCount = 0;
 
-		std::vector<VkDescriptorBufferInfo> bufferInfos;
-		bufferInfos.reserve(descriptorWrite.m_BufferWrites.size());
-
-		for (auto& bw : descriptorWrite.m_BufferWrites)
+		VkDescriptorBufferInfo bufferInfos[MaxWrites];
+		for (uint32_t i = 0; i < descriptorWrite.m_BufferWriteCount; i++)
 		{
-			VkDescriptorBufferInfo bufferInfo = {};
+			auto& bw = descriptorWrite.m_BufferWrites[i];
+			VkDescriptorBufferInfo& bufferInfo = bufferInfos[i];
+			bufferInfo = {};
 			bufferInfo.buffer = (VkBuffer)bw.Buffer;
-			bufferInfo.offset = 0;
+			bufferInfo.offset = bw.Offset;
 			bufferInfo.range = bw.Size;
-			bufferInfos.push_back(bufferInfo);
 
-			VkWriteDescriptorSet writeInfo = {};
+			VkWriteDescriptorSet& writeInfo = writes[writeCount++];
+			writeInfo = {};
 			writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 			writeInfo.dstSet = nullptr;
 			writeInfo.dstBinding = bw.Binding;
 			writeInfo.dstArrayElement = 0;
 			writeInfo.descriptorType = (VkDescriptorType)bw.Type;
 			writeInfo.descriptorCount = 1;
-			writeInfo.pBufferInfo = &bufferInfos[bufferInfos.size() - 1];
-			writes.push_back(writeInfo);
+			writeInfo.pBufferInfo = &bufferInfo;
 		}
 
-		std::vector<VkDescriptorImageInfo> imageInfos;
-		imageInfos.reserve(descriptorWrite.m_ImageWrites.size());
-
-		for (auto& iw : descriptorWrite.m_ImageWrites)
+		VkDescriptorImageInfo imageInfos[MaxWrites];
+		for (uint32_t i = 0; i < descriptorWrite.m_ImageWriteCount; i++)
 		{
-			VkDescriptorImageInfo imageInfo = {};
+			auto& iw = descriptorWrite.m_ImageWrites[i];
+			VkDescriptorImageInfo& imageInfo = imageInfos[i];
+			imageInfo = {};
 			imageInfo.imageView = (VkImageView)iw.ImageView;
 			imageInfo.imageLayout = (VkImageLayout)iw.ImageLayout;
 			imageInfo.sampler = (VkSampler)iw.Sampler;
-			imageInfos.push_back(imageInfo);
 
-			VkWriteDescriptorSet writeInfo = {};
+			VkWriteDescriptorSet& writeInfo = writes[writeCount++];
+			writeInfo = {};
 			writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 			writeInfo.dstSet = nullptr;
 			writeInfo.dstBinding = iw.Binding;
 			writeInfo.dstArrayElement = 0;
 			writeInfo.descriptorType = (VkDescriptorType)iw.Type;
 			writeInfo.descriptorCount = 1;
-			writeInfo.pImageInfo = &imageInfos[imageInfos.size() - 1];
-			writes.push_back(writeInfo);
+			writeInfo.pImageInfo = &imageInfo;
 		}
 
-		std::vector<VkWriteDescriptorSetAccelerationStructureKHR> accelerationInfos;
-		accelerationInfos.reserve(descriptorWrite.m_AccelerationStructureWrites.size());
-
-		for (auto& sw : descriptorWrite.m_AccelerationStructureWrites)
+		// Structures have to outlive the loop, they are only read by vkCmdPushDescriptorSet
+		VkAccelerationStructureKHR structures[MaxWrites];
+		VkWriteDescriptorSetAccelerationStructureKHR accelerationInfos[MaxWrites];
+		for (uint32_t i = 0; i < descriptorWrite.m_AccelerationStructureWriteCount; i++)
 		{
-			VkAccelerationStructureKHR structure = (VkAccelerationStructureKHR)sw.AccelerationStructure;
-			VkWriteDescriptorSetAccelerationStructureKHR descriptorAccelerationStructureInfo{};
+			auto& sw = descriptorWrite.m_AccelerationStructureWrites[i];
+			structures[i] = (VkAccelerationStructureKHR)sw.AccelerationStructure;
+			VkWriteDescriptorSetAccelerationStructureKHR& descriptorAccelerationStructureInfo = accelerationInfos[i];
+			descriptorAccelerationStructureInfo = {};
 			descriptorAccelerationStructureInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR;
 			descriptorAccelerationStructureInfo.accelerationStructureCount = 1;
-			descriptorAccelerationStructureInfo.pAccelerationStructures = &structure;
-			accelerationInfos.push_back(descriptorAccelerationStructureInfo);
+			descriptorAccelerationStructureInfo.pAccelerationStructures = &structures[i];
 
-			VkWriteDescriptorSet writeInfo = {};
+			VkWriteDescriptorSet& writeInfo = writes[writeCount++];
+			writeInfo = {};
 			writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			writeInfo.pNext = &accelerationInfos[accelerationInfos.size() - 1];
+			writeInfo.pNext = &descriptorAccelerationStructureInfo;
 			writeInfo.dstSet = nullptr;
 			writeInfo.dstBinding = sw.Binding;
 			writeInfo.dstArrayElement = 0;
 			writeInfo.descriptorType = (VkDescriptorType)sw.Type;
 			writeInfo.descriptorCount = 1;
-			writes.push_back(writeInfo);
 		}
 
-		vkCmdPushDescriptorSet((VkCommandBuffer)m_CommandBuffer, static_cast<VkPipelineBindPoint>(bindPoint), (VkPipelineLayout)layout, set, (uint32_t)writes.size(), writes.data());
+		vkCmdPushDescriptorSet((VkCommandBuffer)m_CommandBuffer, static_cast<VkPipelineBindPoint>(bindPoint), (VkPipelineLayout)layout, set, writeCount, writes);
 	}
 
 	void CommandBuffer::BindPipeline(PipelineHandle pipeline)
@@ -222,6 +248,7 @@ namespace Arc
 	void CommandBuffer::Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
 	{
 		vkCmdDispatch((VkCommandBuffer)m_CommandBuffer, groupCountX, groupCountY, groupCountZ);
+		m_DispatchCount++;
 	}
 
 	void CommandBuffer::TraceRays(RayTracingPipeline* pipeline, uint32_t width, uint32_t height, uint32_t depth)
@@ -249,6 +276,7 @@ namespace Arc
 			&rayClosestHitSBT,
 			&rayCallableSBT,
 			width, height, depth);
+		m_DispatchCount++;
 	}
 
 	void CommandBuffer::TransitionImage(ImageHandle image, ImageLayout currentLayout, ImageLayout newLayout)
@@ -337,35 +365,94 @@ namespace Arc
 		vkCmdBlitImage2((VkCommandBuffer)m_CommandBuffer, &blitInfo);
 	}
 
-	void CommandBuffer::MemoryBarrier(std::vector<ImageBarrier> imageBarriers)
+	void CommandBuffer::MemoryBarrier(ArrayView<ImageBarrier> imageBarriers)
 	{
-		std::vector<VkImageMemoryBarrier2> barriers;
-		barriers.reserve(imageBarriers.size());
-		for (auto& barrier : imageBarriers)
+		VkImageMemoryBarrier2 barriers[MaxBarrierBatch];
+		for (size_t first = 0; first < imageBarriers.size(); first += MaxBarrierBatch)
 		{
-			VkImageMemoryBarrier2 imageBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
-			imageBarrier.image = (VkImage)barrier.Handle;
-			//imageBarrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
-			//imageBarrier.dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT;
-			imageBarrier.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
-			imageBarrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
-			//imageBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
-			//imageBarrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
-			imageBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT;
-			imageBarrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT;
-			imageBarrier.oldLayout = (VkImageLayout)barrier.OldLayout;
-			imageBarrier.newLayout = (VkImageLayout)barrier.NewLayout;
-
-			VkImageAspectFlags aspectMask = (barrier.NewLayout == ImageLayout::DepthAttachmentOptimal) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
-			VkImageSubresourceRange subRange{ aspectMask, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
-			imageBarrier.subresourceRange = subRange;
-			barriers.push_back(imageBarrier);
+			uint32_t count = (uint32_t)std::min<size_t>(imageBarriers.size() - first, MaxBarrierBatch);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				auto& barrier = imageBarriers[first + i];
+				VkImageMemoryBarrier2& imageBarrier = barriers[i];
+				imageBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+				imageBarrier.image = (VkImage)barrier.Handle;
+				//imageBarrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+				//imageBarrier.dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT;
+				imageBarrier.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+				imageBarrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
+				//imageBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+				//imageBarrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+				imageBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT;
+				imageBarrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT;
+				imageBarrier.oldLayout = (VkImageLayout)barrier.OldLayout;
+				imageBarrier.newLayout = (VkImageLayout)barrier.NewLayout;
+
+				VkImageAspectFlags aspectMask = (barrier.NewLayout == ImageLayout::DepthAttachmentOptimal) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+				VkImageSubresourceRange subRange{ aspectMask, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+				imageBarrier.subresourceRange = subRange;
+			}
+
+			VkDependencyInfo depInfo{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+			depInfo.imageMemoryBarrierCount = count;
+			depInfo.pImageMemoryBarriers = barriers;
+
+			vkCmdPipelineBarrier2((VkCommandBuffer)m_CommandBuffer, &depInfo);
 		}
+	}
 
-		VkDependencyInfo depInfo{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
-		depInfo.imageMemoryBarrierCount = barriers.size();
-		depInfo.pImageMemoryBarriers = barriers.data();
-
-		vkCmdPipelineBarrier2((VkCommandBuffer)m_CommandBuffer, &depInfo);
+	void CommandBuffer::PipelineBarrier(ArrayView<ImageSyncBarrier> imageBarriers, ArrayView<BufferSyncBarrier> bufferBarriers)
+	{
+		VkImageMemoryBarrier2 vkImageBarriers[MaxBarrierBatch];
+		VkBufferMemoryBarrier2 vkBufferBarriers[MaxBarrierBatch];
+		size_t imageOffset = 0;
+		size_t bufferOffset = 0;
+		while (imageOffset < imageBarriers.size() || bufferOffset < bufferBarriers.size())
+		{
+			uint32_t imageCount = (uint32_t)std::min<size_t>(imageBarriers.size() - imageOffset, MaxBarrierBatch);
+			for (uint32_t i = 0; i < imageCount; i++)
+			{
+				auto& barrier = imageBarriers[imageOffset + i];
+				VkImageMemoryBarrier2& imageBarrier = vkImageBarriers[i];
+				imageBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2 };
+				imageBarrier.srcStageMask = barrier.SrcStageMask;
+				imageBarrier.srcAccessMask = barrier.SrcAccessMask;
+				imageBarrier.dstStageMask = barrier.DstStageMask;
+				imageBarrier.dstAccessMask = barrier.DstAccessMask;
+				imageBarrier.oldLayout = (VkImageLayout)barrier.OldLayout;
+				imageBarrier.newLayout = (VkImageLayout)barrier.NewLayout;
+				imageBarrier.srcQueueFamilyIndex = barrier.SrcQueueFamily;
+				imageBarrier.dstQueueFamilyIndex = barrier.DstQueueFamily;
+				imageBarrier.image = (VkImage)barrier.Handle;
+				imageBarrier.subresourceRange = { (VkImageAspectFlags)barrier.Aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+			}
+
+			uint32_t bufferCount = (uint32_t)std::min<size_t>(bufferBarriers.size() - bufferOffset, MaxBarrierBatch);
+			for (uint32_t i = 0; i < bufferCount; i++)
+			{
+				auto& barrier = bufferBarriers[bufferOffset + i];
+				VkBufferMemoryBarrier2& bufferBarrier = vkBufferBarriers[i];
+				bufferBarrier = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2 };
+				bufferBarrier.srcStageMask = barrier.SrcStageMask;
+				bufferBarrier.srcAccessMask = barrier.SrcAccessMask;
+				bufferBarrier.dstStageMask = barrier.DstStageMask;
+				bufferBarrier.dstAccessMask = barrier.DstAccessMask;
+				bufferBarrier.srcQueueFamilyIndex = barrier.SrcQueueFamily;
+				bufferBarrier.dstQueueFamilyIndex = barrier.DstQueueFamily;
+				bufferBarrier.buffer = (VkBuffer)barrier.Handle;
+				bufferBarrier.offset = 0;
+				bufferBarrier.size = VK_WHOLE_SIZE;
+			}
+
+			VkDependencyInfo depInfo{ VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+			depInfo.imageMemoryBarrierCount = imageCount;
+			depInfo.pImageMemoryBarriers = vkImageBarriers;
+			depInfo.bufferMemoryBarrierCount = bufferCount;
+			depInfo.pBufferMemoryBarriers = vkBufferBarriers;
+
+			vkCmdPipelineBarrier2((VkCommandBuffer)m_CommandBuffer, &depInfo);
+			imageOffset += imageCount;
+			bufferOffset += bufferCount;
+		}
 	}
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include "VulkanObjects/PushDescriptorWrite.h"
 #include "VulkanObjects/RayTracingPipeline.h"
 #include "Common.h"
+#include "ArcaneEngine/Core/ArrayView.h"
 #include <vector>
 #include <optional>
 
@@ -14,23 +15,27 @@ namespace Arc
 	class CommandBuffer
 	{
 	public:
-		CommandBuffer(DeviceHandle logicalDevice, CommandPoolHandle commandPool);
+		CommandBuffer(DeviceHandle logicalDevice, CommandPoolHandle commandPool, bool secondary = false);
 		CommandBuffer(CommandBufferHandle commandBuffer);
 		~CommandBuffer();
 
 		void Begin();
+		// Secondary command buffers are recorded outside of a render pass instance and run with ExecuteCommands
+		void BeginSecondary();
 		void End();
+		void ExecuteCommands(const std::vector<CommandBufferHandle>& commandBuffers);
 
 		void SetViewport(const uint32_t area[2]);
 		void SetScissors(const uint32_t area[2]);
 
-		void BeginRendering(const std::vector<ColorAttachment>& colorAttachments, std::optional<DepthAttachment> depthAttachment, const uint32_t renderArea[2]);
+		static constexpr uint32_t MaxColorAttachments = 8;
+		void BeginRendering(ArrayView<ColorAttachment> colorAttachments, std::optional<DepthAttachment> depthAttachment, const uint32_t renderArea[2]);
 		//void BeginRendering(const std::vector<ColorAttachment>& colorAttachments, const DepthAttachment& depthAttachment, const uint32_t renderArea[2]);
 		//void BeginRendering(const std::vector<ColorAttachment>& colorAttachments, const uint32_t renderArea[2]);
 		//void BeginRendering(const DepthAttachment& depthAttachment, const uint32_t renderArea[2]);
 		void EndRendering();
 
-		void BindDescriptorSets(PipelineBindPoint bindPoint, PipelineLayoutHandle layout, uint32_t firstSet, const std::vector<DescriptorSetHandle>& descriptorSets);
+		void BindDescriptorSets(PipelineBindPoint bindPoint, PipelineLayoutHandle layout, uint32_t firstSet, ArrayView<DescriptorSetHandle> descriptorSets);
 		void PushDescriptorSets(PipelineBindPoint bindPoint, PipelineLayoutHandle layout, uint32_t set, const PushDescriptorWrite& descriptorWrite);
 		void PushConstants(ShaderStage shaderStage, PipelineLayoutHandle layout, const void* data, uint32_t size);
 
@@ -52,12 +57,42 @@ namespace Arc
 			ImageLayout OldLayout;
 			ImageLayout NewLayout;
 		};
-		void MemoryBarrier(std::vector<ImageBarrier> imageBarriers);
+		void MemoryBarrier(ArrayView<ImageBarrier> imageBarriers);
+
+		struct ImageSyncBarrier
+		{
+			ImageHandle Handle;
+			ImageAspect Aspect;
+			ImageLayout OldLayout;
+			ImageLayout NewLayout;
+			uint64_t SrcStageMask;
+			uint64_t SrcAccessMask;
+			uint64_t DstStageMask;
+			uint64_t DstAccessMask;
+			// Set both to transfer queue family ownership, uint32_t(-1) is ignored
+			uint32_t SrcQueueFamily = uint32_t(-1);
+			uint32_t DstQueueFamily = uint32_t(-1);
+		};
+		struct BufferSyncBarrier
+		{
+			BufferHandle Handle;
+			uint64_t SrcStageMask;
+			uint64_t SrcAccessMask;
+			uint64_t DstStageMask;
+			uint64_t DstAccessMask;
+			uint32_t SrcQueueFamily = uint32_t(-1);
+			uint32_t DstQueueFamily = uint32_t(-1);
+		};
+		// Barriers are converted in batches on the stack, larger lists are split into several barrier commands
+		void PipelineBarrier(ArrayView<ImageSyncBarrier> imageBarriers, ArrayView<BufferSyncBarrier> bufferBarriers);
 
 		CommandBufferHandle GetHandle() { return m_CommandBuffer; }
+		// Dispatches and ray traces recorded since the command buffer was created
+		uint32_t GetDispatchCount() const { return m_DispatchCount; }
 
 	private:
 		CommandBufferHandle m_CommandBuffer;
+		uint32_t m_DispatchCount = 0;
 	};
 
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 
 namespace Arc
 {
@@ -216,6 +217,18 @@ namespace Arc
         Bindless = 1,
     };
 
+    // Shaders declare the global bindless heap as set BindlessSetIndex, with one unsized array per BindlessBinding
+    constexpr uint32_t BindlessSetIndex = 3;
+    constexpr uint32_t InvalidBindlessIndex = ~0u;
+    enum class BindlessBinding
+    {
+        SampledImage = 0,
+        StorageImage = 1,
+        Sampler = 2,
+        StorageBuffer = 3,
+        Count
+    };
+
     enum class PrimitiveTopology
     {
         PointList = 0,
@@ -2,7 +2,11 @@
 #include "VulkanCore/VulkanHandleCreation.h"
 #include "VulkanCore/VulkanLocal.h"
 #include "ArcaneEngine/Core/Log.h"
+#include "ArcaneEngine/Core/Hash.h"
 #include <vulkan/vulkan_core.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <vector>
 
 namespace Arc
@@ -15,20 +19,29 @@ namespace Arc
         SelectPhysicalDevice();
         CreateSurface(windowHandle, framesInFlight);
         CreateLogicalDevice();
+        CreatePipelineCache();
 
         m_ResourceCache = std::make_unique<ResourceCache>(this);
-        m_RenderGraph = std::make_unique<RenderGraph>();
+        m_ResourceCache->LoadShaderCache(ShaderCachePath);
+        m_UniformAllocator = std::make_unique<UniformAllocator>(this, 4 * 1024 * 1024);
+        m_GeometryAllocator = std::make_unique<GeometryAllocator>(this, 64 * 1024 * 1024);
+        m_RenderGraph = std::make_unique<RenderGraph>(this);
         m_TimestampQuery = std::make_unique<TimestampQuery>(m_LogicalDevice, m_PhysicalDevice);
     }
 
 	Device::~Device()
 	{
+        SavePipelineCache();
+        m_ResourceCache->SaveShaderCache(ShaderCachePath);
         m_TimestampQuery.reset();
         m_RenderGraph.reset();
+        m_GeometryAllocator.reset();
+        m_UniformAllocator.reset();
         m_ResourceCache.reset();
 
         VK_CHECK(vkDeviceWaitIdle((VkDevice)m_LogicalDevice));
         vkDestroyCommandPool((VkDevice)m_LogicalDevice, (VkCommandPool)m_CommandPool, nullptr);
+        vkDestroyPipelineCache((VkDevice)m_LogicalDevice, (VkPipelineCache)m_PipelineCache, nullptr);
         vkDestroyDevice((VkDevice)m_LogicalDevice, nullptr);
         vkDestroySurfaceKHR((VkInstance)m_Instance, (VkSurfaceKHR)m_Surface, nullptr);
 #ifdef ARCANE_ENABLE_VALIDATION
@@ -142,6 +155,7 @@ namespace Arc
         }
 
         vkUpdateDescriptorSets((VkDevice)m_LogicalDevice, static_cast<uint32_t>(writeDescriptorSet.size()), writeDescriptorSet.data(), 0, NULL);
+        m_ResourceCache->TrackDescriptorWrites(descriptor, write);
     }
 
     void Device::UpdateDescriptorSet(DescriptorSetArray* descriptorArray, const DescriptorWrite& write)
@@ -220,6 +234,7 @@ namespace Arc
         }
 
         vkUpdateDescriptorSets((VkDevice)m_LogicalDevice, static_cast<uint32_t>(writeDescriptorSet.size()), writeDescriptorSet.data(), 0, NULL);
+        m_ResourceCache->TrackDescriptorWrites(descriptorArray, write);
     }
 
     void Device::TransitionImageLayout(GpuImage* image, ImageLayout newLayout)
@@ -269,6 +284,7 @@ namespace Arc
                 0, nullptr,
                 1, &barrier);
         });
+        m_RenderGraph->ImportImage(image->GetHandle(), newLayout);
     }
 
     std::vector<uint8_t> Device::GetImageData(GpuImage* image, ImageLayout currentLayout)
@@ -491,13 +507,14 @@ namespace Arc
         return address;
     }
 
-    void Device::SetDeviceLocalBufferData(GpuBuffer* buffer, const void* data, uint32_t size)
+    void Device::SetDeviceLocalBufferData(GpuBuffer* buffer, const void* data, uint32_t size, uint64_t offset)
     {
         GpuBuffer stagingBuffer;
         m_ResourceCache->CreateGpuBuffer(&stagingBuffer, GpuBufferDesc{
             .Size = size,
             .UsageFlags = Arc::BufferUsage::TransferSrc,
             .MemoryProperty = Arc::MemoryProperty::HostVisible,
+            .DebugName = "Staging buffer",
         });
 
         void* dataPtr = m_ResourceCache->MapMemory(&stagingBuffer);
@@ -507,7 +524,7 @@ namespace Arc
         ImmediateSubmit([&](BufferHandle cmd) {
             VkBufferCopy copyRegion{};
             copyRegion.srcOffset = 0;
-            copyRegion.dstOffset = 0;
+            copyRegion.dstOffset = offset;
             copyRegion.size = size;
 
             vkCmdCopyBuffer(
@@ -529,6 +546,7 @@ namespace Arc
             .Size = size,
             .UsageFlags = Arc::BufferUsage::TransferSrc,
             .MemoryProperty = Arc::MemoryProperty::HostVisible,
+            .DebugName = "Staging buffer",
         });
 
         void* dataPtr = m_ResourceCache->MapMemory(&stagingBuffer);
@@ -577,6 +595,7 @@ namespace Arc
             use_barrier.subresourceRange.layerCount = 1;
             vkCmdPipelineBarrier((VkCommandBuffer)cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &use_barrier);
         });
+        m_RenderGraph->ImportImage(image->GetHandle(), image->GetMipLevels() > 1 ? ImageLayout::TransferDstOptimal : newLayout);
 
         m_ResourceCache->ReleaseResource(&stagingBuffer);
     }
@@ -651,16 +670,23 @@ namespace Arc
         };
 
         m_LogicalDevice = CreateLogicalDeviceHandle(deviceCreateInfo);
+        m_MemoryBudgetSupported = IsDeviceExtensionSupported(m_PhysicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
 
         /* Queues */
         VkQueue graphicsQueue;
         VkQueue presentQueue;
+        VkQueue computeQueue;
+        VkQueue transferQueue;
 
         vkGetDeviceQueue((VkDevice)m_LogicalDevice, m_QueueFamiliyIndices.GraphicsIndex, 0, &graphicsQueue);
         vkGetDeviceQueue((VkDevice)m_LogicalDevice, m_QueueFamiliyIndices.PresentIndex, 0, &presentQueue);
+        vkGetDeviceQueue((VkDevice)m_LogicalDevice, m_QueueFamiliyIndices.ComputeIndex, 0, &computeQueue);
+        vkGetDeviceQueue((VkDevice)m_LogicalDevice, m_QueueFamiliyIndices.TransferIndex, 0, &transferQueue);
 
         m_GraphicsQueue = graphicsQueue;
         m_PresentQueue = presentQueue;
+        m_ComputeQueue = computeQueue;
+        m_TransferQueue = transferQueue;
 
         /* Command pools */
         VkCommandPoolCreateInfo poolInfo{};
@@ -672,4 +698,132 @@ namespace Arc
         VK_CHECK(vkCreateCommandPool((VkDevice)m_LogicalDevice, &poolInfo, nullptr, &commandPool));
         m_CommandPool = commandPool;
     }
+
+    // Prepended to the Vulkan cache data, the Vulkan header has no driver UUID and nothing that detects a truncated file
+    struct PipelineCacheFileHeader
+    {
+        uint32_t Magic;
+        uint32_t VendorID;
+        uint32_t DeviceID;
+        uint32_t DriverVersion;
+        uint8_t DriverUUID[VK_UUID_SIZE];
+        uint8_t PipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t DataSize;
+        uint64_t DataHash;
+    };
+    static constexpr uint32_t PipelineCacheMagic = 0x41435043; // "CPCA"
+
+    static PipelineCacheFileHeader GetPipelineCacheFileHeader(PhysicalDeviceHandle physicalDevice)
+    {
+        VkPhysicalDeviceIDProperties idProperties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES };
+        VkPhysicalDeviceProperties2 properties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
+        properties.pNext = &idProperties;
+        vkGetPhysicalDeviceProperties2((VkPhysicalDevice)physicalDevice, &properties);
+
+        PipelineCacheFileHeader header = {};
+        header.Magic = PipelineCacheMagic;
+        header.VendorID = properties.properties.vendorID;
+        header.DeviceID = properties.properties.deviceID;
+        header.DriverVersion = properties.properties.driverVersion;
+        memcpy(header.DriverUUID, idProperties.driverUUID, VK_UUID_SIZE);
+        memcpy(header.PipelineCacheUUID, properties.properties.pipelineCacheUUID, VK_UUID_SIZE);
+        return header;
+    }
+
+    void Device::CreatePipelineCache()
+    {
+        PipelineCacheFileHeader expected = GetPipelineCacheFileHeader(m_PhysicalDevice);
+        std::vector<uint8_t> data;
+
+        std::ifstream file(PipelineCachePath, std::ios::in | std::ios::binary);
+        PipelineCacheFileHeader header = {};
+        if (file && file.read((char*)&header, sizeof(header)))
+        {
+            bool sameDevice = header.Magic == expected.Magic &&
+                header.VendorID == expected.VendorID &&
+                header.DeviceID == expected.DeviceID &&
+                header.DriverVersion == expected.DriverVersion &&
+                memcmp(header.DriverUUID, expected.DriverUUID, VK_UUID_SIZE) == 0 &&
+                memcmp(header.PipelineCacheUUID, expected.PipelineCacheUUID, VK_UUID_SIZE) == 0;
+
+            // A corrupted size must not turn into a huge allocation
+            std::error_code error;
+            uint64_t fileSize = std::filesystem::file_size(PipelineCachePath, error);
+            if (sameDevice && (error || header.DataSize > fileSize - sizeof(header)))
+            {
+                ARC_LOG_WARNING("Pipeline cache {} is corrupted, pipelines are compiled from scratch!", PipelineCachePath);
+            }
+            else if (sameDevice)
+            {
+                data.resize(header.DataSize);
+                if (!file.read((char*)data.data(), data.size()) || HashBytes(data.data(), data.size()) != header.DataHash)
+                {
+                    ARC_LOG_WARNING("Pipeline cache {} is corrupted, pipelines are compiled from scratch!", PipelineCachePath);
+                    data.clear();
+                }
+            }
+            else
+            {
+                ARC_LOG("Pipeline cache {} was written by another device or driver, pipelines are compiled from scratch", PipelineCachePath);
+            }
+        }
+
+        VkPipelineCacheCreateInfo createInfo = { VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+        createInfo.initialDataSize = data.size();
+        createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+        VkPipelineCache pipelineCache;
+        VkResult result = vkCreatePipelineCache((VkDevice)m_LogicalDevice, &createInfo, nullptr, &pipelineCache);
+        if (result != VK_SUCCESS && !data.empty())
+        {
+            ARC_LOG_WARNING("Pipeline cache {} was rejected by the driver, pipelines are compiled from scratch!", PipelineCachePath);
+            createInfo.initialDataSize = 0;
+            createInfo.pInitialData = nullptr;
+            data.clear();
+            result = vkCreatePipelineCache((VkDevice)m_LogicalDevice, &createInfo, nullptr, &pipelineCache);
+        }
+        VK_CHECK(result);
+
+        m_PipelineCache = pipelineCache;
+        m_PipelineCacheLoaded = !data.empty();
+        if (m_PipelineCacheLoaded)
+            ARC_LOG("Loaded pipeline cache {} ({} bytes)", PipelineCachePath, data.size());
+    }
+
+    void Device::SavePipelineCache()
+    {
+        PipelineCreationStats stats = m_ResourceCache->GetPipelineCreationStats();
+        ARC_LOG("{} start: created {} pipelines in {:.2f} ms", m_PipelineCacheLoaded ? "Warm" : "Cold", stats.PipelineCount, stats.TotalTime);
+
+        size_t size = 0;
+        VK_CHECK(vkGetPipelineCacheData((VkDevice)m_LogicalDevice, (VkPipelineCache)m_PipelineCache, &size, nullptr));
+        std::vector<uint8_t> data(size);
+        VK_CHECK(vkGetPipelineCacheData((VkDevice)m_LogicalDevice, (VkPipelineCache)m_PipelineCache, &size, data.data()));
+        data.resize(size);
+
+        PipelineCacheFileHeader header = GetPipelineCacheFileHeader(m_PhysicalDevice);
+        header.DataSize = data.size();
+        header.DataHash = HashBytes(data.data(), data.size());
+
+        std::filesystem::path path = PipelineCachePath;
+        std::filesystem::path tempPath = path;
+        tempPath += ".tmp";
+        std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)data.data(), data.size());
+        file.close();
+        if (!file)
+        {
+            ARC_LOG_ERROR("Failed to write pipeline cache {}!", tempPath.string());
+            return;
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, path, error);
+        if (error)
+        {
+            ARC_LOG_ERROR("Failed to replace pipeline cache {}: {}", PipelineCachePath, error.message());
+            std::filesystem::remove(tempPath, error);
+        }
+    }
 }
\ No newline at end of file
@@ -4,8 +4,11 @@
 #include "VulkanObjects/DescriptorSet.h"
 #include "VulkanObjects/DescriptorWrite.h"
 #include "ResourceCache.h"
+#include "UniformAllocator.h"
+#include "GeometryAllocator.h"
 #include "RenderGraph.h"
 #include "TimestampQuery.h"
+#include <functional>
 #include <vector>
 
 namespace Arc
@@ -23,7 +26,7 @@ namespace Arc
 		void UpdateDescriptorSet(DescriptorSetArray* descriptorArray, const DescriptorWrite& write);
 		void TransitionImageLayout(GpuImage* image, ImageLayout newLayout);
 		void ClearColorImage(GpuImage* image, float clearColor[4], ImageLayout layout);
-		void SetDeviceLocalBufferData(GpuBuffer* buffer, const void* data, uint32_t size);
+		void SetDeviceLocalBufferData(GpuBuffer* buffer, const void* data, uint32_t size, uint64_t offset = 0);
 		uint64_t GetBufferDeviceAddress(GpuBuffer* buffer);
 		void SetImageData(GpuImage* image, const void* data, uint32_t size, ImageLayout newLayout);
 		std::vector<uint8_t> GetImageData(GpuImage* image, ImageLayout currentLayout);
@@ -35,10 +38,16 @@ namespace Arc
 		QueueFamilyIndices GetQueueFamilyIndices() { return m_QueueFamiliyIndices; }
 		QueueHandle GetGraphicsQueue() { return m_GraphicsQueue; }
 		QueueHandle GetPresentQueue() { return m_PresentQueue; }
+		QueueHandle GetComputeQueue() { return m_ComputeQueue; }
+		QueueHandle GetTransferQueue() { return m_TransferQueue; }
 		CommandPoolHandle GetCommanPool() { return m_CommandPool; }
+		PipelineCacheHandle GetPipelineCache() { return m_PipelineCache; }
 		uint32_t GetFramesInFlightCount() { return m_FramesInFlight; }
+		bool IsMemoryBudgetSupported() { return m_MemoryBudgetSupported; }
 
 		ResourceCache* GetResourceCache() { return m_ResourceCache.get(); }
+		UniformAllocator* GetUniformAllocator() { return m_UniformAllocator.get(); }
+		GeometryAllocator* GetGeometryAllocator() { return m_GeometryAllocator.get(); }
 		RenderGraph* GetRenderGraph() { return m_RenderGraph.get(); }
 		TimestampQuery* GetTimestampQuery() { return m_TimestampQuery.get(); }
 
@@ -49,6 +58,10 @@ namespace Arc
 		void SelectPhysicalDevice();
 		void CreateSurface(void* windowHandle, uint32_t framesInFlight);
 		void CreateLogicalDevice();
+		// The cache file is only used when it was written by the same device and driver
+		void CreatePipelineCache();
+		// Writes to a temporary file that replaces the cache file, an interrupted write keeps the old cache
+		void SavePipelineCache();
 
 		InstanceHandle m_Instance;
 		DebugUtilsMessengerHandle m_DebugUtilsMessenger;
@@ -60,9 +73,18 @@ namespace Arc
 		QueueFamilyIndices m_QueueFamiliyIndices;
 		QueueHandle m_GraphicsQueue;
 		QueueHandle m_PresentQueue;
+		QueueHandle m_ComputeQueue;
+		QueueHandle m_TransferQueue;
 		CommandPoolHandle m_CommandPool;
+		PipelineCacheHandle m_PipelineCache;
+		bool m_MemoryBudgetSupported = false;
+		bool m_PipelineCacheLoaded = false;
+		static constexpr const char* PipelineCachePath = "PipelineCache.bin";
+		static constexpr const char* ShaderCachePath = "ShaderCache.bin";
 
 		std::unique_ptr<ResourceCache> m_ResourceCache;
+		std::unique_ptr<UniformAllocator> m_UniformAllocator;
+		std::unique_ptr<GeometryAllocator> m_GeometryAllocator;
 		std::unique_ptr<RenderGraph> m_RenderGraph;
 		std::unique_ptr<TimestampQuery> m_TimestampQuery;
 	};
@@ -0,0 +1,69 @@
+#include "DynamicResolution.h"
+#include "VulkanCore/VulkanLocal.h"
+#include "VulkanCore/VulkanHandleCreation.h"
+#include <vulkan/vulkan_core.h>
+#include <algorithm>
+#include <cmath>
+
+namespace Arc
+{
+	DynamicResolution::DynamicResolution(DeviceHandle device, PhysicalDeviceHandle physicalDevice, uint32_t framesInFlight, const DynamicResolutionDesc& desc)
+	{
+		m_Desc = desc;
+		m_LogicalDevice = device;
+		m_Scale = desc.MaxScale;
+		m_PendingQueries.resize(framesInFlight, false);
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties((VkPhysicalDevice)physicalDevice, &properties);
+		m_TimestampPeriod = (double)properties.limits.timestampPeriod / 1e6;
+
+		QueryPoolInfo info = {
+			.logicalDevice = device,
+			.maxTimestampCount = framesInFlight * 2,
+		};
+		m_QueryPool = CreateQueryPoolHandle(info);
+	}
+
+	DynamicResolution::~DynamicResolution()
+	{
+		vkDestroyQueryPool((VkDevice)m_LogicalDevice, (VkQueryPool)m_QueryPool, nullptr);
+	}
+
+	void DynamicResolution::BeginFrame(CommandBuffer* cmd, uint32_t frameIndex)
+	{
+		uint32_t firstQuery = frameIndex * 2;
+		if (m_PendingQueries[frameIndex])
+		{
+			uint64_t timestamps[2];
+			VkResult result = vkGetQueryPoolResults((VkDevice)m_LogicalDevice, (VkQueryPool)m_QueryPool, firstQuery, 2,
+				sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+			if (result == VK_SUCCESS)
+				Update((float)((timestamps[1] - timestamps[0]) * m_TimestampPeriod));
+			m_PendingQueries[frameIndex] = false;
+		}
+
+		vkCmdResetQueryPool((VkCommandBuffer)cmd->GetHandle(), (VkQueryPool)m_QueryPool, firstQuery, 2);
+		vkCmdWriteTimestamp((VkCommandBuffer)cmd->GetHandle(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, (VkQueryPool)m_QueryPool, firstQuery);
+	}
+
+	void DynamicResolution::EndFrame(CommandBuffer* cmd, uint32_t frameIndex)
+	{
+		vkCmdWriteTimestamp((VkCommandBuffer)cmd->GetHandle(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, (VkQueryPool)m_QueryPool, frameIndex * 2 + 1);
+		m_PendingQueries[frameIndex] = true;
+	}
+
+	void DynamicResolution::Update(float frameTime)
+	{
+		// Smoothed so a single slow frame does not change the resolution
+		m_FrameTime = m_FrameTime == 0.0f ? frameTime : m_FrameTime + (frameTime - m_FrameTime) * 0.1f;
+		if (m_FrameTime <= 0.0f)
+			return;
+
+		// Frame time follows the pixel count, which grows with the square of the scale
+		float targetScale = std::clamp(m_Scale * std::sqrt(m_Desc.TargetFrameTime / m_FrameTime), m_Desc.MinScale, m_Desc.MaxScale);
+		if (std::abs(targetScale - m_Scale) < m_Desc.ScaleStep)
+			return;
+		m_Scale = std::clamp(std::round(targetScale / m_Desc.ScaleStep) * m_Desc.ScaleStep, m_Desc.MinScale, m_Desc.MaxScale);
+	}
+}
\ No newline at end of file
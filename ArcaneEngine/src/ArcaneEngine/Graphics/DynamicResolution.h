@@ -0,0 +1,43 @@
+#pragma once
+#include "VulkanCore/VulkanHandles.h"
+#include "CommandBuffer.h"
+#include <vector>
+
+namespace Arc
+{
+	struct DynamicResolutionDesc
+	{
+		// GPU time of the frame command buffer in milliseconds
+		float TargetFrameTime = 16.0f;
+		float MinScale = 0.5f;
+		float MaxScale = 1.0f;
+		// The scale only moves in whole steps, so scaled images are not recreated every frame
+		float ScaleStep = 0.05f;
+	};
+
+	class DynamicResolution
+	{
+	public:
+		DynamicResolution(DeviceHandle device, PhysicalDeviceHandle physicalDevice, uint32_t framesInFlight, const DynamicResolutionDesc& desc);
+		~DynamicResolution();
+
+		// Reads back the timestamps of the last frame recorded with this frame index, its fence has already been waited on
+		void BeginFrame(CommandBuffer* cmd, uint32_t frameIndex);
+		void EndFrame(CommandBuffer* cmd, uint32_t frameIndex);
+
+		void SetDesc(const DynamicResolutionDesc& desc) { m_Desc = desc; }
+		float GetScale() { return m_Scale; }
+		float GetFrameTime() { return m_FrameTime; }
+
+	private:
+		void Update(float frameTime);
+
+		DynamicResolutionDesc m_Desc;
+		DeviceHandle m_LogicalDevice;
+		QueryPoolHandle m_QueryPool;
+		double m_TimestampPeriod;
+		std::vector<bool> m_PendingQueries;
+		float m_Scale;
+		float m_FrameTime = 0.0f;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "GeometryAllocator.h"
+#include "Device.h"
+#include "VulkanCore/VulkanLocal.h"
+#include "ArcaneEngine/Core/Log.h"
+#include <vulkan/vulkan_core.h>
+#include <vk_mem_alloc.h>
+#include <algorithm>
+
+namespace Arc
+{
+	GeometryAllocator::GeometryAllocator(Device* device, uint32_t blockSize)
+	{
+		if (!device)
+		{
+			ARC_LOG_FATAL("Failed to create GeometryAllocator object: Device pointer is not valid!");
+		}
+		m_Device = device;
+		m_ResourceCache = device->GetResourceCache();
+		m_BlockSize = blockSize;
+
+		// Vertex and index data are read as scalars, storage buffer bindings of a range need the device alignment
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties((VkPhysicalDevice)device->GetPhysicalDevice(), &properties);
+		m_MinAlignment = std::max<uint64_t>(properties.limits.minStorageBufferOffsetAlignment, 16);
+	}
+
+	GeometryAllocator::~GeometryAllocator()
+	{
+		// Deferred frees reference the virtual blocks, like the ResourceCache the allocator is destroyed with the device idle
+		m_ResourceCache->FlushDeletionQueue();
+		for (auto& block : m_Blocks)
+		{
+			vmaClearVirtualBlock((VmaVirtualBlock)block->VirtualBlock);
+			vmaDestroyVirtualBlock((VmaVirtualBlock)block->VirtualBlock);
+			m_ResourceCache->ReleaseResource(&block->Buffer);
+		}
+	}
+
+	GeometryAllocator::Block* GeometryAllocator::CreateBlock(uint64_t size)
+	{
+		auto block = std::make_unique<Block>();
+		m_ResourceCache->CreateGpuBuffer(&block->Buffer, GpuBufferDesc{
+			.Size = (uint32_t)size,
+			.UsageFlags = BufferUsage::StorageBuffer | BufferUsage::VertexBuffer | BufferUsage::IndexBuffer | BufferUsage::ShaderDeviceAddress |
+				BufferUsage::AccelerationStructureBuildInputReadOnly | BufferUsage::TransferDst,
+			.MemoryProperty = MemoryProperty::DeviceLocal,
+			.EngineOwned = true,
+			.DebugName = "GeometryAllocator block",
+		});
+		block->DeviceAddress = m_Device->GetBufferDeviceAddress(&block->Buffer);
+
+		VmaVirtualBlockCreateInfo blockInfo = {};
+		blockInfo.size = size;
+		VmaVirtualBlock virtualBlock;
+		VK_CHECK(vmaCreateVirtualBlock(&blockInfo, &virtualBlock));
+		block->VirtualBlock = virtualBlock;
+
+		m_Blocks.push_back(std::move(block));
+		return m_Blocks.back().get();
+	}
+
+	GeometryAllocation GeometryAllocator::Allocate(uint64_t size, uint64_t alignment)
+	{
+		VmaVirtualAllocationCreateInfo allocInfo = {};
+		allocInfo.size = size;
+		allocInfo.alignment = std::max(alignment, m_MinAlignment);
+
+		auto allocate = [&](uint32_t blockIndex) -> GeometryAllocation {
+			Block* block = m_Blocks[blockIndex].get();
+			VmaVirtualAllocation allocation;
+			VkDeviceSize offset;
+			if (vmaVirtualAllocate((VmaVirtualBlock)block->VirtualBlock, &allocInfo, &allocation, &offset) != VK_SUCCESS)
+				return {};
+
+			return GeometryAllocation{
+				.Buffer = block->Buffer.GetHandle(),
+				.Offset = offset,
+				.Size = size,
+				.DeviceAddress = block->DeviceAddress + offset,
+				.BlockIndex = blockIndex,
+				.Allocation = (VirtualAllocationHandle)allocation,
+			};
+		};
+
+		for (uint32_t i = 0; i < m_Blocks.size(); i++)
+		{
+			GeometryAllocation allocation = allocate(i);
+			if (allocation.IsValid())
+				return allocation;
+		}
+
+		// Larger ranges get a block of their own
+		uint64_t blockSize = std::max<uint64_t>(m_BlockSize, size);
+		if (blockSize > UINT32_MAX)
+		{
+			ARC_LOG_ERROR("GeometryAllocator cannot allocate {} bytes, ranges are limited to 4GB!", size);
+			return {};
+		}
+		CreateBlock(blockSize);
+		return allocate((uint32_t)m_Blocks.size() - 1);
+	}
+
+	void GeometryAllocator::Free(GeometryAllocation& allocation)
+	{
+		if (!allocation.IsValid())
+			return;
+
+		m_ResourceCache->DeferRelease([virtualBlock = m_Blocks[allocation.BlockIndex]->VirtualBlock, virtualAllocation = allocation.Allocation]() {
+			vmaVirtualFree((VmaVirtualBlock)virtualBlock, (VmaVirtualAllocation)virtualAllocation);
+		});
+		allocation = {};
+	}
+
+	void GeometryAllocator::Upload(const GeometryAllocation& allocation, const void* data, uint64_t size)
+	{
+		if (size > allocation.Size)
+		{
+			ARC_LOG_ERROR("GeometryAllocator upload of {} bytes exceeds the allocation size of {} bytes!", size, allocation.Size);
+			return;
+		}
+		m_Device->SetDeviceLocalBufferData(&m_Blocks[allocation.BlockIndex]->Buffer, data, (uint32_t)size, allocation.Offset);
+	}
+}
\ No newline at end of file
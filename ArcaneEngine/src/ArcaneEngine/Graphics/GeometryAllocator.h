@@ -0,0 +1,55 @@
+#pragma once
+#include "VulkanCore/VulkanHandles.h"
+#include "VulkanObjects/GpuBuffer.h"
+#include <memory>
+#include <vector>
+
+namespace Arc
+{
+	struct GeometryAllocation
+	{
+		BufferHandle Buffer = nullptr;
+		uint64_t Offset = 0;
+		uint64_t Size = 0;
+		uint64_t DeviceAddress = 0;
+		uint32_t BlockIndex = 0;
+		VirtualAllocationHandle Allocation = {};
+
+		bool IsValid() const { return Buffer != nullptr; }
+	};
+
+	class Device;
+	class ResourceCache;
+	// Packs static vertex and index data of many meshes into a few large device local buffers.
+	// Ranges are suballocated with VMA virtual blocks, a new block is added when no existing one has space
+	class GeometryAllocator
+	{
+	public:
+		GeometryAllocator(Device* device, uint32_t blockSize);
+		~GeometryAllocator();
+
+		// Alignment 0 uses the minimum storage buffer offset alignment of the device
+		GeometryAllocation Allocate(uint64_t size, uint64_t alignment = 0);
+		// The range is reused once the frames in flight that could read it have completed
+		void Free(GeometryAllocation& allocation);
+		// Copies through a staging buffer and waits for the copy to finish
+		void Upload(const GeometryAllocation& allocation, const void* data, uint64_t size);
+
+		uint32_t GetBlockCount() { return (uint32_t)m_Blocks.size(); }
+
+	private:
+		struct Block
+		{
+			GpuBuffer Buffer;
+			VirtualBlockHandle VirtualBlock = nullptr;
+			uint64_t DeviceAddress = 0;
+		};
+		Block* CreateBlock(uint64_t size);
+
+		Device* m_Device;
+		ResourceCache* m_ResourceCache;
+		std::vector<std::unique_ptr<Block>> m_Blocks;
+		uint32_t m_BlockSize;
+		uint64_t m_MinAlignment;
+	};
+}
\ No newline at end of file
@@ -97,6 +97,7 @@ namespace Arc
 		VK_CHECK(vkCreateDescriptorPool((VkDevice)device->GetLogicalDevice(), &pool_info, nullptr, &imguiPool));
 		m_Device = device->GetLogicalDevice();
 		m_DescriptorPool = imguiPool;
+		m_FramesInFlight = device->GetFramesInFlightCount();
 
 		ImGui_ImplVulkan_InitInfo init_info = {};
 		init_info.Instance = (VkInstance)device->GetInstance();
@@ -122,6 +123,12 @@ namespace Arc
 		return (ImTextureID)ImGui_ImplVulkan_AddTexture((VkSampler)sampler, (VkImageView)imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 	}
 
+	void ImGuiRenderer::RemoveImageId(ImTextureID imageId)
+	{
+		if (imageId)
+			m_RemovedImageIds.push_back({ .ImageId = imageId, .Frame = m_FrameCount });
+	}
+
 	ImGuiRenderer::~ImGuiRenderer()
 	{
 		ImGui_ImplVulkan_Shutdown();
@@ -132,6 +139,15 @@ namespace Arc
 
 	void ImGuiRenderer::BeginFrame()
 	{
+		m_FrameCount++;
+		size_t removedCount = 0;
+		while (removedCount < m_RemovedImageIds.size() && m_RemovedImageIds[removedCount].Frame + m_FramesInFlight <= m_FrameCount)
+		{
+			ImGui_ImplVulkan_RemoveTexture((VkDescriptorSet)m_RemovedImageIds[removedCount].ImageId);
+			removedCount++;
+		}
+		m_RemovedImageIds.erase(m_RemovedImageIds.begin(), m_RemovedImageIds.begin() + removedCount);
+
 		ImGui_ImplVulkan_NewFrame();
 		ImGui_ImplGlfw_NewFrame();
 		ImGui::NewFrame();
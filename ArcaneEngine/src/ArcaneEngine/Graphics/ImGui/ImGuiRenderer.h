@@ -2,6 +2,7 @@
 #include "ArcaneEngine/Graphics/Device.h"
 #include "ArcaneEngine/Window/Window.h"
 #include "imgui/imgui.h"
+#include <vector>
 
 namespace Arc
 {
@@ -12,11 +13,23 @@ namespace Arc
 		~ImGuiRenderer();
 
 		ImTextureID CreateImageId(ImageViewHandle imageView, SamplerHandle sampler);
+		// Frees the descriptor set of the id once the frames in flight that could draw it have completed
+		void RemoveImageId(ImTextureID imageId);
 
 		void BeginFrame();
 		void EndFrame(CommandBufferHandle cmd);
 	private:
 		DeviceHandle m_Device;
 		DescriptorPoolHandle m_DescriptorPool;
+		uint32_t m_FramesInFlight = 0;
+		uint64_t m_FrameCount = 0;
+
+		struct RemovedImageId
+		{
+			ImTextureID ImageId;
+			uint64_t Frame;
+		};
+		// Anything still pending is freed together with the descriptor pool
+		std::vector<RemovedImageId> m_RemovedImageIds;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "PassTimer.h"
+#include "VulkanCore/VulkanLocal.h"
+#include "VulkanCore/VulkanHandleCreation.h"
+#include <vulkan/vulkan_core.h>
+#include <algorithm>
+
+namespace Arc
+{
+	PassTimer::PassTimer(DeviceHandle device, PhysicalDeviceHandle physicalDevice, uint32_t framesInFlight, uint32_t maxPasses)
+	{
+		m_LogicalDevice = device;
+		m_MaxPasses = maxPasses;
+		m_PendingPassCounts.resize(framesInFlight, 0);
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties((VkPhysicalDevice)physicalDevice, &properties);
+		m_TimestampPeriod = (double)properties.limits.timestampPeriod / 1e6;
+
+		// Queries are reset on creation, afterwards only the ones of a frame that was read back
+		QueryPoolInfo info = {
+			.logicalDevice = device,
+			.maxTimestampCount = framesInFlight * maxPasses * 2,
+		};
+		m_QueryPool = CreateQueryPoolHandle(info);
+	}
+
+	PassTimer::~PassTimer()
+	{
+		vkDestroyQueryPool((VkDevice)m_LogicalDevice, (VkQueryPool)m_QueryPool, nullptr);
+	}
+
+	void PassTimer::BeginFrame(uint32_t frameIndex, uint32_t passCount)
+	{
+		uint32_t firstQuery = frameIndex * m_MaxPasses * 2;
+		uint32_t pendingPassCount = m_PendingPassCounts[frameIndex];
+		if (pendingPassCount > 0)
+		{
+			// Culled passes and passes on queues without timestamps never write theirs, so availability is queried per timestamp
+			uint32_t queryCount = pendingPassCount * 2;
+			m_Results.resize(queryCount * 2);
+			VkResult result = vkGetQueryPoolResults((VkDevice)m_LogicalDevice, (VkQueryPool)m_QueryPool, firstQuery, queryCount,
+				m_Results.size() * sizeof(uint64_t), m_Results.data(), sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+			m_PassTimes.assign(pendingPassCount, -1.0f);
+			if (result == VK_SUCCESS || result == VK_NOT_READY)
+			{
+				for (uint32_t i = 0; i < pendingPassCount; i++)
+				{
+					uint64_t start = m_Results[i * 4];
+					uint64_t end = m_Results[i * 4 + 2];
+					bool available = m_Results[i * 4 + 1] != 0 && m_Results[i * 4 + 3] != 0;
+					if (available && end >= start)
+						m_PassTimes[i] = (float)((end - start) * m_TimestampPeriod);
+				}
+			}
+			vkResetQueryPool((VkDevice)m_LogicalDevice, (VkQueryPool)m_QueryPool, firstQuery, queryCount);
+		}
+		m_PendingPassCounts[frameIndex] = std::min(passCount, m_MaxPasses);
+	}
+
+	void PassTimer::BeginPass(CommandBuffer* cmd, uint32_t frameIndex, uint32_t passIndex)
+	{
+		if (passIndex >= m_MaxPasses)
+			return;
+		vkCmdWriteTimestamp((VkCommandBuffer)cmd->GetHandle(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, (VkQueryPool)m_QueryPool, (frameIndex * m_MaxPasses + passIndex) * 2);
+	}
+
+	void PassTimer::EndPass(CommandBuffer* cmd, uint32_t frameIndex, uint32_t passIndex)
+	{
+		if (passIndex >= m_MaxPasses)
+			return;
+		vkCmdWriteTimestamp((VkCommandBuffer)cmd->GetHandle(), VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, (VkQueryPool)m_QueryPool, (frameIndex * m_MaxPasses + passIndex) * 2 + 1);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+#include "VulkanCore/VulkanHandles.h"
+#include "CommandBuffer.h"
+#include <vector>
+
+namespace Arc
+{
+	// GPU time of every pass of a frame, measured with a pair of timestamps around the pass
+	class PassTimer
+	{
+	public:
+		PassTimer(DeviceHandle device, PhysicalDeviceHandle physicalDevice, uint32_t framesInFlight, uint32_t maxPasses);
+		~PassTimer();
+
+		// Reads back the timestamps of the last frame recorded with this frame index and resets its queries on the host.
+		// Every queue that wrote them has to be done with that frame.
+		void BeginFrame(uint32_t frameIndex, uint32_t passCount);
+		void BeginPass(CommandBuffer* cmd, uint32_t frameIndex, uint32_t passIndex);
+		void EndPass(CommandBuffer* cmd, uint32_t frameIndex, uint32_t passIndex);
+
+		// Milliseconds of the pass in the last frame that was read back, negative when the pass was not measured
+		float GetPassTime(uint32_t passIndex) { return passIndex < m_PassTimes.size() ? m_PassTimes[passIndex] : -1.0f; }
+		uint32_t GetMaxPasses() { return m_MaxPasses; }
+
+	private:
+		DeviceHandle m_LogicalDevice;
+		QueryPoolHandle m_QueryPool;
+		double m_TimestampPeriod;
+		uint32_t m_MaxPasses;
+		// Number of passes recorded per frame in flight whose timestamps were not read back yet
+		std::vector<uint32_t> m_PendingPassCounts;
+		std::vector<uint64_t> m_Results;
+		std::vector<float> m_PassTimes;
+	};
+}
\ No newline at end of file
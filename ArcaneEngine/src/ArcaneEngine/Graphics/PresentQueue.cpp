@@ -3,6 +3,7 @@
 #include "ArcaneEngine/Graphics/VulkanCore/VulkanHandleCreation.h"
 #include "ArcaneEngine/Graphics/VulkanCore/VulkanLocal.h"
 #include "ArcaneEngine/Core/Log.h"
+#include "ArcaneEngine/Core/AllocationCounter.h"
 #include <vulkan/vulkan_core.h>
 
 namespace Arc
@@ -15,6 +16,9 @@ namespace Arc
 		}
 
 		m_LogicalDevice = device->GetLogicalDevice();
+		m_ResourceCache = device->GetResourceCache();
+		m_UniformAllocator = device->GetUniformAllocator();
+		m_RenderGraph = device->GetRenderGraph();
 		m_PresentQueue = device->GetPresentQueue();
 		SwapchainCreateInfo swapchainCreateInfo =
 		{
@@ -86,7 +90,8 @@ namespace Arc
 				.imageAcquiredSemaphore = CreateSemaphoreHandle(semaphoreCreateInfo),
 				.renderingFinishedSemaphore = CreateSemaphoreHandle(semaphoreCreateInfo),
 				.inFlightFence = CreateFenceHandle(fenceCreateInfo),
-				.commandBuffer = CommandBuffer(m_LogicalDevice, device->GetCommanPool())
+				.commandBuffer = CommandBuffer(m_LogicalDevice, device->GetCommanPool()),
+				.splitCommandBuffer = CommandBuffer(m_LogicalDevice, device->GetCommanPool())
 			};
 			m_FrameResources.push_back(resources);
 		}
@@ -115,6 +120,7 @@ namespace Arc
 
 	FrameData PresentQueue::BeginFrame()
 	{
+		m_FrameAllocationStart = GetAllocationCount();
 		VkFence fence = (VkFence)m_FrameResources[m_FrameIndex].inFlightFence;
 		VK_CHECK(vkWaitForFences(
 			(VkDevice)m_LogicalDevice,
@@ -122,29 +128,119 @@ namespace Arc
 			&fence,
 			VK_TRUE,
 			std::numeric_limits<uint64_t>::max()));
+		m_RenderGraph->BeginFrame(m_FrameIndex);
+		m_ResourceCache->BeginFrame(m_FrameIndex);
+		m_UniformAllocator->BeginFrame(m_FrameIndex);
 
 		AcquireNextImage();
 
 		CommandBuffer* cmd = &m_FrameResources[m_FrameIndex].commandBuffer;
+		m_FrameResources[m_FrameIndex].split = false;
 		
 		cmd->Begin();
+		// A dropped frame is never submitted, the next pass waits for a frame that is
+		if (!m_OutOfDate)
+			m_ResourceCache->RecordDefragmentationPass(cmd->GetHandle());
 		
 		FrameData frameData;
 		frameData.CommandBuffer = cmd;
 		frameData.FrameIndex = m_FrameIndex;
 		frameData.PresentImage = m_SwapchainImages[m_PresentImageIndex];
 		frameData.PresentImageView = m_SwapchainImageViews[m_PresentImageIndex];
+		frameData.Queue = this;
 
 		return frameData;
 	}
 
+	void PresentQueue::AddWaitSemaphore(SemaphoreHandle semaphore, uint64_t value, uint64_t stageMask)
+	{
+		if (m_WaitSemaphores.size() == MaxSubmitSemaphores)
+			ARC_LOG_FATAL("Frame submit waits on more than {} extra semaphores!", MaxSubmitSemaphores);
+		m_WaitSemaphores.push_back({ semaphore, value, stageMask });
+	}
+
+	void PresentQueue::AddSignalSemaphore(SemaphoreHandle semaphore, uint64_t value, uint64_t stageMask)
+	{
+		if (m_SignalSemaphores.size() == MaxSubmitSemaphores)
+			ARC_LOG_FATAL("Frame submit signals more than {} extra semaphores!", MaxSubmitSemaphores);
+		m_SignalSemaphores.push_back({ semaphore, value, stageMask });
+	}
+
+	CommandBuffer* PresentQueue::SubmitRecordedWork(SemaphoreHandle semaphore, uint64_t value)
+	{
+		FrameResources& frame = m_FrameResources[m_FrameIndex];
+		frame.commandBuffer.End();
+		m_UniformAllocator->Flush(m_FrameIndex);
+
+		VkSemaphoreSubmitInfo signalSemaphoreInfo = {};
+		signalSemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+		signalSemaphoreInfo.semaphore = (VkSemaphore)semaphore;
+		signalSemaphoreInfo.value = value;
+		signalSemaphoreInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+		VkCommandBufferSubmitInfo commandBufferSubmitInfo{};
+		commandBufferSubmitInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+		commandBufferSubmitInfo.commandBuffer = (VkCommandBuffer)frame.commandBuffer.GetHandle();
+
+		VkSubmitInfo2 submitInfo2 = {};
+		submitInfo2.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+		submitInfo2.commandBufferInfoCount = 1;
+		submitInfo2.pCommandBufferInfos = &commandBufferSubmitInfo;
+		submitInfo2.signalSemaphoreInfoCount = 1;
+		submitInfo2.pSignalSemaphoreInfos = &signalSemaphoreInfo;
+		// The fence of the frame is signaled by the final submit, which comes later on this queue
+		VK_CHECK(vkQueueSubmit2((VkQueue)m_PresentQueue, 1, &submitInfo2, VK_NULL_HANDLE));
+
+		frame.split = true;
+		frame.splitCommandBuffer.Begin();
+		return &frame.splitCommandBuffer;
+	}
+
 	void PresentQueue::EndFrame()
 	{
+		// One extra slot for the swapchain semaphore of the frame
+		VkSemaphoreSubmitInfo waitSemaphoreInfos[MaxSubmitSemaphores + 1];
+		VkSemaphoreSubmitInfo signalSemaphoreInfos[MaxSubmitSemaphores + 1];
+		uint32_t waitSemaphoreCount = 0;
+		uint32_t signalSemaphoreCount = 0;
+		auto addSemaphores = [](VkSemaphoreSubmitInfo* infos, uint32_t& count, std::vector<SemaphoreSubmit>& semaphores) {
+			for (size_t i = 0; i < semaphores.size() && i < MaxSubmitSemaphores; i++)
+			{
+				VkSemaphoreSubmitInfo& info = infos[count++];
+				info = {};
+				info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+				info.semaphore = (VkSemaphore)semaphores[i].Semaphore;
+				info.value = semaphores[i].Value;
+				info.stageMask = semaphores[i].StageMask;
+			}
+			semaphores.clear();
+		};
+
 		if (m_OutOfDate)
+		{
+			// Timeline values promised to other queues still have to be signaled, otherwise their waits never finish
+			if (!m_SignalSemaphores.empty())
+			{
+				addSemaphores(waitSemaphoreInfos, waitSemaphoreCount, m_WaitSemaphores);
+				addSemaphores(signalSemaphoreInfos, signalSemaphoreCount, m_SignalSemaphores);
+
+				VkSubmitInfo2 submitInfo2 = {};
+				submitInfo2.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+				submitInfo2.waitSemaphoreInfoCount = waitSemaphoreCount;
+				submitInfo2.pWaitSemaphoreInfos = waitSemaphoreInfos;
+				submitInfo2.signalSemaphoreInfoCount = signalSemaphoreCount;
+				submitInfo2.pSignalSemaphoreInfos = signalSemaphoreInfos;
+				VK_CHECK(vkQueueSubmit2((VkQueue)m_PresentQueue, 1, &submitInfo2, VK_NULL_HANDLE));
+			}
+			m_WaitSemaphores.clear();
+			m_FrameAllocationCount = (uint32_t)(GetAllocationCount() - m_FrameAllocationStart);
 			return;
+		}
 
-		CommandBuffer* cmd = &m_FrameResources[m_FrameIndex].commandBuffer;
+		FrameResources& frame = m_FrameResources[m_FrameIndex];
+		CommandBuffer* cmd = frame.split ? &frame.splitCommandBuffer : &frame.commandBuffer;
 		cmd->End();
+		m_UniformAllocator->Flush(m_FrameIndex);
 
 		VkSubmitInfo2 submitInfo2 = {};
 		submitInfo2.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
@@ -157,8 +253,10 @@ namespace Arc
 		waitSemaphoreInfo.deviceIndex = 0;
 		waitSemaphoreInfo.value = 1;
 
-		submitInfo2.waitSemaphoreInfoCount = 1;
-		submitInfo2.pWaitSemaphoreInfos = &waitSemaphoreInfo;
+		waitSemaphoreInfos[waitSemaphoreCount++] = waitSemaphoreInfo;
+		addSemaphores(waitSemaphoreInfos, waitSemaphoreCount, m_WaitSemaphores);
+		submitInfo2.waitSemaphoreInfoCount = waitSemaphoreCount;
+		submitInfo2.pWaitSemaphoreInfos = waitSemaphoreInfos;
 
 		VkSemaphoreSubmitInfo signalSemaphoreInfo = {};
 		signalSemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
@@ -168,8 +266,10 @@ namespace Arc
 		signalSemaphoreInfo.deviceIndex = 0;
 		signalSemaphoreInfo.value = 1;
 
-		submitInfo2.signalSemaphoreInfoCount = 1;
-		submitInfo2.pSignalSemaphoreInfos = &signalSemaphoreInfo;
+		signalSemaphoreInfos[signalSemaphoreCount++] = signalSemaphoreInfo;
+		addSemaphores(signalSemaphoreInfos, signalSemaphoreCount, m_SignalSemaphores);
+		submitInfo2.signalSemaphoreInfoCount = signalSemaphoreCount;
+		submitInfo2.pSignalSemaphoreInfos = signalSemaphoreInfos;
 
 		VkCommandBufferSubmitInfo commandBufferSubmitInfo{};
 		commandBufferSubmitInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
@@ -185,6 +285,7 @@ namespace Arc
 		VK_CHECK(vkQueueSubmit2((VkQueue)m_PresentQueue, 1, &submitInfo2, inFlightFence));
 
 		PresentImage();
+		m_FrameAllocationCount = (uint32_t)(GetAllocationCount() - m_FrameAllocationStart);
 		m_FrameIndex = (m_FrameIndex + 1) % m_ImageCount;
 	}
 
@@ -4,6 +4,7 @@
 
 namespace Arc
 {
+	class PresentQueue;
 	class FrameData
 	{
 	public:
@@ -11,9 +12,13 @@ namespace Arc
 		uint32_t FrameIndex;
 		ImageHandle PresentImage;
 		ImageViewHandle PresentImageView;
+		PresentQueue* Queue;
 	};
 
 	class Device;
+	class ResourceCache;
+	class UniformAllocator;
+	class RenderGraph;
 	class PresentQueue
 	{
 	public:
@@ -23,6 +28,15 @@ namespace Arc
 		FrameData BeginFrame();
 		void EndFrame();
 		bool OutOfDate() { return m_OutOfDate; };
+		// Heap allocations of every thread from the last BeginFrame to its present, always 0 unless ARC_COUNT_ALLOCATIONS is defined
+		uint32_t GetFrameAllocationCount() { return m_FrameAllocationCount; }
+
+		// Extra semaphores for the submit of the current frame, used to synchronize with work on other queues
+		void AddWaitSemaphore(SemaphoreHandle semaphore, uint64_t value, uint64_t stageMask);
+		void AddSignalSemaphore(SemaphoreHandle semaphore, uint64_t value, uint64_t stageMask);
+		// Ends and submits what was recorded into the frame command buffer so far, signaling the semaphore once it has executed.
+		// Recording continues in the returned second command buffer of the frame, which EndFrame submits instead.
+		CommandBuffer* SubmitRecordedWork(SemaphoreHandle semaphore, uint64_t value);
 
 		Format GetSurfaceFormat() { return m_SurfaceFormat; }
 		ImageHandle GetImage(uint32_t index) { return m_SwapchainImages[index]; };
@@ -40,10 +54,26 @@ namespace Arc
 			SemaphoreHandle renderingFinishedSemaphore;
 			FenceHandle inFlightFence;
 			CommandBuffer commandBuffer;
+			CommandBuffer splitCommandBuffer;
+			bool split = false;
 		};
 		std::vector<FrameResources> m_FrameResources;
 
+		struct SemaphoreSubmit
+		{
+			SemaphoreHandle Semaphore;
+			uint64_t Value;
+			uint64_t StageMask;
+		};
+		// Submit infos are built on the stack, the vectors keep their capacity between frames
+		static constexpr uint32_t MaxSubmitSemaphores = 8;
+		std::vector<SemaphoreSubmit> m_WaitSemaphores;
+		std::vector<SemaphoreSubmit> m_SignalSemaphores;
+
 		DeviceHandle m_LogicalDevice;
+		ResourceCache* m_ResourceCache;
+		UniformAllocator* m_UniformAllocator;
+		RenderGraph* m_RenderGraph;
 		SwapchainHandle m_Swapchain;
 		QueueHandle m_PresentQueue;
 		uint32_t m_ImageCount;
@@ -54,5 +84,7 @@ namespace Arc
 		bool m_OutOfDate;
 		uint32_t m_FrameIndex;
 		uint32_t m_PresentImageIndex;
+		uint64_t m_FrameAllocationStart = 0;
+		uint32_t m_FrameAllocationCount = 0;
 	};
 }
\ No newline at end of file
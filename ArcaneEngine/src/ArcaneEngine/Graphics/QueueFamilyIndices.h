@@ -7,6 +7,8 @@ namespace Arc
 	{
 		uint32_t GraphicsIndex = uint32_t(-1);
 		uint32_t PresentIndex = uint32_t(-1);
-		//uint32_t TransferIndex = uint32_t(-1);
+		// Dedicated families when the device has them, otherwise the graphics family
+		uint32_t ComputeIndex = uint32_t(-1);
+		uint32_t TransferIndex = uint32_t(-1);
 	};
 }
\ No newline at end of file
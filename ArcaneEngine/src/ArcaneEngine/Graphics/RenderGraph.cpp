@@ -1,66 +1,2129 @@
 #include "RenderGraph.h"
+#include "Device.h"
+#include "VulkanCore/VulkanLocal.h"
 #include "ArcaneEngine/Core/Log.h"
+#include "ArcaneEngine/Core/AllocationCounter.h"
+#include <vulkan/vulkan_core.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <numeric>
 
 namespace Arc
 {
-	RenderGraph::RenderGraph()
+	namespace
 	{
+		struct AccessInfo
+		{
+			VkPipelineStageFlags2 Stages = 0;
+			VkAccessFlags2 Access = 0;
+			ImageLayout Layout = ImageLayout::Undefined;
+			bool Write = false;
+		};
+
+		constexpr VkAccessFlags2 WriteAccessMask =
+			VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+			VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+			VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+			VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+		constexpr size_t MaxCompiledGraphs = 16;
+		constexpr size_t MaxPassOrders = 16;
+		// Recording a handful of passes is cheaper than handing them to another thread
+		constexpr size_t MinPassesPerRecordingThread = 16;
+
+		constexpr uint32_t GraphicsQueue = 0;
+		constexpr uint32_t ComputeQueue = 1;
+		constexpr uint32_t TransferQueue = 2;
+
+		// Passes past this index are not timed
+		constexpr uint32_t MaxTimedPasses = 256;
+
+		// Adds the allocations made during its lifetime to the frame count
+		struct AllocationScope
+		{
+			AllocationScope(uint64_t& count) : Count(count), Start(GetAllocationCount()) {}
+			~AllocationScope() { Count += GetAllocationCount() - Start; }
+
+			uint64_t& Count;
+			uint64_t Start;
+		};
+
+		uint64_t HashSignature(const std::vector<uint64_t>& signature)
+		{
+			uint64_t key = 0;
+			for (uint64_t value : signature)
+			{
+				key ^= std::hash<uint64_t>{}(value) + 0x9e3779b9 + (key << 6) + (key >> 2);
+			}
+			return key;
+		}
+
+		bool IsSameImageDesc(const GpuImageDesc& a, const GpuImageDesc& b)
+		{
+			return a.Extent[0] == b.Extent[0] && a.Extent[1] == b.Extent[1] && a.Extent[2] == b.Extent[2] &&
+				a.Format == b.Format && a.UsageFlags == b.UsageFlags && a.AspectFlags == b.AspectFlags && a.MipLevels == b.MipLevels;
+		}
+
+		// Lowest aligned offset that does not overlap any of the occupied [begin, end) ranges
+		uint64_t FindAliasingOffset(std::vector<std::pair<uint64_t, uint64_t>>& occupied, uint64_t size, uint64_t alignment)
+		{
+			std::sort(occupied.begin(), occupied.end());
+			uint64_t offset = 0;
+			for (auto& [begin, end] : occupied)
+			{
+				if (offset + size <= begin)
+					break;
+				offset = std::max(offset, (end + alignment - 1) / alignment * alignment);
+			}
+			return offset;
+		}
+
+		VkPipelineStageFlags2 GetShaderPipelineStages(ShaderStage shaderStage)
+		{
+			VkShaderStageFlags stage = (VkShaderStageFlags)shaderStage;
+			VkPipelineStageFlags2 stages = 0;
+			if (stage & VK_SHADER_STAGE_VERTEX_BIT)
+				stages |= VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT;
+			if (stage & VK_SHADER_STAGE_FRAGMENT_BIT)
+				stages |= VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+			if (stage & VK_SHADER_STAGE_COMPUTE_BIT)
+				stages |= VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+			if (stage & (VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR))
+				stages |= VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR;
+			return stages;
+		}
+
+		AccessInfo GetAccessInfo(const Resource& resource)
+		{
+			AccessInfo info;
+			VkPipelineStageFlags2 shaderStages = GetShaderPipelineStages(resource.Stage);
+			switch (resource.Access)
+			{
+			case ResourceAccess::UniformRead:
+				info = { shaderStages, VK_ACCESS_2_UNIFORM_READ_BIT, ImageLayout::Undefined, false };
+				break;
+			case ResourceAccess::StorageRead:
+				info = { shaderStages, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, ImageLayout::General, false };
+				break;
+			case ResourceAccess::StorageWrite:
+				info = { shaderStages, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, ImageLayout::General, true };
+				break;
+			case ResourceAccess::StorageReadWrite:
+				info = { shaderStages, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, ImageLayout::General, true };
+				break;
+			case ResourceAccess::SampledRead:
+				info = { shaderStages, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, ImageLayout::ShaderReadOnlyOptimal, false };
+				break;
+			case ResourceAccess::ColorAttachmentWrite:
+				info = { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, ImageLayout::AttachmentOptimal, true };
+				break;
+			case ResourceAccess::DepthAttachmentRead:
+				info = { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, ImageLayout::DepthReadOnlyOptimal, false };
+				break;
+			case ResourceAccess::DepthAttachmentWrite:
+				info = { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, ImageLayout::DepthAttachmentOptimal, true };
+				break;
+			case ResourceAccess::TransferRead:
+				info = { VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, ImageLayout::TransferSrcOptimal, false };
+				break;
+			case ResourceAccess::TransferWrite:
+				info = { VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, ImageLayout::TransferDstOptimal, true };
+				break;
+			case ResourceAccess::VertexBufferRead:
+				info = { VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT, ImageLayout::Undefined, false };
+				break;
+			case ResourceAccess::IndexBufferRead:
+				info = { VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT, VK_ACCESS_2_INDEX_READ_BIT, ImageLayout::Undefined, false };
+				break;
+			case ResourceAccess::IndirectRead:
+				info = { VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT, ImageLayout::Undefined, false };
+				break;
+			case ResourceAccess::AccelerationStructureRead:
+				info = { shaderStages, VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR, ImageLayout::Undefined, false };
+				break;
+			}
+			if (resource.Layout != ImageLayout::Undefined)
+				info.Layout = resource.Layout;
+			return info;
+		}
+
+		const char* GetQueueName(uint32_t queue)
+		{
+			switch (queue)
+			{
+			case GraphicsQueue: return "Graphics";
+			case ComputeQueue: return "AsyncCompute";
+			case TransferQueue: return "Transfer";
+			}
+			return "Unknown";
+		}
+
+		const char* GetAccessName(ResourceAccess access)
+		{
+			switch (access)
+			{
+			case ResourceAccess::UniformRead: return "UniformRead";
+			case ResourceAccess::StorageRead: return "StorageRead";
+			case ResourceAccess::StorageWrite: return "StorageWrite";
+			case ResourceAccess::StorageReadWrite: return "StorageReadWrite";
+			case ResourceAccess::SampledRead: return "SampledRead";
+			case ResourceAccess::ColorAttachmentWrite: return "ColorAttachmentWrite";
+			case ResourceAccess::DepthAttachmentRead: return "DepthAttachmentRead";
+			case ResourceAccess::DepthAttachmentWrite: return "DepthAttachmentWrite";
+			case ResourceAccess::TransferRead: return "TransferRead";
+			case ResourceAccess::TransferWrite: return "TransferWrite";
+			case ResourceAccess::VertexBufferRead: return "VertexBufferRead";
+			case ResourceAccess::IndexBufferRead: return "IndexBufferRead";
+			case ResourceAccess::IndirectRead: return "IndirectRead";
+			case ResourceAccess::AccelerationStructureRead: return "AccelerationStructureRead";
+			}
+			return "Unknown";
+		}
+
+		const char* GetLayoutName(ImageLayout layout)
+		{
+			switch (layout)
+			{
+			case ImageLayout::Undefined: return "Undefined";
+			case ImageLayout::General: return "General";
+			case ImageLayout::ColorAttachmentOptimal: return "ColorAttachmentOptimal";
+			case ImageLayout::DepthStencilAttachmentOptimal: return "DepthStencilAttachmentOptimal";
+			case ImageLayout::DepthStencilReadOnlyOptimal: return "DepthStencilReadOnlyOptimal";
+			case ImageLayout::ShaderReadOnlyOptimal: return "ShaderReadOnlyOptimal";
+			case ImageLayout::TransferSrcOptimal: return "TransferSrcOptimal";
+			case ImageLayout::TransferDstOptimal: return "TransferDstOptimal";
+			case ImageLayout::Preinitialized: return "Preinitialized";
+			case ImageLayout::DepthReadOnlyStencilAttachmentOptimal: return "DepthReadOnlyStencilAttachmentOptimal";
+			case ImageLayout::DepthAttachmentStencilReadOnlyOptimal: return "DepthAttachmentStencilReadOnlyOptimal";
+			case ImageLayout::DepthAttachmentOptimal: return "DepthAttachmentOptimal";
+			case ImageLayout::DepthReadOnlyOptimal: return "DepthReadOnlyOptimal";
+			case ImageLayout::StencilAttachmentOptimal: return "StencilAttachmentOptimal";
+			case ImageLayout::StencilReadOnlyOptimal: return "StencilReadOnlyOptimal";
+			case ImageLayout::ReadOnlyOptimal: return "ReadOnlyOptimal";
+			case ImageLayout::AttachmentOptimal: return "AttachmentOptimal";
+			case ImageLayout::PresentSrc: return "PresentSrc";
+			}
+			return "Unknown";
+		}
+
+		const char* GetLoadOpName(AttachmentLoadOp loadOp)
+		{
+			switch (loadOp)
+			{
+			case AttachmentLoadOp::Load: return "Load";
+			case AttachmentLoadOp::Clear: return "Clear";
+			case AttachmentLoadOp::DontCare: return "DontCare";
+			}
+			return "Unknown";
+		}
+
+		// Pass names are plain identifiers in practice, only characters that break the output formats are escaped
+		std::string EscapeName(const char* name)
+		{
+			std::string escaped;
+			for (const char* c = name; *c; c++)
+			{
+				if (*c == '"' || *c == '\\')
+					escaped.push_back('\\');
+				escaped.push_back(*c);
+			}
+			return escaped;
+		}
+	}
+
+	RenderGraph::RenderGraph(Device* device)
+	{
+		m_Device = device;
+
+		QueueFamilyIndices queueFamilies = device->GetQueueFamilyIndices();
+		m_QueueFamilies[GraphicsQueue] = queueFamilies.GraphicsIndex;
+		m_QueueFamilies[ComputeQueue] = queueFamilies.ComputeIndex;
+		m_QueueFamilies[TransferQueue] = queueFamilies.TransferIndex;
+		m_Queues[GraphicsQueue] = device->GetGraphicsQueue();
+		m_Queues[ComputeQueue] = device->GetComputeQueue();
+		m_Queues[TransferQueue] = device->GetTransferQueue();
+
+		if (queueFamilies.ComputeIndex == queueFamilies.GraphicsIndex && queueFamilies.TransferIndex == queueFamilies.GraphicsIndex)
+			return;
+
+		VkSemaphoreTypeCreateInfo semaphoreTypeInfo = {};
+		semaphoreTypeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		semaphoreTypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		semaphoreTypeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreInfo = {};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &semaphoreTypeInfo;
+
+		for (uint32_t queue = 0; queue < QueueCount; queue++)
+		{
+			VkSemaphore semaphore;
+			VK_CHECK(vkCreateSemaphore((VkDevice)m_Device->GetLogicalDevice(), &semaphoreInfo, nullptr, &semaphore));
+			m_TimelineSemaphores[queue] = semaphore;
+		}
+	}
+
+	RenderGraph::~RenderGraph()
+	{
+		m_ThreadPool.reset();
+		if (m_TransientImages.empty() && m_RetiredTransients.empty() && m_HistoryImages.empty() && m_PassRecorders.empty() && !m_TimelineSemaphores[GraphicsQueue])
+			return;
+
+		m_Device->WaitIdle();
+		VkDevice device = (VkDevice)m_Device->GetLogicalDevice();
+		for (auto& recorders : m_PassRecorders)
+		{
+			for (auto& recorder : recorders)
+			{
+				vkDestroyCommandPool(device, (VkCommandPool)recorder.CommandPool, nullptr);
+			}
+		}
+		for (auto& frameCommandBuffers : m_QueueCommandBuffers)
+		{
+			for (auto& queueCommandBuffers : frameCommandBuffers)
+			{
+				if (queueCommandBuffers.CommandPool)
+					vkDestroyCommandPool(device, (VkCommandPool)queueCommandBuffers.CommandPool, nullptr);
+			}
+		}
+		for (SemaphoreHandle semaphore : m_TimelineSemaphores)
+		{
+			if (semaphore)
+				vkDestroySemaphore(device, (VkSemaphore)semaphore, nullptr);
+		}
+
+		ReleaseTransientImages();
+		ReleaseHistoryImages();
+	}
+
+	void RenderGraph::Reset()
+	{
+		ReleaseTransientImages();
+		ReleaseHistoryImages();
+
+		// The handles are about to be destroyed and can be reused by the objects of the next renderer
+		m_ResourceStates.clear();
+		m_RetainedResources.clear();
+		m_CompiledGraphs.clear();
+		m_CompiledGraph = nullptr;
+		m_Signature.clear();
+		m_PassOrders.clear();
+		m_OrderSignature.clear();
+		m_MultithreadedRecording = false;
+	}
+
+	void RenderGraph::AddPass(const RenderPass& renderPass)
+	{
+		AllocationScope allocationScope(m_FrameAllocationCount);
+		RenderPass& pass = m_BuildRenderPasses.emplace_back(renderPass);
+		pass.ColorAttachments = CopyToBuildArena(renderPass.ColorAttachments);
+		pass.Inputs = CopyToBuildArena(renderPass.Inputs);
+		pass.Outputs = CopyToBuildArena(renderPass.Outputs);
+	}
+
+	void RenderGraph::SetPresentPass(const PresentPass& presentPass)
+	{
+		AllocationScope allocationScope(m_FrameAllocationCount);
+		m_BuildPresentPass = presentPass;
+		m_BuildPresentPass.Inputs = CopyToBuildArena(presentPass.Inputs);
+	}
+
+	void RenderGraph::ImportImage(ImageHandle image, ImageLayout layout)
+	{
+		ResourceState state = {};
+		state.Layout = layout;
+		m_ResourceStates[image] = state;
+	}
+
+	void RenderGraph::ForgetResource(void* handle)
+	{
+		m_ResourceStates.erase(handle);
+		ReleaseRetainedResource(handle);
+	}
+
+	bool RenderGraph::GetResourceLayout(void* handle, ImageLayout& layout)
+	{
+		auto it = m_ResourceStates.find(handle);
+		if (it == m_ResourceStates.end())
+		{
+			layout = ImageLayout::Undefined;
+			return true;
+		}
+		layout = it->second.Layout;
+		return m_QueueFamilies[it->second.Queue] == m_QueueFamilies[GraphicsQueue];
+	}
+
+	void RenderGraph::ReplaceResource(void* oldHandle, void* newHandle)
+	{
+		auto it = m_ResourceStates.find(oldHandle);
+		if (it != m_ResourceStates.end())
+		{
+			ResourceState state = it->second;
+			m_ResourceStates.erase(it);
+			m_ResourceStates[newHandle] = state;
+		}
+
+		auto retained = std::lower_bound(m_RetainedResources.begin(), m_RetainedResources.end(), oldHandle);
+		if (retained != m_RetainedResources.end() && *retained == oldHandle)
+		{
+			m_RetainedResources.erase(retained);
+			RetainResource(newHandle);
+		}
+	}
+
+	void RenderGraph::RetainResource(void* handle)
+	{
+		auto it = std::lower_bound(m_RetainedResources.begin(), m_RetainedResources.end(), handle);
+		if (it == m_RetainedResources.end() || *it != handle)
+			m_RetainedResources.insert(it, handle);
+	}
+
+	void RenderGraph::ReleaseRetainedResource(void* handle)
+	{
+		auto it = std::lower_bound(m_RetainedResources.begin(), m_RetainedResources.end(), handle);
+		if (it != m_RetainedResources.end() && *it == handle)
+			m_RetainedResources.erase(it);
+	}
+
+	void RenderGraph::CullPasses()
+	{
+		// Graphs only touch a few dozen resources, a linear search beats hashing and keeps its capacity
+		auto isLive = [&](void* handle) {
+			return std::find(m_LiveResources.begin(), m_LiveResources.end(), handle) != m_LiveResources.end();
+		};
+		auto addLiveResources = [&](ArrayView<Resource> resources) {
+			for (auto& resource : resources)
+			{
+				void* handle = resource.Image ? resource.Image : resource.Buffer;
+				if (handle && !isLive(handle))
+					m_LiveResources.push_back(handle);
+			}
+		};
+		m_LiveResources.assign(m_RetainedResources.begin(), m_RetainedResources.end());
+		addLiveResources(m_PresentPass.Inputs);
+
+		m_CulledPasses.assign(m_RenderPasses.size(), false);
+		for (size_t i = m_RenderPasses.size(); i-- > 0;)
+		{
+			auto& pass = m_RenderPasses[i];
+
+			// Passes without declared outputs can not be proven dead
+			bool live = pass.Outputs.empty();
+			for (auto& resource : pass.Outputs)
+			{
+				void* handle = resource.Image ? resource.Image : resource.Buffer;
+				live |= handle && isLive(handle);
+			}
+			if (!live)
+			{
+				m_CulledPasses[i] = true;
+				continue;
+			}
+
+			// Outputs stay live as well, writes are not known to cover the whole resource
+			addLiveResources(pass.Inputs);
+			addLiveResources(pass.Outputs);
+		}
+	}
+
+	void RenderGraph::ReorderPasses()
+	{
+		// Layouts the resources enter the frame with are part of the key, scheduling simulates barriers from them
+		BuildSignature(m_OrderSignature);
+		for (size_t i = 0; i < m_RenderPasses.size(); i++)
+		{
+			if (m_CulledPasses[i])
+				continue;
+			for (auto resources : { m_RenderPasses[i].Inputs, m_RenderPasses[i].Outputs })
+			{
+				for (auto& resource : resources)
+				{
+					auto it = m_ResourceStates.find(resource.Image ? resource.Image : resource.Buffer);
+					m_OrderSignature.push_back(it != m_ResourceStates.end() ? (uint64_t)it->second.Layout : (uint64_t)ImageLayout::Undefined);
+				}
+			}
+		}
+
+		uint64_t key = HashSignature(m_OrderSignature);
+		auto it = m_PassOrders.find(key);
+		if (it == m_PassOrders.end() || it->second.Signature != m_OrderSignature)
+		{
+			if (it == m_PassOrders.end() && m_PassOrders.size() >= MaxPassOrders)
+				m_PassOrders.clear();
+			PassOrder& passOrder = m_PassOrders[key];
+			passOrder = { .Signature = m_OrderSignature };
+			SchedulePasses(passOrder);
+			it = m_PassOrders.find(key);
+		}
+
+		const PassOrder& passOrder = it->second;
+		m_Statistics.BarriersBeforeReordering = passOrder.BarriersBeforeReordering;
+		m_Statistics.BarriersAfterReordering = passOrder.BarriersAfterReordering;
+
+		size_t passCount = m_RenderPasses.size();
+		m_ReorderedPasses.clear();
+		for (size_t i = 0; i < passCount; i++)
+		{
+			m_ReorderedPasses.push_back(std::move(m_RenderPasses[passOrder.Order[i]]));
+			m_PassDeclarationIndices[i] = passOrder.Order[i];
+			m_CulledPasses[i] = i >= passCount - m_Statistics.CulledPassCount;
+		}
+		m_RenderPasses.swap(m_ReorderedPasses);
+	}
+
+	void RenderGraph::SchedulePasses(PassOrder& passOrder)
+	{
+		size_t passCount = m_RenderPasses.size();
+		struct PassAccess
+		{
+			void* Handle;
+			AccessInfo Info;
+			// Only used to keep the order, no barriers are synthesized for it
+			bool OrderingOnly;
+		};
+		std::vector<std::vector<PassAccess>> passAccesses(passCount);
+		std::vector<std::vector<uint32_t>> successors(passCount);
+		std::vector<uint32_t> predecessorCount(passCount, 0);
+
+		struct ResourceUsage
+		{
+			int32_t LastWriter = -1;
+			std::vector<uint32_t> Readers;
+		};
+		std::unordered_map<void*, ResourceUsage> usages;
+		// Passes without any declared resource are ordered against every other pass
+		void* undeclaredAccess = &usages;
+
+		auto addAccess = [&](std::vector<PassAccess>& accesses, void* handle, const AccessInfo& info, bool orderingOnly) {
+			if (!handle)
+				return;
+			for (auto& access : accesses)
+			{
+				if (access.Handle != handle)
+					continue;
+				access.Info.Write |= info.Write;
+				if (access.Info.Layout != info.Layout)
+					access.Info.Layout = ImageLayout::General;
+				return;
+			}
+			accesses.push_back({ handle, info, orderingOnly });
+		};
+
+		for (uint32_t i = 0; i < passCount; i++)
+		{
+			if (m_CulledPasses[i])
+				continue;
+			auto& pass = m_RenderPasses[i];
+			auto& accesses = passAccesses[i];
+			for (auto& resource : pass.Inputs)
+				addAccess(accesses, resource.Image ? resource.Image : resource.Buffer, GetAccessInfo(resource), false);
+			for (auto& resource : pass.Outputs)
+				addAccess(accesses, resource.Image ? resource.Image : resource.Buffer, GetAccessInfo(resource), false);
+			// Attachments are ordered by their view, layouts are already covered by the declared outputs
+			for (auto& attachment : pass.ColorAttachments)
+				addAccess(accesses, attachment.ImageView, { .Write = true }, true);
+			if (pass.DepthAttachment.has_value())
+				addAccess(accesses, pass.DepthAttachment->ImageView, { .Write = true }, true);
+			addAccess(accesses, undeclaredAccess, { .Write = accesses.empty() }, true);
+
+			for (auto& access : accesses)
+			{
+				ResourceUsage& usage = usages[access.Handle];
+				auto addEdge = [&](uint32_t from) {
+					if (from == i)
+						return;
+					successors[from].push_back(i);
+					predecessorCount[i]++;
+				};
+				if (usage.LastWriter >= 0)
+					addEdge((uint32_t)usage.LastWriter);
+				if (access.Info.Write)
+				{
+					for (uint32_t reader : usage.Readers)
+						addEdge(reader);
+					usage.Readers.clear();
+					usage.LastWriter = (int32_t)i;
+				}
+				else
+				{
+					usage.Readers.push_back(i);
+				}
+			}
+		}
+
+		// Barrier model of SynthesizeBarriers without stage tracking, enough to compare orders against each other
+		struct SimulatedState
+		{
+			ImageLayout Layout = ImageLayout::Undefined;
+			bool Written = false;
+			bool Read = false;
+		};
+		std::unordered_map<void*, SimulatedState> states;
+		auto resetStates = [&]() {
+			states.clear();
+			for (uint32_t i = 0; i < passCount; i++)
+			{
+				for (auto& access : passAccesses[i])
+				{
+					if (access.OrderingOnly)
+						continue;
+					auto it = m_ResourceStates.find(access.Handle);
+					states[access.Handle].Layout = it != m_ResourceStates.end() ? it->second.Layout : ImageLayout::Undefined;
+				}
+			}
+		};
+		auto simulatePass = [&](uint32_t passIndex, bool apply) {
+			uint32_t barrierCount = 0;
+			for (auto& access : passAccesses[passIndex])
+			{
+				if (access.OrderingOnly)
+					continue;
+				SimulatedState& state = states[access.Handle];
+				bool isImage = access.Info.Layout != ImageLayout::Undefined;
+				bool needsBarrier = (isImage && state.Layout != access.Info.Layout) || state.Written || (access.Info.Write && state.Read);
+				barrierCount += needsBarrier ? 1 : 0;
+				if (!apply)
+					continue;
+				if (needsBarrier)
+					state = { .Layout = isImage ? access.Info.Layout : state.Layout };
+				state.Written |= access.Info.Write;
+				state.Read |= !access.Info.Write;
+			}
+			return barrierCount;
+		};
+
+		resetStates();
+		for (uint32_t i = 0; i < passCount; i++)
+		{
+			if (!m_CulledPasses[i])
+				passOrder.BarriersBeforeReordering += simulatePass(i, true);
+		}
+
+		// List scheduling, the ready pass with the fewest barriers goes next and ties keep the declared order
+		std::vector<uint32_t> ready;
+		for (uint32_t i = 0; i < passCount; i++)
+		{
+			if (!m_CulledPasses[i] && predecessorCount[i] == 0)
+				ready.push_back(i);
+		}
+
+		resetStates();
+		std::vector<uint32_t>& order = passOrder.Order;
+		order.reserve(passCount);
+		PassQueue lastQueue = PassQueue::Graphics;
+		while (!ready.empty())
+		{
+			size_t best = 0;
+			uint32_t bestCost = UINT32_MAX;
+			for (size_t r = 0; r < ready.size(); r++)
+			{
+				// Switching queues splits the submission, which costs as much as a barrier
+				uint32_t cost = simulatePass(ready[r], false) + (m_RenderPasses[ready[r]].Queue != lastQueue ? 1 : 0);
+				if (cost < bestCost || (cost == bestCost && ready[r] < ready[best]))
+				{
+					best = r;
+					bestCost = cost;
+				}
+			}
+
+			uint32_t passIndex = ready[best];
+			ready.erase(ready.begin() + best);
+			passOrder.BarriersAfterReordering += simulatePass(passIndex, true);
+			lastQueue = m_RenderPasses[passIndex].Queue;
+			order.push_back(passIndex);
+
+			for (uint32_t successor : successors[passIndex])
+			{
+				if (--predecessorCount[successor] == 0)
+					ready.push_back(successor);
+			}
+		}
+
+		// Culled passes are moved to the end, they are skipped anyway
+		for (uint32_t i = 0; i < passCount; i++)
+		{
+			if (m_CulledPasses[i])
+				order.push_back(i);
+		}
+	}
+
+	GpuImage* RenderGraph::CreateTransientImage(const GpuImageDesc& desc)
+	{
+		AllocationScope allocationScope(m_FrameAllocationCount);
+		if (m_TransientImageCount == m_TransientImages.size())
+		{
+			m_TransientImages.push_back({ .Image = std::make_unique<GpuImage>() });
+		}
+
+		// Images are matched by request order, so a stable frame reuses the same images every frame
+		TransientImage& transient = m_TransientImages[m_TransientImageCount++];
+		if (!transient.Created || !IsSameImageDesc(transient.Desc, desc))
+		{
+			transient.Desc = desc;
+			RecreateTransientImage(transient);
+		}
+		return transient.Image.get();
+	}
+
+	HistoryImage* RenderGraph::CreateHistoryImage(const GpuImageDesc& desc, uint32_t versionCount)
+	{
+		if (versionCount < 2)
+			ARC_LOG_FATAL("History images need at least two versions!");
+
+		ResourceCache* resourceCache = m_Device->GetResourceCache();
+		auto historyImage = std::make_unique<HistoryImage>();
+		historyImage->m_Versions.resize(versionCount);
+		for (auto& version : historyImage->m_Versions)
+		{
+			version = std::make_unique<GpuImage>();
+			resourceCache->CreateGpuImage(version.get(), desc);
+			// Every version is read by a later frame
+			RetainResource(version->GetHandle());
+		}
+		m_HistoryImages.push_back(std::move(historyImage));
+		return m_HistoryImages.back().get();
+	}
+
+	void RenderGraph::ReleaseHistoryImage(HistoryImage* historyImage)
+	{
+		auto it = std::find_if(m_HistoryImages.begin(), m_HistoryImages.end(), [&](auto& image) { return image.get() == historyImage; });
+		if (it == m_HistoryImages.end())
+		{
+			ARC_LOG_ERROR("History image was not created by this render graph!");
+			return;
+		}
+
+		for (auto& version : historyImage->m_Versions)
+		{
+			ForgetResource(version->GetHandle());
+			m_RetiredTransients.push_back({ .Image = std::move(version), .Frame = m_FrameCount });
+		}
+		m_HistoryImages.erase(it);
+	}
+
+	void RenderGraph::ReleaseHistoryImages()
+	{
+		ResourceCache* resourceCache = m_Device->GetResourceCache();
+		for (auto& historyImage : m_HistoryImages)
+		{
+			for (auto& version : historyImage->m_Versions)
+			{
+				resourceCache->ReleaseResource(version.get());
+			}
+		}
+		m_HistoryImages.clear();
+	}
+
+	void RenderGraph::InvalidateHistory(HistoryImage* historyImage)
+	{
+		// Previous accesses are kept, so the transition still waits for frames that used the old contents
+		for (auto& version : historyImage->m_Versions)
+		{
+			auto state = m_ResourceStates.find(version->GetHandle());
+			if (state != m_ResourceStates.end())
+				state->second.Layout = ImageLayout::Undefined;
+		}
+		historyImage->m_HistoryLength = 0;
+	}
+
+	void RenderGraph::RecreateTransientImage(TransientImage& transient)
+	{
+		ResourceCache* resourceCache = m_Device->GetResourceCache();
+		if (transient.Bound)
+		{
+			// A bound image could still be used by frames in flight, so it is released once they have completed
+			RetiredTransient retired = {
+				.Image = std::make_unique<GpuImage>(),
+				.Allocation = transient.DedicatedAllocation,
+				.InHeap = !transient.DedicatedAllocation,
+				.Offset = transient.Offset,
+				.Size = transient.Requirements.Size,
+				.Frame = m_FrameCount
+			};
+			resourceCache->RetireTransientGpuImage(transient.Image.get(), retired.Image.get());
+			m_RetiredTransients.push_back(std::move(retired));
+			transient.DedicatedAllocation = nullptr;
+		}
+		else if (transient.Created)
+		{
+			resourceCache->ReleaseResource(transient.Image.get());
+		}
+		if (transient.DedicatedAllocation)
+		{
+			resourceCache->FreeMemory(transient.DedicatedAllocation);
+			transient.DedicatedAllocation = nullptr;
+		}
+
+		resourceCache->CreateTransientGpuImage(transient.Image.get(), transient.Desc);
+		transient.Requirements = resourceCache->GetMemoryRequirements(transient.Image.get());
+		transient.Created = true;
+		transient.Bound = false;
+	}
+
+	void RenderGraph::AllocateTransientImages()
+	{
+		if (m_TransientImages.empty())
+			return;
+
+		for (auto& transient : m_TransientImages)
+		{
+			transient.Used = false;
+		}
+		auto markUsage = [&](ArrayView<Resource> resources, uint32_t passIndex) {
+			for (auto& resource : resources)
+			{
+				if (!resource.Image)
+					continue;
+				for (uint32_t i = 0; i < m_TransientImageCount; i++)
+				{
+					TransientImage& transient = m_TransientImages[i];
+					if (transient.Image->GetHandle() != resource.Image)
+						continue;
+					if (!transient.Used)
+						transient.FirstPass = passIndex;
+					transient.LastPass = passIndex;
+					transient.Used = true;
+				}
+			}
+		};
+		for (uint32_t i = 0; i < m_RenderPasses.size(); i++)
+		{
+			if (m_CulledPasses[i])
+				continue;
+			markUsage(m_RenderPasses[i].Inputs, i);
+			markUsage(m_RenderPasses[i].Outputs, i);
+		}
+		markUsage(m_PresentPass.Inputs, (uint32_t)m_RenderPasses.size());
+
+		auto livesInHeap = [&](const TransientImage& transient) {
+			return transient.Bound && !transient.DedicatedAllocation;
+		};
+		auto overlaps = [](const TransientImage& a, const TransientImage& b) {
+			bool lifetimesOverlap = a.Used && b.Used && a.FirstPass <= b.LastPass && b.FirstPass <= a.LastPass;
+			bool memoryOverlaps = a.Offset < b.Offset + b.Requirements.Size && b.Offset < a.Offset + a.Requirements.Size;
+			return lifetimesOverlap && memoryOverlaps;
+		};
+
+		// Keep the current placement while it stays valid so images do not have to be recreated
+		bool replan = false;
+		for (size_t i = 0; i < m_TransientImages.size() && !replan; i++)
+		{
+			for (size_t j = i + 1; j < m_TransientImages.size() && !replan; j++)
+			{
+				TransientImage& a = m_TransientImages[i];
+				TransientImage& b = m_TransientImages[j];
+				replan = livesInHeap(a) && livesInHeap(b) && overlaps(a, b);
+			}
+		}
+
+		std::vector<std::pair<uint64_t, uint64_t>> occupied;
+		auto placeImage = [&](TransientImage& transient, auto&& isPlaced) {
+			occupied.clear();
+			for (auto& other : m_TransientImages)
+			{
+				bool lifetimesOverlap = transient.Used && other.Used && transient.FirstPass <= other.LastPass && other.FirstPass <= transient.LastPass;
+				if (&other != &transient && isPlaced(other) && lifetimesOverlap)
+					occupied.push_back({ other.Offset, other.Offset + other.Requirements.Size });
+			}
+			transient.Offset = FindAliasingOffset(occupied, transient.Requirements.Size, transient.Requirements.Alignment);
+		};
+
+		std::vector<TransientImage*> unbound;
+		for (auto& transient : m_TransientImages)
+		{
+			if (transient.Created && !transient.Bound)
+				unbound.push_back(&transient);
+		}
+		std::sort(unbound.begin(), unbound.end(), [](TransientImage* a, TransientImage* b) { return a->Requirements.Size > b->Requirements.Size; });
+
+		std::vector<TransientImage*> placed;
+		if (!replan)
+		{
+			for (TransientImage* transient : unbound)
+			{
+				if (m_TransientHeap && !(transient->Requirements.MemoryTypeBits & m_TransientHeapMemoryTypeBits))
+					continue;
+				placeImage(*transient, [&](const TransientImage& other) { return livesInHeap(other) || std::find(placed.begin(), placed.end(), &other) != placed.end(); });
+				if (transient->Offset + transient->Requirements.Size > m_TransientHeapSize)
+				{
+					replan = true;
+					break;
+				}
+				placed.push_back(transient);
+			}
+		}
+
+		ResourceCache* resourceCache = m_Device->GetResourceCache();
+		std::vector<std::pair<ImageHandle, ImageHandle>> recreatedImages;
+		if (replan)
+		{
+			// Place every image again, largest first, and grow the heap if needed
+			std::vector<TransientImage*> images;
+			uint32_t memoryTypeBits = ~0u;
+			for (auto& transient : m_TransientImages)
+			{
+				if (!transient.Created || transient.DedicatedAllocation)
+					continue;
+				if (!(transient.Requirements.MemoryTypeBits & memoryTypeBits))
+				{
+					// Moves to a dedicated allocation below
+					if (transient.Bound)
+					{
+						ImageHandle oldImage = transient.Image->GetHandle();
+						RecreateTransientImage(transient);
+						recreatedImages.push_back({ oldImage, transient.Image->GetHandle() });
+					}
+					continue;
+				}
+				memoryTypeBits &= transient.Requirements.MemoryTypeBits;
+				images.push_back(&transient);
+			}
+			std::sort(images.begin(), images.end(), [](TransientImage* a, TransientImage* b) { return a->Requirements.Size > b->Requirements.Size; });
+
+			std::vector<uint64_t> previousOffsets;
+			for (TransientImage* transient : images)
+			{
+				previousOffsets.push_back(transient->Offset);
+			}
+
+			placed.clear();
+			uint64_t heapSize = 0;
+			uint64_t heapAlignment = 1;
+			for (TransientImage* transient : images)
+			{
+				placeImage(*transient, [&](const TransientImage& other) { return std::find(placed.begin(), placed.end(), &other) != placed.end(); });
+				placed.push_back(transient);
+				heapSize = std::max(heapSize, transient->Offset + transient->Requirements.Size);
+				heapAlignment = std::max(heapAlignment, transient->Requirements.Alignment);
+			}
+
+			bool newHeap = heapSize > m_TransientHeapSize || (memoryTypeBits & m_TransientHeapMemoryTypeBits) != memoryTypeBits;
+
+			for (size_t i = 0; i < images.size(); i++)
+			{
+				TransientImage* transient = images[i];
+				if (transient->Bound && (newHeap || transient->Offset != previousOffsets[i]))
+				{
+					uint64_t offset = transient->Offset;
+					ImageHandle oldImage = transient->Image->GetHandle();
+					RecreateTransientImage(*transient);
+					transient->Offset = offset;
+					recreatedImages.push_back({ oldImage, transient->Image->GetHandle() });
+				}
+			}
+
+			if (newHeap)
+			{
+				// Every image in the old heap was recreated above, only frames in flight can still use it
+				for (auto& retired : m_RetiredTransients)
+				{
+					retired.InHeap = false;
+				}
+				if (m_TransientHeap)
+					m_RetiredTransients.push_back({ .Allocation = m_TransientHeap, .Frame = m_FrameCount });
+				m_TransientHeap = resourceCache->AllocateMemory(MemoryRequirements{
+					.Size = heapSize,
+					.Alignment = heapAlignment,
+					.MemoryTypeBits = memoryTypeBits
+				});
+				m_TransientHeapSize = heapSize;
+				m_TransientHeapMemoryTypeBits = memoryTypeBits;
+			}
+		}
+
+		for (TransientImage* transient : placed)
+		{
+			if (!transient->Bound)
+			{
+				resourceCache->BindTransientGpuImage(transient->Image.get(), transient->Desc, m_TransientHeap, transient->Offset);
+				transient->Bound = true;
+			}
+		}
+
+		// Images that cannot share the heap memory type get their own allocation
+		for (auto& transient : m_TransientImages)
+		{
+			if (transient.Created && !transient.Bound)
+			{
+				transient.DedicatedAllocation = resourceCache->AllocateMemory(transient.Requirements);
+				transient.Offset = 0;
+				resourceCache->BindTransientGpuImage(transient.Image.get(), transient.Desc, transient.DedicatedAllocation, 0);
+				transient.Bound = true;
+			}
+		}
+
+		// Declarations recorded this frame still reference the replaced images, they are patched in a copy in the execute arena
+		auto patchResources = [&](ArrayView<Resource>& resources) {
+			Resource* patched = nullptr;
+			for (size_t i = 0; i < resources.size(); i++)
+			{
+				for (auto& [oldImage, newImage] : recreatedImages)
+				{
+					if (resources[i].Image != oldImage)
+						continue;
+					if (!patched)
+						patched = m_ExecuteArena.Copy(resources.data(), resources.size());
+					patched[i].Image = newImage;
+				}
+			}
+			if (patched)
+				resources = ArrayView<Resource>(patched, resources.size());
+		};
+		if (!recreatedImages.empty())
+		{
+			for (auto& pass : m_RenderPasses)
+			{
+				patchResources(pass.Inputs);
+				patchResources(pass.Outputs);
+			}
+			patchResources(m_PresentPass.Inputs);
+		}
+	}
+
+	uint32_t RenderGraph::ResetAliasedImages(uint32_t passIndex, uint32_t queue, CompiledGraph& compiledGraph)
+	{
+		uint32_t waitQueues = 0;
+		for (auto& transient : m_TransientImages)
+		{
+			if (!transient.Used || transient.FirstPass != passIndex)
+				continue;
+
+			// Contents are discarded at first use, so the transition waits on every image that used the same memory
+			ResourceState state = {};
+			state.Queue = queue;
+			auto addPreviousAccess = [&](ImageHandle image) {
+				auto it = m_ResourceStates.find(image);
+				if (it == m_ResourceStates.end())
+					return;
+				// Partners that no pass declares are still in their entry state, the cached graph is only reused while it matches
+				auto& entryStates = compiledGraph.EntryStates;
+				if (std::find_if(entryStates.begin(), entryStates.end(), [&](auto& entry) { return entry.first == image; }) == entryStates.end())
+					entryStates.push_back({ image, it->second });
+				if (it->second.Queue != queue)
+				{
+					// Memory used on another queue is waited on with its timeline, the transition is chained to that wait
+					waitQueues |= 1u << it->second.Queue;
+					state.ReadStages |= VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+					return;
+				}
+				state.WriteStages |= it->second.WriteStages | it->second.ReadStages;
+				state.WriteAccess |= it->second.WriteAccess;
+			};
+			addPreviousAccess(transient.Image->GetHandle());
+			for (auto& other : m_TransientImages)
+			{
+				bool sharesMemory = !transient.DedicatedAllocation && !other.DedicatedAllocation && other.Bound &&
+					transient.Offset < other.Offset + other.Requirements.Size && other.Offset < transient.Offset + transient.Requirements.Size;
+				if (&other != &transient && sharesMemory)
+					addPreviousAccess(other.Image->GetHandle());
+			}
+			for (auto& retired : m_RetiredTransients)
+			{
+				bool sharesMemory = !transient.DedicatedAllocation && retired.Image && retired.InHeap &&
+					transient.Offset < retired.Offset + retired.Size && retired.Offset < transient.Offset + transient.Requirements.Size;
+				if (sharesMemory)
+					addPreviousAccess(retired.Image->GetHandle());
+			}
+			m_ResourceStates[transient.Image->GetHandle()] = state;
+		}
+		return waitQueues;
+	}
+
+	void RenderGraph::ReleaseRetiredTransients(bool all)
+	{
+		ResourceCache* resourceCache = m_Device->GetResourceCache();
+		uint32_t framesInFlight = m_Device->GetFramesInFlightCount();
+		std::erase_if(m_RetiredTransients, [&](RetiredTransient& retired) {
+			// Retired while building frame N, the fence of frame N - 1 is waited on before frame N - 1 + framesInFlight
+			if (!all && m_FrameCount + 1 < retired.Frame + framesInFlight)
+				return false;
+			if (retired.Image)
+				resourceCache->ReleaseResource(retired.Image.get());
+			if (retired.Allocation)
+				resourceCache->FreeMemory(retired.Allocation);
+			return true;
+		});
+	}
+
+	void RenderGraph::ReleaseTransientImages()
+	{
+		ReleaseRetiredTransients(true);
+		ResourceCache* resourceCache = m_Device->GetResourceCache();
+		for (auto& transient : m_TransientImages)
+		{
+			if (transient.Created)
+				resourceCache->ReleaseResource(transient.Image.get());
+			if (transient.DedicatedAllocation)
+				resourceCache->FreeMemory(transient.DedicatedAllocation);
+		}
+		m_TransientImages.clear();
+		m_TransientImageCount = 0;
+		if (m_TransientHeap)
+			resourceCache->FreeMemory(m_TransientHeap);
+		m_TransientHeap = nullptr;
+		m_TransientHeapSize = 0;
+		m_TransientHeapMemoryTypeBits = 0;
+	}
 
+	RenderGraph::TransientMemoryReport RenderGraph::GetTransientMemoryReport()
+	{
+		TransientMemoryReport report = {};
+		report.AliasedHeapBytes = m_TransientHeap ? m_TransientHeapSize : 0;
+		for (auto& transient : m_TransientImages)
+		{
+			if (!transient.Bound)
+				continue;
+			if (transient.DedicatedAllocation)
+			{
+				report.DedicatedImageCount++;
+				report.DedicatedBytes += transient.Requirements.Size;
+			}
+			else
+			{
+				report.AliasedImageCount++;
+				report.AliasedImageBytes += transient.Requirements.Size;
+			}
+		}
+		return report;
 	}
 
-	RenderGraph::~RenderGraph()
+	void RenderGraph::PrintTransientMemoryReport()
+	{
+		TransientMemoryReport report = GetTransientMemoryReport();
+		ARC_LOG("Transient images: {} aliased images taking {:.2f} MB share a {:.2f} MB heap, {} dedicated images taking {:.2f} MB",
+			report.AliasedImageCount, report.AliasedImageBytes / 1048576.0, report.AliasedHeapBytes / 1048576.0,
+			report.DedicatedImageCount, report.DedicatedBytes / 1048576.0);
+	}
+
+	void RenderGraph::SetPassTimings(bool enabled)
 	{
+		if (enabled == (m_PassTimer != nullptr))
+			return;
+		if (!enabled)
+		{
+			// Its queries can still be written by frames in flight
+			m_Device->WaitIdle();
+			m_PassTimer.reset();
+			return;
+		}
 
+		uint32_t familyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties((VkPhysicalDevice)m_Device->GetPhysicalDevice(), &familyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties((VkPhysicalDevice)m_Device->GetPhysicalDevice(), &familyCount, families.data());
+		m_TimestampQueues = 0;
+		for (uint32_t queue = 0; queue < QueueCount; queue++)
+		{
+			if (m_QueueFamilies[queue] < familyCount && families[m_QueueFamilies[queue]].timestampValidBits > 0)
+				m_TimestampQueues |= 1u << queue;
+		}
+		m_PassTimer = std::make_unique<PassTimer>(m_Device->GetLogicalDevice(), m_Device->GetPhysicalDevice(), m_Device->GetFramesInFlightCount(), MaxTimedPasses);
 	}
 
-	void RenderGraph::AddPass(const RenderPass& renderPass)
+	void RenderGraph::DumpGraph(const std::string& path)
 	{
-		m_BuildRenderPasses.push_back(renderPass);
+		if (!m_CompiledGraph)
+		{
+			ARC_LOG_WARNING("Render graph has to be built before it can be dumped!");
+			return;
+		}
+
+		std::vector<int32_t> passSubmissions(m_RenderPasses.size(), -1);
+		for (size_t i = 0; i < m_CompiledGraph->Submissions.size(); i++)
+		{
+			for (uint32_t passIndex : m_CompiledGraph->Submissions[i].Passes)
+			{
+				passSubmissions[passIndex] = (int32_t)i;
+			}
+		}
+		auto getPassName = [&](size_t passIndex) {
+			const char* name = m_RenderPasses[passIndex].Name;
+			return name ? EscapeName(name) : std::format("Pass {}", passIndex);
+		};
+		auto getPassTime = [&](size_t passIndex) {
+			return m_PassTimer ? m_PassTimer->GetPassTime(m_PassDeclarationIndices[passIndex]) : -1.0f;
+		};
+		auto getDispatchCount = [&](size_t passIndex) {
+			uint32_t declarationIndex = m_PassDeclarationIndices[passIndex];
+			return declarationIndex < m_PassDispatchCounts.size() ? m_PassDispatchCounts[declarationIndex] : 0;
+		};
+
+		std::string out;
+		auto output = std::back_inserter(out);
+		bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+		if (json)
+		{
+			auto writeResources = [&](const char* key, ArrayView<Resource> resources) {
+				std::format_to(output, "\"{}\": [", key);
+				for (size_t i = 0; i < resources.size(); i++)
+				{
+					const Resource& resource = resources[i];
+					std::format_to(output, "{}{{ \"handle\": \"{}\", \"type\": \"{}\", \"access\": \"{}\", \"stage\": \"0x{:x}\"",
+						i ? ", " : "", resource.Image ? resource.Image : resource.Buffer, resource.Image ? "image" : "buffer", GetAccessName(resource.Access), (uint32_t)resource.Stage);
+					if (resource.Image)
+						std::format_to(output, ", \"layout\": \"{}\"", GetLayoutName(GetAccessInfo(resource).Layout));
+					std::format_to(output, " }}");
+				}
+				std::format_to(output, "]");
+			};
+			auto writeBarriers = [&](const PassBarriers& barriers) {
+				std::format_to(output, "\"imageBarriers\": [");
+				for (size_t i = 0; i < barriers.ImageBarriers.size(); i++)
+				{
+					auto& barrier = barriers.ImageBarriers[i];
+					std::format_to(output, "{}{{ \"image\": \"{}\", \"oldLayout\": \"{}\", \"newLayout\": \"{}\", \"srcStages\": \"0x{:x}\", \"srcAccess\": \"0x{:x}\", \"dstStages\": \"0x{:x}\", \"dstAccess\": \"0x{:x}\", \"srcQueueFamily\": {}, \"dstQueueFamily\": {} }}",
+						i ? ", " : "", barrier.Handle, GetLayoutName(barrier.OldLayout), GetLayoutName(barrier.NewLayout), barrier.SrcStageMask, barrier.SrcAccessMask,
+						barrier.DstStageMask, barrier.DstAccessMask, (int32_t)barrier.SrcQueueFamily, (int32_t)barrier.DstQueueFamily);
+				}
+				std::format_to(output, "], \"bufferBarriers\": [");
+				for (size_t i = 0; i < barriers.BufferBarriers.size(); i++)
+				{
+					auto& barrier = barriers.BufferBarriers[i];
+					std::format_to(output, "{}{{ \"buffer\": \"{}\", \"srcStages\": \"0x{:x}\", \"srcAccess\": \"0x{:x}\", \"dstStages\": \"0x{:x}\", \"dstAccess\": \"0x{:x}\", \"srcQueueFamily\": {}, \"dstQueueFamily\": {} }}",
+						i ? ", " : "", barrier.Handle, barrier.SrcStageMask, barrier.SrcAccessMask, barrier.DstStageMask, barrier.DstAccessMask,
+						(int32_t)barrier.SrcQueueFamily, (int32_t)barrier.DstQueueFamily);
+				}
+				std::format_to(output, "]");
+			};
+
+			std::format_to(output, "{{\n\t\"frame\": {},\n\t\"resolutionScale\": {},\n", m_FrameCount, m_ResolutionScale);
+			std::format_to(output, "\t\"statistics\": {{ \"passCount\": {}, \"culledPassCount\": {}, \"dispatchCount\": {}, \"culledDispatchCount\": {}, \"barrierCount\": {}, \"allocationCount\": {} }},\n",
+				m_Statistics.PassCount, m_Statistics.CulledPassCount, m_Statistics.DispatchCount, m_Statistics.CulledDispatchCount, m_Statistics.BarrierCount, m_Statistics.AllocationCount);
+
+			std::format_to(output, "\t\"submissions\": [\n");
+			auto& submissions = m_CompiledGraph->Submissions;
+			for (size_t i = 0; i < submissions.size(); i++)
+			{
+				auto& submission = submissions[i];
+				std::format_to(output, "\t\t{{ \"queue\": \"{}\", \"passes\": [", GetQueueName(submission.Queue));
+				for (size_t p = 0; p < submission.Passes.size(); p++)
+				{
+					std::format_to(output, "{}{}", p ? ", " : "", submission.Passes[p]);
+				}
+				std::format_to(output, "], \"waitQueues\": [");
+				bool first = true;
+				for (uint32_t queue = 0; queue < QueueCount; queue++)
+				{
+					if (!(submission.WaitQueues & (1u << queue)))
+						continue;
+					std::format_to(output, "{}\"{}\"", first ? "" : ", ", GetQueueName(queue));
+					first = false;
+				}
+				std::format_to(output, "], \"release\": {{ ");
+				writeBarriers(submission.ReleaseBarriers);
+				std::format_to(output, " }} }}{}\n", i + 1 < submissions.size() ? "," : "");
+			}
+			std::format_to(output, "\t],\n\t\"passes\": [\n");
+
+			for (size_t i = 0; i < m_RenderPasses.size(); i++)
+			{
+				auto& pass = m_RenderPasses[i];
+				int32_t submission = passSubmissions[i];
+				std::format_to(output, "\t\t{{ \"index\": {}, \"name\": \"{}\", \"culled\": {}, \"queue\": \"{}\", \"submission\": {}, \"extentScale\": {}, \"dynamicResolution\": {}, \"dispatchCount\": {}, ",
+					i, getPassName(i), (bool)m_CulledPasses[i], submission >= 0 ? GetQueueName(m_CompiledGraph->Submissions[submission].Queue) : "None", submission,
+					pass.ExtentScale, pass.DynamicResolution, getDispatchCount(i));
+				float passTime = getPassTime(i);
+				if (passTime >= 0.0f)
+					std::format_to(output, "\"gpuTime\": {:.4f}, ", passTime);
+				else
+					std::format_to(output, "\"gpuTime\": null, ");
+
+				std::format_to(output, "\"colorAttachments\": [");
+				for (size_t a = 0; a < pass.ColorAttachments.size(); a++)
+				{
+					auto& attachment = pass.ColorAttachments[a];
+					std::format_to(output, "{}{{ \"view\": \"{}\", \"layout\": \"{}\", \"loadOp\": \"{}\" }}",
+						a ? ", " : "", attachment.ImageView, GetLayoutName(attachment.ImageLayout), GetLoadOpName(attachment.LoadOp));
+				}
+				std::format_to(output, "], ");
+				if (pass.DepthAttachment.has_value())
+					std::format_to(output, "\"depthAttachment\": {{ \"view\": \"{}\", \"layout\": \"{}\", \"loadOp\": \"{}\" }}, ",
+						pass.DepthAttachment->ImageView, GetLayoutName(pass.DepthAttachment->ImageLayout), GetLoadOpName(pass.DepthAttachment->LoadOp));
+
+				writeResources("inputs", pass.Inputs);
+				std::format_to(output, ", ");
+				writeResources("outputs", pass.Outputs);
+				std::format_to(output, ", ");
+				writeBarriers(m_CompiledGraph->Barriers[i]);
+				std::format_to(output, " }}{}\n", i + 1 < m_RenderPasses.size() ? "," : "");
+			}
+
+			std::format_to(output, "\t],\n\t\"present\": {{ \"enabled\": {}, ", m_PresentPass.ExecuteFunction != nullptr);
+			writeResources("inputs", m_PresentPass.Inputs);
+			std::format_to(output, ", ");
+			writeBarriers(m_CompiledGraph->PresentBarriers);
+			std::format_to(output, " }}\n}}\n");
+		}
+		else
+		{
+			// Resources are nodes between the passes, edges point in the direction data flows
+			std::format_to(output, "digraph RenderGraph {{\n\trankdir=LR;\n\tnode [fontname=\"Helvetica\", fontsize=10];\n\tedge [fontname=\"Helvetica\", fontsize=8];\n");
+			std::format_to(output, "\tlabel=\"Frame {}, {} passes, {} culled, {} dispatches, {} barriers\";\n",
+				m_FrameCount, m_Statistics.PassCount, m_Statistics.CulledPassCount, m_Statistics.DispatchCount, m_Statistics.BarrierCount);
+
+			std::vector<void*> resources;
+			auto writeResourceNodes = [&](ArrayView<Resource> declared) {
+				for (auto& resource : declared)
+				{
+					void* handle = resource.Image ? resource.Image : resource.Buffer;
+					if (!handle || std::find(resources.begin(), resources.end(), handle) != resources.end())
+						continue;
+					resources.push_back(handle);
+					std::format_to(output, "\t\"{}\" [shape=ellipse, label=\"{} {}\"];\n", handle, resource.Image ? "Image" : "Buffer", handle);
+				}
+			};
+			auto writePassNode = [&](size_t passIndex, const char* indent) {
+				auto& barriers = m_CompiledGraph->Barriers[passIndex];
+				std::format_to(output, "{}pass{} [shape=box, label=\"{}: {}\\n{} dispatches, {} barriers", indent, passIndex, passIndex, getPassName(passIndex),
+					getDispatchCount(passIndex), barriers.ImageBarriers.size() + barriers.BufferBarriers.size());
+				float passTime = getPassTime(passIndex);
+				if (passTime >= 0.0f)
+					std::format_to(output, "\\n{:.3f} ms", passTime);
+				std::format_to(output, "\"{}];\n", m_CulledPasses[passIndex] ? ", style=dashed, color=gray, fontcolor=gray" : "");
+			};
+
+			auto& submissions = m_CompiledGraph->Submissions;
+			for (size_t i = 0; i < submissions.size(); i++)
+			{
+				std::format_to(output, "\tsubgraph cluster_submission{} {{\n\t\tlabel=\"Submission {} ({})\";\n", i, i, GetQueueName(submissions[i].Queue));
+				for (uint32_t passIndex : submissions[i].Passes)
+				{
+					writePassNode(passIndex, "\t\t");
+				}
+				std::format_to(output, "\t}}\n");
+			}
+			for (size_t i = 0; i < m_RenderPasses.size(); i++)
+			{
+				if (passSubmissions[i] < 0)
+					writePassNode(i, "\t");
+			}
+			std::format_to(output, "\tpresent [shape=doubleoctagon, label=\"Present\\n{} barriers\"];\n",
+				m_CompiledGraph->PresentBarriers.ImageBarriers.size() + m_CompiledGraph->PresentBarriers.BufferBarriers.size());
+
+			for (size_t i = 0; i < m_RenderPasses.size(); i++)
+			{
+				auto& pass = m_RenderPasses[i];
+				writeResourceNodes(pass.Inputs);
+				writeResourceNodes(pass.Outputs);
+				for (auto& resource : pass.Inputs)
+				{
+					void* handle = resource.Image ? resource.Image : resource.Buffer;
+					if (handle)
+						std::format_to(output, "\t\"{}\" -> pass{} [label=\"{}\"];\n", handle, i, GetAccessName(resource.Access));
+				}
+				for (auto& resource : pass.Outputs)
+				{
+					void* handle = resource.Image ? resource.Image : resource.Buffer;
+					if (handle)
+						std::format_to(output, "\tpass{} -> \"{}\" [label=\"{}\"];\n", i, handle, GetAccessName(resource.Access));
+				}
+			}
+			writeResourceNodes(m_PresentPass.Inputs);
+			for (auto& resource : m_PresentPass.Inputs)
+			{
+				void* handle = resource.Image ? resource.Image : resource.Buffer;
+				if (handle)
+					std::format_to(output, "\t\"{}\" -> present [label=\"{}\"];\n", handle, GetAccessName(resource.Access));
+			}
+			std::format_to(output, "}}\n");
+		}
+
+		std::ofstream file(path);
+		if (!file)
+		{
+			ARC_LOG_ERROR("Failed to open {} for the render graph dump!", path);
+			return;
+		}
+		file << out;
+		ARC_LOG("Render graph dumped to {}", path);
 	}
 
-	void RenderGraph::SetPresentPass(const PresentPass& presentPass)
+	uint32_t RenderGraph::ResolveQueue(const RenderPass& renderPass)
 	{
-		m_BuildPresentPass = presentPass;
+		uint32_t queue = GraphicsQueue;
+		if (renderPass.Queue == PassQueue::AsyncCompute)
+			queue = ComputeQueue;
+		else if (renderPass.Queue == PassQueue::Transfer)
+			queue = TransferQueue;
+
+		if (queue != GraphicsQueue && (renderPass.ColorAttachments.size() != 0 || renderPass.DepthAttachment.has_value()))
+		{
+			ARC_LOG_WARNING("Pass with attachments can only run on the graphics queue!");
+			return GraphicsQueue;
+		}
+		// Without a dedicated family there is nothing to overlap with, so the pass stays on the graphics queue
+		return m_QueueFamilies[queue] == m_QueueFamilies[GraphicsQueue] ? GraphicsQueue : queue;
 	}
 
-	void RenderGraph::BuildGraph()
+	void RenderGraph::SynthesizeBarriers(ArrayView<Resource> inputs, ArrayView<Resource> outputs, PassBarriers& barriers, CompiledGraph& compiledGraph)
+	{
+		struct PassAccess
+		{
+			const Resource* Declaration;
+			AccessInfo Info;
+		};
+		std::vector<PassAccess> accesses;
+		accesses.reserve(inputs.size() + outputs.size());
+
+		// Merge every declaration of the same resource into a single access for this pass
+		auto addAccess = [&](const Resource& resource) {
+			void* handle = resource.Image ? resource.Image : resource.Buffer;
+			if (!handle)
+				return;
+
+			AccessInfo info = GetAccessInfo(resource);
+			for (auto& access : accesses)
+			{
+				void* accessHandle = access.Declaration->Image ? access.Declaration->Image : access.Declaration->Buffer;
+				if (accessHandle != handle)
+					continue;
+
+				if (resource.Image && access.Info.Layout != info.Layout)
+				{
+					ARC_LOG_WARNING("Image declared with different layouts in the same pass, using General!");
+					access.Info.Layout = ImageLayout::General;
+				}
+				access.Info.Stages |= info.Stages;
+				access.Info.Access |= info.Access;
+				access.Info.Write |= info.Write;
+				return;
+			}
+			accesses.push_back({ &resource, info });
+		};
+		for (auto& resource : inputs)
+			addAccess(resource);
+		for (auto& resource : outputs)
+			addAccess(resource);
+
+		// Release barriers go to the last submission on the source queue, a new one is added when it was used in an earlier frame
+		auto& submissions = compiledGraph.Submissions;
+		uint32_t queue = submissions.back().Queue;
+		auto getReleaseBarriers = [&](uint32_t sourceQueue) -> PassBarriers& {
+			for (size_t i = submissions.size() - 1; i-- > 0;)
+			{
+				if (submissions[i].Queue == sourceQueue)
+					return submissions[i].ReleaseBarriers;
+			}
+			submissions.insert(submissions.end() - 1, Submission{ .Queue = sourceQueue });
+			return submissions[submissions.size() - 2].ReleaseBarriers;
+		};
+
+		for (auto& [resource, info] : accesses)
+		{
+			bool isImage = resource->Image != nullptr;
+			ResourceState& state = m_ResourceStates[isImage ? resource->Image : resource->Buffer];
+
+			if (state.Queue != queue)
+			{
+				// The timeline wait orders this pass after the other queue and makes its writes available
+				submissions.back().WaitQueues |= 1u << state.Queue;
+
+				uint32_t srcFamily = m_QueueFamilies[state.Queue];
+				uint32_t dstFamily = m_QueueFamilies[queue];
+				bool keepContents = !isImage || state.Layout != ImageLayout::Undefined;
+				if (keepContents && srcFamily != dstFamily)
+				{
+					// Ownership transfer, the acquire waits on the same stages as the semaphore so the two are chained
+					PassBarriers& release = getReleaseBarriers(state.Queue);
+					if (isImage)
+					{
+						CommandBuffer::ImageSyncBarrier barrier = {
+							.Handle = resource->Image,
+							.Aspect = resource->Aspect,
+							.OldLayout = state.Layout,
+							.NewLayout = info.Layout,
+							.SrcStageMask = state.WriteStages | state.ReadStages,
+							.SrcAccessMask = state.WriteAccess,
+							.DstStageMask = VK_PIPELINE_STAGE_2_NONE,
+							.DstAccessMask = VK_ACCESS_2_NONE,
+							.SrcQueueFamily = srcFamily,
+							.DstQueueFamily = dstFamily
+						};
+						release.ImageBarriers.push_back(barrier);
+						barrier.SrcStageMask = info.Stages;
+						barrier.SrcAccessMask = VK_ACCESS_2_NONE;
+						barrier.DstStageMask = info.Stages;
+						barrier.DstAccessMask = info.Access;
+						barriers.ImageBarriers.push_back(barrier);
+					}
+					else
+					{
+						CommandBuffer::BufferSyncBarrier barrier = {
+							.Handle = resource->Buffer,
+							.SrcStageMask = state.WriteStages | state.ReadStages,
+							.SrcAccessMask = state.WriteAccess,
+							.DstStageMask = VK_PIPELINE_STAGE_2_NONE,
+							.DstAccessMask = VK_ACCESS_2_NONE,
+							.SrcQueueFamily = srcFamily,
+							.DstQueueFamily = dstFamily
+						};
+						release.BufferBarriers.push_back(barrier);
+						barrier.SrcStageMask = info.Stages;
+						barrier.SrcAccessMask = VK_ACCESS_2_NONE;
+						barrier.DstStageMask = info.Stages;
+						barrier.DstAccessMask = info.Access;
+						barriers.BufferBarriers.push_back(barrier);
+					}
+
+					state = {};
+					state.Layout = isImage ? info.Layout : ImageLayout::Undefined;
+					state.Queue = queue;
+					state.WriteStages = info.Stages;
+					state.WriteAccess = info.Write ? (info.Access & WriteAccessMask) : 0;
+					state.VisibleStages = info.Write ? 0 : info.Stages;
+					state.VisibleAccess = info.Write ? 0 : info.Access;
+					continue;
+				}
+
+				ImageLayout layout = state.Layout;
+				state = {};
+				state.Layout = layout;
+				state.Queue = queue;
+				// A layout transition has to be chained to the semaphore wait
+				if (isImage && layout != info.Layout)
+					state.ReadStages = info.Stages;
+			}
+
+			VkPipelineStageFlags2 srcStages = 0;
+			VkAccessFlags2 srcAccess = 0;
+			VkPipelineStageFlags2 dstStages = info.Stages;
+			VkAccessFlags2 dstAccess = info.Access;
+			bool needsBarrier = false;
+
+			if (isImage && state.Layout != info.Layout)
+			{
+				// Layout transitions are writes, so they wait on every previous access
+				srcStages = state.WriteStages | state.ReadStages;
+				srcAccess = state.WriteAccess;
+				needsBarrier = true;
+
+				ImageLayout oldLayout = state.Layout;
+				state = {};
+				state.Layout = info.Layout;
+				state.Queue = queue;
+				state.WriteStages = info.Stages;
+				state.WriteAccess = info.Write ? (info.Access & WriteAccessMask) : 0;
+				state.VisibleStages = info.Write ? 0 : info.Stages;
+				state.VisibleAccess = info.Write ? 0 : info.Access;
+
+				barriers.ImageBarriers.push_back({
+					.Handle = resource->Image,
+					.Aspect = resource->Aspect,
+					.OldLayout = oldLayout,
+					.NewLayout = info.Layout,
+					.SrcStageMask = srcStages,
+					.SrcAccessMask = srcAccess,
+					.DstStageMask = dstStages,
+					.DstAccessMask = dstAccess
+				});
+				continue;
+			}
+
+			if (info.Write)
+			{
+				if (state.ReadStages)
+				{
+					// Write after read only needs an execution dependency
+					srcStages = state.ReadStages;
+					needsBarrier = true;
+				}
+				else if (state.WriteStages)
+				{
+					srcStages = state.WriteStages;
+					srcAccess = state.WriteAccess;
+					needsBarrier = true;
+				}
+
+				state.WriteStages = info.Stages;
+				state.WriteAccess = info.Access & WriteAccessMask;
+				state.ReadStages = 0;
+				state.VisibleStages = 0;
+				state.VisibleAccess = 0;
+			}
+			else
+			{
+				bool visible = (state.VisibleStages & info.Stages) == info.Stages && (state.VisibleAccess & info.Access) == info.Access;
+				if (state.WriteStages && !visible)
+				{
+					// Widen the destination scope so previously visible stage/access pairs stay visible
+					srcStages = state.WriteStages;
+					srcAccess = state.WriteAccess;
+					dstStages |= state.VisibleStages;
+					dstAccess |= state.VisibleAccess;
+					needsBarrier = true;
+
+					state.VisibleStages = dstStages;
+					state.VisibleAccess = dstAccess;
+				}
+				state.ReadStages |= info.Stages;
+			}
+
+			if (!needsBarrier)
+				continue;
+
+			if (isImage)
+			{
+				barriers.ImageBarriers.push_back({
+					.Handle = resource->Image,
+					.Aspect = resource->Aspect,
+					.OldLayout = info.Layout,
+					.NewLayout = info.Layout,
+					.SrcStageMask = srcStages,
+					.SrcAccessMask = srcAccess,
+					.DstStageMask = dstStages,
+					.DstAccessMask = dstAccess
+				});
+			}
+			else
+			{
+				barriers.BufferBarriers.push_back({
+					.Handle = resource->Buffer,
+					.SrcStageMask = srcStages,
+					.SrcAccessMask = srcAccess,
+					.DstStageMask = dstStages,
+					.DstAccessMask = dstAccess
+				});
+			}
+		}
+	}
+
+	void RenderGraph::BuildSignature(std::vector<uint64_t>& signature)
+	{
+		signature.clear();
+		auto addResources = [&](ArrayView<Resource> resources) {
+			signature.push_back(resources.size());
+			for (auto& resource : resources)
+			{
+				signature.push_back((uint64_t)resource.Image);
+				signature.push_back((uint64_t)resource.Buffer);
+				signature.push_back((uint64_t)resource.Access);
+				signature.push_back((uint64_t)resource.Stage);
+				signature.push_back((uint64_t)resource.Layout);
+				signature.push_back((uint64_t)resource.Aspect);
+			}
+		};
+
+		signature.push_back(m_RenderPasses.size());
+		for (size_t i = 0; i < m_RenderPasses.size(); i++)
+		{
+			auto& pass = m_RenderPasses[i];
+			signature.push_back(m_CulledPasses[i]);
+			signature.push_back((uint64_t)pass.Queue);
+			signature.push_back(pass.ColorAttachments.size());
+			for (auto& attachment : pass.ColorAttachments)
+			{
+				signature.push_back((uint64_t)attachment.ImageView);
+				signature.push_back((uint64_t)attachment.ImageLayout);
+				signature.push_back((uint64_t)attachment.LoadOp);
+				signature.push_back((uint64_t)attachment.StoreOp);
+			}
+			signature.push_back(pass.DepthAttachment.has_value());
+			if (pass.DepthAttachment.has_value())
+			{
+				signature.push_back((uint64_t)pass.DepthAttachment->ImageView);
+				signature.push_back((uint64_t)pass.DepthAttachment->ImageLayout);
+				signature.push_back((uint64_t)pass.DepthAttachment->LoadOp);
+				signature.push_back((uint64_t)pass.DepthAttachment->StoreOp);
+			}
+			addResources(pass.Inputs);
+			addResources(pass.Outputs);
+		}
+		signature.push_back((uint64_t)m_PresentPass.LoadOp);
+		addResources(m_PresentPass.Inputs);
+
+		// The aliasing barriers depend on which images share memory in the transient heap
+		signature.push_back(m_TransientImages.size());
+		for (auto& transient : m_TransientImages)
+		{
+			signature.push_back(transient.Created ? (uint64_t)transient.Image->GetHandle() : 0);
+			signature.push_back(transient.Used);
+			signature.push_back(transient.FirstPass);
+			signature.push_back(transient.DedicatedAllocation != nullptr);
+			signature.push_back(transient.Offset);
+			signature.push_back(transient.Requirements.Size);
+		}
+		for (auto& retired : m_RetiredTransients)
+		{
+			if (!retired.Image || !retired.InHeap)
+				continue;
+			signature.push_back((uint64_t)retired.Image->GetHandle());
+			signature.push_back(retired.Offset);
+			signature.push_back(retired.Size);
+		}
+	}
+
+	bool RenderGraph::IsCompatible(const CompiledGraph& compiledGraph)
+	{
+		if (compiledGraph.Signature != m_Signature)
+			return false;
+
+		for (auto& [handle, entryState] : compiledGraph.EntryStates)
+		{
+			auto it = m_ResourceStates.find(handle);
+			const ResourceState& state = it != m_ResourceStates.end() ? it->second : ResourceState{};
+			if (!(state == entryState))
+				return false;
+		}
+		return true;
+	}
+
+	void RenderGraph::CompileGraph(CompiledGraph& compiledGraph)
 	{
-		m_RenderPasses.clear();
+		compiledGraph.Signature = m_Signature;
+		compiledGraph.Barriers.clear();
+		compiledGraph.Barriers.resize(m_RenderPasses.size());
+		compiledGraph.PresentBarriers = {};
+		compiledGraph.Submissions.clear();
+		compiledGraph.EntryStates.clear();
+		compiledGraph.ExitStates.clear();
+
+		auto addEntryStates = [&](ArrayView<Resource> resources) {
+			for (auto& resource : resources)
+			{
+				void* handle = resource.Image ? resource.Image : resource.Buffer;
+				if (!handle || std::find_if(compiledGraph.EntryStates.begin(), compiledGraph.EntryStates.end(), [&](auto& entry) { return entry.first == handle; }) != compiledGraph.EntryStates.end())
+					continue;
+
+				auto it = m_ResourceStates.find(handle);
+				compiledGraph.EntryStates.push_back({ handle, it != m_ResourceStates.end() ? it->second : ResourceState{} });
+			}
+		};
+		for (size_t i = 0; i < m_RenderPasses.size(); i++)
+		{
+			if (m_CulledPasses[i])
+				continue;
+			addEntryStates(m_RenderPasses[i].Inputs);
+			addEntryStates(m_RenderPasses[i].Outputs);
+		}
+		addEntryStates(m_PresentPass.Inputs);
+
+		auto& submissions = compiledGraph.Submissions;
+		auto beginSubmission = [&](uint32_t queue) -> Submission& {
+			if (submissions.empty() || submissions.back().Queue != queue)
+				submissions.push_back({ .Queue = queue });
+			return submissions.back();
+		};
+		for (size_t i = 0; i < m_RenderPasses.size(); i++)
+		{
+			if (m_CulledPasses[i])
+				continue;
+			uint32_t queue = ResolveQueue(m_RenderPasses[i]);
+			Submission& submission = beginSubmission(queue);
+			submission.Passes.push_back((uint32_t)i);
+			submission.WaitQueues |= ResetAliasedImages((uint32_t)i, queue, compiledGraph);
+			SynthesizeBarriers(m_RenderPasses[i].Inputs, m_RenderPasses[i].Outputs, compiledGraph.Barriers[i], compiledGraph);
+		}
+		beginSubmission(GraphicsQueue).WaitQueues |= ResetAliasedImages((uint32_t)m_RenderPasses.size(), GraphicsQueue, compiledGraph);
+		SynthesizeBarriers(m_PresentPass.Inputs, {}, compiledGraph.PresentBarriers, compiledGraph);
+
+		compiledGraph.ExitStates.reserve(compiledGraph.EntryStates.size());
+		for (auto& [handle, entryState] : compiledGraph.EntryStates)
+		{
+			compiledGraph.ExitStates.push_back({ handle, m_ResourceStates[handle] });
+		}
+	}
 
-		m_RenderPasses = m_BuildRenderPasses;
-		m_PresentPass = m_BuildPresentPass;
+	void RenderGraph::BuildGraph()
+	{
+		AllocationScope allocationScope(m_FrameAllocationCount);
 
+		// Swap instead of copy so the vectors and arenas keep their capacity between frames
+		m_RenderPasses.swap(m_BuildRenderPasses);
 		m_BuildRenderPasses.clear();
+		m_PresentPass = std::move(m_BuildPresentPass);
 		m_BuildPresentPass = {};
+		std::swap(m_ExecuteArena, m_BuildArena);
+		m_BuildArena.Reset();
+
+		m_PassDeclarationIndices.resize(m_RenderPasses.size());
+		std::iota(m_PassDeclarationIndices.begin(), m_PassDeclarationIndices.end(), 0u);
+		CullPasses();
+		m_Statistics = {};
+		m_Statistics.PassCount = (uint32_t)m_RenderPasses.size();
+		m_Statistics.CulledPassCount = (uint32_t)std::count(m_CulledPasses.begin(), m_CulledPasses.end(), true);
+		if (m_PassReordering)
+			ReorderPasses();
+
+		AllocateTransientImages();
+		m_TransientImageCount = 0;
+
+		BuildSignature(m_Signature);
+		uint64_t key = HashSignature(m_Signature);
+
+		auto it = m_CompiledGraphs.find(key);
+		if (it != m_CompiledGraphs.end() && IsCompatible(it->second))
+		{
+			m_CompiledGraph = &it->second;
+			for (auto& [handle, exitState] : m_CompiledGraph->ExitStates)
+			{
+				m_ResourceStates[handle] = exitState;
+			}
+			return;
+		}
+
+		// Graphs that keep changing (for example resized images) would otherwise grow the cache forever
+		if (it == m_CompiledGraphs.end() && m_CompiledGraphs.size() >= MaxCompiledGraphs)
+		{
+			m_CompiledGraphs.clear();
+		}
+		m_CompiledGraph = &m_CompiledGraphs[key];
+		CompileGraph(*m_CompiledGraph);
+	}
+
+	void RenderGraph::EnableDynamicResolution(const DynamicResolutionDesc& desc)
+	{
+		if (m_DynamicResolution)
+		{
+			m_DynamicResolution->SetDesc(desc);
+			return;
+		}
+		m_DynamicResolution = std::make_unique<DynamicResolution>(m_Device->GetLogicalDevice(), m_Device->GetPhysicalDevice(), m_Device->GetFramesInFlightCount(), desc);
+		m_ResolutionScale = m_DynamicResolution->GetScale();
+	}
+
+	void RenderGraph::DisableDynamicResolution()
+	{
+		if (!m_DynamicResolution)
+			return;
+		// Its queries can still be written by frames in flight
+		m_Device->WaitIdle();
+		m_DynamicResolution.reset();
+		m_ResolutionScale = 1.0f;
+	}
+
+	void RenderGraph::GetScaledExtent(const uint32_t outputExtent[2], float extentScale, bool dynamicResolution, uint32_t scaledExtent[2])
+	{
+		float scale = extentScale * (dynamicResolution ? m_ResolutionScale : 1.0f);
+		scaledExtent[0] = std::max(1u, (uint32_t)std::ceil(outputExtent[0] * scale));
+		scaledExtent[1] = std::max(1u, (uint32_t)std::ceil(outputExtent[1] * scale));
+	}
+
+	void RenderGraph::RecordPass(CommandBuffer* cmd, size_t passIndex, bool timed, uint32_t frameIndex, const uint32_t extent[2])
+	{
+		auto& pass = m_RenderPasses[passIndex];
+		uint32_t dispatchCount = cmd->GetDispatchCount();
+		// Barriers of the pass are part of its time
+		// Counts and timings are kept per declaration index, the position changes with the reordering
+		uint32_t declarationIndex = m_PassDeclarationIndices[passIndex];
+		if (timed)
+			m_PassTimer->BeginPass(cmd, frameIndex, declarationIndex);
+		cmd->PipelineBarrier(m_CompiledGraph->Barriers[passIndex].ImageBarriers, m_CompiledGraph->Barriers[passIndex].BufferBarriers);
+
+		uint32_t passExtent[2];
+		GetScaledExtent(extent, pass.ExtentScale, pass.DynamicResolution, passExtent);
+		bool scaled = passExtent[0] != extent[0] || passExtent[1] != extent[1];
+		if (scaled)
+		{
+			cmd->SetViewport(passExtent);
+			cmd->SetScissors(passExtent);
+		}
+
+		// Color only and depth only passes render as well
+		bool hasAttachments = pass.ColorAttachments.size() != 0 || pass.DepthAttachment.has_value();
+		if (hasAttachments)
+		{
+			cmd->BeginRendering(pass.ColorAttachments, pass.DepthAttachment, passExtent);
+			pass.ExecuteFunction(cmd, frameIndex);
+			cmd->EndRendering();
+		}
+		else
+		{
+			pass.ExecuteFunction(cmd, frameIndex);
+		}
+		m_PassDispatchCounts[declarationIndex] = cmd->GetDispatchCount() - dispatchCount;
+		if (timed)
+			m_PassTimer->EndPass(cmd, frameIndex, declarationIndex);
+
+		if (scaled)
+		{
+			cmd->SetViewport(extent);
+			cmd->SetScissors(extent);
+		}
+	}
+
+	void RenderGraph::RecordPasses(CommandBuffer* cmd, const std::vector<uint32_t>& passes, uint32_t queue, uint32_t frameIndex, const uint32_t extent[2])
+	{
+		bool timed = m_PassTimer && (m_TimestampQueues & (1u << queue));
+		// Secondary command buffers are only recorded from graphics pools
+		bool allowThreads = queue == GraphicsQueue;
+		size_t rangeCount = m_MultithreadedRecording && allowThreads ? passes.size() / MinPassesPerRecordingThread : 0;
+		if (rangeCount > 1 && !m_ThreadPool)
+			m_ThreadPool = std::make_unique<ThreadPool>();
+		if (m_ThreadPool)
+			rangeCount = std::min<size_t>(rangeCount, m_ThreadPool->GetThreadCount() + 1);
+
+		if (rangeCount <= 1)
+		{
+			for (uint32_t passIndex : passes)
+			{
+				RecordPass(cmd, passIndex, timed, frameIndex, extent);
+			}
+			return;
+		}
+
+		if (m_PassRecorders.size() <= frameIndex)
+			m_PassRecorders.resize(frameIndex + 1);
+
+		// Pools are per frame in flight, the frame fence guarantees their previous commands have completed
+		auto& recorders = m_PassRecorders[frameIndex];
+		while (recorders.size() < m_UsedPassRecorders + rangeCount)
+		{
+			VkCommandPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			poolInfo.queueFamilyIndex = m_QueueFamilies[GraphicsQueue];
+
+			VkCommandPool commandPool;
+			VK_CHECK(vkCreateCommandPool((VkDevice)m_Device->GetLogicalDevice(), &poolInfo, nullptr, &commandPool));
+			recorders.push_back({
+				.CommandPool = commandPool,
+				.CommandBuffer = std::make_unique<CommandBuffer>(m_Device->GetLogicalDevice(), commandPool, true)
+			});
+		}
+
+		// Culled passes are not part of the submission, so ranges hold the same number of executed passes
+		auto recordRange = [this, &passes, timed, frameIndex, extent](PassRecorder& recorder, size_t firstPass, size_t lastPass) {
+			VK_CHECK(vkResetCommandPool((VkDevice)m_Device->GetLogicalDevice(), (VkCommandPool)recorder.CommandPool, 0));
+			CommandBuffer* cmd = recorder.CommandBuffer.get();
+			cmd->BeginSecondary();
+			cmd->SetViewport(extent);
+			cmd->SetScissors(extent);
+			for (size_t i = firstPass; i < lastPass; i++)
+			{
+				RecordPass(cmd, passes[i], timed, frameIndex, extent);
+			}
+			cmd->End();
+		};
+
+		m_SecondaryCommandBuffers.clear();
+		for (size_t range = 0; range < rangeCount; range++)
+		{
+			size_t firstPass = passes.size() * range / rangeCount;
+			size_t lastPass = passes.size() * (range + 1) / rangeCount;
+
+			// The calling thread records the last range instead of idling
+			PassRecorder& recorder = recorders[m_UsedPassRecorders + range];
+			if (range + 1 < rangeCount)
+				m_ThreadPool->Submit([&recordRange, &recorder, firstPass, lastPass]() { recordRange(recorder, firstPass, lastPass); });
+			else
+				recordRange(recorder, firstPass, lastPass);
+
+			m_SecondaryCommandBuffers.push_back(recorder.CommandBuffer->GetHandle());
+		}
+		m_ThreadPool->Wait();
+		m_UsedPassRecorders += (uint32_t)rangeCount;
+
+		cmd->ExecuteCommands(m_SecondaryCommandBuffers);
+		// Dynamic state is undefined in the primary after executing secondary command buffers
+		cmd->SetViewport(extent);
+		cmd->SetScissors(extent);
+	}
+
+	CommandBuffer* RenderGraph::AcquireQueueCommandBuffer(uint32_t frameIndex, uint32_t queue)
+	{
+		QueueCommandBuffers& queueCommandBuffers = m_QueueCommandBuffers[frameIndex][queue];
+		if (!queueCommandBuffers.CommandPool)
+		{
+			VkCommandPoolCreateInfo poolInfo{};
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			poolInfo.queueFamilyIndex = m_QueueFamilies[queue];
+
+			VkCommandPool commandPool;
+			VK_CHECK(vkCreateCommandPool((VkDevice)m_Device->GetLogicalDevice(), &poolInfo, nullptr, &commandPool));
+			queueCommandBuffers.CommandPool = commandPool;
+		}
+
+		if (queueCommandBuffers.UsedCount == queueCommandBuffers.CommandBuffers.size())
+			queueCommandBuffers.CommandBuffers.push_back(std::make_unique<CommandBuffer>(m_Device->GetLogicalDevice(), queueCommandBuffers.CommandPool));
+		return queueCommandBuffers.CommandBuffers[queueCommandBuffers.UsedCount++].get();
+	}
+
+	void RenderGraph::SubmitQueueCommandBuffer(CommandBuffer* cmd, const Submission& submission, uint64_t prologueValue)
+	{
+		VkSemaphoreSubmitInfo waitSemaphoreInfos[QueueCount] = {};
+		uint32_t waitSemaphoreCount = 0;
+		for (uint32_t queue = 0; queue < QueueCount; queue++)
+		{
+			// Waiting on the latest graphics value covers the prologue as well
+			bool waitsOnPrologue = queue == GraphicsQueue && prologueValue != 0;
+			if (!(submission.WaitQueues & (1u << queue)) && !waitsOnPrologue)
+				continue;
+			VkSemaphoreSubmitInfo& info = waitSemaphoreInfos[waitSemaphoreCount++];
+			info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+			info.semaphore = (VkSemaphore)m_TimelineSemaphores[queue];
+			info.value = submission.WaitQueues & (1u << queue) ? m_TimelineValues[queue] : prologueValue;
+			info.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		}
+
+		VkSemaphoreSubmitInfo signalSemaphoreInfo = {};
+		signalSemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+		signalSemaphoreInfo.semaphore = (VkSemaphore)m_TimelineSemaphores[submission.Queue];
+		signalSemaphoreInfo.value = ++m_TimelineValues[submission.Queue];
+		signalSemaphoreInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+		VkCommandBufferSubmitInfo commandBufferInfo = {};
+		commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+		commandBufferInfo.commandBuffer = (VkCommandBuffer)cmd->GetHandle();
+
+		VkSubmitInfo2 submitInfo2 = {};
+		submitInfo2.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+		submitInfo2.waitSemaphoreInfoCount = waitSemaphoreCount;
+		submitInfo2.pWaitSemaphoreInfos = waitSemaphoreInfos;
+		submitInfo2.commandBufferInfoCount = 1;
+		submitInfo2.pCommandBufferInfos = &commandBufferInfo;
+		submitInfo2.signalSemaphoreInfoCount = 1;
+		submitInfo2.pSignalSemaphoreInfos = &signalSemaphoreInfo;
+		VK_CHECK(vkQueueSubmit2((VkQueue)m_Queues[submission.Queue], 1, &submitInfo2, VK_NULL_HANDLE));
+	}
+
+	void RenderGraph::BeginFrame(uint32_t frameIndex)
+	{
+		if (m_TimelineSemaphores[GraphicsQueue] == nullptr)
+			return;
+		if (m_QueueCommandBuffers.size() <= frameIndex)
+			m_QueueCommandBuffers.resize(frameIndex + 1);
+
+		// Submissions to other queues are not covered by the frame fence
+		for (uint32_t queue = 0; queue < QueueCount; queue++)
+		{
+			QueueCommandBuffers& queueCommandBuffers = m_QueueCommandBuffers[frameIndex][queue];
+			if (queueCommandBuffers.UsedCount == 0)
+				continue;
+
+			VkSemaphore semaphore = (VkSemaphore)m_TimelineSemaphores[queue];
+			VkSemaphoreWaitInfo waitInfo = {};
+			waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+			waitInfo.semaphoreCount = 1;
+			waitInfo.pSemaphores = &semaphore;
+			waitInfo.pValues = &queueCommandBuffers.TimelineValue;
+			VK_CHECK(vkWaitSemaphores((VkDevice)m_Device->GetLogicalDevice(), &waitInfo, UINT64_MAX));
+			VK_CHECK(vkResetCommandPool((VkDevice)m_Device->GetLogicalDevice(), (VkCommandPool)queueCommandBuffers.CommandPool, 0));
+			queueCommandBuffers.UsedCount = 0;
+		}
 	}
 
 	void RenderGraph::Execute(FrameData frameData, const uint32_t extent[2])
 	{
 		auto& cmd = frameData.CommandBuffer;
+		uint64_t allocationCount = GetAllocationCount();
+
+		// BuildGraph already moved the tracked states to the end of the frame. A frame dropped because the swapchain
+		// is out of date never reaches the GPU, so nothing is recorded and the states go back to where the frame started.
+		if (frameData.Queue->OutOfDate())
+		{
+			for (auto& [handle, entryState] : m_CompiledGraph->EntryStates)
+			{
+				m_ResourceStates[handle] = entryState;
+			}
+			m_FrameAllocationCount = 0;
+			return;
+		}
+
+		ReleaseRetiredTransients(false);
+		if (m_DynamicResolution)
+			m_DynamicResolution->BeginFrame(cmd, frameData.FrameIndex);
+
+		// Submissions before the last one would run ahead of the work already recorded into the frame command buffer
+		// (moved resources, frame timestamps), so that work is submitted first and recording continues in a second buffer
+		auto& submissions = m_CompiledGraph->Submissions;
+		uint64_t prologueValue = 0;
+		if (submissions.size() > 1)
+		{
+			prologueValue = ++m_TimelineValues[GraphicsQueue];
+			cmd = frameData.Queue->SubmitRecordedWork(m_TimelineSemaphores[GraphicsQueue], prologueValue);
+		}
 
 		cmd->SetViewport(extent);
 		cmd->SetScissors(extent);
 
-		for (auto& pass : m_RenderPasses)
+		if (m_PassDispatchCounts.size() < m_RenderPasses.size())
+			m_PassDispatchCounts.resize(m_RenderPasses.size());
+		m_UsedPassRecorders = 0;
+
+		bool useTimelines = m_TimelineSemaphores[GraphicsQueue] != nullptr;
+		// Every queue has finished the previous frame with this index at this point, BeginFrame waited for it
+		if (m_PassTimer)
+			m_PassTimer->BeginFrame(frameData.FrameIndex, (uint32_t)m_RenderPasses.size());
+
+		for (size_t i = 0; i + 1 < submissions.size(); i++)
 		{
-			bool hasAttachments = pass.ColorAttachments.size() != 0 && pass.DepthAttachment.has_value();
-			if (hasAttachments)
+			const Submission& submission = submissions[i];
+			bool isGraphics = submission.Queue == GraphicsQueue;
+
+			CommandBuffer* queueCmd = AcquireQueueCommandBuffer(frameData.FrameIndex, submission.Queue);
+			queueCmd->Begin();
+			if (isGraphics)
 			{
-				cmd->BeginRendering(pass.ColorAttachments, pass.DepthAttachment, extent);
-				pass.ExecuteFunction(frameData.CommandBuffer, frameData.FrameIndex);
-				cmd->EndRendering();
+				queueCmd->SetViewport(extent);
+				queueCmd->SetScissors(extent);
 			}
-			else
+			RecordPasses(queueCmd, submission.Passes, submission.Queue, frameData.FrameIndex, extent);
+			queueCmd->PipelineBarrier(submission.ReleaseBarriers.ImageBarriers, submission.ReleaseBarriers.BufferBarriers);
+			queueCmd->End();
+
+			SubmitQueueCommandBuffer(queueCmd, submission, prologueValue);
+			m_QueueCommandBuffers[frameData.FrameIndex][submission.Queue].TimelineValue = m_TimelineValues[submission.Queue];
+		}
+
+		// The last submission is on the graphics queue and recorded into the frame command buffer
+		const Submission& frameSubmission = submissions.back();
+		RecordPasses(cmd, frameSubmission.Passes, GraphicsQueue, frameData.FrameIndex, extent);
+		if (useTimelines)
+		{
+			for (uint32_t queue = 0; queue < QueueCount; queue++)
 			{
-				pass.ExecuteFunction(frameData.CommandBuffer, frameData.FrameIndex);
+				if (frameSubmission.WaitQueues & (1u << queue))
+					frameData.Queue->AddWaitSemaphore(m_TimelineSemaphores[queue], m_TimelineValues[queue], VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
 			}
+			// Always signaled, later frames can start on other queues with resources last used on graphics
+			frameData.Queue->AddSignalSemaphore(m_TimelineSemaphores[GraphicsQueue], ++m_TimelineValues[GraphicsQueue], VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
 		}
 
-		ImageLayout presentImageLayout = ImageLayout::Undefined;
+		m_Statistics.BarrierCount = (uint32_t)(m_CompiledGraph->PresentBarriers.ImageBarriers.size() + m_CompiledGraph->PresentBarriers.BufferBarriers.size());
+		for (auto& submission : submissions)
+		{
+			m_Statistics.BarrierCount += (uint32_t)(submission.ReleaseBarriers.ImageBarriers.size() + submission.ReleaseBarriers.BufferBarriers.size());
+			for (uint32_t passIndex : submission.Passes)
+			{
+				auto& barriers = m_CompiledGraph->Barriers[passIndex];
+				m_Statistics.BarrierCount += (uint32_t)(barriers.ImageBarriers.size() + barriers.BufferBarriers.size());
+			}
+		}
+		for (size_t i = 0; i < m_RenderPasses.size(); i++)
+		{
+			if (m_CulledPasses[i])
+				m_Statistics.CulledDispatchCount += m_PassDispatchCounts[m_PassDeclarationIndices[i]];
+			else
+				m_Statistics.DispatchCount += m_PassDispatchCounts[m_PassDeclarationIndices[i]];
+		}
+
+		// Swapchain image is acquired with a semaphore wait on color attachment output
+		CommandBuffer::ImageSyncBarrier presentBarrier = {
+			.Handle = frameData.PresentImage,
+			.Aspect = ImageAspect::Color,
+			.OldLayout = ImageLayout::Undefined,
+			.NewLayout = ImageLayout::PresentSrc,
+			.SrcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+			.SrcAccessMask = VK_ACCESS_2_NONE,
+			.DstStageMask = VK_PIPELINE_STAGE_2_NONE,
+			.DstAccessMask = VK_ACCESS_2_NONE
+		};
 		if (m_PresentPass.ExecuteFunction != nullptr) 
 		{
-			cmd->TransitionImage(frameData.PresentImage, ImageLayout::Undefined, ImageLayout::TransferSrcOptimal);
-			presentImageLayout = ImageLayout::TransferSrcOptimal;
+			// The compiled graph is shared by every frame that reuses it, the swapchain barrier is added to a copy
+			auto& imageBarriers = m_PresentImageBarriers;
+			imageBarriers.assign(m_CompiledGraph->PresentBarriers.ImageBarriers.begin(), m_CompiledGraph->PresentBarriers.ImageBarriers.end());
+			imageBarriers.push_back(presentBarrier);
+			imageBarriers.back().NewLayout = ImageLayout::AttachmentOptimal;
+			imageBarriers.back().DstStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+			imageBarriers.back().DstAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+			if (m_PresentPass.LoadOp == AttachmentLoadOp::Load)
+				imageBarriers.back().DstAccessMask |= VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT;
+			cmd->PipelineBarrier(imageBarriers, m_CompiledGraph->PresentBarriers.BufferBarriers);
+
 			cmd->BeginRendering({
 				Arc::ColorAttachment{
 				.ImageView = frameData.PresentImageView,
@@ -71,7 +2134,27 @@ namespace Arc
 				}, { }, extent);
 			m_PresentPass.ExecuteFunction(frameData.CommandBuffer, frameData.FrameIndex);
 			cmd->EndRendering();
+
+			presentBarrier.OldLayout = ImageLayout::AttachmentOptimal;
+			presentBarrier.SrcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+		}
+		cmd->PipelineBarrier({ presentBarrier }, {});
+
+		// Passes of the next frame are declared with the new scale
+		if (m_DynamicResolution)
+		{
+			m_DynamicResolution->EndFrame(cmd, frameData.FrameIndex);
+			m_ResolutionScale = m_DynamicResolution->GetScale();
+		}
+		for (auto& historyImage : m_HistoryImages)
+		{
+			uint32_t versionCount = historyImage->GetVersionCount();
+			historyImage->m_Current = (historyImage->m_Current + 1) % versionCount;
+			historyImage->m_HistoryLength = std::min(historyImage->m_HistoryLength + 1, versionCount - 1);
 		}
-		cmd->TransitionImage(frameData.PresentImage, presentImageLayout, ImageLayout::PresentSrc);
+		m_FrameCount++;
+
+		m_Statistics.AllocationCount = (uint32_t)(m_FrameAllocationCount + GetAllocationCount() - allocationCount);
+		m_FrameAllocationCount = 0;
 	}
 }
\ No newline at end of file
@@ -2,50 +2,385 @@
 #include "VulkanCore/VulkanHandles.h"
 #include "CommandBuffer.h"
 #include "PresentQueue.h"
-#include <functional>
+#include "ResourceCache.h"
+#include "DynamicResolution.h"
+#include "PassTimer.h"
+#include "ArcaneEngine/Core/ThreadPool.h"
+#include "ArcaneEngine/Core/ArrayView.h"
+#include "ArcaneEngine/Core/InlineFunction.h"
+#include "ArcaneEngine/Core/LinearAllocator.h"
+#include <string>
+#include <unordered_map>
 
 namespace Arc
 {
+	class Device;
 
+	enum class ResourceAccess
+	{
+		UniformRead,
+		StorageRead,
+		StorageWrite,
+		StorageReadWrite,
+		SampledRead,
+		ColorAttachmentWrite,
+		DepthAttachmentRead,
+		DepthAttachmentWrite,
+		TransferRead,
+		TransferWrite,
+		VertexBufferRead,
+		IndexBufferRead,
+		IndirectRead,
+		AccelerationStructureRead,
+	};
+
+	// Either Image or Buffer is set. Layout is only used for images, Undefined picks the default layout for the access.
 	struct Resource
 	{
+		ImageHandle Image = nullptr;
+		BufferHandle Buffer = nullptr;
+		ResourceAccess Access = ResourceAccess::SampledRead;
+		ShaderStage Stage = ShaderStage::Compute;
+		ImageLayout Layout = ImageLayout::Undefined;
+		ImageAspect Aspect = ImageAspect::Color;
+	};
 
+	// Queue the pass is submitted to, falls back to graphics when the device has no dedicated queue family for it
+	enum class PassQueue
+	{
+		Graphics,
+		AsyncCompute,
+		Transfer,
 	};
 
+	// Stored inline in passes, captures larger than the capacity fail to compile
+	using PassFunction = InlineFunction<void(CommandBuffer* cb, uint32_t frameIndex), 96>;
+
+	// Arrays only have to stay valid until the pass is added, the graph copies them into memory owned by the frame
 	struct RenderPass
 	{
-		std::vector<ColorAttachment> ColorAttachments = {};
+		// Only used to identify the pass in graph dumps, has to outlive the frame (usually a string literal)
+		const char* Name = nullptr;
+		ArrayView<ColorAttachment> ColorAttachments = {};
 		std::optional<DepthAttachment> DepthAttachment = {};
-		std::function<void(CommandBuffer* cb, uint32_t frameIndex)> ExecuteFunction = nullptr;
+		PassFunction ExecuteFunction = nullptr;
+		PassQueue Queue = PassQueue::Graphics;
+		// Render area relative to the output extent, dynamic resolution passes are also scaled by the resolution scale
+		float ExtentScale = 1.0f;
+		bool DynamicResolution = false;
 
-		std::vector<Resource> Inputs = {};
-		std::vector<Resource> Outputs = {};
+		ArrayView<Resource> Inputs = {};
+		ArrayView<Resource> Outputs = {};
 	};
 
 	struct PresentPass
 	{
 		AttachmentLoadOp LoadOp = AttachmentLoadOp::DontCare;
 		std::array<float, 4> ClearColor = {};
-		std::function<void(CommandBuffer* cb, uint32_t frameIndex)> ExecuteFunction = nullptr;
+		PassFunction ExecuteFunction = nullptr;
 
-		std::vector<Resource> Inputs = {};
+		ArrayView<Resource> Inputs = {};
+	};
+
+	// Image with one version per frame of history owned by the render graph. The current version is written this frame,
+	// older versions hold the results of previous frames. Versions rotate at the end of RenderGraph::Execute.
+	class HistoryImage
+	{
+	public:
+		GpuImage* GetCurrent() { return GetVersion(0); }
+		GpuImage* GetPrevious() { return GetVersion(1); }
+		GpuImage* GetVersion(uint32_t age) { return m_Versions[GetVersionIndex(age)].get(); }
+		// Index of the version with the given age, stays with the image while it ages. Used to select resources created per version.
+		uint32_t GetVersionIndex(uint32_t age) { return (m_Current + GetVersionCount() - age % GetVersionCount()) % GetVersionCount(); }
+		GpuImage* GetVersionImage(uint32_t versionIndex) { return m_Versions[versionIndex].get(); }
+		uint32_t GetVersionCount() { return (uint32_t)m_Versions.size(); }
+		// Versions older than the history length were written before the image was created or invalidated
+		uint32_t GetHistoryLength() { return m_HistoryLength; }
+		bool IsValid(uint32_t age) { return age <= m_HistoryLength; }
+	private:
+		std::vector<std::unique_ptr<GpuImage>> m_Versions;
+		uint32_t m_Current = 0;
+		uint32_t m_HistoryLength = 0;
+
+		friend class RenderGraph;
 	};
 
 	class RenderGraph
 	{
 	public:
-		RenderGraph();
+		RenderGraph(Device* device);
 		~RenderGraph();
 
 		void AddPass(const RenderPass& renderPass);
 		void SetPresentPass(const PresentPass& presentPass);
 		void BuildGraph();
+		// Called by the PresentQueue after waiting for the fence of the frame it begins, before the ResourceCache and the
+		// UniformAllocator recycle anything of the frame. Waits for the work the frame with this index submitted to other queues.
+		void BeginFrame(uint32_t frameIndex);
+		// Records nothing when the present queue drops the frame, the tracked states are rolled back to the start of the frame
 		void Execute(FrameData frameData, const uint32_t extent[2]);
+		// Releases the transient and history images and drops all tracked state, called before the resource cache frees the
+		// resources of a renderer. History images returned before become invalid. The device has to be idle.
+		void Reset();
+
+		// Large graphs are split into contiguous ranges of passes recorded on worker threads into secondary command buffers.
+		// Execute functions of passes have to be safe to call concurrently while this is enabled, so it is off by default
+		// and reset by Reset. The UniformAllocator is not thread safe, allocate from it before adding the passes.
+		void SetMultithreadedRecording(bool enabled) { m_MultithreadedRecording = enabled; }
+
+		// Independent passes are reordered so passes that need no barrier run first and barriers are pushed as late as possible.
+		// Order is only kept between passes that access the same resource or attachment with at least one write.
+		void SetPassReordering(bool enabled) { m_PassReordering = enabled; }
+
+		// Used for work recorded outside of the graph, tracked state is replaced with the given layout
+		void ImportImage(ImageHandle image, ImageLayout layout);
+		void ForgetResource(void* handle);
+		// Layout the graph left the resource in, Undefined when it has not seen it.
+		// False when the resource was last used on a queue family other than the graphics one.
+		bool GetResourceLayout(void* handle, ImageLayout& layout);
+		// Moves the tracked state and retention to the handle that replaced the resource, used when it is moved to new memory
+		void ReplaceResource(void* oldHandle, void* newHandle);
+
+		// Passes are culled when none of their outputs reach the present pass or a retained resource.
+		// Resources that are read by later frames or outside of the graph have to be retained.
+		void RetainResource(void* handle);
+		void ReleaseRetainedResource(void* handle);
+
+		// Transient images are owned by the graph and only valid for the frame they are requested in.
+		// Images with non overlapping lifetimes share memory, contents are undefined at their first pass.
+		GpuImage* CreateTransientImage(const GpuImageDesc& desc);
+
+		// History images are retained, versions start in an undefined layout like images created through the resource cache.
+		// Released history is destroyed once the frames in flight that could use it have completed.
+		HistoryImage* CreateHistoryImage(const GpuImageDesc& desc, uint32_t versionCount = 2);
+		void ReleaseHistoryImage(HistoryImage* historyImage);
+		// Contents of every version are discarded, the next access transitions from an undefined layout
+		void InvalidateHistory(HistoryImage* historyImage);
+
+		// The resolution scale follows the measured GPU frame time and changes between frames, never during one.
+		// Scaled transient images are resized without waiting for the device, old images are released once unused.
+		void EnableDynamicResolution(const DynamicResolutionDesc& desc);
+		void DisableDynamicResolution();
+		float GetResolutionScale() { return m_ResolutionScale; }
+		// Extent of a pass or resource relative to the output, the same rounding is used for the render area of passes
+		void GetScaledExtent(const uint32_t outputExtent[2], float extentScale, bool dynamicResolution, uint32_t scaledExtent[2]);
+
+		struct TransientMemoryReport
+		{
+			uint32_t AliasedImageCount = 0;
+			uint64_t AliasedImageBytes = 0;
+			uint64_t AliasedHeapBytes = 0;
+			uint32_t DedicatedImageCount = 0;
+			uint64_t DedicatedBytes = 0;
+		};
+		TransientMemoryReport GetTransientMemoryReport();
+		void PrintTransientMemoryReport();
+
+		// Measures the GPU time of every pass with timestamps, results arrive once the frame slot is reused
+		void SetPassTimings(bool enabled);
+		// Writes the passes, resources, barriers and submissions of the last built graph, with the statistics and
+		// pass timings of the last executed frame. Paths ending in .json are written as JSON, everything else as GraphViz DOT.
+		// Timings are matched by the order the passes were added in, they are only meaningful while the same passes are added.
+		void DumpGraph(const std::string& path);
+
+		// Culled dispatches are counted from the last frame the culled pass was executed.
+		// Barrier counts before and after reordering are estimated while scheduling, BarrierCount is what was recorded.
+		// AllocationCount is the number of heap allocations made inside graph calls of the frame, including the execute functions.
+		// It stays 0 unless ARC_COUNT_ALLOCATIONS is defined.
+		struct Statistics
+		{
+			uint32_t PassCount = 0;
+			uint32_t CulledPassCount = 0;
+			uint32_t DispatchCount = 0;
+			uint32_t CulledDispatchCount = 0;
+			uint32_t BarrierCount = 0;
+			uint32_t BarriersBeforeReordering = 0;
+			uint32_t BarriersAfterReordering = 0;
+			uint32_t AllocationCount = 0;
+		};
+		const Statistics& GetStatistics() const { return m_Statistics; }
 	private:
+		struct ResourceState
+		{
+			uint64_t WriteStages = 0;
+			uint64_t WriteAccess = 0;
+			uint64_t ReadStages = 0;
+			uint64_t VisibleStages = 0;
+			uint64_t VisibleAccess = 0;
+			ImageLayout Layout = ImageLayout::Undefined;
+			// Queue of the last access, stages above are only meaningful on that queue
+			uint32_t Queue = 0;
+
+			bool operator==(const ResourceState& other) const = default;
+		};
+
+		struct PassBarriers
+		{
+			std::vector<CommandBuffer::ImageSyncBarrier> ImageBarriers;
+			std::vector<CommandBuffer::BufferSyncBarrier> BufferBarriers;
+		};
+
+		// Consecutive passes on the same queue. The last submission is always on the graphics queue,
+		// it holds the present pass and is recorded into the frame command buffer.
+		struct Submission
+		{
+			uint32_t Queue = 0;
+			std::vector<uint32_t> Passes;
+			// Mask of queues whose latest timeline value is waited on before the submission starts
+			uint32_t WaitQueues = 0;
+			// Recorded at the end, releases ownership of resources used next on another queue family
+			PassBarriers ReleaseBarriers;
+		};
+
+		// Barriers are only valid when the tracked resources are in the same state as when the graph was compiled
+		struct CompiledGraph
+		{
+			std::vector<uint64_t> Signature;
+			std::vector<PassBarriers> Barriers;
+			PassBarriers PresentBarriers;
+			std::vector<Submission> Submissions;
+			std::vector<std::pair<void*, ResourceState>> EntryStates;
+			std::vector<std::pair<void*, ResourceState>> ExitStates;
+		};
+
+		struct TransientImage
+		{
+			std::unique_ptr<GpuImage> Image;
+			GpuImageDesc Desc;
+			MemoryRequirements Requirements;
+			AllocationHandle DedicatedAllocation = nullptr;
+			uint64_t Offset = 0;
+			bool Created = false;
+			bool Bound = false;
+			bool Used = false;
+			uint32_t FirstPass = 0;
+			uint32_t LastPass = 0;
+		};
+
+		void RecordPass(CommandBuffer* cmd, size_t passIndex, bool timed, uint32_t frameIndex, const uint32_t extent[2]);
+		void RecordPasses(CommandBuffer* cmd, const std::vector<uint32_t>& passes, uint32_t queue, uint32_t frameIndex, const uint32_t extent[2]);
+		CommandBuffer* AcquireQueueCommandBuffer(uint32_t frameIndex, uint32_t queue);
+		// Every submission waits for the graphics timeline to reach prologueValue, 0 when nothing was submitted before the graph
+		void SubmitQueueCommandBuffer(CommandBuffer* cmd, const Submission& submission, uint64_t prologueValue);
+		uint32_t ResolveQueue(const RenderPass& renderPass);
+		void CullPasses();
+		void ReorderPasses();
+		void AllocateTransientImages();
+		void RecreateTransientImage(TransientImage& transient);
+		// Images aliasing the memory are added to the entry states of the graph, their last access decides the barrier
+		uint32_t ResetAliasedImages(uint32_t passIndex, uint32_t queue, CompiledGraph& compiledGraph);
+		void SynthesizeBarriers(ArrayView<Resource> inputs, ArrayView<Resource> outputs, PassBarriers& barriers, CompiledGraph& compiledGraph);
+		void BuildSignature(std::vector<uint64_t>& signature);
+		void CompileGraph(CompiledGraph& compiledGraph);
+		bool IsCompatible(const CompiledGraph& compiledGraph);
+
+		template<typename T>
+		ArrayView<T> CopyToBuildArena(ArrayView<T> view) { return { m_BuildArena.Copy(view.data(), view.size()), view.size() }; }
+
 		std::vector<RenderPass> m_BuildRenderPasses;
 		PresentPass m_BuildPresentPass;
+		LinearAllocator m_BuildArena;
 
 		std::vector<RenderPass> m_RenderPasses;
 		PresentPass m_PresentPass;
+		// Holds the arrays of the executed passes, swapped with the build arena in BuildGraph
+		LinearAllocator m_ExecuteArena;
+		// Heap allocations made inside graph calls since the last Execute
+		uint64_t m_FrameAllocationCount = 0;
+
+		std::unordered_map<void*, ResourceState> m_ResourceStates;
+
+		std::vector<void*> m_RetainedResources;
+		std::vector<void*> m_LiveResources;
+		std::vector<bool> m_CulledPasses;
+		// Index in AddPass order of the pass at each position of m_RenderPasses
+		std::vector<uint32_t> m_PassDeclarationIndices;
+		// Indexed by declaration index, like the pass timings
+		std::vector<uint32_t> m_PassDispatchCounts;
+		Statistics m_Statistics;
+		bool m_PassReordering = false;
+
+		// Scheduling only depends on the declarations and the layouts the resources enter the frame with
+		struct PassOrder
+		{
+			std::vector<uint64_t> Signature;
+			std::vector<uint32_t> Order;
+			uint32_t BarriersBeforeReordering = 0;
+			uint32_t BarriersAfterReordering = 0;
+		};
+		void SchedulePasses(PassOrder& passOrder);
+		std::vector<uint64_t> m_OrderSignature;
+		std::unordered_map<uint64_t, PassOrder> m_PassOrders;
+		std::vector<RenderPass> m_ReorderedPasses;
+
+		std::vector<uint64_t> m_Signature;
+		std::unordered_map<uint64_t, CompiledGraph> m_CompiledGraphs;
+		CompiledGraph* m_CompiledGraph = nullptr;
+		// Present barriers of the compiled graph plus the swapchain image of the frame, kept for its capacity
+		std::vector<CommandBuffer::ImageSyncBarrier> m_PresentImageBarriers;
+
+		Device* m_Device;
+
+		struct PassRecorder
+		{
+			CommandPoolHandle CommandPool = nullptr;
+			std::unique_ptr<Arc::CommandBuffer> CommandBuffer;
+		};
+		bool m_MultithreadedRecording = false;
+		std::unique_ptr<ThreadPool> m_ThreadPool;
+		// Indexed by frame in flight, one recorder for every range of passes
+		std::vector<std::vector<PassRecorder>> m_PassRecorders;
+		uint32_t m_UsedPassRecorders = 0;
+		std::vector<CommandBufferHandle> m_SecondaryCommandBuffers;
+
+		// Indexed by the resolved queue: graphics, async compute and transfer
+		static constexpr uint32_t QueueCount = 3;
+		uint32_t m_QueueFamilies[QueueCount];
+		QueueHandle m_Queues[QueueCount];
+		// Only created when the device has a dedicated compute or transfer family
+		SemaphoreHandle m_TimelineSemaphores[QueueCount] = {};
+		uint64_t m_TimelineValues[QueueCount] = {};
+
+		struct QueueCommandBuffers
+		{
+			CommandPoolHandle CommandPool = nullptr;
+			std::vector<std::unique_ptr<Arc::CommandBuffer>> CommandBuffers;
+			uint32_t UsedCount = 0;
+			// Signaled by the last submission of the frame, pools are reset once it is reached
+			uint64_t TimelineValue = 0;
+		};
+		// Command buffers for submissions that are not recorded into the frame command buffer, indexed by frame in flight
+		std::vector<std::array<QueueCommandBuffers, QueueCount>> m_QueueCommandBuffers;
+		// Replaced transient images and heaps, released once the frames in flight that could use them have completed
+		struct RetiredTransient
+		{
+			std::unique_ptr<GpuImage> Image;
+			AllocationHandle Allocation = nullptr;
+			// Memory in the current heap, new images placed over it wait on its last access
+			bool InHeap = false;
+			uint64_t Offset = 0;
+			uint64_t Size = 0;
+			uint64_t Frame = 0;
+		};
+		void ReleaseRetiredTransients(bool all);
+		void ReleaseTransientImages();
+		void ReleaseHistoryImages();
+
+		std::vector<TransientImage> m_TransientImages;
+		std::vector<RetiredTransient> m_RetiredTransients;
+		uint64_t m_FrameCount = 0;
+		uint32_t m_TransientImageCount = 0;
+		AllocationHandle m_TransientHeap = nullptr;
+		uint64_t m_TransientHeapSize = 0;
+		uint32_t m_TransientHeapMemoryTypeBits = 0;
+
+		std::vector<std::unique_ptr<HistoryImage>> m_HistoryImages;
+
+		std::unique_ptr<DynamicResolution> m_DynamicResolution;
+		float m_ResolutionScale = 1.0f;
+
+		std::unique_ptr<PassTimer> m_PassTimer;
+		// Mask of queues whose family supports timestamps, passes on other queues are not timed
+		uint32_t m_TimestampQueues = 0;
 	};
 }
\ No newline at end of file
@@ -2,12 +2,15 @@
 #include "Device.h"
 #include "VulkanCore/VulkanLocal.h"
 #include "ArcaneEngine/Core/Log.h"
+#include <algorithm>
 
 #define VMA_IMPLEMENTATION
 #include "vk_mem_alloc.h"
 
 namespace Arc
 {
+    extern PFN_vkSetDebugUtilsObjectNameEXT vkSetDebugUtilsObjectNameEXT;
+
 	ResourceCache::ResourceCache(Device* device)
 	{
         if (!device)
@@ -20,46 +23,45 @@ namespace Arc
         m_FramesInFlight = device->GetFramesInFlightCount();
         m_GraphicsQueue = device->GetGraphicsQueue();
         m_CommandPool = device->GetCommanPool();
+        m_PipelineCache = device->GetPipelineCache();
 
         VmaAllocatorCreateInfo allocatorInfo = {};
         allocatorInfo.physicalDevice = (VkPhysicalDevice)m_PhysicalDevice;
         allocatorInfo.device = (VkDevice)m_LogicalDevice;
         allocatorInfo.instance = (VkInstance)device->GetInstance();
         allocatorInfo.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+        if (device->IsMemoryBudgetSupported())
+            allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
         VmaAllocator allocator;
         VK_CHECK(vmaCreateAllocator(&allocatorInfo, &allocator));
         m_Allocator = allocator;
 
-        std::vector<VkDescriptorPoolSize> poolSizes =
-        {
-            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1024},
-            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 16384},
-            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1024},
-            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1024},
-            {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1024},
-        };
-
-        VkDescriptorPoolCreateInfo descriptorPoolInfo{};
-        descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        descriptorPoolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-        descriptorPoolInfo.pPoolSizes = poolSizes.data();
-        descriptorPoolInfo.maxSets = 1024;
-        descriptorPoolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
-
-        VkDescriptorPool descriptorPool;
-        VK_CHECK(vkCreateDescriptorPool((VkDevice)m_LogicalDevice, &descriptorPoolInfo, nullptr, &descriptorPool));
-        m_DescriptorPool = descriptorPool;
+        m_DescriptorPools.Pools.push_back(CreateDescriptorPool());
+        m_TransientDescriptorPools.resize(m_FramesInFlight);
+        CreateBindlessHeap();
 	}
 
 	ResourceCache::~ResourceCache()
 	{
         FreeResources();
-        vkDestroyDescriptorPool((VkDevice)m_LogicalDevice, (VkDescriptorPool)m_DescriptorPool, nullptr);
+        // Engine owned buffers are released by their owners, which the Device destroys first, anything left was leaked
+        if (uint32_t liveResources = GetLiveResourceCount())
+        {
+            ARC_LOG_WARNING("Destroying ResourceCache with {} live resources", liveResources);
+            PrintResourceReport();
+        }
+        ReleaseAllResources(true);
+        DestroyDescriptorPools(m_DescriptorPools);
+        for (auto& chain : m_TransientDescriptorPools)
+            DestroyDescriptorPools(chain);
+        DestroyBindlessHeap();
         vmaDestroyAllocator((VmaAllocator)m_Allocator);
 	}
 
     void* ResourceCache::MapMemory(GpuBuffer* buffer)
     {
+        if (buffer->m_MappedData)
+            return buffer->m_MappedData;
         void* data;
         vmaMapMemory((VmaAllocator)m_Allocator, (VmaAllocation)buffer->m_Allocation, &data);
         return data;
@@ -67,11 +69,15 @@ namespace Arc
 
     void ResourceCache::UnmapMemory(GpuBuffer* buffer)
     {
+        if (buffer->m_MappedData)
+            return;
         vmaUnmapMemory((VmaAllocator)m_Allocator, (VmaAllocation)buffer->m_Allocation);
     }
 
     void* ResourceCache::MapMemory(GpuBufferArray* bufferArray, uint32_t frameIndex)
     {
+        if (!bufferArray->m_MappedData.empty())
+            return bufferArray->m_MappedData[frameIndex];
         void* data;
         vmaMapMemory((VmaAllocator)m_Allocator, (VmaAllocation)bufferArray->m_Allocations[frameIndex], &data);
         return data;
@@ -79,104 +85,325 @@ namespace Arc
 
     void ResourceCache::UnmapMemory(GpuBufferArray* bufferArray, uint32_t frameIndex)
     {
+        if (!bufferArray->m_MappedData.empty())
+            return;
         vmaUnmapMemory((VmaAllocator)m_Allocator, (VmaAllocation)bufferArray->m_Allocations[frameIndex]);
     }
 
+    void ResourceCache::FlushMemory(GpuBuffer* buffer, uint64_t offset, uint64_t size)
+    {
+        if (!buffer->m_HostCoherent)
+            VK_CHECK(vmaFlushAllocation((VmaAllocator)m_Allocator, (VmaAllocation)buffer->m_Allocation, offset, size));
+    }
+
+    void ResourceCache::FlushMemory(GpuBufferArray* bufferArray, uint32_t frameIndex, uint64_t offset, uint64_t size)
+    {
+        if (!bufferArray->m_HostCoherent)
+            VK_CHECK(vmaFlushAllocation((VmaAllocator)m_Allocator, (VmaAllocation)bufferArray->m_Allocations[frameIndex], offset, size));
+    }
+
+    void ResourceCache::DeferRelease(InlineFunction<void(), 64>&& release)
+    {
+        m_DeletionQueue.push_back({ .Release = std::move(release), .Frame = m_FrameCount });
+    }
+
+    void ResourceCache::BeginFrame(uint32_t frameIndex)
+    {
+        ResetDescriptorPools(m_TransientDescriptorPools[frameIndex]);
+
+        m_FrameCount++;
+        // Lets VMA refresh the budgets it fetched from the driver
+        vmaSetCurrentFrameIndex((VmaAllocator)m_Allocator, (uint32_t)m_FrameCount);
+        if (m_OverBudgetCallback)
+            CheckMemoryBudgets();
+
+        // Released while recording frame N, the fence of frame N has been waited on before frame N + framesInFlight begins
+        size_t releasedCount = 0;
+        while (releasedCount < m_DeletionQueue.size() && m_DeletionQueue[releasedCount].Frame + m_FramesInFlight <= m_FrameCount)
+        {
+            m_DeletionQueue[releasedCount].Release();
+            releasedCount++;
+        }
+        m_DeletionQueue.erase(m_DeletionQueue.begin(), m_DeletionQueue.begin() + releasedCount);
+    }
+
+    void ResourceCache::FlushDeletionQueue()
+    {
+        for (auto& deferred : m_DeletionQueue)
+        {
+            deferred.Release();
+        }
+        m_DeletionQueue.clear();
+    }
+
     void ResourceCache::FreeResources()
     {
-        for (auto& [key, layout] : m_DescriptorSetLayouts)
+        if (m_DefragmentationContext)
+        {
+            // The device is idle, a pass waiting for its copies can end right away
+            FlushDeletionQueue();
+            EndDefragmentation();
+        }
+        ReleaseAllResources(false);
+    }
+
+    void ResourceCache::ReleaseAllResources(bool includeEngineOwned)
+    {
+        ReleaseResources(m_GpuBuffers, includeEngineOwned);
+        ReleaseResources(m_GpuBufferArrays, includeEngineOwned);
+        ReleaseResources(m_GpuImages, includeEngineOwned);
+        ReleaseResources(m_TransientGpuImages, includeEngineOwned);
+        ReleaseResources(m_Samplers, includeEngineOwned);
+        ReleaseResources(m_Shaders, includeEngineOwned);
+        ReleaseResources(m_Pipelines, includeEngineOwned);
+        ReleaseResources(m_ComputePipelines, includeEngineOwned);
+        ReleaseResources(m_BottomLevelAS, includeEngineOwned);
+        ReleaseResources(m_TopLevelAS, includeEngineOwned);
+        ReleaseResources(m_RayTracingPipelines, includeEngineOwned);
+
+        FlushDeletionQueue();
+
+        // Descriptor sets are not tracked, their owners are released together with the other resources
+        ResetDescriptorPools(m_DescriptorPools);
+        m_TrackedDescriptorWrites.clear();
+        for (auto& chain : m_TransientDescriptorPools)
+            ResetDescriptorPools(chain);
+
+        // Layouts outlive the pipelines and descriptor sets created from them
+        for (auto& [description, layout] : m_PipelineLayouts)
+        {
+            vkDestroyPipelineLayout((VkDevice)m_LogicalDevice, (VkPipelineLayout)layout, nullptr);
+        }
+        m_PipelineLayouts.clear();
+        for (auto& [description, layout] : m_DescriptorSetLayouts)
         {
             vkDestroyDescriptorSetLayout((VkDevice)m_LogicalDevice, (VkDescriptorSetLayout)layout, nullptr);
         }
         m_DescriptorSetLayouts.clear();
+    }
 
-        for (auto& [resource, type] : m_Resources)
+    void ResourceCache::PrintHeapBudgets()
+    {
+        MemoryStats stats = GetMemoryStats();
+        uint32_t allocationCount = 0;
+        uint64_t allocationBytes = 0;
+        for (uint32_t heapIndex = 0; heapIndex < stats.Heaps.size(); heapIndex++)
         {
-            switch (type)
-            {
-            case ResourceType::GpuBuffer:
-            {
-                ReleaseResource((GpuBuffer*)resource);
-            }
-            break;
-            case ResourceType::GpuBufferArray:
-            {
-                ReleaseResource((GpuBufferArray*)resource);
-            }
-            break;
-            case ResourceType::GpuImage:
-            {
-                ReleaseResource((GpuImage*)resource);
-            }
-            break;
-            case ResourceType::Sampler:
-            {
-                ReleaseResource((Sampler*)resource);
-            }
-            break;
-            case ResourceType::Shader:
-            {
-                ReleaseResource((Shader*)resource);
-            }
-            break;
-            case ResourceType::Pipeline:
-            {
-                ReleaseResource((Pipeline*)resource);
-            }
-            break;
-            case ResourceType::ComputePipeline:
-            {
-                ReleaseResource((ComputePipeline*)resource);
-            }
-            break;
-            case ResourceType::BottomLevelAS:
-            {
-                ReleaseResource((BottomLevelAS*)resource);
-            }
-            break;
-            case ResourceType::TopLevelAS:
-            {
-                ReleaseResource((TopLevelAS*)resource);
-            }
-            break;
-            case ResourceType::RayTracingPipeline:
-            {
-                ReleaseResource((RayTracingPipeline*)resource);
-            }
-            break;
-            }
+            const HeapMemoryStats& heap = stats.Heaps[heapIndex];
+            allocationCount += heap.AllocationCount;
+            allocationBytes += heap.AllocationBytes;
+
+            ARC_LOG("Heap {}{}: {} allocations taking {:.2f} MB in {} blocks taking {:.2f} MB, fragmentation {:.2f}",
+                heapIndex, heap.DeviceLocal ? " (device local)" : "", heap.AllocationCount, heap.AllocationBytes / 1048576.0,
+                heap.BlockCount, heap.BlockBytes / 1048576.0, heap.Fragmentation);
+            ARC_LOG("Heap {}: usage {:.2f} MB of {:.2f} MB budget", heapIndex, heap.Usage / 1048576.0, heap.Budget / 1048576.0);
         }
-        m_Resources.clear();
+        ARC_LOG("Total {} allocations taking {:.2f} MB", allocationCount, allocationBytes / 1048576.0);
+
+        static constexpr const char* ResourceTypeNames[] = { "Buffers", "Images", "Transient image memory", "Acceleration structures", "Shader binding tables" };
+        for (size_t i = 0; i < stats.ResourceBytes.size(); i++)
+            ARC_LOG("{}: {:.2f} MB", ResourceTypeNames[i], stats.ResourceBytes[i] / 1048576.0);
     }
 
-    void ResourceCache::PrintHeapBudgets()
+    static uint64_t GetAllocationSize(AllocatorHandle allocator, AllocationHandle allocation)
+    {
+        if (!allocation)
+            return 0;
+        VmaAllocationInfo allocationInfo;
+        vmaGetAllocationInfo((VmaAllocator)allocator, (VmaAllocation)allocation, &allocationInfo);
+        return allocationInfo.size;
+    }
+
+    MemoryStats ResourceCache::GetMemoryStats()
     {
         const VkPhysicalDeviceMemoryProperties* properties;
         vmaGetMemoryProperties((VmaAllocator)m_Allocator, &properties);
         uint32_t heapCount = properties->memoryHeapCount;
-        std::vector<VmaBudget> budgets(heapCount);
-        vmaGetHeapBudgets((VmaAllocator)m_Allocator, budgets.data());
+        VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+        vmaGetHeapBudgets((VmaAllocator)m_Allocator, budgets);
+        VmaTotalStatistics totalStatistics;
+        vmaCalculateStatistics((VmaAllocator)m_Allocator, &totalStatistics);
 
-        uint32_t allocationCount = 0;
-        uint64_t allocationBytes = 0;
+        MemoryStats stats;
+        stats.Heaps.resize(heapCount);
         for (uint32_t heapIndex = 0; heapIndex < heapCount; heapIndex++)
         {
-            allocationCount += budgets[heapIndex].statistics.allocationCount;
-            allocationBytes += budgets[heapIndex].statistics.allocationBytes;
-
-            printf("My heap currently has %u allocations taking %lf MB,\n",
-                budgets[heapIndex].statistics.allocationCount,
-                budgets[heapIndex].statistics.allocationBytes / 1048576.0);
-            printf("allocated out of %u Vulkan device memory blocks taking %lf MB,\n",
-                budgets[heapIndex].statistics.blockCount,
-                budgets[heapIndex].statistics.blockBytes / 1048576.0);
-            printf("Vulkan reports total usage %lf MB with budget %lf MB.\n",
-                budgets[heapIndex].usage / 1048576.0,
-                budgets[heapIndex].budget / 1048576.0);
+            const VmaDetailedStatistics& detailed = totalStatistics.memoryHeap[heapIndex];
+            HeapMemoryStats& heap = stats.Heaps[heapIndex];
+            heap.Size = properties->memoryHeaps[heapIndex].size;
+            heap.DeviceLocal = properties->memoryHeaps[heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+            heap.Usage = budgets[heapIndex].usage;
+            heap.Budget = budgets[heapIndex].budget;
+            heap.AllocationCount = detailed.statistics.allocationCount;
+            heap.AllocationBytes = detailed.statistics.allocationBytes;
+            heap.BlockCount = detailed.statistics.blockCount;
+            heap.BlockBytes = detailed.statistics.blockBytes;
+
+            uint64_t unusedBytes = heap.BlockBytes - heap.AllocationBytes;
+            if (unusedBytes > 0 && detailed.unusedRangeCount > 0)
+                heap.Fragmentation = 1.0f - (float)((double)detailed.unusedRangeSizeMax / (double)unusedBytes);
+        }
+
+        auto& bytes = stats.ResourceBytes;
+        for (GpuBuffer* gpuBuffer : m_GpuBuffers)
+            bytes[(size_t)ResourceType::Buffer] += GetAllocationSize(m_Allocator, gpuBuffer->m_Allocation);
+        for (GpuBufferArray* gpuBufferArray : m_GpuBufferArrays)
+        {
+            for (AllocationHandle allocation : gpuBufferArray->m_Allocations)
+                bytes[(size_t)ResourceType::Buffer] += GetAllocationSize(m_Allocator, allocation);
+        }
+        // Transient images do not own their memory, it is counted by AllocateMemory
+        for (GpuImage* gpuImage : m_GpuImages)
+            bytes[(size_t)ResourceType::Image] += GetAllocationSize(m_Allocator, gpuImage->m_Allocation);
+        bytes[(size_t)ResourceType::TransientImageMemory] = m_TransientImageMemoryBytes;
+        for (BottomLevelAS* bottomLevelAS : m_BottomLevelAS)
+            bytes[(size_t)ResourceType::AccelerationStructure] += GetAllocationSize(m_Allocator, bottomLevelAS->m_Allocation);
+        for (TopLevelAS* topLevelAS : m_TopLevelAS)
+        {
+            bytes[(size_t)ResourceType::AccelerationStructure] += GetAllocationSize(m_Allocator, topLevelAS->m_Allocation);
+            bytes[(size_t)ResourceType::AccelerationStructure] += GetAllocationSize(m_Allocator, topLevelAS->m_InstanceAllocation);
+        }
+        for (RayTracingPipeline* pipeline : m_RayTracingPipelines)
+            bytes[(size_t)ResourceType::ShaderBindingTable] += GetAllocationSize(m_Allocator, pipeline->m_ShaderBindingTableAllocation);
+
+        return stats;
+    }
+
+    uint32_t ResourceCache::GetLiveResourceCount()
+    {
+        return m_GpuBuffers.GetSize() + m_GpuBufferArrays.GetSize() + m_GpuImages.GetSize() + m_TransientGpuImages.GetSize() + m_Samplers.GetSize() +
+            m_Shaders.GetSize() + m_Pipelines.GetSize() + m_ComputePipelines.GetSize() + m_BottomLevelAS.GetSize() + m_TopLevelAS.GetSize() +
+            m_RayTracingPipelines.GetSize();
+    }
+
+    std::string ResourceCache::GetResourceTag(const char* debugName, const std::source_location& location)
+    {
+        if (debugName && *debugName)
+            return debugName;
+
+        std::string_view fileName = location.file_name();
+        size_t separator = fileName.find_last_of("/\\");
+        if (separator != std::string_view::npos)
+            fileName.remove_prefix(separator + 1);
+        return std::format("{}:{}", fileName, location.line());
+    }
+
+    void ResourceCache::SetDebugName(const char* debugName, const std::source_location& location, uint32_t objectType, const void* handle, AllocationHandle allocation)
+    {
+        if (!vkSetDebugUtilsObjectNameEXT && !allocation)
+            return;
+
+        std::string tag = GetResourceTag(debugName, location);
+        if (vkSetDebugUtilsObjectNameEXT && handle)
+        {
+            VkDebugUtilsObjectNameInfoEXT nameInfo = {};
+            nameInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+            nameInfo.objectType = (VkObjectType)objectType;
+            nameInfo.objectHandle = (uint64_t)handle;
+            nameInfo.pObjectName = tag.c_str();
+            vkSetDebugUtilsObjectNameEXT((VkDevice)m_LogicalDevice, &nameInfo);
+        }
+        if (allocation)
+            vmaSetAllocationName((VmaAllocator)m_Allocator, (VmaAllocation)allocation, tag.c_str());
+    }
+
+    std::vector<ResourceReportEntry> ResourceCache::GetResourceReport()
+    {
+        std::vector<ResourceReportEntry> report;
+        std::unordered_map<std::string, size_t> entryIndices;
+        auto addResource = [&](const char* type, const auto* resource, uint64_t bytes) {
+            std::string tag = GetResourceTag(resource->m_DebugName, resource->m_Location);
+            auto [it, inserted] = entryIndices.try_emplace(tag + '\n' + type, report.size());
+            if (inserted)
+                report.push_back({ .Tag = std::move(tag), .Type = type });
+            report[it->second].Count++;
+            report[it->second].Bytes += bytes;
+        };
 
+        for (GpuBuffer* gpuBuffer : m_GpuBuffers)
+            addResource("GpuBuffer", gpuBuffer, GetAllocationSize(m_Allocator, gpuBuffer->m_Allocation));
+        for (GpuBufferArray* gpuBufferArray : m_GpuBufferArrays)
+        {
+            uint64_t bytes = 0;
+            for (AllocationHandle allocation : gpuBufferArray->m_Allocations)
+                bytes += GetAllocationSize(m_Allocator, allocation);
+            addResource("GpuBufferArray", gpuBufferArray, bytes);
+        }
+        for (GpuImage* gpuImage : m_GpuImages)
+            addResource("GpuImage", gpuImage, GetAllocationSize(m_Allocator, gpuImage->m_Allocation));
+        for (GpuImage* gpuImage : m_TransientGpuImages)
+            addResource("TransientGpuImage", gpuImage, 0);
+        for (Sampler* sampler : m_Samplers)
+            addResource("Sampler", sampler, 0);
+        for (Shader* shader : m_Shaders)
+            addResource("Shader", shader, 0);
+        for (Pipeline* pipeline : m_Pipelines)
+            addResource("Pipeline", pipeline, 0);
+        for (ComputePipeline* pipeline : m_ComputePipelines)
+            addResource("ComputePipeline", pipeline, 0);
+        for (BottomLevelAS* bottomLevelAS : m_BottomLevelAS)
+            addResource("BottomLevelAS", bottomLevelAS, GetAllocationSize(m_Allocator, bottomLevelAS->m_Allocation));
+        for (TopLevelAS* topLevelAS : m_TopLevelAS)
+            addResource("TopLevelAS", topLevelAS, GetAllocationSize(m_Allocator, topLevelAS->m_Allocation) + GetAllocationSize(m_Allocator, topLevelAS->m_InstanceAllocation));
+        for (RayTracingPipeline* pipeline : m_RayTracingPipelines)
+            addResource("RayTracingPipeline", pipeline, GetAllocationSize(m_Allocator, pipeline->m_ShaderBindingTableAllocation));
+
+        std::sort(report.begin(), report.end(), [](const ResourceReportEntry& a, const ResourceReportEntry& b) {
+            return a.Bytes != b.Bytes ? a.Bytes > b.Bytes : a.Count > b.Count;
+        });
+        return report;
+    }
+
+    void ResourceCache::PrintResourceReport()
+    {
+        std::vector<ResourceReportEntry> report = GetResourceReport();
+        uint32_t count = 0;
+        uint64_t bytes = 0;
+        for (const ResourceReportEntry& entry : report)
+        {
+            ARC_LOG("{} x{} {}: {:.2f} MB", entry.Type, entry.Count, entry.Tag, entry.Bytes / 1048576.0);
+            count += entry.Count;
+            bytes += entry.Bytes;
         }
-        double allocationMegaBytes = allocationBytes / 1048576.0;
-        std::cout << "Total " << allocationCount << " allocations taking " << allocationMegaBytes << " MB\n";
+        ARC_LOG("Total {} live resources taking {:.2f} MB", count, bytes / 1048576.0);
+    }
+
+    void ResourceCache::SetOverBudgetCallback(OverBudgetCallback callback, float threshold)
+    {
+        m_OverBudgetCallback = std::move(callback);
+        m_OverBudgetThreshold = threshold;
+        m_OverBudgetHeaps.clear();
+    }
 
+    void ResourceCache::CheckMemoryBudgets()
+    {
+        const VkPhysicalDeviceMemoryProperties* properties;
+        vmaGetMemoryProperties((VmaAllocator)m_Allocator, &properties);
+        uint32_t heapCount = properties->memoryHeapCount;
+        VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+        vmaGetHeapBudgets((VmaAllocator)m_Allocator, budgets);
+        m_OverBudgetHeaps.resize(heapCount, 0);
+
+        for (uint32_t heapIndex = 0; heapIndex < heapCount; heapIndex++)
+        {
+            const VmaBudget& budget = budgets[heapIndex];
+            bool overBudget = budget.usage > budget.budget * m_OverBudgetThreshold;
+            if (overBudget && !m_OverBudgetHeaps[heapIndex])
+            {
+                HeapMemoryStats heap;
+                heap.Size = properties->memoryHeaps[heapIndex].size;
+                heap.DeviceLocal = properties->memoryHeaps[heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+                heap.Usage = budget.usage;
+                heap.Budget = budget.budget;
+                heap.AllocationCount = budget.statistics.allocationCount;
+                heap.AllocationBytes = budget.statistics.allocationBytes;
+                heap.BlockCount = budget.statistics.blockCount;
+                heap.BlockBytes = budget.statistics.blockBytes;
+
+                ARC_LOG_WARNING("Heap {} is over budget: {:.2f} MB of {:.2f} MB", heapIndex, heap.Usage / 1048576.0, heap.Budget / 1048576.0);
+                m_OverBudgetCallback(heapIndex, heap);
+            }
+            m_OverBudgetHeaps[heapIndex] = overBudget;
+        }
     }
 }
\ No newline at end of file
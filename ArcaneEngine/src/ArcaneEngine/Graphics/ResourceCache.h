@@ -5,40 +5,155 @@
 #include "VulkanObjects/Sampler.h"
 #include "VulkanObjects/Shader.h"
 #include "VulkanObjects/DescriptorSet.h"
+#include "VulkanObjects/DescriptorWrite.h"
 #include "VulkanObjects/Pipeline.h"
 #include "VulkanObjects/ComputePipeline.h"
 #include "VulkanObjects/BottomLevelAS.h"
 #include "VulkanObjects/TopLevelAS.h"
 #include "VulkanObjects/RayTracingPipeline.h"
+#include "ArcaneEngine/Core/HandlePool.h"
+#include "ArcaneEngine/Core/InlineFunction.h"
+#include "ArcaneEngine/Core/ArrayView.h"
+#include "ArcaneEngine/Core/ThreadPool.h"
+#include "ArcaneEngine/Core/Hash.h"
+#include <array>
+#include <chrono>
+#include <functional>
+#include <source_location>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace Arc
 {
+	struct LayoutDescriptionHasher
+	{
+		size_t operator()(const std::vector<uint32_t>& description) const { return HashBytes(description.data(), description.size() * sizeof(uint32_t)); }
+	};
+	// Keyed by the full layout description, the map compares it on a hash hit so colliding layouts are never shared
+	template<typename T>
+	using LayoutCache = std::unordered_map<std::vector<uint32_t>, T, LayoutDescriptionHasher>;
+
 	class Device;
+
+	struct MemoryRequirements
+	{
+		uint64_t Size = 0;
+		uint64_t Alignment = 0;
+		uint32_t MemoryTypeBits = 0;
+	};
+
+	enum class ResourceType
+	{
+		Buffer,
+		Image,
+		// Memory the RenderGraph aliases between transient images
+		TransientImageMemory,
+		AccelerationStructure,
+		ShaderBindingTable,
+		Count
+	};
+
+	struct HeapMemoryStats
+	{
+		uint64_t Size = 0;
+		bool DeviceLocal = false;
+		// Usage of the whole process and the budget from VK_EXT_memory_budget, estimated by VMA when the extension is missing
+		uint64_t Usage = 0;
+		uint64_t Budget = 0;
+		uint32_t AllocationCount = 0;
+		uint64_t AllocationBytes = 0;
+		uint32_t BlockCount = 0;
+		uint64_t BlockBytes = 0;
+		// 0 when the free space in the blocks is one range, towards 1 the more it is split up
+		float Fragmentation = 0.0f;
+	};
+
+	struct MemoryStats
+	{
+		std::vector<HeapMemoryStats> Heaps;
+		std::array<uint64_t, (size_t)ResourceType::Count> ResourceBytes = {};
+	};
+
+	struct ResourceReportEntry
+	{
+		// DebugName of the create desc, or file:line of the create call for unnamed resources
+		std::string Tag;
+		const char* Type = nullptr;
+		uint32_t Count = 0;
+		uint64_t Bytes = 0;
+	};
+
+	// The heap stats come from the budget query only, Fragmentation is left at 0
+	using OverBudgetCallback = std::function<void(uint32_t heapIndex, const HeapMemoryStats& heap)>;
+
+	struct PipelineCreationStats
+	{
+		uint32_t PipelineCount = 0;
+		// Milliseconds spent in the driver creating pipelines
+		double TotalTime = 0.0;
+	};
+
+	struct DefragmentationDesc
+	{
+		// Limits of the pass recorded every frame until the memory is compacted
+		uint64_t MaxBytesPerPass = 64ull * 1024 * 1024;
+		uint32_t MaxAllocationsPerPass = 64;
+		// Called for every moved image, for image views referenced outside of descriptor sets written through the Device
+		std::function<void(GpuImage* image)> ImageMoved;
+	};
+
+	struct DefragmentationStats
+	{
+		uint64_t BytesMoved = 0;
+		uint32_t AllocationsMoved = 0;
+		uint32_t PassCount = 0;
+		// Known once the defragmentation has finished
+		uint64_t BytesFreed = 0;
+		uint32_t BlocksFreed = 0;
+	};
+
 	class ResourceCache
 	{
 	public:
 		ResourceCache(Device* device);
 		~ResourceCache();
 
+		// Persistently mapped buffers return their mapped pointer and are not unmapped
 		void* MapMemory(GpuBuffer* buffer);
 		void UnmapMemory(GpuBuffer* buffer);
 		void* MapMemory(GpuBufferArray* bufferArray, uint32_t frameIndex);
 		void UnmapMemory(GpuBufferArray* bufferArray, uint32_t frameIndex);
+		// Makes host writes visible to the device, only does work for memory that is not host coherent
+		void FlushMemory(GpuBuffer* buffer, uint64_t offset = 0, uint64_t size = ~0ull);
+		void FlushMemory(GpuBufferArray* bufferArray, uint32_t frameIndex, uint64_t offset = 0, uint64_t size = ~0ull);
 
 		void CreateGpuBuffer(GpuBuffer* gpuBuffer, const GpuBufferDesc& desc);
 		void CreateGpuBufferArray(GpuBufferArray* gpuBufferArray, const GpuBufferDesc& desc);
 		void CreateGpuImage(GpuImage* gpuImage, const GpuImageDesc& desc);
+		// Creates the image without memory, it has no image view until BindTransientGpuImage is called
+		void CreateTransientGpuImage(GpuImage* gpuImage, const GpuImageDesc& desc);
+		void BindTransientGpuImage(GpuImage* gpuImage, const GpuImageDesc& desc, AllocationHandle allocation, uint64_t offset);
+		// Moves the image objects into retired, so gpuImage can be created again while frames in flight still use the old ones
+		void RetireTransientGpuImage(GpuImage* gpuImage, GpuImage* retired);
+		MemoryRequirements GetMemoryRequirements(GpuImage* gpuImage);
+		AllocationHandle AllocateMemory(const MemoryRequirements& requirements);
+		void FreeMemory(AllocationHandle allocation);
 		void CreateSampler(Sampler* sampler, const SamplerDesc& desc);
 		void CreateShader(Shader* shader, const ShaderDesc& desc);
 		void AllocateDescriptorSet(DescriptorSet* descriptor, const DescriptorSetDesc& desc);
 		void AllocateDescriptorSetArray(DescriptorSetArray* descriptorArray, const DescriptorSetDesc& desc);
+		// Allocated from the pools of the frame, valid until the frame index comes around again. Never released individually
+		void AllocateTransientDescriptorSet(DescriptorSet* descriptor, uint32_t frameIndex, const DescriptorSetDesc& desc);
 		void CreatePipeline(Pipeline* pipeline, const PipelineDesc& desc);
 		void CreateComputePipeline(ComputePipeline* pipeline, const ComputePipelineDesc& desc);
+		// Compiles the pipelines in parallel on a thread pool and returns once all of them are created
+		void CreateComputePipelines(ArrayView<ComputePipeline*> pipelines, ArrayView<ComputePipelineDesc> descs);
 		void CreateBottomLevelAS(BottomLevelAS* accelerationStructure, const BottomLevelASDesc& desc);
 		void CreateTopLevelAS(TopLevelAS* accelerationStructure, const TopLevelASDesc& desc);
 		void CreateRayTracingPipeline(RayTracingPipeline* pipeline, const RayTracingPipelineDesc& desc);
 
+		// Released objects can be reused right away, their Vulkan objects are destroyed once the frames in flight that could use them have completed
 		void ReleaseResource(GpuBuffer* gpuBuffer);
 		void ReleaseResource(GpuBufferArray* gpuBufferArray);
 		void ReleaseResource(GpuImage* gpuImage);
@@ -50,8 +165,51 @@ namespace Arc
 		void ReleaseResource(TopLevelAS* topLevelAS);
 		void ReleaseResource(RayTracingPipeline* raytracingPipeline);
 
+		// Runs release once the frames in flight that could still use the object have completed
+		void DeferRelease(InlineFunction<void(), 64>&& release);
+		// Called by the PresentQueue after waiting for the fence of the frame it begins, destroys the released objects that frame waited for
+		// and resets the transient descriptor pools of the frame
+		void BeginFrame(uint32_t frameIndex);
+		// Destroys all released objects without waiting, the device has to be idle
+		void FlushDeletionQueue();
+		// Releases every object except engine owned buffers and flushes the deletion queue, the device has to be idle
 		void FreeResources();
 		void PrintHeapBudgets();
+		// Walks every live resource and all memory blocks, meant for debug UI and budget decisions rather than every frame
+		MemoryStats GetMemoryStats();
+		// Called from BeginFrame when the usage of a heap rises above threshold * budget, and again only after it dropped below
+		void SetOverBudgetCallback(OverBudgetCallback callback, float threshold = 0.9f);
+		// Live resources grouped by tag and type, largest first. Also printed when the ResourceCache is destroyed with resources still alive
+		std::vector<ResourceReportEntry> GetResourceReport();
+		void PrintResourceReport();
+		PipelineCreationStats GetPipelineCreationStats() { return m_PipelineCreationStats; }
+		// Compacts Movable buffers and images over the next frames, one bounded pass at a time. The copies of a pass are recorded
+		// at the start of a frame. Moved resources get new bindless slots and the descriptor sets that reference them are replaced by new
+		// DescriptorSet handles, the old objects, slots, sets and memory stay untouched until every frame that could use them has completed.
+		// Ending while a pass is in flight finishes once the pass has ended.
+		void BeginDefragmentation(const DefragmentationDesc& desc = {});
+		void EndDefragmentation();
+		// Called by the PresentQueue after beginning the frame command buffer, starts the next pass when the previous one has ended
+		void RecordDefragmentationPass(CommandBufferHandle cmd);
+		bool IsDefragmenting() { return m_DefragmentationContext != nullptr; }
+		DefragmentationStats GetDefragmentationStats() { return m_DefragmentationStats; }
+		// Set BindlessSetIndex of every pipeline whose shaders use it. Created images, storage buffers and samplers get a stable
+		// index in it, released indices are reused once the frames in flight that could still read them have completed
+		DescriptorSetHandle GetBindlessDescriptorSet() { return m_BindlessHeap.DescriptorSet; }
+		uint32_t GetBindlessCapacity(BindlessBinding binding) { return m_BindlessHeap.Capacity[(size_t)binding]; }
+		// Called by Device::UpdateDescriptorSet, only writes to sets from AllocateDescriptorSet and AllocateDescriptorSetArray are kept
+		void TrackDescriptorWrites(DescriptorSet* descriptor, const DescriptorWrite& write);
+		void TrackDescriptorWrites(DescriptorSetArray* descriptorArray, const DescriptorWrite& write);
+		// Reflection results of the shaders created in this session, keyed by the hash of their SPIR-V
+		void LoadShaderCache(const std::string& filePath);
+		void SaveShaderCache(const std::string& filePath);
+		// Created on first use, shared by batched resource creation and shader compilation
+		ThreadPool* GetThreadPool()
+		{
+			if (!m_ThreadPool)
+				m_ThreadPool = std::make_unique<ThreadPool>();
+			return m_ThreadPool.get();
+		}
 
 	private:
 		Device* m_Device;
@@ -60,24 +218,215 @@ namespace Arc
 		QueueHandle m_GraphicsQueue;
 		CommandPoolHandle m_CommandPool;
 		AllocatorHandle m_Allocator;
-		DescriptorPoolHandle m_DescriptorPool;
+
+		// Pools are chained when the current one runs out, resetting the chain keeps every pool for reuse
+		struct DescriptorPoolChain
+		{
+			std::vector<DescriptorPoolHandle> Pools;
+			uint32_t Current = 0;
+		};
+		DescriptorPoolChain m_DescriptorPools;
+		std::vector<DescriptorPoolChain> m_TransientDescriptorPools;
+		DescriptorPoolHandle CreateDescriptorPool();
+		void AllocateDescriptorSets(DescriptorPoolChain& chain, const DescriptorSetLayoutHandle* layouts, uint32_t count, DescriptorSetHandle* descriptorSets);
+		void ResetDescriptorPools(DescriptorPoolChain& chain);
+		void DestroyDescriptorPools(DescriptorPoolChain& chain);
+		PipelineCacheHandle m_PipelineCache;
 		uint32_t m_FramesInFlight;
 
-		enum class ResourceType
+		PipelineLayoutHandle CreateComputePipelineLayout(const ComputePipelineDesc& desc);
+		// Only touches the device and the pipeline cache, safe to call from several threads
+		PipelineHandle CreateComputePipelineHandle(const ComputePipelineDesc& desc, PipelineLayoutHandle pipelineLayout);
+		std::unique_ptr<ThreadPool> m_ThreadPool;
+
+		struct ShaderReflection
+		{
+			uint32_t PushConstantSize = 0;
+			uint32_t StageOutputs = 0;
+			std::vector<Shader::DescriptorLayoutBinding> LayoutBindings;
+		};
+		struct ShaderCacheEntry
+		{
+			// Second hash with another seed and the size, a mismatch means the 64 bit key collided
+			uint64_t CheckHash = 0;
+			uint64_t WordCount = 0;
+			ShaderReflection Reflection;
+			ShaderModuleHandle Module = nullptr;
+			uint32_t ModuleRefCount = 0;
+			// Entries loaded from the file that no shader of this session used are not saved again
+			bool Used = false;
+		};
+		static constexpr uint64_t ShaderCheckHashSeed = 0x84222325cbf29ce4ull;
+		void ReflectShader(const std::vector<uint32_t>& spirV, ShaderReflection& reflection);
+		std::unordered_map<uint64_t, ShaderCacheEntry> m_ShaderCache;
+
+		void RecordPipelineCreation(std::chrono::steady_clock::time_point start, uint32_t pipelineCount = 1)
+		{
+			m_PipelineCreationStats.PipelineCount += pipelineCount;
+			m_PipelineCreationStats.TotalTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		PipelineCreationStats m_PipelineCreationStats;
+
+		struct TrackedDescriptorWrite
+		{
+			uint32_t Binding = 0;
+			uint32_t ArrayElement = 0;
+			DescriptorType Type = {};
+			GpuBuffer* Buffer = nullptr;
+			// The buffer of the frame the set belongs to
+			GpuBufferArray* BufferArray = nullptr;
+			uint32_t FrameIndex = 0;
+			GpuImage* Image = nullptr;
+			ImageLayout ImageLayout = ImageLayout::Undefined;
+			SamplerHandle Sampler = nullptr;
+		};
+		// Owner points at the handle inside the DescriptorSet or DescriptorSetArray, so a replacement set can take its place
+		struct TrackedDescriptorSet
+		{
+			DescriptorSetLayoutHandle Layout = nullptr;
+			DescriptorSetHandle* Owner = nullptr;
+			std::vector<TrackedDescriptorWrite> Writes;
+		};
+		// Keyed by the sets of the persistent pools, cleared with them in FreeResources
+		std::unordered_map<DescriptorSetHandle, TrackedDescriptorSet> m_TrackedDescriptorWrites;
+		void TrackDescriptorWrite(DescriptorSetHandle descriptorSet, const TrackedDescriptorWrite& write);
+
+		DefragmentationContextHandle m_DefragmentationContext = nullptr;
+		DefragmentationDesc m_DefragmentationDesc;
+		DefragmentationStats m_DefragmentationStats;
+		bool m_DefragmentationPassPending = false;
+		bool m_DefragmentationEndRequested = false;
+		struct BufferMove
+		{
+			GpuBuffer* Buffer;
+			BufferHandle NewBuffer;
+			uint32_t NewBindlessIndex;
+		};
+		struct ImageMove
+		{
+			GpuImage* Image;
+			ImageLayout Layout;
+			ImageHandle NewImage;
+			ImageViewHandle NewImageView;
+			uint32_t NewSampledIndex;
+			uint32_t NewStorageIndex;
+		};
+		// Scratch storage of RecordDefragmentationPass, cleared every pass but keeps its capacity. The movable resources are
+		// sorted by allocation, the moved ones by address.
+		std::vector<std::pair<AllocationHandle, GpuBuffer*>> m_MovableBuffers;
+		std::vector<std::pair<AllocationHandle, GpuImage*>> m_MovableImages;
+		std::vector<BufferMove> m_BufferMoves;
+		std::vector<ImageMove> m_ImageMoves;
+		std::vector<const void*> m_MovedResources;
+		std::vector<DescriptorSetHandle> m_ReplacedDescriptorSets;
+		BufferHandle CreateMovedBuffer(GpuBuffer* gpuBuffer, AllocationHandle allocation);
+		void CreateMovedImage(GpuImage* gpuImage, AllocationHandle allocation, ImageHandle& image, ImageViewHandle& imageView);
+
+		struct BindlessHeap
 		{
-			GpuBuffer,
-			GpuBufferArray,
-			GpuImage,
-			Sampler,
-			Shader,
-			Pipeline,
-			ComputePipeline,
-			BottomLevelAS,
-			TopLevelAS,
-			RayTracingPipeline
+			DescriptorPoolHandle Pool = nullptr;
+			DescriptorSetLayoutHandle Layout = nullptr;
+			DescriptorSetHandle DescriptorSet = nullptr;
+			std::array<uint32_t, (size_t)BindlessBinding::Count> Capacity = {};
+			// Shader stages that may use the heap, its layout only matches pipelines that use it from these stages
+			uint32_t StageFlags = 0;
+			// Indices below it have been handed out at least once
+			std::array<uint32_t, (size_t)BindlessBinding::Count> Used = {};
+			std::array<std::vector<uint32_t>, (size_t)BindlessBinding::Count> FreeIndices;
 		};
+		BindlessHeap m_BindlessHeap;
+		void CreateBindlessHeap();
+		void DestroyBindlessHeap();
+		uint32_t AllocateBindlessIndex(BindlessBinding binding);
+		void ReleaseBindlessIndex(BindlessBinding binding, uint32_t& index);
+		// Allocates a new slot for a resource that was moved, frames in flight can still index the current one
+		bool ReplaceBindlessIndex(BindlessBinding binding, uint32_t index, uint32_t& newIndex);
+		void WriteBindlessDescriptors(GpuBuffer* gpuBuffer);
+		void WriteBindlessDescriptors(GpuImage* gpuImage);
+		void WriteBindlessDescriptors(Sampler* sampler);
+
+		void CheckMemoryBudgets();
+		OverBudgetCallback m_OverBudgetCallback;
+		float m_OverBudgetThreshold = 0.9f;
+		std::vector<uint8_t> m_OverBudgetHeaps;
+		uint64_t m_TransientImageMemoryBytes = 0;
+
+		template<typename T, typename Desc>
+		void RegisterResource(HandlePool<T>& pool, T* resource, const Desc& desc)
+		{
+			// Creating into an object that was not released keeps its slot
+			T** registered = pool.Get(resource->m_CacheHandle);
+			if (!registered || *registered != resource)
+				resource->m_CacheHandle = pool.Allocate(resource);
+			// Only the pointer is kept, DebugName has to outlive the resource
+			resource->m_DebugName = desc.DebugName;
+			resource->m_Location = desc.Location;
+		}
+
+		template<typename T>
+		bool UnregisterResource(HandlePool<T>& pool, T* resource)
+		{
+			T** registered = pool.Get(resource->m_CacheHandle);
+			if (!registered || *registered != resource)
+				return false;
+			pool.Release(resource->m_CacheHandle);
+			resource->m_CacheHandle = {};
+			resource->m_DebugName = nullptr;
+			return true;
+		}
 
-		std::unordered_map<uint64_t, DescriptorSetLayoutHandle> m_DescriptorSetLayouts;
-		std::unordered_map<void*, ResourceType> m_Resources;
+		// Collected first since releasing swaps entries within the dense array
+		template<typename T>
+		void ReleaseResources(HandlePool<T>& pool, bool includeEngineOwned)
+		{
+			std::vector<T*> released;
+			for (T* resource : pool)
+			{
+				if constexpr (requires { resource->m_EngineOwned; })
+				{
+					if (resource->m_EngineOwned && !includeEngineOwned)
+						continue;
+				}
+				released.push_back(resource);
+			}
+			for (T* resource : released)
+				ReleaseResource(resource);
+		}
+
+		void ReleaseAllResources(bool includeEngineOwned);
+
+		uint32_t GetLiveResourceCount();
+		std::string GetResourceTag(const char* debugName, const std::source_location& location);
+		// Names the Vulkan object and its allocation after the tag of a registered resource, the object name needs VK_EXT_debug_utils
+		template<typename T>
+		void SetDebugName(const T* resource, uint32_t objectType, const void* handle, AllocationHandle allocation = nullptr)
+		{
+			SetDebugName(resource->m_DebugName, resource->m_Location, objectType, handle, allocation);
+		}
+		void SetDebugName(const char* debugName, const std::source_location& location, uint32_t objectType, const void* handle, AllocationHandle allocation);
+
+		LayoutCache<DescriptorSetLayoutHandle> m_DescriptorSetLayouts;
+		// Shared by all pipelines with the same set layouts and push constants, destroyed in FreeResources
+		LayoutCache<PipelineLayoutHandle> m_PipelineLayouts;
+		HandlePool<GpuBuffer> m_GpuBuffers;
+		HandlePool<GpuBufferArray> m_GpuBufferArrays;
+		HandlePool<GpuImage> m_GpuImages;
+		HandlePool<GpuImage> m_TransientGpuImages;
+		HandlePool<Sampler> m_Samplers;
+		HandlePool<Shader> m_Shaders;
+		HandlePool<Pipeline> m_Pipelines;
+		HandlePool<ComputePipeline> m_ComputePipelines;
+		HandlePool<BottomLevelAS> m_BottomLevelAS;
+		HandlePool<TopLevelAS> m_TopLevelAS;
+		HandlePool<RayTracingPipeline> m_RayTracingPipelines;
+
+		struct DeferredRelease
+		{
+			InlineFunction<void(), 64> Release;
+			uint64_t Frame;
+		};
+		// Ordered by frame, BeginFrame releases from the front
+		std::vector<DeferredRelease> m_DeletionQueue;
+		uint64_t m_FrameCount = 0;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,221 @@
+#include "ArcaneEngine/Graphics/ResourceCache.h"
+#include "ArcaneEngine/Core/Log.h"
+#include "ArcaneEngine/Graphics/VulkanCore/VulkanLocal.h"
+#include <vulkan/vulkan_core.h>
+#include <algorithm>
+
+namespace Arc
+{
+    static constexpr uint32_t BindlessSampledImageCount = 16384;
+    static constexpr uint32_t BindlessStorageImageCount = 4096;
+    static constexpr uint32_t BindlessSamplerCount = 256;
+    static constexpr uint32_t BindlessStorageBufferCount = 16384;
+    // Left below the device limits of each descriptor type for the other sets of a pipeline layout
+    static constexpr uint32_t ReservedDescriptorCount = 64;
+    // Pipelines index the heap from these stages only, vertex shaders get their inputs from the other sets
+    static constexpr VkShaderStageFlags BindlessStages = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT |
+        VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR;
+
+	void ResourceCache::CreateBindlessHeap()
+	{
+        VkPhysicalDeviceDescriptorIndexingProperties indexingProperties = {};
+        indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties = {};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &indexingProperties;
+        vkGetPhysicalDeviceProperties2((VkPhysicalDevice)m_PhysicalDevice, &properties);
+
+        // The per stage limits apply to every stage of the heap, the per set limits to all sets of a pipeline layout together
+        auto getCapacity = [](uint32_t count, uint32_t perStageLimit, uint32_t perSetLimit) {
+            uint32_t limit = std::min(perStageLimit, perSetLimit);
+            return std::min(count, limit > ReservedDescriptorCount ? limit - ReservedDescriptorCount : limit / 2);
+        };
+        auto& capacity = m_BindlessHeap.Capacity;
+        capacity[(size_t)BindlessBinding::SampledImage] = getCapacity(BindlessSampledImageCount,
+            indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages, indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages);
+        capacity[(size_t)BindlessBinding::StorageImage] = getCapacity(BindlessStorageImageCount,
+            indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageImages, indexingProperties.maxDescriptorSetUpdateAfterBindStorageImages);
+        capacity[(size_t)BindlessBinding::Sampler] = getCapacity(BindlessSamplerCount,
+            indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers, indexingProperties.maxDescriptorSetUpdateAfterBindSamplers);
+        capacity[(size_t)BindlessBinding::StorageBuffer] = getCapacity(BindlessStorageBufferCount,
+            indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers, indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers);
+
+        // Images and storage buffers also share one per stage resource limit, shrunk proportionally when they exceed it
+        uint64_t resourceCount = (uint64_t)capacity[(size_t)BindlessBinding::SampledImage] + capacity[(size_t)BindlessBinding::StorageImage] +
+            capacity[(size_t)BindlessBinding::StorageBuffer];
+        uint32_t resourceLimit = indexingProperties.maxPerStageUpdateAfterBindResources;
+        uint64_t resourceBudget = resourceLimit > 4 * ReservedDescriptorCount ? resourceLimit - 4 * ReservedDescriptorCount : resourceLimit / 2;
+        if (resourceCount > resourceBudget)
+        {
+            for (BindlessBinding binding : { BindlessBinding::SampledImage, BindlessBinding::StorageImage, BindlessBinding::StorageBuffer })
+                capacity[(size_t)binding] = (uint32_t)(capacity[(size_t)binding] * resourceBudget / resourceCount);
+        }
+        m_BindlessHeap.StageFlags = BindlessStages;
+
+        const VkDescriptorType types[] = { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_DESCRIPTOR_TYPE_SAMPLER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER };
+        std::array<VkDescriptorSetLayoutBinding, (size_t)BindlessBinding::Count> bindings = {};
+        std::array<VkDescriptorBindingFlags, (size_t)BindlessBinding::Count> bindingFlags = {};
+        std::array<VkDescriptorPoolSize, (size_t)BindlessBinding::Count> poolSizes = {};
+        for (uint32_t i = 0; i < bindings.size(); i++)
+        {
+            bindings[i].binding = i;
+            bindings[i].descriptorType = types[i];
+            bindings[i].descriptorCount = capacity[i];
+            bindings[i].stageFlags = BindlessStages;
+            // Slots are written while frames in flight use the set, but never a slot those frames can still index
+            bindingFlags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+            poolSizes[i] = { types[i], capacity[i] };
+        }
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsInfo.bindingCount = (uint32_t)bindingFlags.size();
+        bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.pNext = &bindingFlagsInfo;
+        layoutInfo.bindingCount = (uint32_t)bindings.size();
+        layoutInfo.pBindings = bindings.data();
+        layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+
+        VkDescriptorSetLayout layout;
+        VK_CHECK(vkCreateDescriptorSetLayout((VkDevice)m_LogicalDevice, &layoutInfo, nullptr, &layout));
+        m_BindlessHeap.Layout = layout;
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.poolSizeCount = (uint32_t)poolSizes.size();
+        poolInfo.pPoolSizes = poolSizes.data();
+        poolInfo.maxSets = 1;
+        poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+
+        VkDescriptorPool pool;
+        VK_CHECK(vkCreateDescriptorPool((VkDevice)m_LogicalDevice, &poolInfo, nullptr, &pool));
+        m_BindlessHeap.Pool = pool;
+
+        VkDescriptorSetAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = pool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &layout;
+
+        VkDescriptorSet descriptorSet;
+        VK_CHECK(vkAllocateDescriptorSets((VkDevice)m_LogicalDevice, &allocInfo, &descriptorSet));
+        m_BindlessHeap.DescriptorSet = descriptorSet;
+	}
+
+    void ResourceCache::DestroyBindlessHeap()
+    {
+        vkDestroyDescriptorPool((VkDevice)m_LogicalDevice, (VkDescriptorPool)m_BindlessHeap.Pool, nullptr);
+        vkDestroyDescriptorSetLayout((VkDevice)m_LogicalDevice, (VkDescriptorSetLayout)m_BindlessHeap.Layout, nullptr);
+        m_BindlessHeap = {};
+    }
+
+    uint32_t ResourceCache::AllocateBindlessIndex(BindlessBinding binding)
+    {
+        auto& freeIndices = m_BindlessHeap.FreeIndices[(size_t)binding];
+        if (!freeIndices.empty())
+        {
+            uint32_t index = freeIndices.back();
+            freeIndices.pop_back();
+            return index;
+        }
+
+        uint32_t& used = m_BindlessHeap.Used[(size_t)binding];
+        if (used == m_BindlessHeap.Capacity[(size_t)binding])
+        {
+            ARC_LOG_ERROR("Bindless heap is full, binding {} holds {} descriptors!", (uint32_t)binding, used);
+            return InvalidBindlessIndex;
+        }
+        return used++;
+    }
+
+    void ResourceCache::ReleaseBindlessIndex(BindlessBinding binding, uint32_t& index)
+    {
+        if (index == InvalidBindlessIndex)
+            return;
+        // The slot keeps its stale descriptor, partially bound heaps only require the descriptors shaders index to be valid
+        DeferRelease([this, binding, index]() {
+            m_BindlessHeap.FreeIndices[(size_t)binding].push_back(index);
+        });
+        index = InvalidBindlessIndex;
+    }
+
+    bool ResourceCache::ReplaceBindlessIndex(BindlessBinding binding, uint32_t index, uint32_t& newIndex)
+    {
+        newIndex = InvalidBindlessIndex;
+        if (index == InvalidBindlessIndex)
+            return true;
+        newIndex = AllocateBindlessIndex(binding);
+        return newIndex != InvalidBindlessIndex;
+    }
+
+    void ResourceCache::WriteBindlessDescriptors(GpuBuffer* gpuBuffer)
+    {
+        if (gpuBuffer->m_BindlessIndex == InvalidBindlessIndex)
+            return;
+
+        VkDescriptorBufferInfo bufferInfo = {};
+        bufferInfo.buffer = (VkBuffer)gpuBuffer->m_Buffer;
+        bufferInfo.offset = 0;
+        bufferInfo.range = gpuBuffer->m_Size;
+
+        VkWriteDescriptorSet writeInfo = {};
+        writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writeInfo.dstSet = (VkDescriptorSet)m_BindlessHeap.DescriptorSet;
+        writeInfo.dstBinding = (uint32_t)BindlessBinding::StorageBuffer;
+        writeInfo.dstArrayElement = gpuBuffer->m_BindlessIndex;
+        writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writeInfo.descriptorCount = 1;
+        writeInfo.pBufferInfo = &bufferInfo;
+        vkUpdateDescriptorSets((VkDevice)m_LogicalDevice, 1, &writeInfo, 0, nullptr);
+    }
+
+    void ResourceCache::WriteBindlessDescriptors(GpuImage* gpuImage)
+    {
+        VkDescriptorImageInfo imageInfos[2] = {};
+        VkWriteDescriptorSet writeInfos[2] = {};
+        uint32_t writeCount = 0;
+        auto addWrite = [&](BindlessBinding binding, uint32_t index, VkDescriptorType type, VkImageLayout layout) {
+            if (index == InvalidBindlessIndex)
+                return;
+            imageInfos[writeCount].imageView = (VkImageView)gpuImage->m_ImageView;
+            imageInfos[writeCount].imageLayout = layout;
+
+            VkWriteDescriptorSet& writeInfo = writeInfos[writeCount];
+            writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writeInfo.dstSet = (VkDescriptorSet)m_BindlessHeap.DescriptorSet;
+            writeInfo.dstBinding = (uint32_t)binding;
+            writeInfo.dstArrayElement = index;
+            writeInfo.descriptorType = type;
+            writeInfo.descriptorCount = 1;
+            writeInfo.pImageInfo = &imageInfos[writeCount];
+            writeCount++;
+        };
+        addWrite(BindlessBinding::SampledImage, gpuImage->m_SampledIndex, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        addWrite(BindlessBinding::StorageImage, gpuImage->m_StorageIndex, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_IMAGE_LAYOUT_GENERAL);
+
+        if (writeCount > 0)
+            vkUpdateDescriptorSets((VkDevice)m_LogicalDevice, writeCount, writeInfos, 0, nullptr);
+    }
+
+    void ResourceCache::WriteBindlessDescriptors(Sampler* sampler)
+    {
+        if (sampler->m_BindlessIndex == InvalidBindlessIndex)
+            return;
+
+        VkDescriptorImageInfo imageInfo = {};
+        imageInfo.sampler = (VkSampler)sampler->m_Sampler;
+
+        VkWriteDescriptorSet writeInfo = {};
+        writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writeInfo.dstSet = (VkDescriptorSet)m_BindlessHeap.DescriptorSet;
+        writeInfo.dstBinding = (uint32_t)BindlessBinding::Sampler;
+        writeInfo.dstArrayElement = sampler->m_BindlessIndex;
+        writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+        writeInfo.descriptorCount = 1;
+        writeInfo.pImageInfo = &imageInfo;
+        vkUpdateDescriptorSets((VkDevice)m_LogicalDevice, 1, &writeInfo, 0, nullptr);
+    }
+}
\ No newline at end of file
@@ -21,9 +21,9 @@ namespace Arc
 
         VkBufferDeviceAddressInfo addrInfo{ VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO };
         addrInfo.buffer = (VkBuffer)desc.VertexBuffer;
-        vertexBufferDeviceAddress.deviceAddress = vkGetBufferDeviceAddress((VkDevice)m_LogicalDevice, &addrInfo);
+        vertexBufferDeviceAddress.deviceAddress = vkGetBufferDeviceAddress((VkDevice)m_LogicalDevice, &addrInfo) + desc.VertexBufferOffset;
         addrInfo.buffer = (VkBuffer)desc.IndexBuffer;
-        indexBufferDeviceAddress.deviceAddress = vkGetBufferDeviceAddress((VkDevice)m_LogicalDevice, &addrInfo);
+        indexBufferDeviceAddress.deviceAddress = vkGetBufferDeviceAddress((VkDevice)m_LogicalDevice, &addrInfo) + desc.IndexBufferOffset;
 
         //Build
         VkAccelerationStructureGeometryKHR accelerationStructureGeometry{};
@@ -142,19 +142,22 @@ namespace Arc
         bottomLevelAS->m_Allocation = blasAllocation;
         bottomLevelAS->m_DeviceAddress = blasDeviceAddress;
 
-        m_Resources[bottomLevelAS] = ResourceType::BottomLevelAS;
+        RegisterResource(m_BottomLevelAS, bottomLevelAS, desc);
+        SetDebugName(bottomLevelAS, VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR, blasHandle);
+        SetDebugName(bottomLevelAS, VK_OBJECT_TYPE_BUFFER, blasBuffer, blasAllocation);
     }
 
     void ResourceCache::ReleaseResource(BottomLevelAS* bottomLevelAS)
     {
-        if (!m_Resources.contains(bottomLevelAS))
+        if (!UnregisterResource(m_BottomLevelAS, bottomLevelAS))
         {
             ARC_LOG_FATAL("Cannot find BottomLevelAS resource to release!");
+            return;
         }
 
-        vkDestroyAccelerationStructureKHR((VkDevice)m_LogicalDevice, (VkAccelerationStructureKHR)bottomLevelAS->m_Handle, nullptr);
-        vmaDestroyBuffer((VmaAllocator)m_Allocator, (VkBuffer)bottomLevelAS->m_Buffer, (VmaAllocation)bottomLevelAS->m_Allocation);
-
-        m_Resources.erase(bottomLevelAS);
+        DeferRelease([this, handle = bottomLevelAS->m_Handle, buffer = bottomLevelAS->m_Buffer, allocation = bottomLevelAS->m_Allocation]() {
+            vkDestroyAccelerationStructureKHR((VkDevice)m_LogicalDevice, (VkAccelerationStructureKHR)handle, nullptr);
+            vmaDestroyBuffer((VmaAllocator)m_Allocator, (VkBuffer)buffer, (VmaAllocation)allocation);
+        });
     }
 }
\ No newline at end of file
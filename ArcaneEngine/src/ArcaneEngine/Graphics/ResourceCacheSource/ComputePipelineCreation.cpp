@@ -2,14 +2,16 @@
 #include "ArcaneEngine/Core/Log.h"
 #include "ArcaneEngine/Graphics/VulkanCore/VulkanLocal.h"
 #include <vulkan/vulkan_core.h>
+#include <algorithm>
 #include <map>
 
 namespace Arc
 {
-    extern VkDescriptorSetLayout GetDescriptorSetLayout(VkDevice device, std::unordered_map<uint64_t, DescriptorSetLayoutHandle>& map, const std::vector<VkDescriptorSetLayoutBinding>& bindings, uint32_t flags);
+    extern VkDescriptorSetLayout GetDescriptorSetLayout(VkDevice device, LayoutCache<DescriptorSetLayoutHandle>& cache, const std::vector<VkDescriptorSetLayoutBinding>& bindings, uint32_t flags);
+    extern VkPipelineLayout GetPipelineLayout(VkDevice device, LayoutCache<PipelineLayoutHandle>& cache, const std::vector<VkDescriptorSetLayout>& layouts, const VkPushConstantRange& pushConstantRange);
 
-	void ResourceCache::CreateComputePipeline(ComputePipeline* pipeline, const ComputePipelineDesc& desc)
-	{
+    PipelineLayoutHandle ResourceCache::CreateComputePipelineLayout(const ComputePipelineDesc& desc)
+    {
         std::map<uint32_t, std::map<uint32_t, VkDescriptorSetLayoutBinding>> bindings;
         for (auto& b : desc.Shader->m_LayoutBindings)
         {
@@ -28,7 +30,17 @@ namespace Arc
         std::vector<VkDescriptorSetLayout> layouts;
         for (auto& set : bindings)
         {
-            uint32_t flags = desc.UsePushDescriptors ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT : 0;
+            // Sets the shaders skip get an empty layout so the later set numbers stay in place
+            while (layouts.size() < set.first)
+                layouts.push_back(GetDescriptorSetLayout((VkDevice)m_LogicalDevice, m_DescriptorSetLayouts, {}, 0));
+            if (set.first == BindlessSetIndex)
+            {
+                layouts.push_back((VkDescriptorSetLayout)m_BindlessHeap.Layout);
+                continue;
+            }
+            bool isPushDescriptor = desc.UsePushDescriptors ||
+                std::find(desc.PushDescriptorSets.begin(), desc.PushDescriptorSets.end(), set.first) != desc.PushDescriptorSets.end();
+            uint32_t flags = isPushDescriptor ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT : 0;
             std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
             for (auto& binding : set.second)
             {
@@ -44,19 +56,12 @@ namespace Arc
         pushConstantRange.offset = 0;
         pushConstantRange.size = desc.Shader->m_PushConstantSize;
 
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(layouts.size());
-        pipelineLayoutInfo.pSetLayouts = layouts.data();
-        if (desc.Shader->m_PushConstantSize > 0)
-        {
-            pipelineLayoutInfo.pushConstantRangeCount = 1;
-            pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-        }
-
-        VkPipelineLayout pipelineLayout;
-        VK_CHECK(vkCreatePipelineLayout((VkDevice)m_LogicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout));
+        VkPipelineLayout pipelineLayout = GetPipelineLayout((VkDevice)m_LogicalDevice, m_PipelineLayouts, layouts, pushConstantRange);
+        return pipelineLayout;
+    }
 
+    PipelineHandle ResourceCache::CreateComputePipelineHandle(const ComputePipelineDesc& desc, PipelineLayoutHandle pipelineLayout)
+    {
         VkPipelineShaderStageCreateInfo shaderStage = {};
         shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
@@ -68,25 +73,76 @@ namespace Arc
 
         VkComputePipelineCreateInfo pipelineInfo{};
         pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-        pipelineInfo.layout = pipelineLayout;
+        pipelineInfo.layout = (VkPipelineLayout)pipelineLayout;
         pipelineInfo.stage = shaderStage;
 
         VkPipeline computePipeline;
-        VK_CHECK(vkCreateComputePipelines((VkDevice)m_LogicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &computePipeline));
-        pipeline->m_Pipeline = computePipeline;
+        VK_CHECK(vkCreateComputePipelines((VkDevice)m_LogicalDevice, (VkPipelineCache)m_PipelineCache, 1, &pipelineInfo, nullptr, &computePipeline));
+        return computePipeline;
+    }
+
+	void ResourceCache::CreateComputePipeline(ComputePipeline* pipeline, const ComputePipelineDesc& desc)
+	{
+        PipelineLayoutHandle pipelineLayout = CreateComputePipelineLayout(desc);
+
+        auto start = std::chrono::steady_clock::now();
+        pipeline->m_Pipeline = CreateComputePipelineHandle(desc, pipelineLayout);
+        RecordPipelineCreation(start);
         pipeline->m_PipelineLayout = pipelineLayout;
 
-        m_Resources[pipeline] = ResourceType::ComputePipeline;
+        RegisterResource(m_ComputePipelines, pipeline, desc);
+        SetDebugName(pipeline, VK_OBJECT_TYPE_PIPELINE, pipeline->m_Pipeline);
 	}
 
+    void ResourceCache::CreateComputePipelines(ArrayView<ComputePipeline*> pipelines, ArrayView<ComputePipelineDesc> descs)
+    {
+        if (descs.empty())
+            return;
+        if (pipelines.size() != descs.size())
+        {
+            ARC_LOG_ERROR("CreateComputePipelines got {} pipelines for {} descs!", pipelines.size(), descs.size());
+            return;
+        }
+
+        // Layouts go through the shared descriptor set layout map, so only the driver compilation runs on the pool
+        for (size_t i = 0; i < descs.size(); i++)
+        {
+            pipelines[i]->m_PipelineLayout = CreateComputePipelineLayout(descs[i]);
+        }
+
+        ThreadPool* threadPool = GetThreadPool();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < descs.size(); i++)
+        {
+            // The calling thread compiles the last pipeline instead of idling, the pipeline cache is internally synchronized
+            ComputePipeline* pipeline = pipelines[i];
+            const ComputePipelineDesc* desc = &descs[i];
+            if (i + 1 < descs.size())
+                threadPool->Submit([this, pipeline, desc]() { pipeline->m_Pipeline = CreateComputePipelineHandle(*desc, pipeline->m_PipelineLayout); });
+            else
+                pipeline->m_Pipeline = CreateComputePipelineHandle(*desc, pipeline->m_PipelineLayout);
+        }
+        threadPool->Wait();
+
+        // Wall time of the batch, so the stats show the gain over creating the pipelines one after another
+        RecordPipelineCreation(start, (uint32_t)descs.size());
+
+        for (size_t i = 0; i < pipelines.size(); i++)
+        {
+            RegisterResource(m_ComputePipelines, pipelines[i], descs[i]);
+            SetDebugName(pipelines[i], VK_OBJECT_TYPE_PIPELINE, pipelines[i]->m_Pipeline);
+        }
+    }
+
     void ResourceCache::ReleaseResource(ComputePipeline* computePipeline)
     {
-        if (!m_Resources.contains(computePipeline))
+        if (!UnregisterResource(m_ComputePipelines, computePipeline))
         {
             ARC_LOG_FATAL("Cannot find ComputePipeline resource to release!");
+            return;
         }
-        vkDestroyPipelineLayout((VkDevice)m_LogicalDevice, (VkPipelineLayout)computePipeline->m_PipelineLayout, nullptr);
-        vkDestroyPipeline((VkDevice)m_LogicalDevice, (VkPipeline)computePipeline->m_Pipeline, nullptr);
-        m_Resources.erase(computePipeline);
+        DeferRelease([this, pipeline = computePipeline->m_Pipeline]() {
+            vkDestroyPipeline((VkDevice)m_LogicalDevice, (VkPipeline)pipeline, nullptr);
+        });
     }
 }
\ No newline at end of file
@@ -0,0 +1,352 @@
+#include "ArcaneEngine/Graphics/ResourceCache.h"
+#include "ArcaneEngine/Graphics/Device.h"
+#include "ArcaneEngine/Graphics/RenderGraph.h"
+#include "ArcaneEngine/Core/Log.h"
+#include "ArcaneEngine/Graphics/VulkanCore/VulkanLocal.h"
+#include <vulkan/vulkan_core.h>
+#include <vk_mem_alloc.h>
+#include <algorithm>
+
+namespace Arc
+{
+	void ResourceCache::BeginDefragmentation(const DefragmentationDesc& desc)
+	{
+        if (m_DefragmentationContext)
+        {
+            ARC_LOG_WARNING("Defragmentation is already running!");
+            return;
+        }
+
+        VmaDefragmentationInfo defragInfo = {};
+        defragInfo.flags = 0;
+        defragInfo.maxBytesPerPass = desc.MaxBytesPerPass;
+        defragInfo.maxAllocationsPerPass = desc.MaxAllocationsPerPass;
+
+        VmaDefragmentationContext context;
+        VK_CHECK(vmaBeginDefragmentation((VmaAllocator)m_Allocator, &defragInfo, &context));
+        m_DefragmentationContext = context;
+        m_DefragmentationDesc = desc;
+        m_DefragmentationStats = {};
+	}
+
+    void ResourceCache::EndDefragmentation()
+    {
+        if (!m_DefragmentationContext)
+            return;
+        // The pass in flight ends once its copies have executed, the defragmentation is finished right after it
+        if (m_DefragmentationPassPending)
+        {
+            m_DefragmentationEndRequested = true;
+            return;
+        }
+        m_DefragmentationEndRequested = false;
+
+        VmaDefragmentationStats vmaStats = {};
+        vmaEndDefragmentation((VmaAllocator)m_Allocator, (VmaDefragmentationContext)m_DefragmentationContext, &vmaStats);
+        m_DefragmentationContext = nullptr;
+        m_DefragmentationStats.BytesFreed = vmaStats.bytesFreed;
+        m_DefragmentationStats.BlocksFreed = vmaStats.deviceMemoryBlocksFreed;
+
+        ARC_LOG("Defragmentation moved {:.2f} MB in {} allocations over {} passes, freed {} blocks ({:.2f} MB)",
+            m_DefragmentationStats.BytesMoved / (1024.0 * 1024.0), m_DefragmentationStats.AllocationsMoved, m_DefragmentationStats.PassCount,
+            m_DefragmentationStats.BlocksFreed, m_DefragmentationStats.BytesFreed / (1024.0 * 1024.0));
+    }
+
+    void ResourceCache::RecordDefragmentationPass(CommandBufferHandle cmd)
+    {
+        if (!m_DefragmentationContext || m_DefragmentationPassPending)
+            return;
+
+        VmaDefragmentationPassMoveInfo passInfo = {};
+        VkResult result = vmaBeginDefragmentationPass((VmaAllocator)m_Allocator, (VmaDefragmentationContext)m_DefragmentationContext, &passInfo);
+        if (result == VK_SUCCESS)
+        {
+            EndDefragmentation();
+            return;
+        }
+        if (result != VK_INCOMPLETE)
+        {
+            VK_CHECK(result);
+            EndDefragmentation();
+            return;
+        }
+
+        // Only resources whose handles can be swapped behind the cache handle are moved, everything else allocated
+        // from the default pools (acceleration structures, buffer arrays, transient memory, ...) stays in place
+        m_MovableBuffers.clear();
+        for (GpuBuffer* gpuBuffer : m_GpuBuffers)
+        {
+            if (gpuBuffer->m_Movable)
+                m_MovableBuffers.emplace_back(gpuBuffer->m_Allocation, gpuBuffer);
+        }
+        m_MovableImages.clear();
+        for (GpuImage* gpuImage : m_GpuImages)
+        {
+            if (gpuImage->m_Movable)
+                m_MovableImages.emplace_back(gpuImage->m_Allocation, gpuImage);
+        }
+        std::sort(m_MovableBuffers.begin(), m_MovableBuffers.end());
+        std::sort(m_MovableImages.begin(), m_MovableImages.end());
+        auto findMovable = [](auto& movable, AllocationHandle allocation) {
+            auto it = std::lower_bound(movable.begin(), movable.end(), allocation, [](const auto& entry, AllocationHandle key) { return entry.first < key; });
+            return it != movable.end() && it->first == allocation ? it->second : nullptr;
+        };
+
+        std::vector<BufferMove>& bufferMoves = m_BufferMoves;
+        std::vector<ImageMove>& imageMoves = m_ImageMoves;
+        bufferMoves.clear();
+        imageMoves.clear();
+
+        RenderGraph* renderGraph = m_Device->GetRenderGraph();
+        for (uint32_t i = 0; i < passInfo.moveCount; i++)
+        {
+            VmaDefragmentationMove& move = passInfo.pMoves[i];
+            move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+
+            // Frames in flight keep indexing the bindless slots of the old objects, moved resources get new slots
+            ImageLayout layout;
+            if (GpuBuffer* gpuBuffer = findMovable(m_MovableBuffers, move.srcAllocation))
+            {
+                BufferMove bufferMove = { .Buffer = gpuBuffer };
+                if (!renderGraph->GetResourceLayout(gpuBuffer->m_Buffer, layout))
+                    continue;
+                if (!ReplaceBindlessIndex(BindlessBinding::StorageBuffer, gpuBuffer->m_BindlessIndex, bufferMove.NewBindlessIndex))
+                    continue;
+                bufferMove.NewBuffer = CreateMovedBuffer(gpuBuffer, move.dstTmpAllocation);
+                bufferMoves.push_back(bufferMove);
+            }
+            else if (GpuImage* gpuImage = findMovable(m_MovableImages, move.srcAllocation))
+            {
+                // Images that were never transitioned have no contents worth copying and no known layout
+                if (!renderGraph->GetResourceLayout(gpuImage->m_Image, layout) || layout == ImageLayout::Undefined)
+                    continue;
+                ImageMove imageMove = { .Image = gpuImage, .Layout = layout };
+                if (!ReplaceBindlessIndex(BindlessBinding::SampledImage, gpuImage->m_SampledIndex, imageMove.NewSampledIndex))
+                    continue;
+                if (!ReplaceBindlessIndex(BindlessBinding::StorageImage, gpuImage->m_StorageIndex, imageMove.NewStorageIndex))
+                {
+                    ReleaseBindlessIndex(BindlessBinding::SampledImage, imageMove.NewSampledIndex);
+                    continue;
+                }
+                CreateMovedImage(gpuImage, move.dstTmpAllocation, imageMove.NewImage, imageMove.NewImageView);
+                imageMoves.push_back(imageMove);
+            }
+            else
+            {
+                continue;
+            }
+            move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_COPY;
+        }
+
+        if (!bufferMoves.empty() || !imageMoves.empty())
+        {
+            // Recorded at the start of the frame, queue order puts the copies after every earlier frame that used the old resources
+            VkMemoryBarrier copyBarrier = {};
+            copyBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            copyBarrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+            copyBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+            vkCmdPipelineBarrier((VkCommandBuffer)cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &copyBarrier, 0, nullptr, 0, nullptr);
+            for (BufferMove& bufferMove : bufferMoves)
+            {
+                VkBufferCopy copy = {};
+                copy.size = bufferMove.Buffer->m_Size;
+                vkCmdCopyBuffer((VkCommandBuffer)cmd, (VkBuffer)bufferMove.Buffer->m_Buffer, (VkBuffer)bufferMove.NewBuffer, 1, &copy);
+            }
+
+            for (ImageMove& imageMove : imageMoves)
+            {
+                GpuImage* gpuImage = imageMove.Image;
+                VkImageSubresourceRange range = {};
+                range.aspectMask = (VkImageAspectFlags)gpuImage->m_AspectFlags;
+                range.levelCount = gpuImage->m_MipLevels;
+                range.layerCount = 1;
+
+                VkImageMemoryBarrier barriers[2] = {};
+                barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barriers[0].srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+                barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+                barriers[0].oldLayout = (VkImageLayout)imageMove.Layout;
+                barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+                barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barriers[0].image = (VkImage)gpuImage->m_Image;
+                barriers[0].subresourceRange = range;
+
+                barriers[1] = barriers[0];
+                barriers[1].srcAccessMask = 0;
+                barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                barriers[1].image = (VkImage)imageMove.NewImage;
+                vkCmdPipelineBarrier((VkCommandBuffer)cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 2, barriers);
+
+                // A 32 bit extent has at most 32 mip levels
+                VkImageCopy copies[32];
+                uint32_t mipLevels = std::min(gpuImage->m_MipLevels, 32u);
+                for (uint32_t mip = 0; mip < mipLevels; mip++)
+                {
+                    VkImageCopy& copy = copies[mip];
+                    copy = {};
+                    copy.srcSubresource.aspectMask = range.aspectMask;
+                    copy.srcSubresource.mipLevel = mip;
+                    copy.srcSubresource.layerCount = 1;
+                    copy.dstSubresource = copy.srcSubresource;
+                    copy.extent.width = std::max(gpuImage->m_Extent[0] >> mip, 1u);
+                    copy.extent.height = std::max(gpuImage->m_Extent[1] >> mip, 1u);
+                    copy.extent.depth = std::max(gpuImage->m_Extent[2] >> mip, 1u);
+                }
+                vkCmdCopyImage((VkCommandBuffer)cmd, (VkImage)gpuImage->m_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    (VkImage)imageMove.NewImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels, copies);
+
+                // The new image continues in the layout the render graph last recorded for the old one
+                VkImageMemoryBarrier restore = barriers[1];
+                restore.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                restore.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+                restore.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                restore.newLayout = (VkImageLayout)imageMove.Layout;
+                vkCmdPipelineBarrier((VkCommandBuffer)cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 1, &restore);
+            }
+
+            VkMemoryBarrier memoryBarrier = {};
+            memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            memoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+            vkCmdPipelineBarrier((VkCommandBuffer)cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+
+            // The old objects are destroyed without their allocation once the frame has completed,
+            // VMA keeps srcAllocation and points it at the new memory
+            std::vector<const void*>& movedResources = m_MovedResources;
+            movedResources.clear();
+            for (BufferMove& bufferMove : bufferMoves)
+            {
+                GpuBuffer* gpuBuffer = bufferMove.Buffer;
+                DeferRelease([this, buffer = gpuBuffer->m_Buffer]() {
+                    vkDestroyBuffer((VkDevice)m_LogicalDevice, (VkBuffer)buffer, nullptr);
+                });
+                renderGraph->ReplaceResource(gpuBuffer->m_Buffer, bufferMove.NewBuffer);
+                gpuBuffer->m_Buffer = bufferMove.NewBuffer;
+                ReleaseBindlessIndex(BindlessBinding::StorageBuffer, gpuBuffer->m_BindlessIndex);
+                gpuBuffer->m_BindlessIndex = bufferMove.NewBindlessIndex;
+                WriteBindlessDescriptors(gpuBuffer);
+                movedResources.push_back(gpuBuffer);
+
+                VmaAllocationInfo allocInfo;
+                vmaGetAllocationInfo((VmaAllocator)m_Allocator, (VmaAllocation)gpuBuffer->m_Allocation, &allocInfo);
+                m_DefragmentationStats.BytesMoved += allocInfo.size;
+            }
+            for (ImageMove& imageMove : imageMoves)
+            {
+                GpuImage* gpuImage = imageMove.Image;
+                DeferRelease([this, image = gpuImage->m_Image, imageView = gpuImage->m_ImageView]() {
+                    vkDestroyImageView((VkDevice)m_LogicalDevice, (VkImageView)imageView, nullptr);
+                    vkDestroyImage((VkDevice)m_LogicalDevice, (VkImage)image, nullptr);
+                });
+                renderGraph->ReplaceResource(gpuImage->m_Image, imageMove.NewImage);
+                gpuImage->m_Image = imageMove.NewImage;
+                gpuImage->m_ImageView = imageMove.NewImageView;
+                ReleaseBindlessIndex(BindlessBinding::SampledImage, gpuImage->m_SampledIndex);
+                ReleaseBindlessIndex(BindlessBinding::StorageImage, gpuImage->m_StorageIndex);
+                gpuImage->m_SampledIndex = imageMove.NewSampledIndex;
+                gpuImage->m_StorageIndex = imageMove.NewStorageIndex;
+                WriteBindlessDescriptors(gpuImage);
+                movedResources.push_back(gpuImage);
+
+                VmaAllocationInfo allocInfo;
+                vmaGetAllocationInfo((VmaAllocator)m_Allocator, (VmaAllocation)gpuImage->m_Allocation, &allocInfo);
+                m_DefragmentationStats.BytesMoved += allocInfo.size;
+            }
+            m_DefragmentationStats.AllocationsMoved += static_cast<uint32_t>(bufferMoves.size() + imageMoves.size());
+
+            // Sets of other frames in flight may still be pending and their layouts do not allow updates after binding.
+            // Every tracked set that references a moved resource is replaced by a new set with all of its writes, the old
+            // set stays untouched for the frames still using it and is reclaimed when the persistent pools are reset.
+            std::sort(movedResources.begin(), movedResources.end());
+            auto isMoved = [&](const void* resource) {
+                return resource && std::binary_search(movedResources.begin(), movedResources.end(), resource);
+            };
+            std::vector<DescriptorSetHandle>& replacedSets = m_ReplacedDescriptorSets;
+            replacedSets.clear();
+            for (auto& [descriptorSet, trackedSet] : m_TrackedDescriptorWrites)
+            {
+                if (*trackedSet.Owner != descriptorSet)
+                    continue;
+                for (TrackedDescriptorWrite& tracked : trackedSet.Writes)
+                {
+                    if (isMoved(tracked.Buffer) || isMoved(tracked.Image))
+                    {
+                        replacedSets.push_back(descriptorSet);
+                        break;
+                    }
+                }
+            }
+
+            for (DescriptorSetHandle descriptorSet : replacedSets)
+            {
+                auto node = m_TrackedDescriptorWrites.extract(descriptorSet);
+                TrackedDescriptorSet& trackedSet = node.mapped();
+                DescriptorSetHandle newSet = nullptr;
+                AllocateDescriptorSets(m_DescriptorPools, &trackedSet.Layout, 1, &newSet);
+                if (!newSet)
+                {
+                    m_TrackedDescriptorWrites.insert(std::move(node));
+                    continue;
+                }
+
+                // Written one descriptor at a time, the infos only have to live through the update call
+                for (TrackedDescriptorWrite& tracked : trackedSet.Writes)
+                {
+                    VkWriteDescriptorSet writeInfo = {};
+                    writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                    writeInfo.dstSet = (VkDescriptorSet)newSet;
+                    writeInfo.dstBinding = tracked.Binding;
+                    writeInfo.dstArrayElement = tracked.ArrayElement;
+                    writeInfo.descriptorType = (VkDescriptorType)tracked.Type;
+                    writeInfo.descriptorCount = 1;
+                    VkDescriptorBufferInfo bufferInfo = {};
+                    VkDescriptorImageInfo imageInfo = {};
+                    if (tracked.Buffer)
+                    {
+                        bufferInfo = { (VkBuffer)tracked.Buffer->m_Buffer, 0, tracked.Buffer->m_Size };
+                        writeInfo.pBufferInfo = &bufferInfo;
+                    }
+                    else if (tracked.BufferArray)
+                    {
+                        bufferInfo = { (VkBuffer)tracked.BufferArray->GetHandle(tracked.FrameIndex), 0, tracked.BufferArray->GetSize() };
+                        writeInfo.pBufferInfo = &bufferInfo;
+                    }
+                    else
+                    {
+                        VkImageView imageView = tracked.Image ? (VkImageView)tracked.Image->m_ImageView : VK_NULL_HANDLE;
+                        imageInfo = { (VkSampler)tracked.Sampler, imageView, (VkImageLayout)tracked.ImageLayout };
+                        writeInfo.pImageInfo = &imageInfo;
+                    }
+                    vkUpdateDescriptorSets((VkDevice)m_LogicalDevice, 1, &writeInfo, 0, nullptr);
+                }
+
+                *trackedSet.Owner = newSet;
+                node.key() = newSet;
+                m_TrackedDescriptorWrites.insert(std::move(node));
+            }
+
+            if (m_DefragmentationDesc.ImageMoved)
+            {
+                for (ImageMove& imageMove : imageMoves)
+                    m_DefragmentationDesc.ImageMoved(imageMove.Image);
+            }
+        }
+        m_DefragmentationStats.PassCount++;
+
+        // Ending the pass frees the source memory of the moves, so it waits for the frame that copies out of it.
+        // Queued after the old objects, which are destroyed first.
+        m_DefragmentationPassPending = true;
+        DeferRelease([this, moveCount = passInfo.moveCount, moves = passInfo.pMoves]() {
+            m_DefragmentationPassPending = false;
+            VmaDefragmentationPassMoveInfo passInfo = {};
+            passInfo.moveCount = moveCount;
+            passInfo.pMoves = moves;
+            VkResult result = vmaEndDefragmentationPass((VmaAllocator)m_Allocator, (VmaDefragmentationContext)m_DefragmentationContext, &passInfo);
+            if (result == VK_SUCCESS || m_DefragmentationEndRequested)
+                EndDefragmentation();
+        });
+    }
+}
\ No newline at end of file
@@ -5,7 +5,7 @@
 
 namespace Arc
 {
-    extern VkDescriptorSetLayout GetDescriptorSetLayout(VkDevice device, std::unordered_map<uint64_t, DescriptorSetLayoutHandle>& map, const std::vector<VkDescriptorSetLayoutBinding>& bindings, uint32_t flags);
+    extern VkDescriptorSetLayout GetDescriptorSetLayout(VkDevice device, LayoutCache<DescriptorSetLayoutHandle>& cache, const std::vector<VkDescriptorSetLayoutBinding>& bindings, uint32_t flags);
 
 	void ResourceCache::AllocateDescriptorSet(DescriptorSet* descriptor, const DescriptorSetDesc& desc)
 	{
@@ -26,18 +26,34 @@ namespace Arc
 
         VkDescriptorSetLayout layout = GetDescriptorSetLayout((VkDevice)m_LogicalDevice, m_DescriptorSetLayouts, bindings, 0);
 
-        VkDescriptorSetAllocateInfo descAllocInfo = {};
-        descAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        descAllocInfo.descriptorPool = (VkDescriptorPool)m_DescriptorPool;
-        descAllocInfo.descriptorSetCount = 1;
-        descAllocInfo.pSetLayouts = &layout;
-
-        VkDescriptorSet descriptorSet;
-        VK_CHECK(vkAllocateDescriptorSets((VkDevice)m_LogicalDevice, &descAllocInfo, &descriptorSet));
-        descriptor->m_DescriptorSet = descriptorSet;
+        DescriptorSetLayoutHandle layoutHandle = layout;
+        AllocateDescriptorSets(m_DescriptorPools, &layoutHandle, 1, &descriptor->m_DescriptorSet);
         descriptor->m_BindingTypes = types;
+        m_TrackedDescriptorWrites[descriptor->m_DescriptorSet] = { .Layout = layoutHandle, .Owner = &descriptor->m_DescriptorSet };
 	}
 
+    void ResourceCache::AllocateTransientDescriptorSet(DescriptorSet* descriptor, uint32_t frameIndex, const DescriptorSetDesc& desc)
+    {
+        std::vector<VkDescriptorSetLayoutBinding> bindings;
+        std::vector<DescriptorType> types;
+        for (int i = 0; i < desc.Bindings.size(); i++)
+        {
+            VkDescriptorSetLayoutBinding binding = {};
+            binding.binding = i;
+            binding.descriptorCount = desc.Bindings[i].Flags == DescriptorFlag::Bindless ? 1024 : 1;
+            binding.descriptorType = (VkDescriptorType)desc.Bindings[i].Type;
+            binding.stageFlags = (VkShaderStageFlags)desc.Bindings[i].ShaderStage;
+            binding.pImmutableSamplers = nullptr;
+            bindings.push_back(binding);
+
+            types.push_back(desc.Bindings[i].Type);
+        }
+
+        DescriptorSetLayoutHandle layout = GetDescriptorSetLayout((VkDevice)m_LogicalDevice, m_DescriptorSetLayouts, bindings, 0);
+        AllocateDescriptorSets(m_TransientDescriptorPools[frameIndex], &layout, 1, &descriptor->m_DescriptorSet);
+        descriptor->m_BindingTypes = types;
+    }
+
     void ResourceCache::AllocateDescriptorSetArray(DescriptorSetArray* descriptorArray, const DescriptorSetDesc& desc)
     {
         std::vector<VkDescriptorSetLayoutBinding> bindings;
@@ -57,25 +73,142 @@ namespace Arc
 
         VkDescriptorSetLayout layout = GetDescriptorSetLayout((VkDevice)m_LogicalDevice, m_DescriptorSetLayouts, bindings, 0);
 
-        std::vector<VkDescriptorSetLayout> layouts(m_FramesInFlight);
+        std::vector<DescriptorSetLayoutHandle> layouts(m_FramesInFlight);
         for (int i = 0; i < layouts.size(); i++)
             layouts[i] = layout;
 
         descriptorArray->m_DescriptorSets.resize(m_FramesInFlight);
         descriptorArray->m_BindingTypes = types;
+        AllocateDescriptorSets(m_DescriptorPools, layouts.data(), m_FramesInFlight, descriptorArray->m_DescriptorSets.data());
+        for (DescriptorSetHandle& descriptorSet : descriptorArray->m_DescriptorSets)
+            m_TrackedDescriptorWrites[descriptorSet] = { .Layout = layout, .Owner = &descriptorSet };
+    }
+
+    void ResourceCache::TrackDescriptorWrite(DescriptorSetHandle descriptorSet, const TrackedDescriptorWrite& write)
+    {
+        auto it = m_TrackedDescriptorWrites.find(descriptorSet);
+        if (it == m_TrackedDescriptorWrites.end())
+            return;
+        // A later write to the same element replaces the earlier one
+        for (TrackedDescriptorWrite& tracked : it->second.Writes)
+        {
+            if (tracked.Binding == write.Binding && tracked.ArrayElement == write.ArrayElement)
+            {
+                tracked = write;
+                return;
+            }
+        }
+        it->second.Writes.push_back(write);
+    }
+
+    void ResourceCache::TrackDescriptorWrites(DescriptorSet* descriptor, const DescriptorWrite& write)
+    {
+        for (auto& bw : write.m_BufferWrites)
+        {
+            TrackDescriptorWrite(descriptor->m_DescriptorSet, { .Binding = bw.Binding, .ArrayElement = bw.ArrayElement,
+                .Type = descriptor->m_BindingTypes[bw.Binding], .Buffer = bw.Buffer });
+        }
+        for (auto& iw : write.m_ImageWrites)
+        {
+            TrackDescriptorWrite(descriptor->m_DescriptorSet, { .Binding = iw.Binding, .ArrayElement = iw.ArrayElement,
+                .Type = descriptor->m_BindingTypes[iw.Binding], .Image = iw.Image, .ImageLayout = iw.ImageLayout,
+                .Sampler = iw.Sampler ? iw.Sampler->GetHandle() : nullptr });
+        }
+    }
+
+    void ResourceCache::TrackDescriptorWrites(DescriptorSetArray* descriptorArray, const DescriptorWrite& write)
+    {
+        // Device::UpdateDescriptorSet writes every element to index 0
+        for (uint32_t i = 0; i < descriptorArray->m_DescriptorSets.size(); i++)
+        {
+            DescriptorSetHandle descriptorSet = descriptorArray->m_DescriptorSets[i];
+            for (auto& baw : write.m_BufferArrayWrites)
+            {
+                TrackDescriptorWrite(descriptorSet, { .Binding = baw.Binding, .Type = descriptorArray->m_BindingTypes[baw.Binding],
+                    .BufferArray = baw.Buffer, .FrameIndex = i });
+            }
+            for (auto& bw : write.m_BufferWrites)
+            {
+                TrackDescriptorWrite(descriptorSet, { .Binding = bw.Binding, .Type = descriptorArray->m_BindingTypes[bw.Binding], .Buffer = bw.Buffer });
+            }
+            for (auto& iw : write.m_ImageWrites)
+            {
+                TrackDescriptorWrite(descriptorSet, { .Binding = iw.Binding, .Type = descriptorArray->m_BindingTypes[iw.Binding], .Image = iw.Image,
+                    .ImageLayout = iw.ImageLayout, .Sampler = iw.Sampler ? iw.Sampler->GetHandle() : nullptr });
+            }
+        }
+    }
+
+    DescriptorPoolHandle ResourceCache::CreateDescriptorPool()
+    {
+        std::vector<VkDescriptorPoolSize> poolSizes =
+        {
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1024},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 16384},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1024},
+            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1024},
+            {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1024},
+        };
+
+        VkDescriptorPoolCreateInfo descriptorPoolInfo{};
+        descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        descriptorPoolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        descriptorPoolInfo.pPoolSizes = poolSizes.data();
+        descriptorPoolInfo.maxSets = 1024;
+        descriptorPoolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
 
-        VkDescriptorSetAllocateInfo descAllocInfo = {};
-        descAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        descAllocInfo.descriptorPool = (VkDescriptorPool)m_DescriptorPool;
-        descAllocInfo.descriptorSetCount = m_FramesInFlight;
-        descAllocInfo.pSetLayouts = layouts.data();
+        VkDescriptorPool descriptorPool;
+        VK_CHECK(vkCreateDescriptorPool((VkDevice)m_LogicalDevice, &descriptorPoolInfo, nullptr, &descriptorPool));
+        return descriptorPool;
+    }
+
+    void ResourceCache::AllocateDescriptorSets(DescriptorPoolChain& chain, const DescriptorSetLayoutHandle* layouts, uint32_t count, DescriptorSetHandle* descriptorSets)
+    {
+        while (true)
+        {
+            bool newPool = chain.Current == chain.Pools.size();
+            if (newPool)
+                chain.Pools.push_back(CreateDescriptorPool());
+
+            VkDescriptorSetAllocateInfo descAllocInfo = {};
+            descAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            descAllocInfo.descriptorPool = (VkDescriptorPool)chain.Pools[chain.Current];
+            descAllocInfo.descriptorSetCount = count;
+            descAllocInfo.pSetLayouts = (const VkDescriptorSetLayout*)layouts;
+
+            VkResult result = vkAllocateDescriptorSets((VkDevice)m_LogicalDevice, &descAllocInfo, (VkDescriptorSet*)descriptorSets);
+            if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL)
+            {
+                VK_CHECK(result);
+                return;
+            }
+
+            // Sets that do not fit into an empty pool would chain new pools forever
+            if (newPool)
+            {
+                ARC_LOG_ERROR("Failed to allocate {} descriptor sets, they do not fit into an empty descriptor pool!", count);
+                return;
+            }
+            chain.Current++;
+        }
+    }
 
-        std::vector<VkDescriptorSet> descriptorSets(m_FramesInFlight);
-        VK_CHECK(vkAllocateDescriptorSets((VkDevice)m_LogicalDevice, &descAllocInfo, descriptorSets.data()));
+    void ResourceCache::ResetDescriptorPools(DescriptorPoolChain& chain)
+    {
+        for (uint32_t i = 0; i < chain.Pools.size() && i <= chain.Current; i++)
+        {
+            VK_CHECK(vkResetDescriptorPool((VkDevice)m_LogicalDevice, (VkDescriptorPool)chain.Pools[i], 0));
+        }
+        chain.Current = 0;
+    }
 
-        for (uint32_t i = 0; i < m_FramesInFlight; i++)
+    void ResourceCache::DestroyDescriptorPools(DescriptorPoolChain& chain)
+    {
+        for (DescriptorPoolHandle pool : chain.Pools)
         {
-            descriptorArray->m_DescriptorSets[i] = descriptorSets[i];
+            vkDestroyDescriptorPool((VkDevice)m_LogicalDevice, (VkDescriptorPool)pool, nullptr);
         }
+        chain.Pools.clear();
+        chain.Current = 0;
     }
 }
\ No newline at end of file
@@ -1,24 +1,27 @@
-#include "ArcaneEngine/Graphics/VulkanCore/VulkanHandles.h"
+#include "ArcaneEngine/Graphics/ResourceCache.h"
 #include "ArcaneEngine/Graphics/VulkanCore/VulkanLocal.h"
 #include <vulkan/vulkan_core.h>
 #include <vector>
-#include <unordered_map>
 
 namespace Arc
 {
-    VkDescriptorSetLayout GetDescriptorSetLayout(VkDevice device, std::unordered_map<uint64_t, DescriptorSetLayoutHandle>& map, const std::vector<VkDescriptorSetLayoutBinding>& bindings, uint32_t flags)
+    VkDescriptorSetLayout GetDescriptorSetLayout(VkDevice device, LayoutCache<DescriptorSetLayoutHandle>& cache, const std::vector<VkDescriptorSetLayoutBinding>& bindings, uint32_t flags)
     {
-        uint64_t key = std::hash<uint32_t>{}(flags);
-        for (const auto& binding : bindings) {
-            key ^= std::hash<uint64_t>{}(binding.binding) + 0x9e3779b9 + (key << 6) + (key >> 2);
-            key ^= std::hash<uint64_t>{}(binding.descriptorType) + 0x9e3779b9 + (key << 6) + (key >> 2);
-            key ^= std::hash<uint64_t>{}(binding.descriptorCount) + 0x9e3779b9 + (key << 6) + (key >> 2);
-            key ^= std::hash<uint64_t>{}(binding.stageFlags) + 0x9e3779b9 + (key << 6) + (key >> 2);
+        std::vector<uint32_t> description;
+        description.reserve(1 + bindings.size() * 4);
+        description.push_back(flags);
+        for (const auto& binding : bindings)
+        {
+            description.push_back(binding.binding);
+            description.push_back(binding.descriptorType);
+            description.push_back(binding.descriptorCount);
+            description.push_back(binding.stageFlags);
         }
 
-        if (map.contains(key))
+        auto it = cache.find(description);
+        if (it != cache.end())
         {
-            return (VkDescriptorSetLayout)map[key];
+            return (VkDescriptorSetLayout)it->second;
         }
 
         std::vector<VkDescriptorBindingFlags> bindingFlags(bindings.size());
@@ -42,8 +45,46 @@ namespace Arc
         VkDescriptorSetLayout layout;
         VK_CHECK(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout));
 
-        map[key] = layout;
+        cache.emplace(std::move(description), layout);
 
         return layout;
     }
+
+    // Set layouts come from GetDescriptorSetLayout, so equal handles mean equal set descriptions
+    VkPipelineLayout GetPipelineLayout(VkDevice device, LayoutCache<PipelineLayoutHandle>& cache, const std::vector<VkDescriptorSetLayout>& layouts, const VkPushConstantRange& pushConstantRange)
+    {
+        std::vector<uint32_t> description;
+        description.reserve(2 + layouts.size() * 2);
+        description.push_back(pushConstantRange.size > 0 ? pushConstantRange.stageFlags : 0);
+        description.push_back(pushConstantRange.size);
+        for (VkDescriptorSetLayout layout : layouts)
+        {
+            uint64_t handle = (uint64_t)layout;
+            description.push_back((uint32_t)handle);
+            description.push_back((uint32_t)(handle >> 32));
+        }
+
+        auto it = cache.find(description);
+        if (it != cache.end())
+        {
+            return (VkPipelineLayout)it->second;
+        }
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(layouts.size());
+        pipelineLayoutInfo.pSetLayouts = layouts.data();
+        if (pushConstantRange.size > 0)
+        {
+            pipelineLayoutInfo.pushConstantRangeCount = 1;
+            pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+        }
+
+        VkPipelineLayout pipelineLayout;
+        VK_CHECK(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout));
+
+        cache.emplace(std::move(description), pipelineLayout);
+
+        return pipelineLayout;
+    }
 }
\ No newline at end of file
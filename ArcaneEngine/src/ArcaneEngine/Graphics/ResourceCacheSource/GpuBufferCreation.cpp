@@ -6,14 +6,8 @@
 
 namespace Arc
 {
-	void ResourceCache::CreateGpuBuffer(GpuBuffer* gpuBuffer, const GpuBufferDesc& desc)
-	{
-        VkBufferCreateInfo bufferInfo{};
-        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        bufferInfo.size = desc.Size;
-        bufferInfo.usage = (VkBufferUsageFlags)desc.UsageFlags;
-        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
+    static VmaAllocationCreateInfo GetAllocationCreateInfo(const GpuBufferDesc& desc)
+    {
         VmaAllocationCreateInfo allocInfo = {};
         allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
         allocInfo.requiredFlags = (VkMemoryPropertyFlags)desc.MemoryProperty;
@@ -22,30 +16,88 @@ namespace Arc
             allocInfo.requiredFlags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT)
         {
             allocInfo.flags |= VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+            if (desc.PersistentMapping)
+                allocInfo.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
+        }
+        else if (desc.PersistentMapping)
+        {
+            ARC_LOG_ERROR("PersistentMapping requires host visible GpuBuffer memory, the buffer is not mapped!");
         }
+        return allocInfo;
+    }
+
+	void ResourceCache::CreateGpuBuffer(GpuBuffer* gpuBuffer, const GpuBufferDesc& desc)
+	{
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = desc.Size;
+        bufferInfo.usage = (VkBufferUsageFlags)desc.UsageFlags;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo allocInfo = GetAllocationCreateInfo(desc);
+
+        // Device addresses and acceleration structures point into the memory, the buffer has to stay where it is
+        constexpr VkBufferUsageFlags pinnedUsage = VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR;
+        bool movable = desc.Movable && !(allocInfo.requiredFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(bufferInfo.usage & pinnedUsage);
+        if (desc.Movable && !movable)
+            ARC_LOG_WARNING("Buffer {} cannot be Movable, it is host visible or its device address is used", desc.DebugName ? desc.DebugName : "");
+        if (movable)
+            bufferInfo.usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 
         VkBuffer buffer;
         VmaAllocation allocation;
+        VmaAllocationInfo allocationInfo;
         VK_CHECK(vmaCreateBuffer((VmaAllocator)m_Allocator, &bufferInfo, &allocInfo,
             &buffer,
             &allocation,
-            nullptr));
+            &allocationInfo));
+
+        VkMemoryPropertyFlags memoryProperties;
+        vmaGetAllocationMemoryProperties((VmaAllocator)m_Allocator, allocation, &memoryProperties);
 
         gpuBuffer->m_Buffer = buffer;
         gpuBuffer->m_Allocation = allocation;
         gpuBuffer->m_Size = desc.Size;
+        gpuBuffer->m_MappedData = allocationInfo.pMappedData;
+        gpuBuffer->m_HostCoherent = memoryProperties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        gpuBuffer->m_UsageFlags = (BufferUsage)bufferInfo.usage;
+        gpuBuffer->m_Movable = movable;
+        gpuBuffer->m_EngineOwned = desc.EngineOwned;
+        if (bufferInfo.usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT && gpuBuffer->m_BindlessIndex == InvalidBindlessIndex)
+            gpuBuffer->m_BindlessIndex = AllocateBindlessIndex(BindlessBinding::StorageBuffer);
+        WriteBindlessDescriptors(gpuBuffer);
 
-        m_Resources[gpuBuffer] = ResourceType::GpuBuffer;
+        RegisterResource(m_GpuBuffers, gpuBuffer, desc);
+        SetDebugName(gpuBuffer, VK_OBJECT_TYPE_BUFFER, buffer, allocation);
 	}
 
+    BufferHandle ResourceCache::CreateMovedBuffer(GpuBuffer* gpuBuffer, AllocationHandle allocation)
+    {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = gpuBuffer->m_Size;
+        bufferInfo.usage = (VkBufferUsageFlags)gpuBuffer->m_UsageFlags;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkBuffer buffer;
+        VK_CHECK(vkCreateBuffer((VkDevice)m_LogicalDevice, &bufferInfo, nullptr, &buffer));
+        VK_CHECK(vmaBindBufferMemory((VmaAllocator)m_Allocator, (VmaAllocation)allocation, buffer));
+        SetDebugName(gpuBuffer, VK_OBJECT_TYPE_BUFFER, buffer);
+        return buffer;
+    }
+
     void ResourceCache::ReleaseResource(GpuBuffer* gpuBuffer)
     {
-        if (!m_Resources.contains(gpuBuffer))
+        if (!UnregisterResource(m_GpuBuffers, gpuBuffer))
         {
             ARC_LOG_FATAL("Cannot find GpuBuffer resource to release!");
+            return;
         }
-        vmaDestroyBuffer((VmaAllocator)m_Allocator, (VkBuffer)gpuBuffer->m_Buffer, (VmaAllocation)gpuBuffer->m_Allocation);
-        m_Resources.erase(gpuBuffer);
+        DeferRelease([this, buffer = gpuBuffer->m_Buffer, allocation = gpuBuffer->m_Allocation]() {
+            vmaDestroyBuffer((VmaAllocator)m_Allocator, (VkBuffer)buffer, (VmaAllocation)allocation);
+        });
+        ReleaseBindlessIndex(BindlessBinding::StorageBuffer, gpuBuffer->m_BindlessIndex);
+        gpuBuffer->m_MappedData = nullptr;
     }
 
     void ResourceCache::CreateGpuBufferArray(GpuBufferArray* gpuBufferArray, const GpuBufferDesc& desc)
@@ -56,44 +108,53 @@ namespace Arc
         bufferInfo.usage = (VkBufferUsageFlags)desc.UsageFlags;
         bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-        VmaAllocationCreateInfo allocInfo = {};
-        allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
-        allocInfo.requiredFlags = (VkMemoryPropertyFlags)desc.MemoryProperty;
-        if (allocInfo.requiredFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT ||
-            allocInfo.requiredFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT ||
-            allocInfo.requiredFlags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT)
-        {
-            allocInfo.flags |= VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-        }
+        VmaAllocationCreateInfo allocInfo = GetAllocationCreateInfo(desc);
 
         gpuBufferArray->m_Buffers.resize(m_FramesInFlight);
         gpuBufferArray->m_Allocations.resize(m_FramesInFlight);
+        gpuBufferArray->m_MappedData.clear();
+        gpuBufferArray->m_HostCoherent = true;
         gpuBufferArray->m_Size = desc.Size;
+        gpuBufferArray->m_EngineOwned = desc.EngineOwned;
         for (uint32_t i = 0; i < m_FramesInFlight; i++)
         {
             VkBuffer buffer;
             VmaAllocation allocation;
+            VmaAllocationInfo allocationInfo;
             VK_CHECK(vmaCreateBuffer((VmaAllocator)m_Allocator, &bufferInfo, &allocInfo,
                 &buffer,
                 &allocation,
-                nullptr));
+                &allocationInfo));
             gpuBufferArray->m_Buffers[i] = buffer;
             gpuBufferArray->m_Allocations[i] = allocation;
+
+            if (allocationInfo.pMappedData)
+            {
+                VkMemoryPropertyFlags memoryProperties;
+                vmaGetAllocationMemoryProperties((VmaAllocator)m_Allocator, allocation, &memoryProperties);
+                gpuBufferArray->m_MappedData.push_back(allocationInfo.pMappedData);
+                gpuBufferArray->m_HostCoherent &= (memoryProperties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+            }
         }
 
-        m_Resources[gpuBufferArray] = ResourceType::GpuBufferArray;
+        RegisterResource(m_GpuBufferArrays, gpuBufferArray, desc);
+        for (uint32_t i = 0; i < m_FramesInFlight; i++)
+            SetDebugName(gpuBufferArray, VK_OBJECT_TYPE_BUFFER, gpuBufferArray->m_Buffers[i], gpuBufferArray->m_Allocations[i]);
     }
 
     void ResourceCache::ReleaseResource(GpuBufferArray* gpuBufferArray)
     {
-        if (!m_Resources.contains(gpuBufferArray))
+        if (!UnregisterResource(m_GpuBufferArrays, gpuBufferArray))
         {
             ARC_LOG_FATAL("Cannot find GpuBufferArray resource to release!");
+            return;
         }
-        for (int i = 0; i < gpuBufferArray->m_Buffers.size(); i++)
-        {
-            vmaDestroyBuffer((VmaAllocator)m_Allocator, (VkBuffer)gpuBufferArray->m_Buffers[i], (VmaAllocation)gpuBufferArray->m_Allocations[i]);
-        }
-        m_Resources.erase(gpuBufferArray);
+        DeferRelease([this, buffers = std::move(gpuBufferArray->m_Buffers), allocations = std::move(gpuBufferArray->m_Allocations)]() {
+            for (int i = 0; i < buffers.size(); i++)
+            {
+                vmaDestroyBuffer((VmaAllocator)m_Allocator, (VkBuffer)buffers[i], (VmaAllocation)allocations[i]);
+            }
+        });
+        gpuBufferArray->m_MappedData.clear();
     }
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "ArcaneEngine/Graphics/ResourceCache.h"
+#include "ArcaneEngine/Graphics/Device.h"
 #include "ArcaneEngine/Core/Log.h"
 #include "ArcaneEngine/Graphics/VulkanCore/VulkanLocal.h"
 #include <vulkan/vulkan_core.h>
@@ -6,25 +7,17 @@
 
 namespace Arc
 {
-	void ResourceCache::CreateGpuImage(GpuImage* gpuImage, const GpuImageDesc& desc)
-	{
+    static VkImageCreateInfo GetImageCreateInfo(const GpuImageDesc& desc)
+    {
 
         //image->m_MipLevels = 1;
         //if (imageDescription.MipLevelsEnabled)
         //    image->m_MipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(image->m_Width, image->m_Height)))) + 1;
 
-        VkImageType imageType = VK_IMAGE_TYPE_2D;
-        VkImageViewType imageViewType = VK_IMAGE_VIEW_TYPE_2D;
-        if (desc.Extent[2] > 1)
-        {
-            imageType = VK_IMAGE_TYPE_3D;
-            imageViewType = VK_IMAGE_VIEW_TYPE_3D;
-        }
-
         VkImageCreateInfo imageInfo = {};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
         imageInfo.pNext = nullptr;
-        imageInfo.imageType = imageType;
+        imageInfo.imageType = desc.Extent[2] > 1 ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D;
         imageInfo.format = (VkFormat)desc.Format;
         imageInfo.extent.width = desc.Extent[0];
         imageInfo.extent.height = desc.Extent[1];
@@ -41,20 +34,15 @@ namespace Arc
         if (desc.MipLevels > 1)
             imageInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 
-        VmaAllocationCreateInfo allocInfo = {};
-        allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
-        allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-
-        VkImage image;
-        VmaAllocation allocation;
-        VK_CHECK(vmaCreateImage((VmaAllocator)m_Allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr));
-        gpuImage->m_Image = image;
-        gpuImage->m_Allocation = allocation;
+        return imageInfo;
+    }
 
+    static VkImageView CreateImageView(VkDevice device, VkImage image, const GpuImageDesc& desc)
+    {
         VkImageViewCreateInfo imageViewInfo{};
         imageViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
         imageViewInfo.image = image;
-        imageViewInfo.viewType = imageViewType;
+        imageViewInfo.viewType = desc.Extent[2] > 1 ? VK_IMAGE_VIEW_TYPE_3D : VK_IMAGE_VIEW_TYPE_2D;
         imageViewInfo.format = (VkFormat)desc.Format;
         imageViewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
         imageViewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
@@ -65,28 +53,174 @@ namespace Arc
         imageViewInfo.subresourceRange.levelCount = desc.MipLevels;
         imageViewInfo.subresourceRange.baseArrayLayer = 0;
         imageViewInfo.subresourceRange.layerCount = 1;
-        
+
         VkImageView imageView;
-        VK_CHECK(vkCreateImageView((VkDevice)m_LogicalDevice, &imageViewInfo, nullptr, &imageView));
-        gpuImage->m_ImageView = imageView;
+        VK_CHECK(vkCreateImageView(device, &imageViewInfo, nullptr, &imageView));
+        return imageView;
+    }
+
+	void ResourceCache::CreateGpuImage(GpuImage* gpuImage, const GpuImageDesc& desc)
+	{
+        VkImageCreateInfo imageInfo = GetImageCreateInfo(desc);
+        if (desc.Movable)
+            imageInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+        VkImage image;
+        VmaAllocation allocation;
+        VK_CHECK(vmaCreateImage((VmaAllocator)m_Allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr));
+        gpuImage->m_Image = image;
+        gpuImage->m_Allocation = allocation;
+        gpuImage->m_ImageView = CreateImageView((VkDevice)m_LogicalDevice, image, desc);
         gpuImage->m_Format = desc.Format;
         gpuImage->m_Extent[0] = desc.Extent[0];
         gpuImage->m_Extent[1] = desc.Extent[1];
         gpuImage->m_Extent[2] = desc.Extent[2];
         gpuImage->m_MipLevels = desc.MipLevels;
+        gpuImage->m_UsageFlags = (ImageUsage)imageInfo.usage;
+        gpuImage->m_AspectFlags = desc.AspectFlags;
+        gpuImage->m_Movable = desc.Movable;
+        // A view of both depth and stencil cannot be sampled
+        if (imageInfo.usage & VK_IMAGE_USAGE_SAMPLED_BIT && desc.AspectFlags != (ImageAspect::Depth | ImageAspect::Stencil) && gpuImage->m_SampledIndex == InvalidBindlessIndex)
+            gpuImage->m_SampledIndex = AllocateBindlessIndex(BindlessBinding::SampledImage);
+        if (imageInfo.usage & VK_IMAGE_USAGE_STORAGE_BIT && gpuImage->m_StorageIndex == InvalidBindlessIndex)
+            gpuImage->m_StorageIndex = AllocateBindlessIndex(BindlessBinding::StorageImage);
+        WriteBindlessDescriptors(gpuImage);
 
-        m_Resources[gpuImage] = ResourceType::GpuImage;
+        RegisterResource(m_GpuImages, gpuImage, desc);
+        SetDebugName(gpuImage, VK_OBJECT_TYPE_IMAGE, image, allocation);
+        SetDebugName(gpuImage, VK_OBJECT_TYPE_IMAGE_VIEW, gpuImage->m_ImageView);
     }
 
+    void ResourceCache::CreateMovedImage(GpuImage* gpuImage, AllocationHandle allocation, ImageHandle& image, ImageViewHandle& imageView)
+    {
+        GpuImageDesc desc = {
+            .Extent = { gpuImage->m_Extent[0], gpuImage->m_Extent[1], gpuImage->m_Extent[2] },
+            .Format = gpuImage->m_Format,
+            .UsageFlags = gpuImage->m_UsageFlags,
+            .AspectFlags = gpuImage->m_AspectFlags,
+            .MipLevels = gpuImage->m_MipLevels,
+        };
+        VkImageCreateInfo imageInfo = GetImageCreateInfo(desc);
+
+        VkImage newImage;
+        VK_CHECK(vkCreateImage((VkDevice)m_LogicalDevice, &imageInfo, nullptr, &newImage));
+        VK_CHECK(vmaBindImageMemory((VmaAllocator)m_Allocator, (VmaAllocation)allocation, newImage));
+        image = newImage;
+        imageView = CreateImageView((VkDevice)m_LogicalDevice, newImage, desc);
+        SetDebugName(gpuImage, VK_OBJECT_TYPE_IMAGE, image);
+        SetDebugName(gpuImage, VK_OBJECT_TYPE_IMAGE_VIEW, imageView);
+    }
+
+    void ResourceCache::CreateTransientGpuImage(GpuImage* gpuImage, const GpuImageDesc& desc)
+    {
+        VkImageCreateInfo imageInfo = GetImageCreateInfo(desc);
+
+        VkImage image;
+        VK_CHECK(vkCreateImage((VkDevice)m_LogicalDevice, &imageInfo, nullptr, &image));
+        gpuImage->m_Image = image;
+        gpuImage->m_Allocation = nullptr;
+        gpuImage->m_ImageView = nullptr;
+        gpuImage->m_Format = desc.Format;
+        gpuImage->m_Extent[0] = desc.Extent[0];
+        gpuImage->m_Extent[1] = desc.Extent[1];
+        gpuImage->m_Extent[2] = desc.Extent[2];
+        gpuImage->m_MipLevels = desc.MipLevels;
+
+        RegisterResource(m_TransientGpuImages, gpuImage, desc);
+        SetDebugName(gpuImage, VK_OBJECT_TYPE_IMAGE, image);
+    }
+
+    void ResourceCache::BindTransientGpuImage(GpuImage* gpuImage, const GpuImageDesc& desc, AllocationHandle allocation, uint64_t offset)
+    {
+        if (gpuImage->m_ImageView)
+        {
+            ARC_LOG_ERROR("Transient GpuImage memory is already bound!");
+            return;
+        }
+        VK_CHECK(vmaBindImageMemory2((VmaAllocator)m_Allocator, (VmaAllocation)allocation, offset, (VkImage)gpuImage->m_Image, nullptr));
+        gpuImage->m_Allocation = allocation;
+        gpuImage->m_ImageView = CreateImageView((VkDevice)m_LogicalDevice, (VkImage)gpuImage->m_Image, desc);
+    }
+
+    void ResourceCache::RetireTransientGpuImage(GpuImage* gpuImage, GpuImage* retired)
+    {
+        GpuImage** registered = m_TransientGpuImages.Get(gpuImage->m_CacheHandle);
+        if (!registered || *registered != gpuImage)
+        {
+            ARC_LOG_FATAL("Cannot find transient GpuImage resource to retire!");
+            return;
+        }
+        // The slot moves over to retired together with the handle
+        *retired = *gpuImage;
+        *registered = retired;
+        gpuImage->m_Image = nullptr;
+        gpuImage->m_ImageView = nullptr;
+        gpuImage->m_Allocation = nullptr;
+        gpuImage->m_CacheHandle = {};
+    }
+
+    MemoryRequirements ResourceCache::GetMemoryRequirements(GpuImage* gpuImage)
+    {
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements((VkDevice)m_LogicalDevice, (VkImage)gpuImage->m_Image, &requirements);
+        return MemoryRequirements{
+            .Size = requirements.size,
+            .Alignment = requirements.alignment,
+            .MemoryTypeBits = requirements.memoryTypeBits
+        };
+    }
+
+    AllocationHandle ResourceCache::AllocateMemory(const MemoryRequirements& requirements)
+    {
+        VkMemoryRequirements memoryRequirements = {};
+        memoryRequirements.size = requirements.Size;
+        memoryRequirements.alignment = requirements.Alignment;
+        memoryRequirements.memoryTypeBits = requirements.MemoryTypeBits;
+
+        VmaAllocationCreateInfo allocInfo = {};
+        allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        allocInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+
+        VmaAllocation allocation;
+        VmaAllocationInfo allocationInfo;
+        VK_CHECK(vmaAllocateMemory((VmaAllocator)m_Allocator, &memoryRequirements, &allocInfo, &allocation, &allocationInfo));
+        m_TransientImageMemoryBytes += allocationInfo.size;
+        return allocation;
+    }
+
+    void ResourceCache::FreeMemory(AllocationHandle allocation)
+    {
+        VmaAllocationInfo allocationInfo;
+        vmaGetAllocationInfo((VmaAllocator)m_Allocator, (VmaAllocation)allocation, &allocationInfo);
+        m_TransientImageMemoryBytes -= allocationInfo.size;
+        vmaFreeMemory((VmaAllocator)m_Allocator, (VmaAllocation)allocation);
+    }
 
     void ResourceCache::ReleaseResource(GpuImage* gpuImage)
     {
-        if (!m_Resources.contains(gpuImage))
+        bool transient = UnregisterResource(m_TransientGpuImages, gpuImage);
+        if (!transient && !UnregisterResource(m_GpuImages, gpuImage))
         {
             ARC_LOG_FATAL("Cannot find GpuImage resource to release!");
+            return;
         }
-        vmaDestroyImage((VmaAllocator)m_Allocator, (VkImage)gpuImage->m_Image, (VmaAllocation)gpuImage->m_Allocation);
-        vkDestroyImageView((VkDevice)m_LogicalDevice, (VkImageView)gpuImage->m_ImageView, nullptr);
-        m_Resources.erase(gpuImage);
+        DeferRelease([this, transient, image = gpuImage->m_Image, imageView = gpuImage->m_ImageView, allocation = gpuImage->m_Allocation]() {
+            // Transient images do not own their memory, it is shared with other images and freed by the RenderGraph
+            if (transient)
+                vkDestroyImage((VkDevice)m_LogicalDevice, (VkImage)image, nullptr);
+            else
+                vmaDestroyImage((VmaAllocator)m_Allocator, (VkImage)image, (VmaAllocation)allocation);
+            if (imageView)
+                vkDestroyImageView((VkDevice)m_LogicalDevice, (VkImageView)imageView, nullptr);
+        });
+        ReleaseBindlessIndex(BindlessBinding::SampledImage, gpuImage->m_SampledIndex);
+        ReleaseBindlessIndex(BindlessBinding::StorageImage, gpuImage->m_StorageIndex);
+        if (RenderGraph* renderGraph = m_Device->GetRenderGraph())
+            renderGraph->ForgetResource(gpuImage->m_Image);
     }
 }
\ No newline at end of file
@@ -7,7 +7,8 @@
 
 namespace Arc
 {
-    extern VkDescriptorSetLayout GetDescriptorSetLayout(VkDevice device, std::unordered_map<uint64_t, DescriptorSetLayoutHandle>& map, const std::vector<VkDescriptorSetLayoutBinding>& bindings, uint32_t flags);
+    extern VkDescriptorSetLayout GetDescriptorSetLayout(VkDevice device, LayoutCache<DescriptorSetLayoutHandle>& cache, const std::vector<VkDescriptorSetLayoutBinding>& bindings, uint32_t flags);
+    extern VkPipelineLayout GetPipelineLayout(VkDevice device, LayoutCache<PipelineLayoutHandle>& cache, const std::vector<VkDescriptorSetLayout>& layouts, const VkPushConstantRange& pushConstantRange);
 
 	void ResourceCache::CreatePipeline(Pipeline* pipeline, const PipelineDesc& desc)
 	{
@@ -180,6 +181,20 @@ namespace Arc
         std::vector<VkDescriptorSetLayout> layouts;
         for (auto& set : bindings)
         {
+            // Sets the shaders skip get an empty layout so the later set numbers stay in place
+            while (layouts.size() < set.first)
+                layouts.push_back(GetDescriptorSetLayout((VkDevice)m_LogicalDevice, m_DescriptorSetLayouts, {}, 0));
+            if (set.first == BindlessSetIndex)
+            {
+                for (auto& binding : set.second)
+                {
+                    if (binding.second.stageFlags & ~m_BindlessHeap.StageFlags)
+                        ARC_LOG_ERROR("Pipeline {} uses the bindless heap from stage 0x{:x}, which the heap layout does not include!",
+                            desc.DebugName ? desc.DebugName : "", binding.second.stageFlags & ~m_BindlessHeap.StageFlags);
+                }
+                layouts.push_back((VkDescriptorSetLayout)m_BindlessHeap.Layout);
+                continue;
+            }
             uint32_t flags = desc.UsePushDescriptors ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT : 0;
             std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
             for (auto& binding : set.second)
@@ -192,18 +207,7 @@ namespace Arc
         }
 
 
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(layouts.size());
-        pipelineLayoutInfo.pSetLayouts = layouts.data();
-        if (pushConstantSize > 0)
-        {
-            pipelineLayoutInfo.pushConstantRangeCount = 1;
-            pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-        }
-
-        VkPipelineLayout pipelineLayout;
-        VK_CHECK(vkCreatePipelineLayout((VkDevice)m_LogicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout));
+        VkPipelineLayout pipelineLayout = GetPipelineLayout((VkDevice)m_LogicalDevice, m_PipelineLayouts, layouts, pushConstantRange);
         pipeline->m_PipelineLayout = pipelineLayout;
 
         std::vector<VkPipelineShaderStageCreateInfo> shaderStages(desc.ShaderStages.size());
@@ -242,20 +246,24 @@ namespace Arc
         pipelineInfo.basePipelineIndex = -1;
 
         VkPipeline pipelineTemp;
-        VK_CHECK(vkCreateGraphicsPipelines((VkDevice)m_LogicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipelineTemp));
+        auto start = std::chrono::steady_clock::now();
+        VK_CHECK(vkCreateGraphicsPipelines((VkDevice)m_LogicalDevice, (VkPipelineCache)m_PipelineCache, 1, &pipelineInfo, nullptr, &pipelineTemp));
+        RecordPipelineCreation(start);
         pipeline->m_Pipeline = pipelineTemp;
 
-        m_Resources[pipeline] = ResourceType::Pipeline;
+        RegisterResource(m_Pipelines, pipeline, desc);
+        SetDebugName(pipeline, VK_OBJECT_TYPE_PIPELINE, pipelineTemp);
 	}
 
     void ResourceCache::ReleaseResource(Pipeline* pipeline)
     {
-        if (!m_Resources.contains(pipeline))
+        if (!UnregisterResource(m_Pipelines, pipeline))
         {
             ARC_LOG_FATAL("Cannot find Pipeline resource to release!");
+            return;
         }
-        vkDestroyPipelineLayout((VkDevice)m_LogicalDevice, (VkPipelineLayout)pipeline->m_PipelineLayout, nullptr);
-        vkDestroyPipeline((VkDevice)m_LogicalDevice, (VkPipeline)pipeline->m_Pipeline, nullptr);
-        m_Resources.erase(pipeline);
+        DeferRelease([this, handle = pipeline->m_Pipeline]() {
+            vkDestroyPipeline((VkDevice)m_LogicalDevice, (VkPipeline)handle, nullptr);
+        });
     }
 }
\ No newline at end of file
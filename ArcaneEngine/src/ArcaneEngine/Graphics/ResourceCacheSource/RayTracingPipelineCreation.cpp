@@ -25,7 +25,8 @@ namespace Arc
 
     extern PFN_vkCreateRayTracingPipelinesKHR vkCreateRayTracingPipelinesKHR;
     extern PFN_vkGetRayTracingShaderGroupHandlesKHR  vkGetRayTracingShaderGroupHandlesKHR;
-    extern VkDescriptorSetLayout GetDescriptorSetLayout(VkDevice device, std::unordered_map<uint64_t, DescriptorSetLayoutHandle>& map, const std::vector<VkDescriptorSetLayoutBinding>& bindings, uint32_t flags);
+    extern VkDescriptorSetLayout GetDescriptorSetLayout(VkDevice device, LayoutCache<DescriptorSetLayoutHandle>& cache, const std::vector<VkDescriptorSetLayoutBinding>& bindings, uint32_t flags);
+    extern VkPipelineLayout GetPipelineLayout(VkDevice device, LayoutCache<PipelineLayoutHandle>& cache, const std::vector<VkDescriptorSetLayout>& layouts, const VkPushConstantRange& pushConstantRange);
 
     void ResourceCache::CreateRayTracingPipeline(RayTracingPipeline* pipeline, const RayTracingPipelineDesc& desc)
     {
@@ -54,6 +55,14 @@ namespace Arc
         std::vector<VkDescriptorSetLayout> layouts;
         for (auto& set : bindings)
         {
+            // Sets the shaders skip get an empty layout so the later set numbers stay in place
+            while (layouts.size() < set.first)
+                layouts.push_back(GetDescriptorSetLayout((VkDevice)m_LogicalDevice, m_DescriptorSetLayouts, {}, 0));
+            if (set.first == BindlessSetIndex)
+            {
+                layouts.push_back((VkDescriptorSetLayout)m_BindlessHeap.Layout);
+                continue;
+            }
             bool isPushDescriptor = false;
             for (const uint32_t& pd : desc.PushDescriptorSets)
             {
@@ -84,18 +93,7 @@ namespace Arc
         pushConstantRange.offset = 0;
         pushConstantRange.size = pushConstantSize;
 
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(layouts.size());
-        pipelineLayoutInfo.pSetLayouts = layouts.data();
-        if (pushConstantSize > 0)
-        {
-            pipelineLayoutInfo.pushConstantRangeCount = 1;
-            pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-        }
-
-        VkPipelineLayout pipelineLayout;
-        VK_CHECK(vkCreatePipelineLayout((VkDevice)m_LogicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout));
+        VkPipelineLayout pipelineLayout = GetPipelineLayout((VkDevice)m_LogicalDevice, m_PipelineLayouts, layouts, pushConstantRange);
 
         std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
         std::vector<VkRayTracingShaderGroupCreateInfoKHR> shaderGroups;
@@ -188,7 +186,9 @@ namespace Arc
         rayTracingPipelineCI.layout = pipelineLayout;
 
         VkPipeline rtPipeline;
-        VK_CHECK(vkCreateRayTracingPipelinesKHR((VkDevice)m_LogicalDevice, VK_NULL_HANDLE, VK_NULL_HANDLE, 1, &rayTracingPipelineCI, nullptr, &rtPipeline));
+        auto start = std::chrono::steady_clock::now();
+        VK_CHECK(vkCreateRayTracingPipelinesKHR((VkDevice)m_LogicalDevice, VK_NULL_HANDLE, (VkPipelineCache)m_PipelineCache, 1, &rayTracingPipelineCI, nullptr, &rtPipeline));
+        RecordPipelineCreation(start);
 
 
         VkPhysicalDeviceRayTracingPipelinePropertiesKHR rayProps{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_PROPERTIES_KHR };
@@ -257,18 +257,22 @@ namespace Arc
         pipeline->m_PipelineLayout = pipelineLayout;
         pipeline->m_ShaderBindingTableBuffer = buffer;
         pipeline->m_ShaderBindingTableAllocation = allocation;
-        m_Resources[pipeline] = ResourceType::RayTracingPipeline;
+        RegisterResource(m_RayTracingPipelines, pipeline, desc);
+        SetDebugName(pipeline, VK_OBJECT_TYPE_PIPELINE, rtPipeline);
+        SetDebugName(pipeline, VK_OBJECT_TYPE_BUFFER, buffer, allocation);
     }
 
     void ResourceCache::ReleaseResource(RayTracingPipeline* raytracingPipeline)
     {
-        if (!m_Resources.contains(raytracingPipeline))
+        if (!UnregisterResource(m_RayTracingPipelines, raytracingPipeline))
         {
             ARC_LOG_FATAL("Cannot find RayTracingPipeline resource to release!");
+            return;
         }
-        vmaDestroyBuffer((VmaAllocator)m_Allocator, (VkBuffer)raytracingPipeline->m_ShaderBindingTableBuffer, (VmaAllocation)raytracingPipeline->m_ShaderBindingTableAllocation);
-        vkDestroyPipelineLayout((VkDevice)m_LogicalDevice, (VkPipelineLayout)raytracingPipeline->m_PipelineLayout, nullptr);
-        vkDestroyPipeline((VkDevice)m_LogicalDevice, (VkPipeline)raytracingPipeline->m_Pipeline, nullptr);
-        m_Resources.erase(raytracingPipeline);
+        DeferRelease([this, buffer = raytracingPipeline->m_ShaderBindingTableBuffer, allocation = raytracingPipeline->m_ShaderBindingTableAllocation,
+            pipeline = raytracingPipeline->m_Pipeline]() {
+            vmaDestroyBuffer((VmaAllocator)m_Allocator, (VkBuffer)buffer, (VmaAllocation)allocation);
+            vkDestroyPipeline((VkDevice)m_LogicalDevice, (VkPipeline)pipeline, nullptr);
+        });
     }
 }
\ No newline at end of file
@@ -29,18 +29,25 @@ namespace Arc
         VkSampler samplerEx;
         VK_CHECK(vkCreateSampler((VkDevice)m_LogicalDevice, &samplerInfo, nullptr, &samplerEx));
         sampler->m_Sampler = samplerEx;
+        if (sampler->m_BindlessIndex == InvalidBindlessIndex)
+            sampler->m_BindlessIndex = AllocateBindlessIndex(BindlessBinding::Sampler);
+        WriteBindlessDescriptors(sampler);
 
-        m_Resources[sampler] = ResourceType::Sampler;
+        RegisterResource(m_Samplers, sampler, desc);
+        SetDebugName(sampler, VK_OBJECT_TYPE_SAMPLER, samplerEx);
 
 	}
 
     void ResourceCache::ReleaseResource(Sampler* sampler)
     {
-        if (!m_Resources.contains(sampler))
+        if (!UnregisterResource(m_Samplers, sampler))
         {
             ARC_LOG_FATAL("Cannot find Sampler resource to release!");
+            return;
         }
-        vkDestroySampler((VkDevice)m_LogicalDevice, (VkSampler)sampler->m_Sampler, nullptr);
-        m_Resources.erase(sampler);
+        DeferRelease([this, handle = sampler->m_Sampler]() {
+            vkDestroySampler((VkDevice)m_LogicalDevice, (VkSampler)handle, nullptr);
+        });
+        ReleaseBindlessIndex(BindlessBinding::Sampler, sampler->m_BindlessIndex);
     }
 }
\ No newline at end of file
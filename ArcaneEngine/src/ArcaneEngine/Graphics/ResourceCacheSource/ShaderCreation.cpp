@@ -1,8 +1,12 @@
 #include "ArcaneEngine/Graphics/ResourceCache.h"
 #include "ArcaneEngine/Core/Log.h"
+#include "ArcaneEngine/Core/Hash.h"
 #include "ArcaneEngine/Graphics/VulkanCore/VulkanLocal.h"
 #include <vulkan/vulkan_core.h>
 #include <spirv_cross/spirv_cross.hpp>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 
 namespace Arc
 {
@@ -14,18 +18,68 @@ namespace Arc
             return;
         }
 
-        VkShaderModuleCreateInfo createInfo = {};
-        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = desc.SpirV.size() * sizeof(uint32_t);
-        createInfo.pCode = reinterpret_cast<const uint32_t*>(desc.SpirV.data());
+        uint64_t hash = HashBytes(desc.SpirV.data(), desc.SpirV.size() * sizeof(uint32_t));
+        uint64_t checkHash = HashBytes(desc.SpirV.data(), desc.SpirV.size() * sizeof(uint32_t), ShaderCheckHashSeed);
+        auto it = m_ShaderCache.find(hash);
+        ShaderCacheEntry* entry = nullptr;
+        if (it != m_ShaderCache.end())
+        {
+            if (it->second.CheckHash == checkHash && it->second.WordCount == desc.SpirV.size())
+                entry = &it->second;
+            else
+                ARC_LOG_WARNING("Shader hash collision, the shader is reflected and created without the shader cache");
+        }
+        else
+        {
+            entry = &m_ShaderCache[hash];
+            entry->CheckHash = checkHash;
+            entry->WordCount = desc.SpirV.size();
+            ReflectShader(desc.SpirV, entry->Reflection);
+        }
+        if (entry)
+            entry->Used = true;
+
+        ShaderReflection collisionReflection;
+        if (!entry)
+            ReflectShader(desc.SpirV, collisionReflection);
+        const ShaderReflection& reflection = entry ? entry->Reflection : collisionReflection;
+
+        // Identical SPIR-V shares one module, the last Shader released destroys it
+        if (entry && entry->Module)
+        {
+            shader->m_Module = entry->Module;
+            entry->ModuleRefCount++;
+        }
+        else
+        {
+            VkShaderModuleCreateInfo createInfo = {};
+            createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            createInfo.codeSize = desc.SpirV.size() * sizeof(uint32_t);
+            createInfo.pCode = reinterpret_cast<const uint32_t*>(desc.SpirV.data());
 
-        VkShaderModule shaderModule;
-        VK_CHECK(vkCreateShaderModule((VkDevice)m_LogicalDevice, &createInfo, nullptr, &shaderModule));
-        shader->m_Module = shaderModule;
+            VkShaderModule shaderModule;
+            VK_CHECK(vkCreateShaderModule((VkDevice)m_LogicalDevice, &createInfo, nullptr, &shaderModule));
+            shader->m_Module = shaderModule;
+            if (entry)
+            {
+                entry->Module = shaderModule;
+                entry->ModuleRefCount = 1;
+            }
+        }
+        shader->m_SpirVHash = entry ? hash : 0;
         shader->m_EntryPoint = desc.EntryPoint;
         shader->m_ShaderStage = desc.ShaderStage;
+        shader->m_PushConstantSize = reflection.PushConstantSize;
+        shader->m_StageOutputs = reflection.StageOutputs;
+        shader->m_LayoutBindings = reflection.LayoutBindings;
+
+        RegisterResource(m_Shaders, shader, desc);
+        SetDebugName(shader, VK_OBJECT_TYPE_SHADER_MODULE, shader->m_Module);
+	}
 
-        spirv_cross::Compiler compiler(desc.SpirV);
+    void ResourceCache::ReflectShader(const std::vector<uint32_t>& spirV, ShaderReflection& reflection)
+    {
+        spirv_cross::Compiler compiler(spirV);
         spirv_cross::ShaderResources resources = compiler.get_shader_resources();
 
         // TODO reflect vertex attribute/binding data
@@ -66,14 +120,14 @@ namespace Arc
             // Should be maximum one push constant
             const auto& bufferType = compiler.get_type(resource.base_type_id);
             uint32_t size = static_cast<uint32_t>(compiler.get_declared_struct_size(bufferType));
-            shader->m_PushConstantSize = size;
+            reflection.PushConstantSize = size;
         }
 
         const uint32_t bindlessCount = 1024;
 
-        shader->m_StageOutputs = 0;
+        reflection.StageOutputs = 0;
         for (const auto& output : resources.stage_outputs)
-            shader->m_StageOutputs++;
+            reflection.StageOutputs++;
         
         for (const auto& resource : resources.sampled_images)
         {
@@ -90,7 +144,7 @@ namespace Arc
             layoutBinding.binding = binding;
             layoutBinding.descriptorCount = count;
             layoutBinding.descriptorType = DescriptorType::CombinedImageSampler;
-            shader->m_LayoutBindings.push_back(layoutBinding);
+            reflection.LayoutBindings.push_back(layoutBinding);
         }
 
         for (const auto& resource : resources.uniform_buffers)
@@ -109,7 +163,7 @@ namespace Arc
             layoutBinding.binding = binding;
             layoutBinding.descriptorCount = count;
             layoutBinding.descriptorType = DescriptorType::UniformBuffer;
-            shader->m_LayoutBindings.push_back(layoutBinding);
+            reflection.LayoutBindings.push_back(layoutBinding);
         }
 
         for (const auto& resource : resources.storage_buffers)
@@ -128,7 +182,7 @@ namespace Arc
             layoutBinding.binding = binding;
             layoutBinding.descriptorCount = count;
             layoutBinding.descriptorType = DescriptorType::StorageBuffer;
-            shader->m_LayoutBindings.push_back(layoutBinding);
+            reflection.LayoutBindings.push_back(layoutBinding);
         }
 
         for (const auto& resource : resources.separate_images)
@@ -146,7 +200,7 @@ namespace Arc
             layoutBinding.binding = binding;
             layoutBinding.descriptorCount = count;
             layoutBinding.descriptorType = DescriptorType::SampledImage;
-            shader->m_LayoutBindings.push_back(layoutBinding);
+            reflection.LayoutBindings.push_back(layoutBinding);
         }
 
         for (const auto& resource : resources.storage_images)
@@ -164,7 +218,7 @@ namespace Arc
             layoutBinding.binding = binding;
             layoutBinding.descriptorCount = count;
             layoutBinding.descriptorType = DescriptorType::StorageImage;
-            shader->m_LayoutBindings.push_back(layoutBinding);
+            reflection.LayoutBindings.push_back(layoutBinding);
         }
 
         for (const auto& resource : resources.separate_samplers)
@@ -182,7 +236,7 @@ namespace Arc
             layoutBinding.binding = binding;
             layoutBinding.descriptorCount = count;
             layoutBinding.descriptorType = DescriptorType::Sampler;
-            shader->m_LayoutBindings.push_back(layoutBinding);
+            reflection.LayoutBindings.push_back(layoutBinding);
         }
 
         for (const auto& resource : resources.acceleration_structures)
@@ -200,19 +254,179 @@ namespace Arc
             layoutBinding.binding = binding;
             layoutBinding.descriptorCount = count;
             layoutBinding.descriptorType = DescriptorType::AccelerationStructure;
-            shader->m_LayoutBindings.push_back(layoutBinding);
+            reflection.LayoutBindings.push_back(layoutBinding);
         }
-
-        m_Resources[shader] = ResourceType::Shader;
-	}
+    }
 
     void ResourceCache::ReleaseResource(Shader* shader)
     {
-        if (!m_Resources.contains(shader))
+        if (!UnregisterResource(m_Shaders, shader))
         {
             ARC_LOG_FATAL("Cannot find Shader resource to release!");
+            return;
+        }
+
+        if (shader->m_SpirVHash)
+        {
+            auto it = m_ShaderCache.find(shader->m_SpirVHash);
+            if (it != m_ShaderCache.end() && it->second.Module == shader->m_Module)
+            {
+                // The reflection stays cached so recreating the same shader skips spirv_cross
+                if (--it->second.ModuleRefCount > 0)
+                    return;
+                it->second.Module = nullptr;
+            }
+        }
+
+        DeferRelease([this, module = shader->m_Module]() {
+            vkDestroyShaderModule((VkDevice)m_LogicalDevice, (VkShaderModule)module, nullptr);
+        });
+    }
+
+    // Reflection results only, modules are always created from the SPIR-V passed to CreateShader
+    struct ShaderCacheFileHeader
+    {
+        uint32_t Magic;
+        uint32_t Version;
+        uint64_t DataSize;
+        uint64_t DataHash;
+    };
+    static constexpr uint32_t ShaderCacheMagic = 0x43534341; // "ACSC"
+    // Bump when the reflection in ReflectShader changes
+    static constexpr uint32_t ShaderCacheVersion = 1;
+
+    template<typename T>
+    static void WriteValue(std::vector<uint8_t>& data, const T& value)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+        data.insert(data.end(), bytes, bytes + sizeof(T));
+    }
+
+    template<typename T>
+    static bool ReadValue(const std::vector<uint8_t>& data, size_t& offset, T& value)
+    {
+        if (offset + sizeof(T) > data.size())
+            return false;
+        memcpy(&value, data.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    void ResourceCache::LoadShaderCache(const std::string& filePath)
+    {
+        std::ifstream file(filePath, std::ios::in | std::ios::binary);
+        ShaderCacheFileHeader header = {};
+        if (!file || !file.read((char*)&header, sizeof(header)))
+            return;
+        if (header.Magic != ShaderCacheMagic || header.Version != ShaderCacheVersion)
+        {
+            ARC_LOG("Shader cache {} was written by another version, shaders are reflected from scratch", filePath);
+            return;
+        }
+
+        // A corrupted size must not turn into a huge allocation
+        std::error_code error;
+        uint64_t fileSize = std::filesystem::file_size(filePath, error);
+        if (error || header.DataSize > fileSize - sizeof(header))
+        {
+            ARC_LOG_WARNING("Shader cache {} is corrupted, shaders are reflected from scratch!", filePath);
+            return;
+        }
+
+        std::vector<uint8_t> data(header.DataSize);
+        if (!file.read((char*)data.data(), data.size()) || HashBytes(data.data(), data.size()) != header.DataHash)
+        {
+            ARC_LOG_WARNING("Shader cache {} is corrupted, shaders are reflected from scratch!", filePath);
+            return;
+        }
+
+        size_t offset = 0;
+        uint32_t entryCount = 0;
+        ReadValue(data, offset, entryCount);
+        for (uint32_t i = 0; i < entryCount; i++)
+        {
+            uint64_t hash = 0;
+            ShaderCacheEntry entry;
+            uint32_t bindingCount = 0;
+            bool valid = ReadValue(data, offset, hash) &&
+                ReadValue(data, offset, entry.CheckHash) &&
+                ReadValue(data, offset, entry.WordCount) &&
+                ReadValue(data, offset, entry.Reflection.PushConstantSize) &&
+                ReadValue(data, offset, entry.Reflection.StageOutputs) &&
+                ReadValue(data, offset, bindingCount);
+
+            entry.Reflection.LayoutBindings.resize(valid ? bindingCount : 0);
+            for (auto& binding : entry.Reflection.LayoutBindings)
+            {
+                valid = valid && ReadValue(data, offset, binding.setIndex) &&
+                    ReadValue(data, offset, binding.binding) &&
+                    ReadValue(data, offset, binding.descriptorCount) &&
+                    ReadValue(data, offset, binding.descriptorType);
+            }
+            if (!valid)
+            {
+                ARC_LOG_WARNING("Shader cache {} is corrupted, shaders are reflected from scratch!", filePath);
+                m_ShaderCache.clear();
+                return;
+            }
+            m_ShaderCache.try_emplace(hash, std::move(entry));
+        }
+        ARC_LOG("Loaded shader cache {} ({} shaders)", filePath, entryCount);
+    }
+
+    void ResourceCache::SaveShaderCache(const std::string& filePath)
+    {
+        // Shaders that were edited or removed would otherwise stay in the file forever
+        uint32_t entryCount = 0;
+        for (auto& [hash, entry] : m_ShaderCache)
+            entryCount += entry.Used || entry.Module;
+
+        std::vector<uint8_t> data;
+        WriteValue(data, entryCount);
+        for (auto& [hash, entry] : m_ShaderCache)
+        {
+            if (!entry.Used && !entry.Module)
+                continue;
+            WriteValue(data, hash);
+            WriteValue(data, entry.CheckHash);
+            WriteValue(data, entry.WordCount);
+            WriteValue(data, entry.Reflection.PushConstantSize);
+            WriteValue(data, entry.Reflection.StageOutputs);
+            WriteValue(data, (uint32_t)entry.Reflection.LayoutBindings.size());
+            for (auto& binding : entry.Reflection.LayoutBindings)
+            {
+                WriteValue(data, binding.setIndex);
+                WriteValue(data, binding.binding);
+                WriteValue(data, binding.descriptorCount);
+                WriteValue(data, binding.descriptorType);
+            }
+        }
+
+        ShaderCacheFileHeader header = {};
+        header.Magic = ShaderCacheMagic;
+        header.Version = ShaderCacheVersion;
+        header.DataSize = data.size();
+        header.DataHash = HashBytes(data.data(), data.size());
+
+        std::filesystem::path path = filePath;
+        std::filesystem::path tempPath = path;
+        tempPath += ".tmp";
+        std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)data.data(), data.size());
+        file.close();
+        if (!file)
+        {
+            ARC_LOG_ERROR("Failed to write shader cache {}!", tempPath.string());
+            return;
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, path, error);
+        if (error)
+        {
+            ARC_LOG_ERROR("Failed to replace shader cache {}: {}", filePath, error.message());
+            std::filesystem::remove(tempPath, error);
         }
-        vkDestroyShaderModule((VkDevice)m_LogicalDevice, (VkShaderModule)shader->m_Module, nullptr);
-        m_Resources.erase(shader);
     }
 }
\ No newline at end of file
@@ -45,6 +45,22 @@ namespace Arc
             instances[i] = instance;
         }
 
+        // Rebuilding replaces every object, frames in flight may still trace against the old ones
+        if (m_Handle || m_InstanceBuffer)
+        {
+            m_Device->GetResourceCache()->DeferRelease([logicalDevice = m_LogicalDevice, allocator = m_Allocator, handle = m_Handle, buffer = m_Buffer,
+                allocation = m_Allocation, instanceBuffer = m_InstanceBuffer, instanceAllocation = m_InstanceAllocation]() {
+                vkDestroyAccelerationStructureKHR((VkDevice)logicalDevice, (VkAccelerationStructureKHR)handle, nullptr);
+                vmaDestroyBuffer((VmaAllocator)allocator, (VkBuffer)buffer, (VmaAllocation)allocation);
+                vmaDestroyBuffer((VmaAllocator)allocator, (VkBuffer)instanceBuffer, (VmaAllocation)instanceAllocation);
+            });
+            m_Handle = nullptr;
+            m_Buffer = nullptr;
+            m_Allocation = nullptr;
+            m_InstanceBuffer = nullptr;
+            m_InstanceAllocation = nullptr;
+        }
+
         VkBuffer instanceBuffer;
         VmaAllocation instanceBufferAllocation;
         {
@@ -200,20 +216,22 @@ namespace Arc
         topLevelAS->m_LogicalDevice = m_LogicalDevice;
         topLevelAS->m_Allocator = m_Allocator;
 
-        m_Resources[topLevelAS] = ResourceType::TopLevelAS;
+        RegisterResource(m_TopLevelAS, topLevelAS, desc);
     }
 
     void ResourceCache::ReleaseResource(TopLevelAS* topLevelAS)
     {
-        if (!m_Resources.contains(topLevelAS))
+        if (!UnregisterResource(m_TopLevelAS, topLevelAS))
         {
             ARC_LOG_FATAL("Cannot find TopLevelAS resource to release!");
+            return;
         }
 
-        vkDestroyAccelerationStructureKHR((VkDevice)m_LogicalDevice, (VkAccelerationStructureKHR)topLevelAS->m_Handle, nullptr);
-        vmaDestroyBuffer((VmaAllocator)m_Allocator, (VkBuffer)topLevelAS->m_Buffer, (VmaAllocation)topLevelAS->m_Allocation);
-        vmaDestroyBuffer((VmaAllocator)m_Allocator, (VkBuffer)topLevelAS->m_InstanceBuffer, (VmaAllocation)topLevelAS->m_InstanceAllocation);
-
-        m_Resources.erase(topLevelAS);
+        DeferRelease([this, handle = topLevelAS->m_Handle, buffer = topLevelAS->m_Buffer, allocation = topLevelAS->m_Allocation,
+            instanceBuffer = topLevelAS->m_InstanceBuffer, instanceAllocation = topLevelAS->m_InstanceAllocation]() {
+            vkDestroyAccelerationStructureKHR((VkDevice)m_LogicalDevice, (VkAccelerationStructureKHR)handle, nullptr);
+            vmaDestroyBuffer((VmaAllocator)m_Allocator, (VkBuffer)buffer, (VmaAllocation)allocation);
+            vmaDestroyBuffer((VmaAllocator)m_Allocator, (VkBuffer)instanceBuffer, (VmaAllocation)instanceAllocation);
+        });
     }
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "ShaderCompiler.h"
 #include "ArcaneEngine/Core/Log.h"
+#include <algorithm>
 #include <fstream>
 #include <filesystem>
 
@@ -90,6 +91,24 @@ namespace Arc::ShaderCompiler
 		return CompileFromSource(dataText, shaderStage, shaderDesc, filePath);
 	}
 
+	bool Compile(ArrayView<std::string> filePaths, std::vector<ShaderDesc>& shaderDescs, ThreadPool& threadPool)
+	{
+		shaderDescs.clear();
+		shaderDescs.resize(filePaths.size());
+		std::vector<uint8_t> succeeded(filePaths.size(), 0);
+
+		for (size_t i = 0; i < filePaths.size(); i++)
+		{
+			const std::string* filePath = &filePaths[i];
+			ShaderDesc* shaderDesc = &shaderDescs[i];
+			uint8_t* result = &succeeded[i];
+			threadPool.Submit([filePath, shaderDesc, result]() { *result = Compile(*filePath, *shaderDesc); });
+		}
+		threadPool.Wait();
+
+		return std::find(succeeded.begin(), succeeded.end(), 0) == succeeded.end();
+	}
+
 	bool CompileFromSource(const std::string& source, ShaderStage shaderStage, ShaderDesc& shaderDesc, const std::string& debugName)
 	{	
 		shaderc::Compiler compiler;
@@ -1,9 +1,14 @@
 #pragma once
 #include "ArcaneEngine/Graphics/VulkanObjects/Shader.h"
+#include "ArcaneEngine/Core/ArrayView.h"
+#include "ArcaneEngine/Core/ThreadPool.h"
 #include <string>
+#include <vector>
 
 namespace Arc::ShaderCompiler
 {
 	bool Compile(const std::string& filePath, ShaderDesc& shaderDesc);
 	bool CompileFromSource(const std::string& source, ShaderStage shaderStage, ShaderDesc& shaderDesc, const std::string& debugName);
+	// Compiles the files in parallel, every call uses its own shaderc compiler. Returns false if any file failed, its desc is left empty
+	bool Compile(ArrayView<std::string> filePaths, std::vector<ShaderDesc>& shaderDescs, ThreadPool& threadPool);
 }
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "UniformAllocator.h"
+#include "Device.h"
+#include "VulkanCore/VulkanLocal.h"
+#include "ArcaneEngine/Core/Log.h"
+#include <vulkan/vulkan_core.h>
+#include <algorithm>
+
+namespace Arc
+{
+	UniformAllocator::UniformAllocator(Device* device, uint32_t frameSize)
+	{
+		if (!device)
+		{
+			ARC_LOG_FATAL("Failed to create UniformAllocator object: Device pointer is not valid!");
+		}
+		m_ResourceCache = device->GetResourceCache();
+
+		// One alignment for both kinds of descriptors, so every allocation can be bound as either
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties((VkPhysicalDevice)device->GetPhysicalDevice(), &properties);
+		m_Alignment = (uint32_t)std::max(properties.limits.minUniformBufferOffsetAlignment, properties.limits.minStorageBufferOffsetAlignment);
+		m_FrameSize = frameSize;
+
+		m_ResourceCache->CreateGpuBufferArray(&m_Buffers, GpuBufferDesc{
+			.Size = frameSize,
+			.UsageFlags = BufferUsage::UniformBuffer | BufferUsage::StorageBuffer | BufferUsage::ShaderDeviceAddress,
+			.MemoryProperty = MemoryProperty::HostVisible,
+			.PersistentMapping = true,
+			.EngineOwned = true,
+			.DebugName = "UniformAllocator",
+		});
+
+		uint32_t framesInFlight = device->GetFramesInFlightCount();
+		m_Offsets = std::make_unique<std::atomic<uint32_t>[]>(framesInFlight);
+		m_DeviceAddresses.resize(framesInFlight);
+		for (uint32_t i = 0; i < framesInFlight; i++)
+		{
+			VkBufferDeviceAddressInfo addressInfo = { VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO };
+			addressInfo.buffer = (VkBuffer)m_Buffers.GetHandle(i);
+			m_DeviceAddresses[i] = vkGetBufferDeviceAddress((VkDevice)device->GetLogicalDevice(), &addressInfo);
+		}
+	}
+
+	UniformAllocator::~UniformAllocator()
+	{
+		m_ResourceCache->ReleaseResource(&m_Buffers);
+	}
+
+	void UniformAllocator::BeginFrame(uint32_t frameIndex)
+	{
+		m_Offsets[frameIndex].store(0, std::memory_order_relaxed);
+	}
+
+	void UniformAllocator::Flush(uint32_t frameIndex)
+	{
+		uint32_t usedSize = GetUsedSize(frameIndex);
+		if (usedSize > 0)
+			m_ResourceCache->FlushMemory(&m_Buffers, frameIndex, 0, usedSize);
+	}
+
+	UniformAllocation UniformAllocator::Allocate(uint32_t frameIndex, uint32_t size)
+	{
+		// Sizes are rounded up to the alignment, so every offset handed out stays aligned
+		uint32_t alignedSize = (size + m_Alignment - 1) & ~(m_Alignment - 1);
+		if (size > m_FrameSize || alignedSize > m_FrameSize)
+		{
+			ARC_LOG_ERROR("UniformAllocator cannot allocate {} bytes from a {} byte frame!", size, m_FrameSize);
+			return {};
+		}
+		uint32_t offset = m_Offsets[frameIndex].fetch_add(alignedSize, std::memory_order_relaxed);
+		if (offset > m_FrameSize - alignedSize)
+		{
+			// Later allocations of the frame fail as well, the offset is only reset by BeginFrame
+			m_Offsets[frameIndex].store(m_FrameSize, std::memory_order_relaxed);
+			ARC_LOG_ERROR("UniformAllocator is out of space, {} bytes requested with {} of {} bytes used!", size, std::min(offset, m_FrameSize), m_FrameSize);
+			return {};
+		}
+
+		return UniformAllocation{
+			.Buffer = m_Buffers.GetHandle(frameIndex),
+			.Offset = offset,
+			.Size = size,
+			.Data = (uint8_t*)m_Buffers.GetMappedData(frameIndex) + offset,
+			.DeviceAddress = m_DeviceAddresses[frameIndex] + offset,
+		};
+	}
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+#include "VulkanCore/VulkanHandles.h"
+#include "VulkanObjects/GpuBuffer.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace Arc
+{
+	struct UniformAllocation
+	{
+		BufferHandle Buffer = nullptr;
+		uint32_t Offset = 0;
+		uint32_t Size = 0;
+		void* Data = nullptr;
+		uint64_t DeviceAddress = 0;
+	};
+
+	class Device;
+	class ResourceCache;
+	// Suballocates per frame constants from one persistently mapped buffer per frame in flight.
+	// Allocations are bound with PushBufferWrite offsets or read through their device address, they are valid until the frame index comes around again
+	class UniformAllocator
+	{
+	public:
+		UniformAllocator(Device* device, uint32_t frameSize);
+		~UniformAllocator();
+
+		// Called by the PresentQueue after waiting for the fence of the frame, all allocations of that frame are reused
+		void BeginFrame(uint32_t frameIndex);
+		// Called by the PresentQueue before submitting the frame, flushes the used range when the memory is not host coherent
+		void Flush(uint32_t frameIndex);
+
+		// Returns an empty allocation if the frame has run out of space. Safe to call from pass recording threads,
+		// the offset of the frame is advanced with an atomic add
+		UniformAllocation Allocate(uint32_t frameIndex, uint32_t size);
+		template<typename T>
+		UniformAllocation Upload(uint32_t frameIndex, const T& data)
+		{
+			UniformAllocation allocation = Allocate(frameIndex, sizeof(T));
+			if (allocation.Data)
+				memcpy(allocation.Data, &data, sizeof(T));
+			return allocation;
+		}
+
+		uint32_t GetUsedSize(uint32_t frameIndex) { return std::min(m_Offsets[frameIndex].load(std::memory_order_relaxed), m_FrameSize); }
+		uint32_t GetFrameSize() { return m_FrameSize; }
+
+	private:
+		ResourceCache* m_ResourceCache;
+		GpuBufferArray m_Buffers;
+		std::vector<uint64_t> m_DeviceAddresses;
+		// Can run past the frame size once the frame is out of space
+		std::unique_ptr<std::atomic<uint32_t>[]> m_Offsets;
+		uint32_t m_FrameSize;
+		uint32_t m_Alignment;
+	};
+}
\ No newline at end of file
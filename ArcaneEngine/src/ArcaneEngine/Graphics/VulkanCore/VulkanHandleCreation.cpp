@@ -2,6 +2,7 @@
 #include <vulkan/vulkan_core.h>
 #include <vector>
 #include <set>
+#include <cstring>
 #include "ArcaneEngine/Core/Log.h"
 #include "VulkanLocal.h"
 
@@ -181,7 +182,8 @@ namespace Arc
 
         queueIndices.GraphicsIndex = uint32_t(-1);
         queueIndices.PresentIndex = uint32_t(-1);
-        //queueIndices.TransferIndex = uint32_t(-1);
+        queueIndices.ComputeIndex = uint32_t(-1);
+        queueIndices.TransferIndex = uint32_t(-1);
 
         uint32_t queueFamilyCount = 0;
         vkGetPhysicalDeviceQueueFamilyProperties((VkPhysicalDevice)info.physicalDevice, &queueFamilyCount, nullptr);
@@ -210,28 +212,34 @@ namespace Arc
 
             i++;
         }
-        /*
+
         i = 0;
         for (VkQueueFamilyProperties& queueFamily : queueFamilies)
         {
-            if (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT)
+            VkQueueFlags flags = queueFamily.queueFlags;
+            if (queueIndices.ComputeIndex == uint32_t(-1) && (flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+            {
+                // Dedicated compute queue
+                queueIndices.ComputeIndex = i;
+            }
+            if (queueIndices.TransferIndex == uint32_t(-1) && (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
             {
+                // Dedicated transfer queue
                 queueIndices.TransferIndex = i;
-
-                if (queueFamily.queueFlags - VK_QUEUE_TRANSFER_BIT == 0)
-                {
-                    // Dedicated transfer queue
-                    break;
-                }
             }
             i++;
-        }*/
+        }
 
         if (queueIndices.GraphicsIndex == uint32_t(-1))
         {
             ARC_LOG("Failed to find queue family indices with VK_QUEUE_GRAPHICS_BIT!");
         }
 
+        if (queueIndices.ComputeIndex == uint32_t(-1))
+            queueIndices.ComputeIndex = queueIndices.GraphicsIndex;
+        if (queueIndices.TransferIndex == uint32_t(-1))
+            queueIndices.TransferIndex = queueIndices.GraphicsIndex;
+
         return queueIndices;
     }
 
@@ -243,14 +251,35 @@ namespace Arc
     PFN_vkCmdBuildAccelerationStructuresKHR     vkCmdBuildAccelerationStructuresKHR = nullptr;
     PFN_vkGetAccelerationStructureBuildSizesKHR vkGetAccelerationStructureBuildSizesKHR = nullptr;
     PFN_vkGetAccelerationStructureDeviceAddressKHR vkGetAccelerationStructureDeviceAddressKHR = nullptr;
+    // Null unless the instance was created with VK_EXT_debug_utils
+    PFN_vkSetDebugUtilsObjectNameEXT            vkSetDebugUtilsObjectNameEXT = nullptr;
 
 #define VK_LOAD_DEVICE_FUNC(name) \
     name = reinterpret_cast<PFN_##name>(vkGetDeviceProcAddr(device, #name))
 
+    bool IsDeviceExtensionSupported(PhysicalDeviceHandle physicalDevice, const char* extensionName)
+    {
+        uint32_t extensionCount = 0;
+        vkEnumerateDeviceExtensionProperties((VkPhysicalDevice)physicalDevice, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties((VkPhysicalDevice)physicalDevice, nullptr, &extensionCount, extensions.data());
+        for (const auto& extension : extensions)
+        {
+            if (strcmp(extension.extensionName, extensionName) == 0)
+                return true;
+        }
+        return false;
+    }
+
     DeviceHandle CreateLogicalDeviceHandle(DeviceCreateInfo& info)
     {
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = { info.queueFamilyIndices.GraphicsIndex, info.queueFamilyIndices.PresentIndex };
+        std::set<uint32_t> uniqueQueueFamilies = {
+            info.queueFamilyIndices.GraphicsIndex,
+            info.queueFamilyIndices.PresentIndex,
+            info.queueFamilyIndices.ComputeIndex,
+            info.queueFamilyIndices.TransferIndex
+        };
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -272,9 +301,16 @@ namespace Arc
         features_1_2.bufferDeviceAddress = VK_TRUE;
         features_1_2.descriptorIndexing = VK_TRUE;
         features_1_2.hostQueryReset = VK_TRUE;
+        features_1_2.timelineSemaphore = VK_TRUE;
         features_1_2.scalarBlockLayout = VK_TRUE;
         features_1_2.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        features_1_2.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        features_1_2.descriptorBindingStorageImageUpdateAfterBind = VK_TRUE;
+        features_1_2.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
         features_1_2.descriptorBindingPartiallyBound = VK_TRUE;
+        features_1_2.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        features_1_2.shaderStorageImageArrayNonUniformIndexing = VK_TRUE;
+        features_1_2.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
         features_1_2.runtimeDescriptorArray = VK_TRUE;
 
         VkPhysicalDeviceVulkan13Features features_1_3 = {};
@@ -308,6 +344,9 @@ namespace Arc
             VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME,
             VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME
         };
+        // Optional, VMA estimates the budgets without it
+        if (IsDeviceExtensionSupported(info.physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+            deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
 
         VkDeviceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -328,6 +367,7 @@ namespace Arc
         VK_LOAD_DEVICE_FUNC(vkCmdBuildAccelerationStructuresKHR);
         VK_LOAD_DEVICE_FUNC(vkGetAccelerationStructureBuildSizesKHR);
         VK_LOAD_DEVICE_FUNC(vkGetAccelerationStructureDeviceAddressKHR);
+        VK_LOAD_DEVICE_FUNC(vkSetDebugUtilsObjectNameEXT);
 
         return device;
     }
@@ -497,7 +537,7 @@ namespace Arc
     {
         VkCommandBufferAllocateInfo allocInfo = {};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.level = info.secondary ? VK_COMMAND_BUFFER_LEVEL_SECONDARY : VK_COMMAND_BUFFER_LEVEL_PRIMARY;
         allocInfo.commandPool = (VkCommandPool)info.commandPool;
         allocInfo.commandBufferCount = static_cast<uint32_t>(1);
 
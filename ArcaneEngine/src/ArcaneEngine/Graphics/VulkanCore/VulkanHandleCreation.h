@@ -56,6 +56,7 @@ namespace Arc
 		QueueFamilyIndices queueFamilyIndices = {};
 	};
 	DeviceHandle CreateLogicalDeviceHandle(DeviceCreateInfo& info);
+	bool IsDeviceExtensionSupported(PhysicalDeviceHandle physicalDevice, const char* extensionName);
 
 	struct SwapchainCreateInfo
 	{
@@ -88,6 +89,7 @@ namespace Arc
 	{
 		DeviceHandle logicalDevice = {};
 		CommandPoolHandle commandPool = {};
+		bool secondary = false;
 	};
 	CommandBufferHandle CreateCommandBufferHandle(CommandBufferCreateInfo& info);
 
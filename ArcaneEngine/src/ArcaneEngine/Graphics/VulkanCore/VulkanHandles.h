@@ -32,6 +32,9 @@ namespace Arc
 	ARC_DEFINE_HANDLE(QueueHandle)
 	ARC_DEFINE_HANDLE(AllocatorHandle)
 	ARC_DEFINE_HANDLE(AllocationHandle)
+	ARC_DEFINE_HANDLE(VirtualBlockHandle)
+	ARC_DEFINE_NON_DISPATCHABLE_HANDLE(VirtualAllocationHandle)
+	ARC_DEFINE_HANDLE(DefragmentationContextHandle)
 	ARC_DEFINE_NON_DISPATCHABLE_HANDLE(SemaphoreHandle)
 	ARC_DEFINE_HANDLE(CommandBufferHandle)
 	ARC_DEFINE_NON_DISPATCHABLE_HANDLE(FenceHandle)
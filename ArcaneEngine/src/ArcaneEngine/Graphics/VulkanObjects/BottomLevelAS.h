@@ -1,7 +1,9 @@
 #pragma once
 #include "ArcaneEngine/Graphics/VulkanCore/VulkanHandles.h"
+#include "ArcaneEngine/Core/HandlePool.h"
 #include "ArcaneEngine/Graphics/Common.h"
 #include <vector>
+#include <source_location>
 
 namespace Arc
 {
@@ -9,9 +11,14 @@ namespace Arc
 	{
 		BufferHandle VertexBuffer = nullptr;
 		BufferHandle IndexBuffer = nullptr;
+		// Byte offsets of the geometry in shared buffers, see GeometryAllocator
+		uint64_t VertexBufferOffset = 0;
+		uint64_t IndexBufferOffset = 0;
 		uint32_t VertexStride = 0;
 		uint32_t NumTriangles = 0;
 		Format VertexFormat = Format::Undefined;
+		const char* DebugName = nullptr;
+		std::source_location Location = std::source_location::current();
 	};
 
 	typedef uint64_t BottomLevelASHandle;
@@ -25,6 +32,9 @@ namespace Arc
 		uint64_t m_DeviceAddress{};
 		BufferHandle m_Buffer{};
 		AllocationHandle m_Allocation{};
+		Handle<BottomLevelAS> m_CacheHandle;
+		const char* m_DebugName = nullptr;
+		std::source_location m_Location;
 
 		friend class ResourceCache;
 	};
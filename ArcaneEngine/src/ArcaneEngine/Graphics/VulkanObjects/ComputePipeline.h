@@ -1,6 +1,9 @@
 #pragma once
 #include "ArcaneEngine/Graphics/VulkanCore/VulkanHandles.h"
+#include "ArcaneEngine/Core/HandlePool.h"
 #include "ArcaneEngine/Graphics/VulkanObjects/Shader.h"
+#include <source_location>
+#include <vector>
 
 namespace Arc
 {
@@ -8,6 +11,10 @@ namespace Arc
 	{
 		Shader* Shader = nullptr;
 		bool UsePushDescriptors = false;
+		// Sets that use push descriptors while the other sets are bound, ignored with UsePushDescriptors
+		std::vector<uint32_t> PushDescriptorSets = {};
+		const char* DebugName = nullptr;
+		std::source_location Location = std::source_location::current();
 	};
 
 	class ComputePipeline
@@ -19,6 +26,9 @@ namespace Arc
 	private:
 		PipelineHandle m_Pipeline;
 		PipelineLayoutHandle m_PipelineLayout;
+		Handle<ComputePipeline> m_CacheHandle;
+		const char* m_DebugName = nullptr;
+		std::source_location m_Location;
 
 		friend class ResourceCache;
 	};
@@ -98,5 +98,6 @@ namespace Arc
 
 		friend class Device;
 		friend class CommandBuffer;
+		friend class ResourceCache;
 	};
 }
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 #include "ArcaneEngine/Graphics/VulkanCore/VulkanHandles.h"
+#include "ArcaneEngine/Core/HandlePool.h"
 #include "ArcaneEngine/Graphics/Common.h"
+#include <span>
 #include <vector>
+#include <source_location>
 
 namespace Arc
 {
@@ -10,6 +13,15 @@ namespace Arc
 		uint32_t Size;
 		BufferUsage UsageFlags;
 		MemoryProperty MemoryProperty;
+		// Keeps host visible memory mapped for the lifetime of the buffer, writes to non-coherent memory need ResourceCache::FlushMemory
+		bool PersistentMapping = false;
+		// Owned by an engine system that outlives the renderers, FreeResources leaves it for its owner to release
+		bool EngineOwned = false;
+		// Adds transfer usage so defragmentation can copy the buffer into new memory. Only device local buffers without a device
+		// address or acceleration structure storage usage can move, other buffers are never moved
+		bool Movable = false;
+		const char* DebugName = nullptr;
+		std::source_location Location = std::source_location::current();
 	};
 
 	class GpuBuffer
@@ -17,11 +29,27 @@ namespace Arc
 	public:
 		BufferHandle GetHandle() { return m_Buffer; }
 		uint32_t GetSize() { return m_Size; }
+		// Index into BindlessBinding::StorageBuffer of the bindless heap, storage buffers only
+		uint32_t GetBindlessIndex() { return m_BindlessIndex; }
+		// Only valid for buffers created with PersistentMapping
+		void* GetMappedData() { return m_MappedData; }
+		template<typename T>
+		std::span<T> GetMappedSpan() { return { static_cast<T*>(m_MappedData), m_MappedData ? m_Size / sizeof(T) : 0 }; }
 
 	private:
 		BufferHandle m_Buffer;
 		AllocationHandle m_Allocation;
 		uint32_t m_Size;
+		void* m_MappedData = nullptr;
+		bool m_HostCoherent = true;
+		BufferUsage m_UsageFlags = {};
+		// Created with GpuBufferDesc::Movable, defragmentation can give it a new buffer and memory
+		bool m_Movable = false;
+		bool m_EngineOwned = false;
+		uint32_t m_BindlessIndex = InvalidBindlessIndex;
+		Handle<GpuBuffer> m_CacheHandle;
+		const char* m_DebugName = nullptr;
+		std::source_location m_Location;
 		
 		friend class ResourceCache;
 	};
@@ -31,11 +59,21 @@ namespace Arc
 	public:
 		BufferHandle GetHandle(uint32_t frameIndex) { return m_Buffers[frameIndex]; }
 		uint32_t GetSize() { return m_Size; }
+		// Only valid for buffers created with PersistentMapping
+		void* GetMappedData(uint32_t frameIndex) { return m_MappedData.empty() ? nullptr : m_MappedData[frameIndex]; }
+		template<typename T>
+		std::span<T> GetMappedSpan(uint32_t frameIndex) { return { static_cast<T*>(GetMappedData(frameIndex)), m_MappedData.empty() ? 0 : m_Size / sizeof(T) }; }
 
 	private:
 		std::vector<BufferHandle> m_Buffers;
 		std::vector<AllocationHandle> m_Allocations;
 		uint32_t m_Size;
+		std::vector<void*> m_MappedData;
+		bool m_HostCoherent = true;
+		bool m_EngineOwned = false;
+		Handle<GpuBufferArray> m_CacheHandle;
+		const char* m_DebugName = nullptr;
+		std::source_location m_Location;
 
 		friend class ResourceCache;
 	};
@@ -1,6 +1,8 @@
 #pragma once
 #include "ArcaneEngine/Graphics/VulkanCore/VulkanHandles.h"
+#include "ArcaneEngine/Core/HandlePool.h"
 #include "ArcaneEngine/Graphics/Common.h"
+#include <source_location>
 
 namespace Arc
 {
@@ -11,6 +13,10 @@ namespace Arc
 		ImageUsage UsageFlags = {};
 		ImageAspect AspectFlags = ImageAspect::Color;
 		uint32_t MipLevels = 1;
+		// Adds transfer usage so defragmentation can copy the image into new memory, other images are never moved
+		bool Movable = false;
+		const char* DebugName = nullptr;
+		std::source_location Location = std::source_location::current();
 	};
 
 	class GpuImage
@@ -22,6 +28,9 @@ namespace Arc
 		Format GetFormat() { return m_Format; }
 		uint32_t* GetExtent() { return m_Extent; }
 		uint32_t GetMipLevels() { return m_MipLevels; }
+		// Indices into the bindless heap for images with Sampled or Storage usage. Sampled entries expect ShaderReadOnlyOptimal, storage entries General
+		uint32_t GetSampledIndex() { return m_SampledIndex; }
+		uint32_t GetStorageIndex() { return m_StorageIndex; }
 
 	private:
 		ImageHandle m_Image;
@@ -30,6 +39,14 @@ namespace Arc
 		Format m_Format;
 		uint32_t m_Extent[3];
 		uint32_t m_MipLevels;
+		ImageUsage m_UsageFlags = {};
+		ImageAspect m_AspectFlags = ImageAspect::Color;
+		bool m_Movable = false;
+		uint32_t m_SampledIndex = InvalidBindlessIndex;
+		uint32_t m_StorageIndex = InvalidBindlessIndex;
+		Handle<GpuImage> m_CacheHandle;
+		const char* m_DebugName = nullptr;
+		std::source_location m_Location;
 
 		friend class ResourceCache;
 	};
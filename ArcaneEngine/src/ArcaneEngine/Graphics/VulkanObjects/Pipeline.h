@@ -1,7 +1,9 @@
 #pragma once
 #include "ArcaneEngine/Graphics/VulkanCore/VulkanHandles.h"
+#include "ArcaneEngine/Core/HandlePool.h"
 #include "ArcaneEngine/Graphics/VulkanObjects/Shader.h"
 #include "ArcaneEngine/Graphics/VulkanObjects/VertexAttributes.h"
+#include <source_location>
 
 namespace Arc
 {
@@ -17,6 +19,8 @@ namespace Arc
 		std::vector<Format> ColorAttachmentFormats = {};
 		Format DepthAttachmentFormat = Format::Undefined;
 		bool UsePushDescriptors = false;
+		const char* DebugName = nullptr;
+		std::source_location Location = std::source_location::current();
 	};
 
 	class Pipeline
@@ -28,6 +32,9 @@ namespace Arc
 	private:
 		PipelineHandle m_Pipeline;
 		PipelineLayoutHandle m_PipelineLayout;
+		Handle<Pipeline> m_CacheHandle;
+		const char* m_DebugName = nullptr;
+		std::source_location m_Location;
 
 		friend class ResourceCache;
 	};
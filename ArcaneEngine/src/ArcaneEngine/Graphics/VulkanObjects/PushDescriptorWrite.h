@@ -4,7 +4,8 @@
 #include "GpuImage.h"
 #include "Sampler.h"
 #include "ArcaneEngine/Graphics/Common.h"
-#include <vector>
+#include "ArcaneEngine/Core/Log.h"
+#include <array>
 
 namespace Arc
 {
@@ -14,6 +15,7 @@ namespace Arc
 		DescriptorType Type = {};
 		BufferHandle Buffer = nullptr;
 		uint32_t Size = 0;
+		uint32_t Offset = 0;
 	};
 
 	struct PushImageWrite
@@ -32,29 +34,44 @@ namespace Arc
 		AccelerationStructureHandle AccelerationStructure = {};
 	};
 
+	// Writes are stored inline so building a push descriptor set every pass does not allocate
 	class PushDescriptorWrite
 	{
 	public:
+		static constexpr uint32_t MaxWrites = 16;
+
 		PushDescriptorWrite& AddWrite(const PushBufferWrite& write)
 		{
-			m_BufferWrites.push_back(write);
-			return *this;
+			return Add(m_BufferWrites, m_BufferWriteCount, write);
 		}
 		PushDescriptorWrite& AddWrite(const PushImageWrite& write)
 		{
-			m_ImageWrites.push_back(write);
-			return *this;
+			return Add(m_ImageWrites, m_ImageWriteCount, write);
 		}
 		PushDescriptorWrite& AddWrite(const PushAccelerationStructureWrite& write)
 		{
-			m_AccelerationStructureWrites.push_back(write);
-			return *this;
+			return Add(m_AccelerationStructureWrites, m_AccelerationStructureWriteCount, write);
 		}
 
 	private:
-		std::vector<PushBufferWrite> m_BufferWrites;
-		std::vector<PushImageWrite> m_ImageWrites;
-		std::vector<PushAccelerationStructureWrite> m_AccelerationStructureWrites;
+		template<typename T>
+		PushDescriptorWrite& Add(std::array<T, MaxWrites>& writes, uint32_t& count, const T& write)
+		{
+			if (count == MaxWrites)
+			{
+				ARC_LOG_ERROR("Push descriptor write exceeds {} writes of one type, binding {} is ignored!", MaxWrites, write.Binding);
+				return *this;
+			}
+			writes[count++] = write;
+			return *this;
+		}
+
+		std::array<PushBufferWrite, MaxWrites> m_BufferWrites;
+		std::array<PushImageWrite, MaxWrites> m_ImageWrites;
+		std::array<PushAccelerationStructureWrite, MaxWrites> m_AccelerationStructureWrites;
+		uint32_t m_BufferWriteCount = 0;
+		uint32_t m_ImageWriteCount = 0;
+		uint32_t m_AccelerationStructureWriteCount = 0;
 
 		friend class Device;
 		friend class CommandBuffer;
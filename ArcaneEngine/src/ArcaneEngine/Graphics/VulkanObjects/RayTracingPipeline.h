@@ -1,7 +1,9 @@
 #pragma once
 #include "ArcaneEngine/Graphics/VulkanCore/VulkanHandles.h"
+#include "ArcaneEngine/Core/HandlePool.h"
 #include "ArcaneEngine/Graphics/VulkanObjects/Shader.h"
 #include "ArcaneEngine/Graphics/VulkanObjects/VertexAttributes.h"
+#include <source_location>
 
 namespace Arc
 {
@@ -9,6 +11,8 @@ namespace Arc
 	{
 		std::vector<Shader*> ShaderStages = {};
 		std::vector<uint32_t> PushDescriptorSets = {};
+		const char* DebugName = nullptr;
+		std::source_location Location = std::source_location::current();
 	};
 
 	class RayTracingPipeline
@@ -37,6 +41,9 @@ namespace Arc
 		StridedDeviceAddressRegion m_RayGenShaderBindingTable;
 		StridedDeviceAddressRegion m_RayMissShaderBindingTable;
 		StridedDeviceAddressRegion m_RayClosestHitShaderBindingTable;
+		Handle<RayTracingPipeline> m_CacheHandle;
+		const char* m_DebugName = nullptr;
+		std::source_location m_Location;
 
 		friend class ResourceCache;
 	};
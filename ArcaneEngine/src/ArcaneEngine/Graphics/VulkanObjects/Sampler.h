@@ -1,6 +1,8 @@
 #pragma once
 #include "ArcaneEngine/Graphics/VulkanCore/VulkanHandles.h"
+#include "ArcaneEngine/Core/HandlePool.h"
 #include "ArcaneEngine/Graphics/Common.h"
+#include <source_location>
 
 namespace Arc
 {
@@ -9,14 +11,22 @@ namespace Arc
 		Filter MinFilter = Filter::Linear;
 		Filter MagFilter = Filter::Linear;
 		SamplerAddressMode AddressMode = SamplerAddressMode::MirroredRepeat;
+		const char* DebugName = nullptr;
+		std::source_location Location = std::source_location::current();
 	};
 
 	class Sampler
 	{
 	public:
 		SamplerHandle GetHandle() { return m_Sampler; }
+		// Index into BindlessBinding::Sampler of the bindless heap
+		uint32_t GetBindlessIndex() { return m_BindlessIndex; }
 	private:
 		SamplerHandle m_Sampler;
+		uint32_t m_BindlessIndex = InvalidBindlessIndex;
+		Handle<Sampler> m_CacheHandle;
+		const char* m_DebugName = nullptr;
+		std::source_location m_Location;
 
 		friend class ResourceCache;
 	};
@@ -1,8 +1,10 @@
 #pragma once
 #include "ArcaneEngine/Graphics/VulkanCore/VulkanHandles.h"
+#include "ArcaneEngine/Core/HandlePool.h"
 #include "ArcaneEngine/Graphics/Common.h"
 #include <vector>
 #include <string>
+#include <source_location>
 
 namespace Arc
 {
@@ -11,6 +13,8 @@ namespace Arc
 		std::vector<uint32_t> SpirV = {};
 		std::string EntryPoint{ "main" };
 		ShaderStage ShaderStage = {};
+		const char* DebugName = nullptr;
+		std::source_location Location = std::source_location::current();
 	};
 
 	class Shader
@@ -36,6 +40,11 @@ namespace Arc
 			DescriptorType descriptorType;
 		};
 		std::vector<DescriptorLayoutBinding> m_LayoutBindings = {};
+		// Key into the ResourceCache shader cache, 0 if the module is not shared
+		uint64_t m_SpirVHash = 0;
+		Handle<Shader> m_CacheHandle;
+		const char* m_DebugName = nullptr;
+		std::source_location m_Location;
 
 		friend class ResourceCache;
 	};
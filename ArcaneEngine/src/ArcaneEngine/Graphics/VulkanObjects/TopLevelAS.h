@@ -1,8 +1,10 @@
 #pragma once
 #include "ArcaneEngine/Graphics/VulkanCore/VulkanHandles.h"
+#include "ArcaneEngine/Core/HandlePool.h"
 #include "ArcaneEngine/Graphics/VulkanObjects/BottomLevelAS.h"
 #include "ArcaneEngine/Graphics/Common.h"
 #include <vector>
+#include <source_location>
 
 namespace Arc
 {
@@ -15,7 +17,8 @@ namespace Arc
 
 	struct TopLevelASDesc
 	{
-
+		const char* DebugName = nullptr;
+		std::source_location Location = std::source_location::current();
 	};
 
 	class Device;
@@ -41,8 +44,11 @@ namespace Arc
 		BufferHandle m_Buffer{};
 		AllocationHandle m_Allocation{};
 
-		BufferHandle m_InstanceBuffer;
-		AllocationHandle m_InstanceAllocation;
+		BufferHandle m_InstanceBuffer{};
+		AllocationHandle m_InstanceAllocation{};
+		Handle<TopLevelAS> m_CacheHandle;
+		const char* m_DebugName = nullptr;
+		std::source_location m_Location;
 
 		friend class ResourceCache;
 	};